@@ -0,0 +1,870 @@
+#pragma once
+
+#include "logging.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace erl::common::serialization {
+
+    /**
+     * Serialization format of a stream.
+     * - kAuto: Serialization<T>::Write picks kBinaryContainer, readers detect the format.
+     * - kText: ASCII tokens interleaved with the payloads, see WriteTokens.
+     * - kBinaryContainer: a header, a section table and aligned payloads, see BinaryContainer.
+     * - kBinarySchema: kBinaryContainer, and Yamlable parameters whose members all support it
+     *   are written in the compact layout of WriteSchema instead of YAML. Readers older than
+     *   this layout cannot read such data, so it must be requested explicitly.
+     */
+    enum class Format {
+        kAuto = 0,
+        kText = 1,
+        kBinaryContainer = 2,
+        kBinarySchema = 3,
+    };
+
+    inline int
+    FormatIndex() {
+        static const int index = std::ios_base::xalloc();
+        return index;
+    }
+
+    /**
+     * Attach the serialization format to a stream. WriteTokens writes a binary container to
+     * streams marked with Format::kBinaryContainer or Format::kBinarySchema and text tokens
+     * otherwise.
+     */
+    inline void
+    SetFormat(std::ios_base &stream, const Format format) {
+        stream.iword(FormatIndex()) = static_cast<long>(format);
+    }
+
+    [[nodiscard]] inline Format
+    GetFormat(std::ios_base &stream) {
+        return static_cast<Format>(stream.iword(FormatIndex()));
+    }
+
+    /**
+     * 64-bit checksum computed incrementally. Four independent lanes of multiply-rotate rounds
+     * keep it well above disk bandwidth. Feeding the bytes in any number of pieces gives the same
+     * digest.
+     */
+    class Checksum64 {
+        static constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+        static constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr std::size_t kBlockSize = 32;
+
+        std::uint64_t m_lanes_[4] = {kPrime1 + kPrime2, kPrime2, 0, ~kPrime1};
+        char m_pending_[kBlockSize] = {};
+        std::size_t m_num_pending_ = 0;
+        std::uint64_t m_total_size_ = 0;
+
+    public:
+        void
+        Update(const char *data, std::size_t size) {
+            m_total_size_ += size;
+            if (m_num_pending_ > 0) {
+                const std::size_t n = std::min(size, kBlockSize - m_num_pending_);
+                std::memcpy(m_pending_ + m_num_pending_, data, n);
+                m_num_pending_ += n;
+                data += n;
+                size -= n;
+                if (m_num_pending_ < kBlockSize) { return; }
+                ProcessBlock(m_pending_);
+                m_num_pending_ = 0;
+            }
+            for (; size >= kBlockSize; data += kBlockSize, size -= kBlockSize) {
+                ProcessBlock(data);
+            }
+            std::memcpy(m_pending_, data, size);
+            m_num_pending_ = size;
+        }
+
+        [[nodiscard]] std::uint64_t
+        Digest() const {
+            std::uint64_t hash = m_total_size_;
+            for (const std::uint64_t lane: m_lanes_) { hash = Round(hash ^ lane, lane); }
+            std::size_t i = 0;
+            for (; i + 8 <= m_num_pending_; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, m_pending_ + i, 8);
+                hash = Round(hash, word);
+            }
+            for (; i < m_num_pending_; ++i) {
+                hash = Round(hash, static_cast<std::uint8_t>(m_pending_[i]));
+            }
+            hash ^= hash >> 33;
+            hash *= kPrime2;
+            hash ^= hash >> 29;
+            hash *= kPrime1;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+    private:
+        static std::uint64_t
+        Round(std::uint64_t acc, const std::uint64_t word) {
+            acc += word * kPrime2;
+            acc = (acc << 31) | (acc >> 33);
+            return acc * kPrime1;
+        }
+
+        void
+        ProcessBlock(const char *block) {
+            for (int lane = 0; lane < 4; ++lane) {
+                std::uint64_t word;
+                std::memcpy(&word, block + 8 * lane, 8);
+                m_lanes_[lane] = Round(m_lanes_[lane], word);
+            }
+        }
+    };
+
+    [[nodiscard]] inline std::uint64_t
+    Checksum(const char *data, const std::size_t size) {
+        Checksum64 checksum;
+        checksum.Update(data, size);
+        return checksum.Digest();
+    }
+
+    /**
+     * Read-only stream buffer over a memory range, seekable.
+     */
+    class MemoryStreamBuf : public std::streambuf {
+    public:
+        MemoryStreamBuf(const char *data, const std::size_t size) {
+            char *begin = const_cast<char *>(data);
+            setg(begin, begin, begin + size);
+        }
+
+    protected:
+        pos_type
+        seekoff(
+            const off_type off,
+            const std::ios_base::seekdir dir,
+            const std::ios_base::openmode which) override {
+            if (!(which & std::ios_base::in)) { return {off_type(-1)}; }
+            char *base = dir == std::ios_base::beg ? eback()
+                         : dir == std::ios_base::cur ? gptr()
+                                                     : egptr();
+            char *target = base + off;
+            if (target < eback() || target > egptr()) { return {off_type(-1)}; }
+            setg(eback(), target, egptr());
+            return {target - eback()};
+        }
+
+        pos_type
+        seekpos(const pos_type pos, const std::ios_base::openmode which) override {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+    };
+
+    class MemoryIStream : public std::istream {
+        MemoryStreamBuf m_buf_;
+
+    public:
+        MemoryIStream(const char *data, const std::size_t size)
+            : std::istream(nullptr),
+              m_buf_(data, size) {
+            rdbuf(&m_buf_);
+        }
+    };
+
+    /**
+     * Growable byte buffer made of chunks. Appending never moves the bytes written before, so
+     * large payloads are not copied again while they grow.
+     */
+    class ChunkedBuffer {
+        struct Chunk {
+            std::unique_ptr<char[]> data;
+            std::size_t size = 0;
+            std::size_t capacity = 0;
+        };
+
+        static constexpr std::size_t kMinChunkSize = 64 << 10;
+        static constexpr std::size_t kMaxChunkSize = 16 << 20;
+
+        std::vector<Chunk> m_chunks_{};
+        std::size_t m_size_ = 0;
+
+    public:
+        [[nodiscard]] std::size_t
+        Size() const {
+            return m_size_;
+        }
+
+        void
+        Append(const char *data, std::size_t size) {
+            while (size > 0) {
+                if (m_chunks_.empty() || m_chunks_.back().size == m_chunks_.back().capacity) {
+                    const std::size_t growth =
+                        m_chunks_.empty() ? kMinChunkSize
+                                          : std::min(2 * m_chunks_.back().capacity, kMaxChunkSize);
+                    const std::size_t capacity = std::max(growth, size);
+                    m_chunks_.push_back({std::unique_ptr<char[]>(new char[capacity]), 0, capacity});
+                }
+                Chunk &chunk = m_chunks_.back();
+                const std::size_t n = std::min(size, chunk.capacity - chunk.size);
+                std::memcpy(chunk.data.get() + chunk.size, data, n);
+                chunk.size += n;
+                m_size_ += n;
+                data += n;
+                size -= n;
+            }
+        }
+
+        /**
+         * Call func(data, size) for every chunk in order.
+         */
+        template<typename Func>
+        void
+        ForEachChunk(Func func) const {
+            for (const Chunk &chunk: m_chunks_) { func(chunk.data.get(), chunk.size); }
+        }
+    };
+
+    /**
+     * Write-only stream buffer appending to a ChunkedBuffer. tellp() reports the size.
+     */
+    class ChunkedStreamBuf : public std::streambuf {
+        ChunkedBuffer &m_buffer_;
+
+    public:
+        explicit ChunkedStreamBuf(ChunkedBuffer &buffer)
+            : m_buffer_(buffer) {}
+
+    protected:
+        int_type
+        overflow(const int_type ch) override {
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                const char c = traits_type::to_char_type(ch);
+                m_buffer_.Append(&c, 1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize
+        xsputn(const char *s, const std::streamsize n) override {
+            m_buffer_.Append(s, static_cast<std::size_t>(n));
+            return n;
+        }
+
+        pos_type
+        seekoff(
+            const off_type off,
+            const std::ios_base::seekdir dir,
+            const std::ios_base::openmode which) override {
+            if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out)) {
+                return {off_type(-1)};
+            }
+            return {static_cast<off_type>(m_buffer_.Size())};
+        }
+    };
+
+    class ChunkedOStream : public std::ostream {
+        ChunkedStreamBuf m_buf_;
+
+    public:
+        explicit ChunkedOStream(ChunkedBuffer &buffer)
+            : std::ostream(nullptr),
+              m_buf_(buffer) {
+            rdbuf(&m_buf_);
+        }
+    };
+
+    /**
+     * Write-only stream buffer forwarding to another stream buffer and adding every byte to the
+     * checksum. It cannot seek, so nested containers written through it are buffered.
+     */
+    class ChecksumStreamBuf : public std::streambuf {
+        std::streambuf *m_sink_;
+        Checksum64 m_checksum_{};
+        std::uint64_t m_size_ = 0;
+
+    public:
+        explicit ChecksumStreamBuf(std::streambuf *sink)
+            : m_sink_(sink) {}
+
+        [[nodiscard]] std::uint64_t
+        Size() const {
+            return m_size_;
+        }
+
+        [[nodiscard]] std::uint64_t
+        Digest() const {
+            return m_checksum_.Digest();
+        }
+
+    protected:
+        int_type
+        overflow(const int_type ch) override {
+            if (traits_type::eq_int_type(ch, traits_type::eof())) {
+                return traits_type::not_eof(ch);
+            }
+            const char c = traits_type::to_char_type(ch);
+            return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+        }
+
+        std::streamsize
+        xsputn(const char *s, const std::streamsize n) override {
+            const std::streamsize m = m_sink_->sputn(s, n);
+            if (m > 0) {
+                m_checksum_.Update(s, static_cast<std::size_t>(m));
+                m_size_ += static_cast<std::uint64_t>(m);
+            }
+            return m;
+        }
+
+        int
+        sync() override {
+            return m_sink_->pubsync();
+        }
+    };
+
+    /**
+     * Read-only stream buffer over a section of another stream buffer. Bytes are pulled from the
+     * source on demand, large reads go straight into the destination, and every byte pulled is
+     * added to the checksum. tellg() reports the position in the section.
+     */
+    class SectionStreamBuf : public std::streambuf {
+        std::streambuf *m_source_;
+        std::streampos m_base_;  // position of the section in the source
+        std::uint64_t m_length_;
+        std::uint64_t m_remaining_;  // bytes not pulled from the source yet
+        Checksum64 m_checksum_{};
+        bool m_seeked_ = false;  // the checksum has to be computed again if the reader seeks
+        char m_buffer_[4096];
+
+    public:
+        SectionStreamBuf(std::streambuf *source, const std::uint64_t length)
+            : m_source_(source),
+              m_base_(source->pubseekoff(0, std::ios_base::cur, std::ios_base::in)),
+              m_length_(length),
+              m_remaining_(length) {
+            setg(m_buffer_, m_buffer_, m_buffer_);
+        }
+
+        /**
+         * Pull the bytes that were not read and compute the checksum of the whole section.
+         * @param checksum The checksum.
+         * @return false if the source ends before the section.
+         */
+        [[nodiscard]] bool
+        Finish(std::uint64_t &checksum) {
+            setg(m_buffer_, m_buffer_, m_buffer_);
+            if (m_seeked_) {
+                m_checksum_ = {};
+                m_remaining_ = m_length_;
+                m_source_->pubseekpos(m_base_, std::ios_base::in);
+            }
+            while (m_remaining_ > 0) {
+                if (Pull(m_buffer_, sizeof(m_buffer_)) <= 0) { return false; }
+            }
+            checksum = m_checksum_.Digest();
+            return true;
+        }
+
+    protected:
+        int_type
+        underflow() override {
+            if (gptr() == egptr()) {
+                const std::streamsize n = Pull(m_buffer_, sizeof(m_buffer_));
+                if (n <= 0) { return traits_type::eof(); }
+                setg(m_buffer_, m_buffer_, m_buffer_ + n);
+            }
+            return traits_type::to_int_type(*gptr());
+        }
+
+        std::streamsize
+        xsgetn(char *s, const std::streamsize n) override {
+            std::streamsize copied = 0;
+            while (copied < n) {
+                if (gptr() < egptr()) {
+                    const std::streamsize m = std::min(n - copied, egptr() - gptr());
+                    std::memcpy(s + copied, gptr(), m);
+                    gbump(static_cast<int>(m));
+                    copied += m;
+                } else if (n - copied >= static_cast<std::streamsize>(sizeof(m_buffer_))) {
+                    const std::streamsize m = Pull(s + copied, n - copied);
+                    if (m <= 0) { break; }
+                    copied += m;
+                } else if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+                    break;
+                }
+            }
+            return copied;
+        }
+
+        pos_type
+        seekoff(
+            const off_type off,
+            const std::ios_base::seekdir dir,
+            const std::ios_base::openmode which) override {
+            if (!(which & std::ios_base::in)) { return {off_type(-1)}; }
+            const off_type pos =
+                static_cast<off_type>(m_length_ - m_remaining_) - (egptr() - gptr());
+            const auto length = static_cast<off_type>(m_length_);
+            const off_type target = dir == std::ios_base::beg   ? off
+                                    : dir == std::ios_base::cur ? pos + off
+                                                                : length + off;
+            if (target == pos) { return {pos}; }
+            if (target < 0 || target > length) { return {off_type(-1)}; }
+            if (m_source_->pubseekpos(m_base_ + target, std::ios_base::in) == pos_type(-1)) {
+                return {off_type(-1)};
+            }
+            setg(m_buffer_, m_buffer_, m_buffer_);
+            m_remaining_ = m_length_ - static_cast<std::uint64_t>(target);
+            m_seeked_ = true;
+            return {target};
+        }
+
+        pos_type
+        seekpos(const pos_type pos, const std::ios_base::openmode which) override {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+
+    private:
+        std::streamsize
+        Pull(char *dst, std::streamsize n) {
+            n = static_cast<std::streamsize>(std::min<std::uint64_t>(n, m_remaining_));
+            if (n == 0) { return 0; }
+            const std::streamsize m = m_source_->sgetn(dst, n);
+            if (m > 0) {
+                m_checksum_.Update(dst, static_cast<std::size_t>(m));
+                m_remaining_ -= static_cast<std::uint64_t>(m);
+            }
+            return m;
+        }
+    };
+
+    class SectionIStream : public std::istream {
+        SectionStreamBuf m_buf_;
+
+    public:
+        SectionIStream(std::streambuf *source, const std::uint64_t length)
+            : std::istream(nullptr),
+              m_buf_(source, length) {
+            rdbuf(&m_buf_);
+        }
+
+        [[nodiscard]] bool
+        Finish(std::uint64_t &checksum) {
+            return m_buf_.Finish(checksum);
+        }
+    };
+
+    /**
+     * Binary container: a fixed header, a section table and the section payloads.
+     *
+     * header (32 bytes): magic (8), version (u32), number of sections (u32),
+     *                    size of the section table (u64), size of the container (u64)
+     * section table: per section offset (u64), length (u64), checksum (u64), tag size (u32),
+     *                reserved (u32), tag
+     * payloads: each one starts at a multiple of kAlignment from the start of the container
+     *
+     * Offsets are relative to the start of the container, so a container can be embedded in any
+     * stream, including the payload of another container. Values are stored in the byte order of
+     * the host, like the rest of the binary serialization.
+     */
+    struct BinaryContainer {
+        static constexpr char kMagic[8] = {'\x7f', 'E', 'R', 'L', 'B', 'I', 'N', '\n'};
+        static constexpr std::uint32_t kVersion = 1;
+        static constexpr std::size_t kAlignment = 64;
+        static constexpr std::size_t kHeaderSize = 32;
+        static constexpr std::size_t kNotFound = std::numeric_limits<std::size_t>::max();
+
+        struct Section {
+            std::string tag;
+            std::uint64_t offset = 0;
+            std::uint64_t length = 0;
+            std::uint64_t checksum = 0;
+        };
+
+        [[nodiscard]] static std::uint64_t
+        AlignUp(const std::uint64_t n) {
+            return (n + kAlignment - 1) / kAlignment * kAlignment;
+        }
+    };
+
+    /**
+     * Write a container either from buffered payloads (AddSection + Write) or by streaming every
+     * section straight into a seekable stream (Encode).
+     */
+    class BinaryContainerWriter {
+        std::vector<std::string> m_tags_{};
+        std::vector<ChunkedBuffer> m_payloads_{};
+
+    public:
+        void
+        AddSection(std::string tag, ChunkedBuffer payload) {
+            m_tags_.push_back(std::move(tag));
+            m_payloads_.push_back(std::move(payload));
+        }
+
+        void
+        AddSection(std::string tag, const std::string &payload) {
+            ChunkedBuffer buffer;
+            buffer.Append(payload.data(), payload.size());
+            AddSection(std::move(tag), std::move(buffer));
+        }
+
+        /**
+         * Write the container of the added sections. Their checksums are computed in parallel.
+         * @param s The output stream to write to.
+         * @return true if successful.
+         */
+        [[nodiscard]] bool
+        Write(std::ostream &s) const {
+            const auto num_sections = static_cast<long>(m_payloads_.size());
+            std::vector<BinaryContainer::Section> sections(num_sections);
+#pragma omp parallel for schedule(dynamic) if (num_sections > 1)
+            for (long i = 0; i < num_sections; ++i) {
+                Checksum64 checksum;
+                m_payloads_[i].ForEachChunk(
+                    [&](const char *data, const std::size_t size) { checksum.Update(data, size); });
+                sections[i].checksum = checksum.Digest();
+            }
+            std::uint64_t offset = GetPayloadOffset(m_tags_);
+            for (long i = 0; i < num_sections; ++i) {
+                sections[i].offset = offset;
+                sections[i].length = m_payloads_[i].Size();
+                offset = BinaryContainer::AlignUp(offset + sections[i].length);
+            }
+            WriteHeader(s, m_tags_, sections, offset);
+            std::uint64_t written = BinaryContainer::kHeaderSize + GetTableSize(m_tags_);
+            for (long i = 0; i < num_sections; ++i) {
+                WritePadding(s, sections[i].offset - written);
+                m_payloads_[i].ForEachChunk([&s](const char *data, const std::size_t size) {
+                    s.write(data, static_cast<std::streamsize>(size));
+                });
+                written = sections[i].offset + sections[i].length;
+            }
+            WritePadding(s, offset - written);
+            return s.good();
+        }
+
+        /**
+         * Test if Encode can write to the stream, i.e. the stream can seek back.
+         */
+        [[nodiscard]] static bool
+        IsSeekable(std::ostream &s) {
+            std::streambuf *buf = s.rdbuf();
+            if (buf == nullptr) { return false; }
+            const std::streampos pos = buf->pubseekoff(0, std::ios_base::cur, std::ios_base::out);
+            return pos != std::streampos(-1) && buf->pubseekpos(pos, std::ios_base::out) == pos;
+        }
+
+        /**
+         * Write a container by streaming each section straight into the stream, without buffering
+         * the payloads. The section table is written with placeholders first and rewritten once
+         * the lengths and checksums are known, so the stream must be seekable.
+         * @param s The output stream to write to.
+         * @param tags The tags of the sections.
+         * @param encode Function bool(std::size_t i, std::ostream &) that writes section i.
+         * @return true if successful.
+         */
+        template<typename Func>
+        [[nodiscard]] static bool
+        Encode(std::ostream &s, const std::vector<std::string> &tags, Func encode) {
+            const std::streampos start = s.tellp();
+            if (start == std::streampos(-1)) {
+                ERL_WARN("Binary container streaming requires a seekable stream.");
+                return false;
+            }
+            std::vector<BinaryContainer::Section> sections(tags.size());
+            WriteHeader(s, tags, sections, 0);  // placeholders
+            std::uint64_t offset = GetPayloadOffset(tags);
+            WritePadding(s, offset - (BinaryContainer::kHeaderSize + GetTableSize(tags)));
+            for (std::size_t i = 0; i < tags.size(); ++i) {
+                ChecksumStreamBuf buf(s.rdbuf());
+                std::ostream stream(&buf);
+                stream.copyfmt(s);  // keep the format flag for nested objects
+                if (!encode(i, stream) || !stream.good()) {
+                    s.setstate(std::ios_base::failbit);
+                    return false;
+                }
+                sections[i].offset = offset;
+                sections[i].length = buf.Size();
+                sections[i].checksum = buf.Digest();
+                const std::uint64_t end = offset + sections[i].length;
+                offset = BinaryContainer::AlignUp(end);
+                WritePadding(s, offset - end);
+            }
+            s.seekp(start);
+            WriteHeader(s, tags, sections, offset);
+            s.seekp(start + static_cast<std::streamoff>(offset));
+            return s.good();
+        }
+
+    private:
+        [[nodiscard]] static std::uint64_t
+        GetTableSize(const std::vector<std::string> &tags) {
+            std::uint64_t table_size = 0;
+            for (const std::string &tag: tags) { table_size += 32 + tag.size(); }
+            return table_size;
+        }
+
+        [[nodiscard]] static std::uint64_t
+        GetPayloadOffset(const std::vector<std::string> &tags) {
+            return BinaryContainer::AlignUp(BinaryContainer::kHeaderSize + GetTableSize(tags));
+        }
+
+        static void
+        WritePadding(std::ostream &s, const std::uint64_t size) {
+            static const char padding[BinaryContainer::kAlignment] = {};
+            s.write(padding, static_cast<std::streamsize>(size));
+        }
+
+        static void
+        WriteHeader(
+            std::ostream &s,
+            const std::vector<std::string> &tags,
+            const std::vector<BinaryContainer::Section> &sections,
+            const std::uint64_t total_size) {
+            auto write_u32 = [&s](const std::uint32_t value) {
+                s.write(reinterpret_cast<const char *>(&value), sizeof(value));
+            };
+            auto write_u64 = [&s](const std::uint64_t value) {
+                s.write(reinterpret_cast<const char *>(&value), sizeof(value));
+            };
+            s.write(BinaryContainer::kMagic, sizeof(BinaryContainer::kMagic));
+            write_u32(BinaryContainer::kVersion);
+            write_u32(static_cast<std::uint32_t>(tags.size()));
+            write_u64(GetTableSize(tags));
+            write_u64(total_size);
+            for (std::size_t i = 0; i < tags.size(); ++i) {
+                write_u64(sections[i].offset);
+                write_u64(sections[i].length);
+                write_u64(sections[i].checksum);
+                write_u32(static_cast<std::uint32_t>(tags[i].size()));
+                write_u32(0);
+                s.write(tags[i].data(), static_cast<std::streamsize>(tags[i].size()));
+            }
+        }
+    };
+
+    /**
+     * Random access to the sections of a container. Only the section table is read by Open, the
+     * payloads are read on demand, so unknown sections cost nothing.
+     */
+    class BinaryContainerReader {
+        std::istream *m_stream_ = nullptr;
+        std::streampos m_start_{};
+        std::uint64_t m_total_size_ = 0;
+        std::vector<BinaryContainer::Section> m_sections_{};
+
+    public:
+        /**
+         * Test if the next bytes of the stream start a container, without consuming them.
+         */
+        [[nodiscard]] static bool
+        Detect(std::istream &s) {
+            return s.peek() == std::istream::traits_type::to_int_type(BinaryContainer::kMagic[0]);
+        }
+
+        /**
+         * Read the header and the section table of the container starting at the current
+         * position. The stream must be seekable and outlive the reader. Sizes in the header are
+         * checked against the remaining stream size before anything is allocated.
+         * @param s The input stream to read from.
+         * @return true if successful.
+         */
+        [[nodiscard]] bool
+        Open(std::istream &s) {
+            m_stream_ = &s;
+            m_start_ = s.tellg();
+            if (m_start_ == std::streampos(-1)) {
+                ERL_WARN("Binary container requires a seekable stream.");
+                return false;
+            }
+            s.seekg(0, std::ios_base::end);
+            const std::streampos end = s.tellg();
+            s.seekg(m_start_);
+            if (end == std::streampos(-1) || !s.good()) {
+                ERL_WARN("Binary container requires a seekable stream.");
+                return false;
+            }
+            const auto available = static_cast<std::uint64_t>(end - m_start_);
+            char magic[sizeof(BinaryContainer::kMagic)];
+            s.read(magic, sizeof(magic));
+            if (!s.good() || std::memcmp(magic, BinaryContainer::kMagic, sizeof(magic)) != 0) {
+                ERL_WARN("Invalid binary container magic.");
+                return false;
+            }
+            std::uint32_t version, num_sections;
+            std::uint64_t table_size;
+            s.read(reinterpret_cast<char *>(&version), sizeof(version));
+            s.read(reinterpret_cast<char *>(&num_sections), sizeof(num_sections));
+            s.read(reinterpret_cast<char *>(&table_size), sizeof(table_size));
+            s.read(reinterpret_cast<char *>(&m_total_size_), sizeof(m_total_size_));
+            if (version > BinaryContainer::kVersion) {
+                ERL_WARN(
+                    "Binary container version {} is newer than the supported version {}.",
+                    version,
+                    BinaryContainer::kVersion);
+                return false;
+            }
+            constexpr std::uint64_t kEntrySize = 32;  // without the tag
+            // the header was read in full, so available >= kHeaderSize
+            if (!s.good() || table_size > available - BinaryContainer::kHeaderSize ||
+                num_sections * kEntrySize > table_size) {
+                ERL_WARN(
+                    "Corrupt binary container header: {} sections in a {}-byte table, {} bytes "
+                    "available.",
+                    num_sections,
+                    table_size,
+                    available);
+                return false;
+            }
+            std::uint64_t table_left = table_size;
+            m_sections_.resize(num_sections);
+            for (auto &section: m_sections_) {
+                std::uint32_t tag_size, reserved;
+                s.read(reinterpret_cast<char *>(&section.offset), sizeof(section.offset));
+                s.read(reinterpret_cast<char *>(&section.length), sizeof(section.length));
+                s.read(reinterpret_cast<char *>(&section.checksum), sizeof(section.checksum));
+                s.read(reinterpret_cast<char *>(&tag_size), sizeof(tag_size));
+                s.read(reinterpret_cast<char *>(&reserved), sizeof(reserved));
+                if (!s.good()) { break; }
+                table_left -= kEntrySize;
+                if (tag_size > table_left || section.offset > available ||
+                    section.length > available - section.offset) {
+                    ERL_WARN(
+                        "Corrupt binary container section table: tag of {} bytes, payload of {} "
+                        "bytes at {}, {} bytes available.",
+                        tag_size,
+                        section.length,
+                        section.offset,
+                        available);
+                    return false;
+                }
+                table_left -= tag_size;
+                section.tag.resize(tag_size);
+                s.read(section.tag.data(), tag_size);
+            }
+            if (!s.good()) {
+                ERL_WARN("Truncated binary container section table.");
+                return false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] const std::vector<BinaryContainer::Section> &
+        GetSections() const {
+            return m_sections_;
+        }
+
+        [[nodiscard]] std::uint64_t
+        GetTotalSize() const {
+            return m_total_size_;
+        }
+
+        /**
+         *
+         * @param tag Tag of the section.
+         * @return Index of the section, BinaryContainer::kNotFound if absent.
+         */
+        [[nodiscard]] std::size_t
+        FindSection(const std::string &tag) const {
+            for (std::size_t i = 0; i < m_sections_.size(); ++i) {
+                if (m_sections_[i].tag == tag) { return i; }
+            }
+            return BinaryContainer::kNotFound;
+        }
+
+        [[nodiscard]] bool
+        HasSection(const std::string &tag) const {
+            return FindSection(tag) != BinaryContainer::kNotFound;
+        }
+
+        /**
+         * Read the payload of a section.
+         * @param index Index of the section.
+         * @param payload The payload.
+         * @param verify Whether to verify the checksum, see VerifySection.
+         * @return true if successful.
+         */
+        [[nodiscard]] bool
+        ReadSection(const std::size_t index, std::string &payload, const bool verify = true) const {
+            const BinaryContainer::Section &section = m_sections_[index];
+            m_stream_->clear();
+            m_stream_->seekg(m_start_ + static_cast<std::streamoff>(section.offset));
+            payload.resize(section.length);
+            m_stream_->read(payload.data(), static_cast<std::streamsize>(section.length));
+            if (!m_stream_->good()) {
+                ERL_WARN("Failed to read section {}. Truncated file?", section.tag);
+                return false;
+            }
+            return !verify || VerifySection(index, payload);
+        }
+
+        [[nodiscard]] bool
+        ReadSection(const std::string &tag, std::string &payload, const bool verify = true) const {
+            const std::size_t index = FindSection(tag);
+            if (index == BinaryContainer::kNotFound) {
+                ERL_WARN("Section {} not found.", tag);
+                return false;
+            }
+            return ReadSection(index, payload, verify);
+        }
+
+        /**
+         * Decode a section straight from the stream, without buffering the payload. The bytes
+         * func does not read are skipped, and the checksum of the section is verified after func
+         * returns.
+         * @param index Index of the section.
+         * @param func Function bool(std::istream &) that reads the payload.
+         * @return true if func succeeds and the checksum matches.
+         */
+        template<typename Func>
+        [[nodiscard]] bool
+        DecodeSection(const std::size_t index, Func func) const {
+            const BinaryContainer::Section &section = m_sections_[index];
+            m_stream_->clear();
+            m_stream_->seekg(m_start_ + static_cast<std::streamoff>(section.offset));
+            if (!m_stream_->good()) {
+                ERL_WARN("Failed to seek to section {}.", section.tag);
+                return false;
+            }
+            SectionIStream stream(m_stream_->rdbuf(), section.length);
+            if (!func(stream)) { return false; }
+            std::uint64_t checksum;
+            if (!stream.Finish(checksum)) {
+                ERL_WARN("Failed to read section {}. Truncated file?", section.tag);
+                return false;
+            }
+            if (checksum != section.checksum) {
+                ERL_WARN("Checksum mismatch in section {}.", section.tag);
+                return false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] bool
+        VerifySection(const std::size_t index, const std::string &payload) const {
+            const BinaryContainer::Section &section = m_sections_[index];
+            if (Checksum(payload.data(), payload.size()) != section.checksum) {
+                ERL_WARN("Checksum mismatch in section {}.", section.tag);
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * Move the stream to the end of the container.
+         */
+        [[nodiscard]] bool
+        SeekToEnd() const {
+            m_stream_->clear();
+            m_stream_->seekg(m_start_ + static_cast<std::streamoff>(m_total_size_));
+            return m_stream_->good();
+        }
+    };
+}  // namespace erl::common::serialization
@@ -3,9 +3,139 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <vector>
 
 namespace erl::common {
+
+    /**
+     * Read-only memory mapping of a whole file. The mapping is released when the last shared
+     * pointer to it goes away, so views into the file (MappedArray, MappedEigenMatrix) keep it
+     * alive by holding one.
+     */
+    class MappedFile {
+    public:
+        enum class Advice {
+            kNormal = 0,
+            kSequential = 1,  // read ahead aggressively, drop pages behind
+            kRandom = 2,      // no read ahead
+            kWillNeed = 3,    // start reading the range now
+            kDontNeed = 4,    // the range is not needed anymore, free the page cache
+        };
+
+    private:
+        std::string m_path_{};
+        const char *m_data_ = nullptr;
+        std::size_t m_size_ = 0;
+
+        MappedFile() = default;
+
+    public:
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &
+        operator=(const MappedFile &) = delete;
+        MappedFile(MappedFile &&) = delete;
+        MappedFile &
+        operator=(MappedFile &&) = delete;
+
+        ~MappedFile();
+
+        /**
+         * Map a file into memory.
+         * @param path Path of the file.
+         * @param advice Expected access pattern.
+         * @return The mapping, or nullptr if the file cannot be opened or mapped.
+         */
+        [[nodiscard]] static std::shared_ptr<const MappedFile>
+        Open(const std::string &path, Advice advice = Advice::kNormal);
+
+        [[nodiscard]] const std::string &
+        GetPath() const {
+            return m_path_;
+        }
+
+        /**
+         *
+         * @return Start of the mapping, page-aligned. nullptr for an empty file.
+         */
+        [[nodiscard]] const char *
+        GetData() const {
+            return m_data_;
+        }
+
+        [[nodiscard]] std::size_t
+        GetSize() const {
+            return m_size_;
+        }
+
+        /**
+         * Give the kernel a hint about how a byte range is going to be accessed.
+         */
+        void
+        Advise(std::size_t offset, std::size_t length, Advice advice) const;
+    };
+
+    /**
+     * Array of T viewed directly in a memory-mapped file, without copying.
+     */
+    template<typename T>
+    class MappedArray {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable.");
+
+        std::shared_ptr<const MappedFile> m_file_ = nullptr;
+        const T *m_data_ = nullptr;
+        std::size_t m_size_ = 0;
+
+    public:
+        MappedArray() = default;
+
+        MappedArray(std::shared_ptr<const MappedFile> file, const T *data, const std::size_t size)
+            : m_file_(std::move(file)),
+              m_data_(data),
+              m_size_(size) {}
+
+        [[nodiscard]] bool
+        IsValid() const {
+            return m_file_ != nullptr;
+        }
+
+        [[nodiscard]] const std::shared_ptr<const MappedFile> &
+        GetFile() const {
+            return m_file_;
+        }
+
+        [[nodiscard]] const T *
+        data() const {
+            return m_data_;
+        }
+
+        [[nodiscard]] std::size_t
+        size() const {
+            return m_size_;
+        }
+
+        [[nodiscard]] bool
+        empty() const {
+            return m_size_ == 0;
+        }
+
+        [[nodiscard]] const T *
+        begin() const {
+            return m_data_;
+        }
+
+        [[nodiscard]] const T *
+        end() const {
+            return m_data_ + m_size_;
+        }
+
+        const T &
+        operator[](const std::size_t i) const {
+            ERL_DEBUG_ASSERT(i < m_size_, "index {} out of range [0, {}).", i, m_size_);
+            return m_data_[i];
+        }
+    };
+
     template<typename T>
     std::vector<T>
     LoadBinaryFile(const std::string &path) {
@@ -16,14 +146,33 @@ namespace erl::common {
             "{} does not exist in {}.",
             path,
             std::filesystem::current_path());
-        auto data = std::vector<char>(std::istreambuf_iterator<char>(ifs), {});
+        // read straight into the result instead of going through a byte buffer
+        ifs.seekg(0, std::ios::end);
+        const auto file_size = static_cast<std::size_t>(ifs.tellg());
+        ifs.seekg(0, std::ios::beg);
+        std::vector<T> data(file_size / sizeof(T));
+        ifs.read(
+            reinterpret_cast<char *>(data.data()),
+            static_cast<std::streamsize>(data.size() * sizeof(T)));
+        ERL_ASSERTM(ifs.good(), "Failed to read {}.", path);
         ifs.close();
+        return data;
+    }
 
-        T *begin = reinterpret_cast<T *>(data.data());
-        T *end = begin + data.size() / sizeof(T);
-        std::vector<T> reinterpreted_data(begin, end);
-
-        return reinterpreted_data;
+    /**
+     * Map a binary file written by SaveBinaryFile instead of loading it.
+     * @return View of the file, invalid if the file cannot be mapped.
+     */
+    template<typename T>
+    MappedArray<T>
+    MapBinaryFile(
+        const std::string &path,
+        const MappedFile::Advice advice = MappedFile::Advice::kNormal) {
+        std::shared_ptr<const MappedFile> file = MappedFile::Open(path, advice);
+        if (file == nullptr) { return {}; }
+        const T *data = reinterpret_cast<const T *>(file->GetData());
+        const std::size_t size = file->GetSize() / sizeof(T);
+        return {std::move(file), data, size};
     }
 
     template<typename T>
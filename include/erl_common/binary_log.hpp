@@ -0,0 +1,307 @@
+#pragma once
+
+#include "logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace erl::common {
+
+    /**
+     * Structured log sink that writes binary records into a memory-mapped ring file instead of
+     * formatting text. A record holds a timestamp, the id of a static format entry (level, file,
+     * line, format string and argument types) and the raw bytes of the arguments, so writing one
+     * is a memcpy. The file is shared with the page cache, so the records written before a crash
+     * survive it; BinaryLogReader and the erl_binary_log_decode tool turn them into text.
+     *
+     * File layout:
+     * - FileHeader
+     * - dictionary of format entries, appended when a call site is first used
+     * - ring of records, the oldest ones are overwritten when it is full
+     */
+    class BinaryLog {
+    public:
+        enum class ArgType : std::uint8_t {
+            kBool = 0,
+            kChar = 1,
+            kInt8 = 2,
+            kUInt8 = 3,
+            kInt16 = 4,
+            kUInt16 = 5,
+            kInt32 = 6,
+            kUInt32 = 7,
+            kInt64 = 8,
+            kUInt64 = 9,
+            kFloat = 10,
+            kDouble = 11,
+            kString = 12,  // 32-bit length followed by the characters
+        };
+
+        struct Setting {
+            std::size_t ring_capacity = 16 << 20;       // bytes of records kept in the file
+            std::size_t dictionary_capacity = 1 << 20;  // bytes of format entries
+        };
+
+        struct Format {
+            std::uint32_t id = 0;
+            LoggingLevel level = kInfo;
+            std::string file{};
+            std::uint32_t line = 0;
+            std::string format{};
+            std::vector<ArgType> arg_types{};
+        };
+
+        static constexpr char kMagic[8] = {'\x7f', 'E', 'R', 'L', 'B', 'L', 'O', 'G'};
+        static constexpr std::uint32_t kVersion = 1;
+        static constexpr std::uint32_t kPaddingId = 0xffffffff;  // fills the end of the ring
+
+        struct FileHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t dictionary_capacity;
+            std::uint64_t ring_capacity;
+            std::atomic<std::uint64_t> dictionary_size;
+            std::atomic<std::uint64_t> ring_head;  // bytes ever written to the ring
+            std::atomic<std::uint64_t> ring_tail;  // offset of the oldest complete record
+            std::atomic<std::uint64_t> num_dropped_records;
+        };
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+        static_assert(sizeof(FileHeader) == 64);
+
+        struct RecordHeader {
+            std::uint32_t size;  // including this header, a multiple of 8
+            std::uint32_t format_id;
+            std::int64_t time_ns;  // since the epoch of the system clock
+        };
+
+        /**
+         * Call site of a log statement, a static variable of the log macros. Its format is
+         * registered by the first record, the id stays valid across Open and Close.
+         */
+        struct Site {
+            static constexpr std::uint32_t kUnregistered = 0xffffffff;
+
+            LoggingLevel level;
+            const char *file;
+            int line;
+            std::atomic<std::uint32_t> format_id{kUnregistered};
+
+            constexpr Site(const LoggingLevel level_in, const char *file_in, const int line_in)
+                : level(level_in),
+                  file(file_in),
+                  line(line_in) {}
+        };
+
+        template<typename T>
+        static constexpr bool kIsString =
+            std::is_same_v<T, const char *> || std::is_same_v<T, char *> ||
+            std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+        template<typename T>
+        static constexpr ArgType
+        GetArgType() {
+            if constexpr (kIsString<T>) {
+                return ArgType::kString;
+            } else if constexpr (std::is_enum_v<T>) {
+                return GetArgType<std::underlying_type_t<T>>();
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return ArgType::kBool;
+            } else if constexpr (std::is_same_v<T, char>) {
+                return ArgType::kChar;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                static_assert(sizeof(T) == 4 || sizeof(T) == 8, "long double is not supported.");
+                return sizeof(T) == 4 ? ArgType::kFloat : ArgType::kDouble;
+            } else {
+                static_assert(std::is_integral_v<T>, "Only numbers and strings can be logged.");
+                constexpr bool kSigned = std::is_signed_v<T>;
+                switch (sizeof(T)) {
+                    case 1:
+                        return kSigned ? ArgType::kInt8 : ArgType::kUInt8;
+                    case 2:
+                        return kSigned ? ArgType::kInt16 : ArgType::kUInt16;
+                    case 4:
+                        return kSigned ? ArgType::kInt32 : ArgType::kUInt32;
+                    default:
+                        return kSigned ? ArgType::kInt64 : ArgType::kUInt64;
+                }
+            }
+        }
+
+    private:
+        struct Sink;
+        static std::atomic<bool> s_open_;
+
+    public:
+        /**
+         * Create the file, replacing an existing one, and direct the binary log statements to
+         * it. The sink that is open is closed first.
+         */
+        static bool
+        Open(const std::string &path, const Setting &setting);
+
+        static bool
+        Open(const std::string &path) {
+            return Open(path, Setting());
+        }
+
+        static void
+        Close();
+
+        [[nodiscard]] static bool
+        IsOpen() {
+            return s_open_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Write the mapped pages to the disk. Not needed to survive a crash of the process, only
+         * to survive a crash of the system.
+         */
+        static void
+        Flush();
+
+        /**
+         * @return Number of records that were too large or whose format did not fit into the
+         * dictionary. Records overwritten by the ring are not counted.
+         */
+        [[nodiscard]] static std::uint64_t
+        GetNumDroppedRecords();
+
+        /**
+         * Write a record of a call site, registering its format first if needed.
+         */
+        template<typename... Args>
+        static void
+        Write(Site &site, const char *format, const Args &...args) {
+            std::uint32_t format_id = site.format_id.load(std::memory_order_acquire);
+            if (format_id == Site::kUnregistered) {
+                format_id = RegisterFormat(site, format, {GetArgType<std::decay_t<Args>>()...});
+            }
+            const std::int64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::system_clock::now().time_since_epoch())
+                                             .count();
+            const std::size_t payload_size = (GetArgSize(args) + ... + 0);
+            char *dst = Reserve(format_id, time_ns, payload_size);
+            if (dst == nullptr) { return; }
+            (WriteArg(dst, args), ...);
+            Commit();
+        }
+
+    private:
+        static std::uint32_t
+        RegisterFormat(Site &site, const char *format, std::vector<ArgType> arg_types);
+
+        /**
+         * Lock the sink and make room for a record in the ring.
+         * @return Where the arguments go, nullptr if the record is dropped (the lock is not held
+         * then).
+         */
+        static char *
+        Reserve(std::uint32_t format_id, std::int64_t time_ns, std::size_t payload_size);
+
+        /**
+         * Publish the reserved record and unlock the sink.
+         */
+        static void
+        Commit();
+
+        template<typename T>
+        static std::size_t
+        GetArgSize(const T &arg) {
+            using U = std::decay_t<T>;
+            if constexpr (kIsString<U>) {
+                return sizeof(std::uint32_t) + std::string_view(arg).size();
+            } else {
+                return sizeof(U);
+            }
+        }
+
+        template<typename T>
+        static void
+        WriteArg(char *&dst, const T &arg) {
+            using U = std::decay_t<T>;
+            if constexpr (kIsString<U>) {
+                const std::string_view str(arg);
+                const auto size = static_cast<std::uint32_t>(str.size());
+                std::memcpy(dst, &size, sizeof(size));
+                std::memcpy(dst + sizeof(size), str.data(), size);
+                dst += sizeof(size) + size;
+            } else {
+                std::memcpy(dst, &arg, sizeof(U));
+                dst += sizeof(U);
+            }
+        }
+    };
+
+    /**
+     * Reader of a file written by BinaryLog. The file is read as it is, i.e. after the writer
+     * has closed it or crashed.
+     */
+    class BinaryLogReader {
+    public:
+        struct Record {
+            std::int64_t time_ns = 0;
+            std::uint32_t format_id = 0;
+            std::string message{};
+        };
+
+    private:
+        std::vector<BinaryLog::Format> m_formats_{};
+        std::vector<Record> m_records_{};
+        std::uint64_t m_num_dropped_records_ = 0;
+
+    public:
+        /**
+         * Read the dictionary and decode all records of the ring, from the oldest to the newest.
+         */
+        [[nodiscard]] bool
+        Open(const std::string &path);
+
+        [[nodiscard]] const std::vector<BinaryLog::Format> &
+        GetFormats() const {
+            return m_formats_;
+        }
+
+        [[nodiscard]] const std::vector<Record> &
+        GetRecords() const {
+            return m_records_;
+        }
+
+        [[nodiscard]] std::uint64_t
+        GetNumDroppedRecords() const {
+            return m_num_dropped_records_;
+        }
+
+        /**
+         * @return The record as a line of the text log: [date time][LEVEL]: file:line: message
+         */
+        [[nodiscard]] std::string
+        ToString(const Record &record) const;
+    };
+}  // namespace erl::common
+
+// the arguments are evaluated only if the level is enabled and a sink is open
+#define ERL_BLOG_AT(level, macro_level, ...)                                             \
+    do {                                                                                 \
+        if (ERL_LOG_ACTIVE_LEVEL <= (macro_level) && erl::common::BinaryLog::IsOpen() && \
+            erl::common::Logging::IsEnabled(level)) {                                    \
+            static erl::common::BinaryLog::Site erl_blog_site(level, __FILE__, __LINE__); \
+            erl::common::BinaryLog::Write(erl_blog_site, __VA_ARGS__);                   \
+        }                                                                                \
+    } while (false)
+
+/**
+ * Binary counterparts of ERL_DEBUG, ERL_INFO, ERL_WARN and ERL_ERROR. The format string must be a
+ * literal with fmt placeholders, the arguments numbers or strings.
+ */
+#define ERL_BLOG_DEBUG(...) ERL_BLOG_AT(erl::common::kDebug, ERL_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define ERL_BLOG_INFO(...)  ERL_BLOG_AT(erl::common::kInfo, ERL_LOG_LEVEL_INFO, __VA_ARGS__)
+#define ERL_BLOG_WARN(...)  ERL_BLOG_AT(erl::common::kWarn, ERL_LOG_LEVEL_WARN, __VA_ARGS__)
+#define ERL_BLOG_ERROR(...) ERL_BLOG_AT(erl::common::kError, ERL_LOG_LEVEL_ERROR, __VA_ARGS__)
@@ -1,36 +1,69 @@
 #pragma once
 
+#include "latency_histogram.hpp"
 #include "logging.hpp"
+#include "profiler.hpp"
 
 #include <chrono>
+#include <optional>
 
 namespace erl::common {
 
+    /**
+     * Time the enclosing block and log the duration at the info level. When constructed with a
+     * site, the block is also a scope of Profiler, which is what the ERL_BLOCK_TIMER* macros do.
+     * With a histogram, the duration is recorded into it in the unit of Duration instead of
+     * being logged, so that hot blocks can be timed for their percentiles.
+     */
     template<typename Duration>
     struct BlockTimer {
         std::string label;
         double *dt;
-        std::chrono::time_point<std::chrono::high_resolution_clock> t1;
+        LatencyHistogram *histogram;
+        std::optional<ProfileScope> scope;
+        std::chrono::time_point<std::chrono::steady_clock> t1;
 
-        explicit BlockTimer(std::string label, double *dt = nullptr)
-            : label(std::move(label)), dt(dt), t1(std::chrono::high_resolution_clock::now()) {}
+        explicit BlockTimer(
+            std::string label,
+            double *dt = nullptr,
+            LatencyHistogram *histogram = nullptr)
+            : label(std::move(label)),
+              dt(dt),
+              histogram(histogram),
+              t1(std::chrono::steady_clock::now()) {}
+
+        BlockTimer(
+            const ProfileSite &site,
+            std::string label,
+            double *dt = nullptr,
+            LatencyHistogram *histogram = nullptr)
+            : label(std::move(label)),
+              dt(dt),
+              histogram(histogram) {
+            scope.emplace(site);
+            t1 = std::chrono::steady_clock::now();
+        }
 
         template<typename T, typename Period>
         T
         Elapsed() {
-            auto &&t2 = std::chrono::high_resolution_clock::now();
+            auto &&t2 = std::chrono::steady_clock::now();
             return std::chrono::duration<T, Period>(t2 - t1).count();
         }
 
         ~BlockTimer() {
-            const bool verbose = Logging::GetLevel() <= LoggingLevel::kInfo;
+            auto &&t2 = std::chrono::steady_clock::now();
+            scope.reset();  // the logging below is not profiled
+
+            const bool verbose =
+                this->histogram == nullptr && Logging::GetLevel() <= LoggingLevel::kInfo;
             // No need to measure time and print the message.
-            if (this->dt == nullptr && !verbose) { return; }
+            if (this->dt == nullptr && this->histogram == nullptr && !verbose) { return; }
 
-            auto &&t2 = std::chrono::high_resolution_clock::now();
             double &&t_diff =
                 std::chrono::duration<double, typename Duration::period>(t2 - t1).count();
             if (this->dt != nullptr) { *this->dt = t_diff; }
+            if (this->histogram != nullptr) { this->histogram->Record(t_diff); }
 
             if (verbose) {
                 std::string unit;
@@ -54,28 +87,39 @@ namespace erl::common {
     };
 }  // namespace erl::common
 
-#define ERL_BLOCK_TIMER()                                     \
-    erl::common::BlockTimer<std::chrono::milliseconds> timer( \
-        LOGGING_LABELED_MSG(__PRETTY_FUNCTION__))
-#define ERL_BLOCK_TIMER_TIME(dt)                              \
-    erl::common::BlockTimer<std::chrono::milliseconds> timer( \
-        LOGGING_LABELED_MSG(__PRETTY_FUNCTION__),             \
-        &(dt))
+// the profiler scope is named after the first msg of the call site, a single declaration
+#define ERL_BLOCK_TIMER_IMPL(duration, name, msg, dt_ptr, histogram_ptr)                 \
+    erl::common::BlockTimer<duration> ERL_PROFILE_CONCAT(erl_block_timer_, __LINE__)(      \
+        erl::common::GetProfileSite([] {}, name, __PRETTY_FUNCTION__, __FILE__, __LINE__), \
+        LOGGING_LABELED_MSG(msg),                                                         \
+        dt_ptr,                                                                           \
+        histogram_ptr)
+
+#define ERL_BLOCK_TIMER() \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::milliseconds, __func__, __PRETTY_FUNCTION__, nullptr, nullptr)
+#define ERL_BLOCK_TIMER_TIME(dt) \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::milliseconds, __func__, __PRETTY_FUNCTION__, &(dt), nullptr)
 #define ERL_BLOCK_TIMER_MSG(msg) \
-    erl::common::BlockTimer<std::chrono::milliseconds> timer(LOGGING_LABELED_MSG(msg))
+    ERL_BLOCK_TIMER_IMPL(std::chrono::milliseconds, msg, msg, nullptr, nullptr)
 #define ERL_BLOCK_TIMER_MSG_TIME(msg, dt) \
-    erl::common::BlockTimer<std::chrono::milliseconds> timer(LOGGING_LABELED_MSG(msg), &(dt))
-#define ERL_BLOCK_TIMER_MICRO()                               \
-    erl::common::BlockTimer<std::chrono::microseconds> timer( \
-        LOGGING_LABELED_MSG(__PRETTY_FUNCTION__))
-#define ERL_BLOCK_TIMER_MICRO_TIME(dt)                        \
-    erl::common::BlockTimer<std::chrono::microseconds> timer( \
-        LOGGING_LABELED_MSG(__PRETTY_FUNCTION__),             \
-        &(dt))
+    ERL_BLOCK_TIMER_IMPL(std::chrono::milliseconds, msg, msg, &(dt), nullptr)
+#define ERL_BLOCK_TIMER_MICRO() \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::microseconds, __func__, __PRETTY_FUNCTION__, nullptr, nullptr)
+#define ERL_BLOCK_TIMER_MICRO_TIME(dt) \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::microseconds, __func__, __PRETTY_FUNCTION__, &(dt), nullptr)
 #define ERL_BLOCK_TIMER_MICRO_MSG(msg) \
-    erl::common::BlockTimer<std::chrono::microseconds> timer(LOGGING_LABELED_MSG(msg))
+    ERL_BLOCK_TIMER_IMPL(std::chrono::microseconds, msg, msg, nullptr, nullptr)
 #define ERL_BLOCK_TIMER_MICRO_MSG_TIME(msg, dt) \
-    erl::common::BlockTimer<std::chrono::microseconds> timer(LOGGING_LABELED_MSG(msg), &(dt))
+    ERL_BLOCK_TIMER_IMPL(std::chrono::microseconds, msg, msg, &(dt), nullptr)
+// record the duration of the block into a LatencyHistogram, without logging it
+#define ERL_BLOCK_TIMER_HISTOGRAM(histogram) \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::milliseconds, __func__, __func__, nullptr, &(histogram))
+#define ERL_BLOCK_TIMER_MSG_HISTOGRAM(msg, histogram) \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::milliseconds, msg, msg, nullptr, &(histogram))
+#define ERL_BLOCK_TIMER_MICRO_HISTOGRAM(histogram) \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::microseconds, __func__, __func__, nullptr, &(histogram))
+#define ERL_BLOCK_TIMER_MICRO_MSG_HISTOGRAM(msg, histogram) \
+    ERL_BLOCK_TIMER_IMPL(std::chrono::microseconds, msg, msg, nullptr, &(histogram))
 
 #ifdef NDEBUG
     #define ERL_DEBUG_BLOCK_TIMER()                       (void) 0
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "serialization.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace erl::common::serialization {
+
+    /**
+     * Writes checkpoints on a background thread. A job owns a snapshot of the object that nobody
+     * modifies anymore, so Submit returns as soon as the snapshot is handed over and the caller
+     * keeps working while the worker serializes it. Files are written atomically: the data goes to
+     * a temporary file next to the target, which is flushed to disk and renamed over the target,
+     * so a crash leaves either the previous or the new checkpoint, never a partial one. Jobs run
+     * in submission order. The destructor finishes the queued jobs.
+     */
+    class CheckpointWriter {
+    public:
+        enum class Status {
+            kPending = 0,
+            kRunning = 1,
+            kSucceeded = 2,
+            kFailed = 3,
+        };
+
+        struct Metrics {
+            std::size_t num_submitted = 0;
+            std::size_t num_succeeded = 0;
+            std::size_t num_failed = 0;
+            std::size_t queue_depth = 0;  // jobs waiting, not counting the running one
+            std::size_t max_queue_depth = 0;
+            std::uint64_t total_bytes = 0;
+            std::uint64_t last_bytes = 0;
+            double total_duration_ms = 0.0;
+            double last_duration_ms = 0.0;
+            double max_duration_ms = 0.0;
+        };
+
+        /**
+         * Function that writes the complete file at the given path, called on the worker thread.
+         */
+        using WriteFileFunction = std::function<bool(const std::string &path)>;
+
+    private:
+        struct Job {
+            std::string filename;
+            WriteFileFunction write_file;
+            Status status = Status::kPending;
+            std::uint64_t bytes = 0;
+            double duration_ms = 0.0;
+            mutable std::mutex mutex;
+            std::condition_variable cv;
+        };
+
+    public:
+        /**
+         * Handle of a submitted job, to poll or wait for its completion.
+         */
+        class Ticket {
+            std::shared_ptr<Job> m_job_ = nullptr;
+
+        public:
+            Ticket() = default;
+
+            explicit Ticket(std::shared_ptr<Job> job)
+                : m_job_(std::move(job)) {}
+
+            [[nodiscard]] bool
+            IsValid() const {
+                return m_job_ != nullptr;
+            }
+
+            [[nodiscard]] const std::string &
+            GetFilename() const {
+                return m_job_->filename;
+            }
+
+            [[nodiscard]] Status
+            GetStatus() const {
+                std::lock_guard<std::mutex> lock(m_job_->mutex);
+                return m_job_->status;
+            }
+
+            [[nodiscard]] bool
+            IsDone() const {
+                const Status status = GetStatus();
+                return status == Status::kSucceeded || status == Status::kFailed;
+            }
+
+            /**
+             * Block until the job is done.
+             * @return true if the checkpoint was written.
+             */
+            bool
+            Wait() const {
+                std::unique_lock<std::mutex> lock(m_job_->mutex);
+                m_job_->cv.wait(lock, [this] { return IsDoneLocked(); });
+                return m_job_->status == Status::kSucceeded;
+            }
+
+            /**
+             * Block until the job is done or the timeout expires.
+             * @return true if the job is done.
+             */
+            template<typename Rep, typename Period>
+            bool
+            WaitFor(const std::chrono::duration<Rep, Period> &timeout) const {
+                std::unique_lock<std::mutex> lock(m_job_->mutex);
+                return m_job_->cv.wait_for(lock, timeout, [this] { return IsDoneLocked(); });
+            }
+
+            /**
+             *
+             * @return Size of the written file in bytes, 0 until the job succeeds.
+             */
+            [[nodiscard]] std::uint64_t
+            GetBytes() const {
+                std::lock_guard<std::mutex> lock(m_job_->mutex);
+                return m_job_->bytes;
+            }
+
+            /**
+             *
+             * @return Time spent on the worker thread, 0 until the job is done.
+             */
+            [[nodiscard]] double
+            GetDurationMs() const {
+                std::lock_guard<std::mutex> lock(m_job_->mutex);
+                return m_job_->duration_ms;
+            }
+
+        private:
+            [[nodiscard]] bool
+            IsDoneLocked() const {
+                return m_job_->status == Status::kSucceeded || m_job_->status == Status::kFailed;
+            }
+        };
+
+    private:
+        std::deque<std::shared_ptr<Job>> m_queue_{};
+        mutable std::mutex m_mutex_;
+        std::condition_variable m_queue_cv_;  // a job is queued or the writer stops
+        std::condition_variable m_idle_cv_;   // the queue is drained
+        bool m_stop_ = false;
+        bool m_busy_ = false;
+        Metrics m_metrics_{};
+        std::thread m_thread_;
+
+    public:
+        CheckpointWriter();
+
+        CheckpointWriter(const CheckpointWriter &) = delete;
+        CheckpointWriter &
+        operator=(const CheckpointWriter &) = delete;
+        CheckpointWriter(CheckpointWriter &&) = delete;
+        CheckpointWriter &
+        operator=(CheckpointWriter &&) = delete;
+
+        ~CheckpointWriter();
+
+        /**
+         * Queue a job that writes the file with a user-provided function. The function must own
+         * everything it reads, e.g. a snapshot captured by value.
+         * @param filename Path of the checkpoint.
+         * @param write_file Function that writes the complete file at the given temporary path.
+         * @return Ticket of the job.
+         */
+        Ticket
+        Submit(std::string filename, WriteFileFunction write_file);
+
+        /**
+         * Queue a checkpoint of a snapshot handed over by shared pointer (copy-on-write): the
+         * caller keeps a reference but must replace, not modify, the object from now on.
+         * The file is written by Serialization<T>::Write.
+         */
+        template<typename T>
+        Ticket
+        Submit(
+            std::string filename,
+            std::shared_ptr<const T> snapshot,
+            const Format format = Format::kAuto) {
+            return Submit(
+                std::move(filename),
+                [snapshot = std::move(snapshot), format](const std::string &path) {
+                    return Serialization<T>::Write(path, snapshot.get(), format);
+                });
+        }
+
+        /**
+         * Queue a checkpoint of a copy of the object, taken on the calling thread.
+         */
+        template<typename T>
+        Ticket
+        SubmitCopy(std::string filename, const T &obj, const Format format = Format::kAuto) {
+            return Submit<T>(std::move(filename), std::make_shared<const T>(obj), format);
+        }
+
+        /**
+         * Queue a checkpoint taken by a user-provided snapshot function. snapshot_func() runs on
+         * the calling thread and returns a function bool(std::ostream &) that owns the snapshot
+         * and writes it, like the function passed to Serialization<T>::Write.
+         */
+        template<typename T, typename SnapshotFunc>
+        Ticket
+        SubmitSnapshot(
+            std::string filename,
+            SnapshotFunc snapshot_func,
+            const Format format = Format::kAuto) {
+            return Submit(
+                std::move(filename),
+                [write = snapshot_func(), format](const std::string &path) {
+                    return Serialization<T>::Write(path, write, format);
+                });
+        }
+
+        /**
+         * Block until all queued jobs are done.
+         */
+        void
+        WaitAll();
+
+        [[nodiscard]] std::size_t
+        GetQueueDepth() const;
+
+        [[nodiscard]] Metrics
+        GetMetrics() const;
+
+        /**
+         * Write a file atomically on the calling thread: write_file writes a temporary file next
+         * to the target, which is flushed to disk and renamed over the target.
+         * @param filename Path of the file.
+         * @param write_file Function that writes the complete file at the given path.
+         * @param bytes Size of the written file.
+         * @return true if successful. The target is untouched otherwise.
+         */
+        static bool
+        WriteAtomically(
+            const std::string &filename,
+            const WriteFileFunction &write_file,
+            std::uint64_t &bytes);
+
+    private:
+        void
+        Run();
+    };
+}  // namespace erl::common::serialization
@@ -0,0 +1,405 @@
+#pragma once
+
+#include "binary_file.hpp"
+#include "eigen.hpp"
+#include "logging.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace erl::common {
+
+    /**
+     * Append-only columnar binary log for time series. The file starts with a schema and is
+     * followed by row groups. A row group stores each column as one chunk with its own encoding
+     * and min/max statistics, so readers load only the columns and row groups they need.
+     *
+     * File: magic, u32 version, u32 num_columns, per column {u8 type, u8 encoding, u16 name size,
+     * name}, padding to 8 bytes. Row group: u32 kRowGroupMagic, u32 num_columns, u64 num_rows,
+     * u64 group size, per column {u64 offset in group, u64 size, u8 encoding, 7 bytes padding,
+     * 8 bytes min, 8 bytes max}, then the chunks, each aligned to 8 bytes. A truncated last row
+     * group, e.g. after a crash, is ignored by the reader and overwritten when appending.
+     */
+    struct ColumnarLog {
+        enum class Type : std::uint8_t {
+            kFloat64 = 0,
+            kFloat32 = 1,
+            kInt64 = 2,
+            kInt32 = 3,
+            kUInt8 = 4,
+        };
+
+        enum class Encoding : std::uint8_t {
+            kPlain = 0,      // raw values, readable without copy
+            kDelta = 1,      // varint of zigzag deltas (integers) or XOR with the previous value
+            kRunLength = 2,  // varint run length + value, for slowly changing columns
+        };
+
+        struct Column {
+            std::string name{};
+            Type type = Type::kFloat64;
+            Encoding encoding = Encoding::kPlain;
+
+            [[nodiscard]] bool
+            operator==(const Column &other) const {
+                return name == other.name && type == other.type;
+            }
+        };
+
+        struct ColumnChunk {
+            std::uint64_t offset = 0;  // in the file
+            std::uint64_t size = 0;
+            Encoding encoding = Encoding::kPlain;
+            double min = 0.0;  // NaN values are ignored
+            double max = 0.0;
+            std::int64_t min_int = 0;  // exact statistics of integer columns
+            std::int64_t max_int = 0;
+        };
+
+        struct RowGroup {
+            std::uint64_t first_row = 0;
+            std::uint64_t num_rows = 0;
+            std::vector<ColumnChunk> chunks{};
+        };
+
+        inline static constexpr char kMagic[8] = {'\x7f', 'E', 'R', 'L', 'C', 'O', 'L', '\n'};
+        inline static constexpr std::uint32_t kVersion = 1;
+        inline static constexpr std::uint32_t kRowGroupMagic = 0x50524752;  // "RGRP"
+        inline static constexpr std::size_t kRowGroupHeaderSize = 24;
+        inline static constexpr std::size_t kChunkHeaderSize = 40;
+
+        static std::size_t
+        GetTypeSize(Type type);
+
+        static const char *
+        GetTypeName(Type type);
+
+        static bool
+        IsFloatingPoint(const Type type) {
+            return type == Type::kFloat64 || type == Type::kFloat32;
+        }
+
+        template<typename T>
+        static constexpr Type
+        GetType() {
+            if constexpr (std::is_same_v<T, double>) {
+                return Type::kFloat64;
+            } else if constexpr (std::is_same_v<T, float>) {
+                return Type::kFloat32;
+            } else if constexpr (std::is_same_v<T, std::int64_t>) {
+                return Type::kInt64;
+            } else if constexpr (std::is_same_v<T, std::int32_t>) {
+                return Type::kInt32;
+            } else {
+                static_assert(std::is_same_v<T, std::uint8_t>, "Unsupported column type.");
+                return Type::kUInt8;
+            }
+        }
+
+        /**
+         * Encode n values of the given type and compute their statistics.
+         */
+        static void
+        EncodeChunk(
+            Type type,
+            Encoding encoding,
+            const char *values,
+            std::size_t n,
+            std::string &out,
+            ColumnChunk &chunk);
+
+        /**
+         * Decode n values of a chunk into values of type out_type.
+         * @return false if the chunk is malformed.
+         */
+        [[nodiscard]] static bool
+        DecodeChunk(
+            Type type,
+            Encoding encoding,
+            const char *data,
+            std::size_t size,
+            std::size_t n,
+            Type out_type,
+            char *out);
+    };
+
+    class ColumnarLogWriter {
+    public:
+        struct Setting {
+            std::size_t row_group_size = 65536;  // rows buffered before a row group is written
+            bool parallel = true;                // encode the columns in parallel
+        };
+
+    private:
+        Setting m_setting_{};
+        std::string m_path_{};
+        std::ofstream m_ofs_{};
+        std::vector<ColumnarLog::Column> m_columns_{};
+        std::vector<std::vector<char>> m_buffers_{};  // values of the current row group
+        std::size_t m_num_buffered_rows_ = 0;
+        std::uint64_t m_num_rows_ = 0;
+
+    public:
+        ColumnarLogWriter() = default;
+
+        explicit ColumnarLogWriter(const Setting &setting)
+            : m_setting_(setting) {}
+
+        ColumnarLogWriter(const ColumnarLogWriter &) = delete;
+        ColumnarLogWriter &
+        operator=(const ColumnarLogWriter &) = delete;
+        ColumnarLogWriter(ColumnarLogWriter &&) = delete;
+        ColumnarLogWriter &
+        operator=(ColumnarLogWriter &&) = delete;
+
+        ~ColumnarLogWriter() { Close(); }
+
+        /**
+         * Create a log, or append to an existing one with the same columns.
+         * @return false if the file cannot be opened or the columns do not match.
+         */
+        [[nodiscard]] bool
+        Open(
+            const std::string &path,
+            std::vector<ColumnarLog::Column> columns,
+            bool append = false);
+
+        [[nodiscard]] bool
+        IsOpen() const {
+            return m_ofs_.is_open();
+        }
+
+        [[nodiscard]] const std::vector<ColumnarLog::Column> &
+        GetColumns() const {
+            return m_columns_;
+        }
+
+        /**
+         *
+         * @return Number of rows in the file, including the buffered ones.
+         */
+        [[nodiscard]] std::uint64_t
+        GetNumRows() const {
+            return m_num_rows_ + m_num_buffered_rows_;
+        }
+
+        /**
+         * Append one row, one value per column, converted to the column types.
+         */
+        template<typename... Args>
+        void
+        AppendRow(const Args &...values) {
+            ERL_DEBUG_ASSERT(
+                sizeof...(Args) == m_columns_.size(),
+                "{} values for {} columns.",
+                sizeof...(Args),
+                m_columns_.size());
+            std::size_t i = 0;
+            (AppendValue(i++, values), ...);
+            EndRow();
+        }
+
+        template<typename T>
+        void
+        AppendRow(const std::vector<T> &values) {
+            ERL_DEBUG_ASSERT(
+                values.size() == m_columns_.size(),
+                "{} values for {} columns.",
+                values.size(),
+                m_columns_.size());
+            for (std::size_t i = 0; i < values.size(); ++i) { AppendValue(i, values[i]); }
+            EndRow();
+        }
+
+        /**
+         * Write the buffered rows as a row group.
+         */
+        bool
+        Flush();
+
+        void
+        Close();
+
+    private:
+        template<typename T>
+        void
+        AppendValue(const std::size_t column, const T &value) {
+            std::vector<char> &buffer = m_buffers_[column];
+            switch (m_columns_[column].type) {
+                case ColumnarLog::Type::kFloat64:
+                    return Push(buffer, static_cast<double>(value));
+                case ColumnarLog::Type::kFloat32:
+                    return Push(buffer, static_cast<float>(value));
+                case ColumnarLog::Type::kInt64:
+                    return Push(buffer, static_cast<std::int64_t>(value));
+                case ColumnarLog::Type::kInt32:
+                    return Push(buffer, static_cast<std::int32_t>(value));
+                case ColumnarLog::Type::kUInt8:
+                    return Push(buffer, static_cast<std::uint8_t>(value));
+            }
+        }
+
+        template<typename T>
+        static void
+        Push(std::vector<char> &buffer, const T value) {
+            const std::size_t n = buffer.size();
+            buffer.resize(n + sizeof(T));
+            std::memcpy(buffer.data() + n, &value, sizeof(T));
+        }
+
+        void
+        EndRow();
+    };
+
+    class ColumnarLogReader {
+        std::shared_ptr<const MappedFile> m_file_ = nullptr;
+        std::vector<ColumnarLog::Column> m_columns_{};
+        std::vector<ColumnarLog::RowGroup> m_row_groups_{};
+        std::uint64_t m_num_rows_ = 0;
+        std::size_t m_data_begin_ = 0;  // first row group
+        std::size_t m_data_end_ = 0;    // end of the last complete row group
+
+    public:
+        [[nodiscard]] bool
+        Open(const std::string &path);
+
+        [[nodiscard]] bool
+        IsOpen() const {
+            return m_file_ != nullptr;
+        }
+
+        [[nodiscard]] const std::vector<ColumnarLog::Column> &
+        GetColumns() const {
+            return m_columns_;
+        }
+
+        [[nodiscard]] const std::vector<ColumnarLog::RowGroup> &
+        GetRowGroups() const {
+            return m_row_groups_;
+        }
+
+        [[nodiscard]] std::uint64_t
+        GetNumRows() const {
+            return m_num_rows_;
+        }
+
+        /**
+         *
+         * @return Offset in the file right after the last complete row group.
+         */
+        [[nodiscard]] std::size_t
+        GetDataEnd() const {
+            return m_data_end_;
+        }
+
+        /**
+         *
+         * @return Index of the column with the given name, -1 if there is none.
+         */
+        [[nodiscard]] long
+        GetColumnIndex(const std::string &name) const;
+
+        /**
+         * Select the row groups that may contain values of a column in [lower, upper], based on
+         * their statistics.
+         */
+        [[nodiscard]] std::vector<std::size_t>
+        FilterRowGroups(const std::string &column, double lower, double upper) const;
+
+        /**
+         * Read one column, converted to T.
+         * @param row_groups Row groups to read, all if empty.
+         */
+        template<typename T>
+        [[nodiscard]] bool
+        ReadColumn(
+            const std::string &name,
+            Eigen::VectorX<T> &values,
+            const std::vector<std::size_t> &row_groups = {}) const {
+            const long column = GetColumnIndex(name);
+            if (column < 0) {
+                ERL_WARN("Column {} is not in {}.", name, m_file_->GetPath());
+                return false;
+            }
+            values.resize(static_cast<long>(CountRows(row_groups)));
+            return ReadColumn(column, ColumnarLog::GetType<T>(), values.data(), row_groups);
+        }
+
+        /**
+         * Read several columns into the columns of a matrix. Only these columns are read.
+         */
+        template<typename T>
+        [[nodiscard]] bool
+        ReadColumns(
+            const std::vector<std::string> &names,
+            Eigen::MatrixX<T> &matrix,
+            const std::vector<std::size_t> &row_groups = {}) const {
+            const auto num_rows = static_cast<long>(CountRows(row_groups));
+            matrix.resize(num_rows, static_cast<long>(names.size()));
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                const long column = GetColumnIndex(names[i]);
+                if (column < 0) {
+                    ERL_WARN("Column {} is not in {}.", names[i], m_file_->GetPath());
+                    return false;
+                }
+                T *out = matrix.col(static_cast<long>(i)).data();
+                if (!ReadColumn(column, ColumnarLog::GetType<T>(), out, row_groups)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Read a column into a buffer of out_type, which must hold all rows of the row groups.
+         * Fails if a row group is out of range.
+         */
+        [[nodiscard]] bool
+        ReadColumn(
+            long column,
+            ColumnarLog::Type out_type,
+            void *out,
+            const std::vector<std::size_t> &row_groups = {}) const;
+
+        /**
+         * View a plain-encoded chunk in the mapped file without copying.
+         * @return Invalid if the chunk does not exist, is not plain-encoded or T is not the column
+         * type.
+         */
+        template<typename T>
+        [[nodiscard]] MappedArray<T>
+        GetChunkView(const std::size_t row_group, const long column) const {
+            if (!IsOpen() || row_group >= m_row_groups_.size() || column < 0 ||
+                column >= static_cast<long>(m_columns_.size())) {
+                return {};
+            }
+            const ColumnarLog::RowGroup &group = m_row_groups_[row_group];
+            const ColumnarLog::ColumnChunk &chunk = group.chunks[column];
+            if (chunk.encoding != ColumnarLog::Encoding::kPlain ||
+                m_columns_[column].type != ColumnarLog::GetType<T>()) {
+                return {};
+            }
+            return {
+                m_file_,
+                reinterpret_cast<const T *>(m_file_->GetData() + chunk.offset),
+                group.num_rows};
+        }
+
+        /**
+         * Count the rows of the given row groups, all if empty. Out-of-range row groups count no
+         * rows; ReadColumn rejects them.
+         */
+        [[nodiscard]] std::uint64_t
+        CountRows(const std::vector<std::size_t> &row_groups) const;
+
+        /**
+         *
+         * @return True if every row group index is in range.
+         */
+        [[nodiscard]] bool
+        CheckRowGroups(const std::vector<std::size_t> &row_groups) const;
+    };
+}  // namespace erl::common
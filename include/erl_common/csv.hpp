@@ -1,14 +1,259 @@
 #pragma once
 
+#include "binary_file.hpp"
+#include "eigen.hpp"
 #include "logging.hpp"
+#include "string_utils.hpp"
 
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <string_view>
 #include <vector>
 
 namespace erl::common {
 
+    /**
+     * Parse one CSV cell, without surrounding whitespace, with FromChars. An empty cell
+     * is NaN for floating-point types and an error for integer types.
+     * @return true if the whole cell is a valid value of type T.
+     */
+    template<typename T>
+    bool
+    ParseCsvCell(const char *begin, const char *end, T &value) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            value.assign(begin, end);
+            return true;
+        } else {
+            static_assert(
+                std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                "T must be a number or std::string.");
+            if constexpr (std::is_floating_point_v<T>) {
+                if (begin == end) {
+                    value = std::numeric_limits<T>::quiet_NaN();
+                    return true;
+                }
+            }
+            if (begin != end && *begin == '+') { ++begin; }  // not accepted by from_chars
+            const auto [ptr, ec] = FromChars(begin, end, value);
+            return ec == std::errc() && ptr == end;
+        }
+    }
+
+    /**
+     * Fast CSV reader. The file is memory-mapped and split into chunks at line boundaries that
+     * are parsed in parallel, straight into typed columns selected by header name. ForEachRow
+     * streams the rows instead, with constant memory. Cells are trimmed; quoted cells are not
+     * supported, and blank lines are skipped.
+     */
+    class CsvReader {
+    public:
+        struct Setting {
+            char delimiter = ',';
+            bool has_header = true;  // otherwise the columns are named "0", "1", ...
+            std::size_t chunk_size = 4 << 20;
+            bool parallel = true;
+        };
+
+        /**
+         * Cells of one row, valid during the callback of ForEachRow only.
+         */
+        class Row {
+            friend class CsvReader;
+            long m_index_ = 0;
+            std::vector<std::string_view> m_cells_{};
+
+        public:
+            /**
+             *
+             * @return Index of the row, not counting the header.
+             */
+            [[nodiscard]] long
+            GetIndex() const {
+                return m_index_;
+            }
+
+            [[nodiscard]] std::size_t
+            Size() const {
+                return m_cells_.size();
+            }
+
+            [[nodiscard]] std::string_view
+            operator[](const std::size_t i) const {
+                return m_cells_[i];
+            }
+
+            /**
+             * Parse cell i. A missing cell is treated as an empty one.
+             */
+            template<typename T>
+            [[nodiscard]] bool
+            Get(const std::size_t i, T &value) const {
+                if (i >= m_cells_.size()) { return ParseCsvCell<T>(nullptr, nullptr, value); }
+                const std::string_view &cell = m_cells_[i];
+                return ParseCsvCell<T>(cell.data(), cell.data() + cell.size(), value);
+            }
+        };
+
+    private:
+        struct ColumnSink {
+            long column = 0;
+            void *data = nullptr;
+            bool (*parse)(const char *begin, const char *end, void *data, long row) = nullptr;
+        };
+
+        Setting m_setting_{};
+        std::shared_ptr<const MappedFile> m_file_ = nullptr;
+        const char *m_begin_ = nullptr;  // first data row
+        const char *m_end_ = nullptr;
+        std::vector<std::string> m_header_{};
+
+    public:
+        CsvReader() = default;
+
+        explicit CsvReader(const Setting &setting)
+            : m_setting_(setting) {}
+
+        [[nodiscard]] bool
+        Open(const std::string &path);
+
+        [[nodiscard]] bool
+        IsOpen() const {
+            return m_file_ != nullptr;
+        }
+
+        [[nodiscard]] const Setting &
+        GetSetting() const {
+            return m_setting_;
+        }
+
+        [[nodiscard]] const std::vector<std::string> &
+        GetHeader() const {
+            return m_header_;
+        }
+
+        /**
+         *
+         * @return Index of the column with the given name, -1 if there is none.
+         */
+        [[nodiscard]] long
+        GetColumnIndex(const std::string &name) const;
+
+        [[nodiscard]] long
+        CountRows() const;
+
+        /**
+         * Call func for each row in order. The pages already visited are released, so memory
+         * stays constant for files of any size.
+         * @param func Returns false to stop.
+         * @return false if the file is not open.
+         */
+        bool
+        ForEachRow(const std::function<bool(const Row &)> &func) const;
+
+        /**
+         * Read columns into a matrix, one matrix column per CSV column.
+         * @param matrix Resized to (number of rows, number of columns).
+         * @param columns Names of the columns, all columns if empty.
+         * @return true if every selected cell is a valid number.
+         */
+        template<typename T>
+        [[nodiscard]] bool
+        ReadMatrix(
+            Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &matrix,
+            const std::vector<std::string> &columns = {}) const {
+            std::vector<long> indices;
+            if (columns.empty()) {
+                indices.resize(m_header_.size());
+                std::iota(indices.begin(), indices.end(), 0);
+            } else if (!GetColumnIndices(columns.begin(), columns.end(), indices)) {
+                return false;
+            }
+            return ParseColumns([&](const long num_rows) {
+                matrix.resize(num_rows, static_cast<long>(indices.size()));
+                std::vector<ColumnSink> sinks;
+                sinks.reserve(indices.size());
+                for (std::size_t i = 0; i < indices.size(); ++i) {
+                    sinks.push_back(MakeSink(indices[i], matrix.col(static_cast<long>(i)).data()));
+                }
+                return sinks;
+            });
+        }
+
+        /**
+         * Read columns of different types by name, e.g.
+         * ReadColumns({"time", "x", "id"}, times, xs, ids) with Eigen::VectorXd times, xs and
+         * Eigen::VectorXi ids. A column is anything with resize(n) and data(), e.g.
+         * Eigen::VectorX<T> or std::vector<T>, including std::vector<std::string>.
+         * @return true if every selected cell is valid.
+         */
+        template<typename... Columns>
+        [[nodiscard]] bool
+        ReadColumns(
+            const std::array<std::string, sizeof...(Columns)> &names,
+            Columns &...columns) const {
+            std::vector<long> indices;
+            if (!GetColumnIndices(names.begin(), names.end(), indices)) { return false; }
+            return ParseColumns([&](const long num_rows) {
+                std::vector<ColumnSink> sinks;
+                sinks.reserve(sizeof...(Columns));
+                auto add_sink = [&](auto &column) {
+                    column.resize(num_rows);
+                    sinks.push_back(MakeSink(indices[sinks.size()], column.data()));
+                };
+                (add_sink(columns), ...);
+                return sinks;
+            });
+        }
+
+    private:
+        template<typename T>
+        static bool
+        ParseInto(const char *begin, const char *end, void *data, const long row) {
+            return ParseCsvCell<T>(begin, end, static_cast<T *>(data)[row]);
+        }
+
+        template<typename T>
+        static ColumnSink
+        MakeSink(const long column, T *data) {
+            return {column, data, &ParseInto<T>};
+        }
+
+        template<typename Iterator>
+        bool
+        GetColumnIndices(Iterator begin, Iterator end, std::vector<long> &indices) const {
+            indices.clear();
+            for (; begin != end; ++begin) {
+                const long index = GetColumnIndex(*begin);
+                if (index < 0) {
+                    ERL_WARN("Column {} is not in the header of {}.", *begin, m_file_->GetPath());
+                    return false;
+                }
+                indices.push_back(index);
+            }
+            return true;
+        }
+
+        /**
+         * Split the data rows into chunks of about chunk_size bytes at line boundaries.
+         * @return Boundaries of the chunks, number of chunks + 1.
+         */
+        [[nodiscard]] std::vector<const char *>
+        SplitChunks() const;
+
+        /**
+         * Count the rows, call prepare(num_rows) to allocate the columns, then parse the chunks
+         * into the returned sinks.
+         */
+        [[nodiscard]] bool
+        ParseColumns(const std::function<std::vector<ColumnSink>(long)> &prepare) const;
+    };
+
     std::vector<std::vector<std::string>>
     LoadCsvFile(const char *path, char delimiter = ',');
 
@@ -18,30 +263,23 @@ namespace erl::common {
         const char *path,
         std::function<T(const std::string &)> cast_func,
         char delimiter = ',') {
-        std::ifstream ifs;
-        ifs.open(path);
-        if (!ifs.is_open()) { ERL_FATAL("Fail to open file: {}", path); }
+        CsvReader::Setting setting;
+        setting.delimiter = delimiter;
+        setting.has_header = false;
+        CsvReader reader(setting);
+        if (!reader.Open(path)) { ERL_FATAL("Fail to open file: {}", path); }
 
         std::vector<std::vector<T>> rows;
-        std::string line;
         std::string cell;
-
-        while (std::getline(ifs, line)) {
-            std::stringstream ss(line);
-            std::vector<T> row;
-
-            while (std::getline(ss, cell, delimiter)) {
-                const auto *type_of_whitespaces = "\t\n\r ";
-                auto first = cell.find_first_not_of(type_of_whitespaces);
-                auto last = cell.find_last_not_of(type_of_whitespaces);
-                cell = cell.substr(first, (last - first + 1));
-                row.push_back(cast_func(cell));
+        reader.ForEachRow([&](const CsvReader::Row &row) {
+            std::vector<T> &casted_row = rows.emplace_back();
+            casted_row.reserve(row.Size());
+            for (std::size_t i = 0; i < row.Size(); ++i) {
+                cell.assign(row[i]);
+                casted_row.push_back(cast_func(cell));
             }
-
-            rows.push_back(row);
-        }
-
-        ifs.close();
+            return true;
+        });
         return rows;
     }
 
@@ -54,28 +292,197 @@ namespace erl::common {
         return LoadAndCastCsvFile<T>(path.c_str(), cast_func, delimiter);
     }
 
+    /**
+     * Append a value to a CSV buffer. Numbers are formatted by AppendChars, floating-point
+     * numbers in the shortest form that reads back exactly.
+     */
+    template<typename T>
+    void
+    AppendCsvValue(std::string &buffer, const T &value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            buffer.push_back(value ? '1' : '0');
+        } else if constexpr (std::is_same_v<T, char>) {
+            buffer.push_back(value);
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            AppendChars(buffer, value);
+        } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            buffer.append(std::string_view(value));
+        } else {
+            std::ostringstream ss;
+            ss << value;
+            buffer.append(ss.str());
+        }
+    }
+
+    /**
+     * Buffered CSV writer. Rows are formatted into a large buffer that goes to the file in one
+     * write once it is full, instead of a stream operation per value and a flush per row. Rows
+     * of an Eigen matrix are formatted in blocks in parallel.
+     */
+    class CsvWriter {
+    public:
+        struct Setting {
+            char delimiter = ',';
+            std::size_t buffer_size = 1 << 20;  // bytes buffered before writing to the file
+            double flush_period = 0;            // seconds, also flush after this period if > 0
+            std::size_t block_rows = 4096;      // rows per parallel formatting task
+            bool parallel = true;
+        };
+
+    private:
+        Setting m_setting_{};
+        std::ofstream m_ofs_{};
+        std::string m_buffer_{};
+        std::chrono::steady_clock::time_point m_last_flush_{};
+
+    public:
+        CsvWriter() = default;
+
+        explicit CsvWriter(const Setting &setting)
+            : m_setting_(setting) {}
+
+        CsvWriter(const CsvWriter &) = delete;
+        CsvWriter &
+        operator=(const CsvWriter &) = delete;
+        CsvWriter(CsvWriter &&) = default;
+        CsvWriter &
+        operator=(CsvWriter &&) = delete;
+
+        ~CsvWriter() { Close(); }
+
+        [[nodiscard]] bool
+        Open(const std::string &path, bool append = false);
+
+        [[nodiscard]] bool
+        IsOpen() const {
+            return m_ofs_.is_open();
+        }
+
+        [[nodiscard]] const Setting &
+        GetSetting() const {
+            return m_setting_;
+        }
+
+        /**
+         * Write the buffered rows to the file.
+         * @return true if the file is good.
+         */
+        bool
+        Flush();
+
+        void
+        Close();
+
+        /**
+         * Write one row of values of any mix of types.
+         */
+        template<typename... Args>
+        void
+        WriteRow(const Args &...values) {
+            std::size_t i = 0;
+            auto append = [&](const auto &value) {
+                if (i++ > 0) { m_buffer_.push_back(m_setting_.delimiter); }
+                AppendCsvValue(m_buffer_, value);
+            };
+            (append(values), ...);
+            EndRow();
+        }
+
+        /**
+         * Write one row from a container, e.g. a header.
+         */
+        template<typename Container>
+        void
+        WriteRange(const Container &values) {
+            bool first = true;
+            for (const auto &value: values) {
+                if (!first) { m_buffer_.push_back(m_setting_.delimiter); }
+                AppendCsvValue(m_buffer_, value);
+                first = false;
+            }
+            EndRow();
+        }
+
+        /**
+         * Write the rows of a matrix.
+         */
+        template<typename Derived>
+        bool
+        WriteMatrix(const Eigen::DenseBase<Derived> &matrix) {
+            const long rows = matrix.rows();
+            const long block_rows = std::max<long>(static_cast<long>(m_setting_.block_rows), 1);
+            const long num_blocks = (rows + block_rows - 1) / block_rows;
+            constexpr long kBlocksPerBatch = 64;  // bounds the memory of formatted blocks
+            std::vector<std::string> buffers(std::min(num_blocks, kBlocksPerBatch));
+            for (long b0 = 0; b0 < num_blocks; b0 += kBlocksPerBatch) {
+                const long n = std::min(kBlocksPerBatch, num_blocks - b0);
+#pragma omp parallel for schedule(dynamic) if (m_setting_.parallel && n > 1)
+                for (long b = 0; b < n; ++b) {
+                    std::string &buffer = buffers[b];
+                    buffer.clear();
+                    const long r0 = (b0 + b) * block_rows;
+                    const long r1 = std::min(r0 + block_rows, rows);
+                    for (long r = r0; r < r1; ++r) { AppendRow(buffer, matrix.derived().row(r)); }
+                }
+                for (long b = 0; b < n; ++b) { Append(buffers[b]); }
+            }
+            return m_ofs_.good();
+        }
+
+    private:
+        template<typename Row>
+        void
+        AppendRow(std::string &buffer, const Row &row) const {
+            for (long c = 0; c < row.size(); ++c) {
+                if (c > 0) { buffer.push_back(m_setting_.delimiter); }
+                AppendCsvValue(buffer, row[c]);
+            }
+            buffer.push_back('\n');
+        }
+
+        void
+        EndRow();
+
+        /**
+         * Append preformatted rows.
+         */
+        void
+        Append(const std::string &rows);
+    };
+
     template<typename T>
     void
     SaveCsvFile(
         const char *path,
         const std::vector<std::vector<T>> &rows,
         const char delimiter = ',') {
-        std::ofstream ofs;
-        ofs.open(path);
-        if (!ofs.is_open()) { ERL_FATAL("Fail to open file: {}", path); }
-
-        for (const auto &row: rows) {
-            auto iter = row.begin();
-            ofs << *iter;
-            ++iter;
-            while (iter < row.end()) {
-                ofs << delimiter << *iter;
-                ++iter;
-            }
-            ofs << std::endl;
-        }
+        CsvWriter::Setting setting;
+        setting.delimiter = delimiter;
+        CsvWriter writer(setting);
+        if (!writer.Open(path)) { ERL_FATAL("Fail to open file: {}", path); }
+        for (const auto &row: rows) { writer.WriteRange(row); }
+        writer.Close();
+    }
 
-        ofs.close();
+    /**
+     * Save a matrix as CSV, one matrix row per line.
+     * @param header Column names, no header line if empty.
+     */
+    template<typename Derived>
+    bool
+    SaveEigenMatrixToCsvFile(
+        const std::string &path,
+        const Eigen::DenseBase<Derived> &matrix,
+        const std::vector<std::string> &header = {},
+        const char delimiter = ',') {
+        CsvWriter::Setting setting;
+        setting.delimiter = delimiter;
+        CsvWriter writer(setting);
+        if (!writer.Open(path)) { return false; }
+        if (!header.empty()) { writer.WriteRange(header); }
+        const bool success = writer.WriteMatrix(matrix) && writer.Flush();
+        writer.Close();
+        return success;
     }
 
     struct SimpleCsv {
@@ -1,10 +1,9 @@
 #pragma once
 
 #include "logging.hpp"
+#include "occupancy_bitmap.hpp"
 #include "serialization.hpp"
 
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 namespace erl::common {
@@ -13,164 +12,74 @@ namespace erl::common {
     class DataBufferManager {
     public:
         using DataBuffer = Buffer;
+        static constexpr std::size_t kInvalidIndex = static_cast<std::size_t>(-1);
 
-        class Iterator {
-            DataBufferManager *m_manager_;
-            std::unordered_set<std::size_t> m_available_indices_;
+        template<typename Manager, typename Value>
+        class IteratorImpl {
+            Manager *m_manager_;
             std::size_t m_index_ = 0;
 
         public:
-            explicit Iterator(DataBufferManager *manager)
+            explicit IteratorImpl(Manager *manager)
                 : m_manager_(manager) {
                 if (m_manager_ == nullptr) { return; }
-                if (m_manager_->m_entries_.empty()) {
-                    m_manager_ = nullptr;
-                    return;
-                }
-                m_available_indices_.insert(
-                    m_manager_->m_available_indices_.begin(),
-                    m_manager_->m_available_indices_.end());
-                m_index_ = 0;
-                while (m_index_ < m_manager_->m_entries_.size() &&
-                       m_available_indices_.count(m_index_)) {
-                    ++m_index_;
-                }
-                if (m_index_ >= m_manager_->m_entries_.size()) {
-                    m_manager_ = nullptr;
-                    return;
-                }
+                m_index_ = m_manager_->m_occupancy_.FindNext(0);
+                if (m_index_ >= m_manager_->m_entries_.size()) { m_manager_ = nullptr; }
             }
 
-            Iterator(const Iterator &other) = default;
-            Iterator &
-            operator=(const Iterator &other) = default;
-            Iterator(Iterator &&other) = default;
-            Iterator &
-            operator=(Iterator &&other) = default;
-
-            ~Iterator() = default;
-
             [[nodiscard]] bool
-            operator==(const Iterator &other) const {
+            operator==(const IteratorImpl &other) const {
                 if (m_manager_ != other.m_manager_) { return false; }
                 if (m_manager_ == nullptr) { return true; }
                 return m_index_ == other.m_index_;
             }
 
             [[nodiscard]] bool
-            operator!=(const Iterator &other) const {
+            operator!=(const IteratorImpl &other) const {
                 return !(*this == other);
             }
 
-            T &
-            operator*() {
+            Value &
+            operator*() const {
                 return m_manager_->m_entries_[m_index_];
             }
 
-            T *
-            operator->() {
+            Value *
+            operator->() const {
                 return &operator*();
             }
 
-            Iterator &
+            IteratorImpl &
             operator++() {
-                ++m_index_;
-                while (m_index_ < m_manager_->m_entries_.size() &&
-                       m_available_indices_.count(m_index_)) {
-                    ++m_index_;
-                }
+                m_index_ = m_manager_->m_occupancy_.FindNext(m_index_ + 1);
                 if (m_index_ >= m_manager_->m_entries_.size()) { m_manager_ = nullptr; }
                 return *this;
             }
 
-            Iterator
+            IteratorImpl
             operator++(int) {
-                Iterator tmp = *this;
+                IteratorImpl tmp = *this;
                 ++(*this);
                 return tmp;
             }
-        };
-
-        class ConstIterator {
-            const DataBufferManager *m_manager_;
-            std::unordered_set<std::size_t> m_available_indices_;
-            std::size_t m_index_ = 0;
-
-        public:
-            explicit ConstIterator(const DataBufferManager *manager)
-                : m_manager_(manager) {
-                if (m_manager_ == nullptr) { return; }
-                if (m_manager_->m_entries_.empty()) {
-                    m_manager_ = nullptr;
-                    return;
-                }
-                m_available_indices_.insert(
-                    m_manager_->m_available_indices_.begin(),
-                    m_manager_->m_available_indices_.end());
-                m_index_ = 0;
-                while (m_index_ < m_manager_->m_entries_.size() &&
-                       m_available_indices_.count(m_index_)) {
-                    ++m_index_;
-                }
-                if (m_index_ >= m_manager_->m_entries_.size()) {
-                    m_manager_ = nullptr;
-                    return;
-                }
-            }
-
-            ConstIterator(const ConstIterator &other) = default;
-            ConstIterator &
-            operator=(const ConstIterator &other) = default;
-            ConstIterator(ConstIterator &&other) = default;
-            ConstIterator &
-            operator=(ConstIterator &&other) = default;
-
-            ~ConstIterator() = default;
-
-            [[nodiscard]] bool
-            operator==(const ConstIterator &other) const {
-                if (m_manager_ != other.m_manager_) { return false; }
-                if (m_manager_ == nullptr) { return true; }
-                return m_index_ == other.m_index_;
-            }
-
-            [[nodiscard]] bool
-            operator!=(const ConstIterator &other) const {
-                return !(*this == other);
-            }
-
-            const T &
-            operator*() {
-                return m_manager_->m_entries_[m_index_];
-            }
 
-            const T *
-            operator->() {
-                return &operator*();
-            }
-
-            ConstIterator &
-            operator++() {
-                ++m_index_;
-                while (m_index_ < m_manager_->m_entries_.size() &&
-                       m_available_indices_.count(m_index_)) {
-                    ++m_index_;
-                }
-                if (m_index_ >= m_manager_->m_entries_.size()) { m_manager_ = nullptr; }
-                return *this;
-            }
-
-            ConstIterator
-            operator++(int) {
-                Iterator tmp = *this;
-                ++(*this);
-                return tmp;
+            /**
+             *
+             * @return The index of the entry the iterator points to.
+             */
+            [[nodiscard]] std::size_t
+            Index() const {
+                return m_index_;
             }
         };
 
+        using Iterator = IteratorImpl<DataBufferManager, T>;
+        using ConstIterator = IteratorImpl<const DataBufferManager, const T>;
+
     private:
         DataBuffer m_entries_;
         std::vector<std::size_t> m_available_indices_;
+        OccupancyBitmap m_occupancy_;  // marks the entries in use, rebuilt on Read
 
     public:
         DataBufferManager() = default;
@@ -192,12 +101,14 @@ namespace erl::common {
         void
         Reserve(std::size_t size) {
             m_entries_.reserve(size);
+            m_occupancy_.Reserve(size);
         }
 
         [[nodiscard]] std::size_t
         AddEntry(T &&entry) {
             if (m_available_indices_.empty()) {
-                m_entries_.emplace_back(entry);
+                m_entries_.emplace_back(std::move(entry));
+                m_occupancy_.PushBack(true);
                 return m_entries_.size() - 1;
             }
 
@@ -205,6 +116,7 @@ namespace erl::common {
             m_available_indices_.pop_back();
             ERL_DEBUG_ASSERT(index < m_entries_.size(), "Index {} is out of range.", index);
             m_entries_[index] = std::move(entry);
+            m_occupancy_.Set(index);
             return index;
         }
 
@@ -223,23 +135,33 @@ namespace erl::common {
         AllocateEntry() {
             if (m_available_indices_.empty()) {
                 m_entries_.emplace_back(T());  // default construct a new entry
-                return m_entries_.size() - 1;
+                m_occupancy_.PushBack(true);
+                return {m_entries_.size() - 1, m_entries_.back()};
             }
             std::size_t index = m_available_indices_.back();
             m_available_indices_.pop_back();
             ERL_DEBUG_ASSERT(index < m_entries_.size(), "Index {} is out of range.", index);
+            m_occupancy_.Set(index);
             return {index, m_entries_[index]};
         }
 
         void
         RemoveEntry(const std::size_t index) {
-            ERL_DEBUG_ASSERT(index != static_cast<std::size_t>(-1), "Index is invalid.");
+            ERL_DEBUG_ASSERT(index != kInvalidIndex, "Index is invalid.");
             ERL_DEBUG_ASSERT(index < m_entries_.size(), "Index {} is out of range.", index);
+            ERL_DEBUG_ASSERT(m_occupancy_.Test(index), "Index {} is already removed.", index);
             m_available_indices_.push_back(index);
-            ERL_DEBUG_ASSERT(
-                std::unordered_set(m_available_indices_.begin(), m_available_indices_.end())
-                        .size() == m_available_indices_.size(),
-                "Redundant indices");
+            m_occupancy_.Reset(index);
+        }
+
+        /**
+         *
+         * @param index Index of an entry.
+         * @return true if the entry is in use, i.e. added and not removed.
+         */
+        [[nodiscard]] bool
+        IsInUse(const std::size_t index) const {
+            return index < m_entries_.size() && m_occupancy_.Test(index);
         }
 
         T &
@@ -256,20 +178,13 @@ namespace erl::common {
 
         [[nodiscard]] bool
         operator==(const DataBufferManager &other) const {
-            if (m_entries_.size() - m_available_indices_.size() !=
-                other.m_entries_.size() - other.m_available_indices_.size()) {
-                return false;
-            }
-            const std::unordered_set available_indices(
-                m_available_indices_.begin(),
-                m_available_indices_.end());
-            for (std::size_t i = 0; i < m_entries_.size(); ++i) {
-                if (!available_indices.count(i)) { continue; }
-                if (i >= other.m_entries_.size() || m_entries_[i] != other.m_entries_[i]) {
-                    return false;
-                }
-            }
-            return true;
+            if (Size() != other.Size()) { return false; }
+            bool equal = true;
+            m_occupancy_.ForEach([&](const std::size_t i) {
+                if (!equal) { return; }
+                equal = other.IsInUse(i) && m_entries_[i] == other.m_entries_[i];
+            });
+            return equal;
         }
 
         [[nodiscard]] bool
@@ -287,33 +202,37 @@ namespace erl::common {
             return m_available_indices_;
         }
 
+        [[nodiscard]] const OccupancyBitmap &
+        GetOccupancy() const {
+            return m_occupancy_;
+        }
+
         void
         Clear() {
             m_entries_.clear();
             m_available_indices_.clear();
+            m_occupancy_.Clear();
         }
 
-        std::unordered_map<std::size_t, std::size_t>
+        /**
+         * Move all entries in use to the front of the buffer and release the removed ones.
+         * @return A vector mapping old indices to new ones, kInvalidIndex for removed entries.
+         */
+        std::vector<std::size_t>
         Compact() {
-            std::unordered_map<std::size_t, std::size_t> index_mapping;
-            if (m_available_indices_.empty()) {
-                for (std::size_t i = 0; i < m_entries_.size(); ++i) { index_mapping[i] = i; }
-                return index_mapping;
-            }
-            std::sort(m_available_indices_.begin(), m_available_indices_.end());
-            std::size_t remove_idx = 0;
+            std::vector<std::size_t> index_mapping(m_entries_.size(), kInvalidIndex);
             std::size_t write_idx = 0;
-            for (std::size_t read_idx = 0; read_idx < m_entries_.size(); ++read_idx) {
-                if (remove_idx < m_available_indices_.size() &&
-                    read_idx == m_available_indices_[remove_idx]) {
-                    ++remove_idx;
-                    continue;
-                }
+            m_occupancy_.ForEach([&](const std::size_t read_idx) {
                 index_mapping[read_idx] = write_idx;
-                m_entries_[write_idx++] = std::move(m_entries_[read_idx]);
-            }
+                if (read_idx != write_idx) {
+                    m_entries_[write_idx] = std::move(m_entries_[read_idx]);
+                }
+                ++write_idx;
+            });
             m_entries_.resize(write_idx);
             m_available_indices_.clear();
+            m_occupancy_.SetFirst(write_idx);
+            m_occupancy_.Resize(write_idx);
             return index_mapping;
         }
 
@@ -326,14 +245,7 @@ namespace erl::common {
                     [](const DataBufferManager *self, std::ostream &stream) {
                         const std::size_t size = self->m_entries_.size();
                         stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
-                        const T *entry = self->m_entries_.data();
-                        for (std::size_t i = 0; i < size; ++i, ++entry) {
-                            if (!Writer<T>::Run(entry, stream)) {
-                                ERL_WARN("Failed to write entry {}.", i);
-                                return false;
-                            }
-                        }
-                        return true;
+                        return WriteArray(stream, self->m_entries_.data(), size);
                     },
                 },
                 {
@@ -341,10 +253,48 @@ namespace erl::common {
                     [](const DataBufferManager *self, std::ostream &stream) {
                         const std::size_t size = self->m_available_indices_.size();
                         stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
-                        for (const auto &index: self->m_available_indices_) {
-                            stream.write(reinterpret_cast<const char *>(&index), sizeof(index));
+                        return WriteArray(stream, self->m_available_indices_.data(), size);
+                    },
+                },
+            };
+            return WriteTokens(s, this, token_function_pairs);
+        }
+
+        /**
+         * Write only the entries in use, as if Compact() was called before Write(). The manager
+         * itself is not modified. Reading the stream with Read() gives a compacted manager whose
+         * entries keep their relative order.
+         * @param s The output stream to write to.
+         * @return true if successful.
+         */
+        [[nodiscard]] bool
+        WriteLive(std::ostream &s) const {
+            using namespace serialization;
+            static const TokenWriteFunctionPairs<DataBufferManager> token_function_pairs = {
+                {
+                    "entries",
+                    [](const DataBufferManager *self, std::ostream &stream) {
+                        const std::size_t size = self->Size();
+                        stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
+                        // write each run of consecutive entries in use at once
+                        const OccupancyBitmap &occupancy = self->m_occupancy_;
+                        std::size_t begin = occupancy.FindNext(0);
+                        while (begin < occupancy.Size()) {
+                            const std::size_t end = occupancy.FindNextEmpty(begin);
+                            if (!WriteArray(stream, self->m_entries_.data() + begin, end - begin)) {
+                                return false;
+                            }
+                            begin = occupancy.FindNext(end);
                         }
-                        return true;
+                        return stream.good();
+                    },
+                },
+                {
+                    "available_indices",
+                    [](const DataBufferManager *, std::ostream &stream) {
+                        constexpr std::size_t size = 0;
+                        stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
+                        return stream.good();
                     },
                 },
             };
@@ -361,14 +311,7 @@ namespace erl::common {
                         std::size_t size;
                         stream.read(reinterpret_cast<char *>(&size), sizeof(size));
                         self->m_entries_.resize(size);
-                        T *entry = self->m_entries_.data();
-                        for (std::size_t i = 0; i < size; ++i, ++entry) {
-                            if (!Reader<T>::Run(entry, stream)) {
-                                ERL_WARN("Failed to read entry {}.", i);
-                                return false;
-                            }
-                        }
-                        return true;
+                        return ReadArray(stream, self->m_entries_.data(), size);
                     },
                 },
                 {
@@ -377,10 +320,21 @@ namespace erl::common {
                         std::size_t size;
                         stream.read(reinterpret_cast<char *>(&size), sizeof(size));
                         self->m_available_indices_.resize(size);
-                        for (std::size_t i = 0; i < size; ++i) {
-                            stream.read(
-                                reinterpret_cast<char *>(&self->m_available_indices_[i]),
-                                sizeof(std::size_t));
+                        if (!ReadArray(stream, self->m_available_indices_.data(), size)) {
+                            return false;
+                        }
+                        self->m_occupancy_.Clear();
+                        self->m_occupancy_.Resize(self->m_entries_.size(), true);
+                        for (const std::size_t &index: self->m_available_indices_) {
+                            if (index >= self->m_entries_.size() ||
+                                !self->m_occupancy_.Test(index)) {
+                                ERL_WARN(
+                                    "Available index {} is out of range or repeated, {} entries.",
+                                    index,
+                                    self->m_entries_.size());
+                                return false;
+                            }
+                            self->m_occupancy_.Reset(index);
                         }
                         return true;
                     },
@@ -2,7 +2,10 @@
 
 #include "compile_definitions.hpp"
 
+#include "binary_file.hpp"
 #include "logging.hpp"
+#include "serialization.hpp"
+#include "string_utils.hpp"
 
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
@@ -116,6 +119,15 @@ namespace Eigen {
 
 namespace erl::common {
 
+    namespace serialization {
+        // the coefficients of a fixed-size matrix are stored inline, so its bytes can be copied
+        template<typename T, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+        struct IsBulkSerializable<
+            Eigen::Matrix<T, Rows, Cols, Options, MaxRows, MaxCols>,
+            std::enable_if_t<Rows != Eigen::Dynamic && Cols != Eigen::Dynamic>>
+            : std::is_trivially_copyable<T> {};
+    }  // namespace serialization
+
     template<typename T, int Rows, int Cols>
     Eigen::MatrixX<T>
     DownsampleEigenMatrix(const Eigen::Matrix<T, Rows, Cols> &mat, int row_stride, int col_stride) {
@@ -193,6 +205,23 @@ namespace erl::common {
     Eigen::IOFormat
     GetEigenTextFormat(EigenTextFormat format);
 
+    /**
+     * Format a matrix with the layout of GetEigenTextFormat(format), without going through a
+     * stream. Numbers are written by AppendChars in the shortest form that reads back exactly,
+     * and columns are not padded to a common width. Blocks of rows are formatted in parallel.
+     * @param buffer Output, the text is appended so the buffer can be reused.
+     */
+    template<typename Derived>
+    void
+    AppendEigenText(
+        std::string &buffer,
+        const Eigen::DenseBase<Derived> &matrix,
+        EigenTextFormat format = EigenTextFormat::kDefaultFmt,
+        bool parallel = true);
+
+    /**
+     * Save a matrix as text, formatted like AppendEigenText.
+     */
     template<typename T>
     void
     SaveEigenMatrixToTextFile(
@@ -207,8 +236,9 @@ namespace erl::common {
      * @tparam Cols Number of columns of the matrix. Use Eigen::Dynamic for dynamic size.
      * @tparam RowMajor Storage order of the matrix. Use Eigen::ColMajor for column-major order,
      * Eigen::RowMajor for row-major order.
-     * @param file_path Path to the text file.
-     * @param format Format of the text file.
+     * @param file_path Path to the text file, memory-mapped and parsed in parallel. The
+     * separators and brackets of all EigenTextFormat layouts are recognized, lines without
+     * numbers are skipped.
      * @param transpose Whether the returned matrix is the transpose of the matrix in the file.
      * @return Eigen matrix loaded from the text file.
      */
@@ -218,9 +248,22 @@ namespace erl::common {
         int Cols = Eigen::Dynamic,
         int RowMajor = Eigen::ColMajor>
     Eigen::Matrix<T, Rows, Cols, RowMajor>
+    LoadEigenMatrixFromTextFile(const std::string &file_path, bool transpose = false);
+
+    /**
+     * @deprecated The format is ignored since the loader recognizes all EigenTextFormat layouts.
+     * Use LoadEigenMatrixFromTextFile(file_path, transpose) instead.
+     */
+    template<
+        typename T,
+        int Rows = Eigen::Dynamic,
+        int Cols = Eigen::Dynamic,
+        int RowMajor = Eigen::ColMajor>
+    [[deprecated("the format is ignored, use LoadEigenMatrixFromTextFile(file_path, transpose)")]]
+    Eigen::Matrix<T, Rows, Cols, RowMajor>
     LoadEigenMatrixFromTextFile(
         const std::string &file_path,
-        EigenTextFormat format = EigenTextFormat::kDefaultFmt,
+        EigenTextFormat format,
         bool transpose = false);
 
     template<typename T = double, int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic>
@@ -285,6 +328,372 @@ namespace erl::common {
         std::istream &s,
         Eigen::Matrix<Eigen::Matrix<T, Rows1, Cols1>, Rows2, Cols2> &matrix_of_matrices);
 
+    /**
+     * Matrix viewed directly in a memory-mapped file written by SaveEigenMatrixToBinaryStream. The
+     * view keeps the mapping alive, so it can outlive the call that created it.
+     */
+    template<typename T = double, int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic>
+    class MappedEigenMatrix {
+    public:
+        using Matrix = Eigen::Matrix<T, Rows, Cols>;
+        using Map = Eigen::Map<const Matrix>;
+
+    private:
+        std::shared_ptr<const MappedFile> m_file_ = nullptr;
+        const T *m_data_ = nullptr;
+        long m_rows_ = Rows == Eigen::Dynamic ? 0 : Rows;
+        long m_cols_ = Cols == Eigen::Dynamic ? 0 : Cols;
+        std::size_t m_end_offset_ = 0;
+
+    public:
+        MappedEigenMatrix() = default;
+
+        MappedEigenMatrix(
+            std::shared_ptr<const MappedFile> file,
+            const T *data,
+            const long rows,
+            const long cols,
+            const std::size_t end_offset)
+            : m_file_(std::move(file)),
+              m_data_(data),
+              m_rows_(rows),
+              m_cols_(cols),
+              m_end_offset_(end_offset) {}
+
+        [[nodiscard]] bool
+        IsValid() const {
+            return m_file_ != nullptr;
+        }
+
+        [[nodiscard]] const std::shared_ptr<const MappedFile> &
+        GetFile() const {
+            return m_file_;
+        }
+
+        /**
+         *
+         * @return Offset in the file right after the matrix, where the next record starts.
+         */
+        [[nodiscard]] std::size_t
+        GetEndOffset() const {
+            return m_end_offset_;
+        }
+
+        [[nodiscard]] long
+        rows() const {
+            return m_rows_;
+        }
+
+        [[nodiscard]] long
+        cols() const {
+            return m_cols_;
+        }
+
+        [[nodiscard]] Map
+        Get() const {
+            return Map(m_data_, m_rows_, m_cols_);
+        }
+
+        [[nodiscard]] Map
+        operator*() const {
+            return Get();
+        }
+    };
+
+    /**
+     * Map a matrix stored by SaveEigenMatrixToBinaryStream at the given offset of a mapped file.
+     * @param file Mapped file.
+     * @param offset Offset of the matrix in the file, e.g. GetEndOffset() of the previous matrix.
+     * @return View of the matrix, invalid if the record is malformed or misaligned.
+     */
+    template<typename T = double, int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic>
+    MappedEigenMatrix<T, Rows, Cols>
+    MapEigenMatrixFromMappedFile(
+        const std::shared_ptr<const MappedFile> &file,
+        std::size_t offset = 0);
+
+    /**
+     * Map a matrix file written by SaveEigenMatrixToBinaryFile instead of loading it. Pages are
+     * read on first access and shared with other processes mapping the same file.
+     */
+    template<typename T = double, int Rows = Eigen::Dynamic, int Cols = Eigen::Dynamic>
+    MappedEigenMatrix<T, Rows, Cols>
+    MapEigenMatrixFromBinaryFile(
+        const std::string &file_path,
+        MappedFile::Advice advice = MappedFile::Advice::kNormal);
+
+    /**
+     * Streams a column-major matrix file written by SaveEigenMatrixToBinaryFile in blocks of
+     * columns, for matrices that do not fit in memory. The block buffer is reused, so only one
+     * block is held at a time.
+     */
+    template<typename T = double, int Rows = Eigen::Dynamic>
+    class EigenBinaryColumnBlockReader {
+    public:
+        using Block = Eigen::Matrix<T, Rows, Eigen::Dynamic>;
+
+    private:
+        std::ifstream m_ifs_{};
+        std::streamoff m_data_offset_ = 0;
+        long m_rows_ = 0;
+        long m_cols_ = 0;
+        long m_block_cols_ = 0;
+        long m_next_col_ = 0;
+        long m_block_begin_ = 0;
+        Block m_block_{};
+
+    public:
+        /**
+         * @param file_path Path of the matrix file.
+         * @param block_cols Maximum number of columns per block.
+         * @param offset Offset of the matrix in the file.
+         */
+        EigenBinaryColumnBlockReader(
+            const std::string &file_path,
+            long block_cols,
+            std::streamoff offset = 0);
+
+        [[nodiscard]] bool
+        IsOpen() const {
+            return m_ifs_.is_open();
+        }
+
+        [[nodiscard]] long
+        GetRows() const {
+            return m_rows_;
+        }
+
+        [[nodiscard]] long
+        GetCols() const {
+            return m_cols_;
+        }
+
+        [[nodiscard]] long
+        GetBlockCols() const {
+            return m_block_cols_;
+        }
+
+        [[nodiscard]] bool
+        HasNext() const {
+            return IsOpen() && m_next_col_ < m_cols_;
+        }
+
+        /**
+         * Move to the given column, the next block starts there.
+         */
+        [[nodiscard]] bool
+        Seek(long col);
+
+        /**
+         * Read the next block of columns.
+         * @return false at the end of the matrix or on a read error.
+         */
+        [[nodiscard]] bool
+        Next();
+
+        /**
+         *
+         * @return Index of the first column of the current block.
+         */
+        [[nodiscard]] long
+        GetBlockBegin() const {
+            return m_block_begin_;
+        }
+
+        [[nodiscard]] const Block &
+        GetBlock() const {
+            return m_block_;
+        }
+
+        /**
+         * Call func(long col_begin, const Block &block) for each remaining block.
+         * @return true if all blocks were read.
+         */
+        template<typename Func>
+        bool
+        ForEachBlock(Func &&func) {
+            while (HasNext()) {
+                if (!Next()) { return false; }
+                func(m_block_begin_, m_block_);
+            }
+            return IsOpen();
+        }
+    };
+
+    /**
+     * Binary format of compressed sparse matrices (CSC for column-major, CSR for row-major): a
+     * 64-byte header {magic, u32 version, u8 row major, u8 scalar size, u8 index size, i64 rows,
+     * i64 cols, i64 non-zeros}, followed by the outer index, inner index and value arrays of
+     * Eigen's compressed storage, each starting at a multiple of kAlignment. The arrays can be
+     * used in place from a memory-mapped file.
+     */
+    struct SparseEigenMatrixBinary {
+        inline static constexpr char kMagic[8] = {'\x7f', 'E', 'R', 'L', 'S', 'P', 'M', '\n'};
+        inline static constexpr std::uint32_t kVersion = 1;
+        inline static constexpr std::size_t kHeaderSize = 64;
+        inline static constexpr std::size_t kAlignment = 64;
+
+        [[nodiscard]] static std::size_t
+        Align(const std::size_t offset) {
+            return (offset + kAlignment - 1) / kAlignment * kAlignment;
+        }
+    };
+
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    [[nodiscard]] bool
+    SaveSparseEigenMatrixToBinaryFile(
+        const std::string &file_path,
+        const Eigen::SparseMatrix<T, Options, StorageIndex> &matrix);
+
+    /**
+     * Write a sparse matrix in the format of SparseEigenMatrixBinary. Padding is relative to the
+     * position of the stream when the call starts.
+     */
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    [[nodiscard]] bool
+    SaveCompressedSparseEigenMatrixToBinaryStream(
+        std::ostream &s,
+        const Eigen::SparseMatrix<T, Options, StorageIndex> &matrix);
+
+    /**
+     * Read a sparse matrix written by SaveCompressedSparseEigenMatrixToBinaryStream. The stream must
+     * be seekable so that the stored sizes can be checked against its length before allocating. On
+     * failure, the matrix is left empty.
+     */
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    [[nodiscard]] bool
+    LoadCompressedSparseEigenMatrixFromBinaryStream(
+        std::istream &s,
+        Eigen::SparseMatrix<T, Options, StorageIndex> &matrix);
+
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    [[nodiscard]] bool
+    LoadSparseEigenMatrixFromBinaryFile(
+        const std::string &file_path,
+        Eigen::SparseMatrix<T, Options, StorageIndex> &matrix);
+
+    /**
+     * Sparse matrix viewed directly in a memory-mapped file written by
+     * SaveSparseEigenMatrixToBinaryFile. The view keeps the mapping alive.
+     */
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    class MappedSparseEigenMatrix {
+    public:
+        using Matrix = Eigen::SparseMatrix<T, Options, StorageIndex>;
+        using Map = Eigen::Map<const Matrix>;
+
+    private:
+        std::shared_ptr<const MappedFile> m_file_ = nullptr;
+        long m_rows_ = 0;
+        long m_cols_ = 0;
+        long m_non_zeros_ = 0;
+        const StorageIndex *m_outer_index_ = nullptr;
+        const StorageIndex *m_inner_index_ = nullptr;
+        const T *m_values_ = nullptr;
+        std::size_t m_end_offset_ = 0;
+
+    public:
+        MappedSparseEigenMatrix() = default;
+
+        MappedSparseEigenMatrix(
+            std::shared_ptr<const MappedFile> file,
+            const long rows,
+            const long cols,
+            const long non_zeros,
+            const StorageIndex *outer_index,
+            const StorageIndex *inner_index,
+            const T *values,
+            const std::size_t end_offset)
+            : m_file_(std::move(file)),
+              m_rows_(rows),
+              m_cols_(cols),
+              m_non_zeros_(non_zeros),
+              m_outer_index_(outer_index),
+              m_inner_index_(inner_index),
+              m_values_(values),
+              m_end_offset_(end_offset) {}
+
+        [[nodiscard]] bool
+        IsValid() const {
+            return m_file_ != nullptr;
+        }
+
+        [[nodiscard]] const std::shared_ptr<const MappedFile> &
+        GetFile() const {
+            return m_file_;
+        }
+
+        [[nodiscard]] std::size_t
+        GetEndOffset() const {
+            return m_end_offset_;
+        }
+
+        [[nodiscard]] long
+        rows() const {
+            return m_rows_;
+        }
+
+        [[nodiscard]] long
+        cols() const {
+            return m_cols_;
+        }
+
+        [[nodiscard]] long
+        nonZeros() const {
+            return m_non_zeros_;
+        }
+
+        [[nodiscard]] Map
+        Get() const {
+            return Map(
+                m_rows_,
+                m_cols_,
+                m_non_zeros_,
+                m_outer_index_,
+                m_inner_index_,
+                m_values_);
+        }
+
+        [[nodiscard]] Map
+        operator*() const {
+            return Get();
+        }
+    };
+
+    /**
+     * Map a sparse matrix stored by SaveCompressedSparseEigenMatrixToBinaryStream at the given
+     * offset, which must be a multiple of SparseEigenMatrixBinary::kAlignment. The index arrays
+     * are checked once, so a corrupt file cannot make the view read out of bounds.
+     * @return View of the matrix, invalid if the record is malformed or does not match the
+     * template parameters.
+     */
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    MappedSparseEigenMatrix<T, Options, StorageIndex>
+    MapSparseEigenMatrixFromMappedFile(
+        const std::shared_ptr<const MappedFile> &file,
+        std::size_t offset = 0);
+
+    template<typename T = double, int Options = Eigen::ColMajor, typename StorageIndex = int>
+    MappedSparseEigenMatrix<T, Options, StorageIndex>
+    MapSparseEigenMatrixFromBinaryFile(
+        const std::string &file_path,
+        MappedFile::Advice advice = MappedFile::Advice::kNormal);
+
+    /**
+     * Build a compressed sparse matrix from triplets, like SparseMatrix::setFromTriplets, with
+     * the passes over the triplets and the per-row (per-column) sorting done in parallel.
+     * Duplicated entries are summed in the order of the triplets, so the result does not depend
+     * on the number of threads.
+     */
+    template<typename T, int Options, typename StorageIndex>
+    void
+    SetSparseEigenMatrixFromTriplets(
+        Eigen::SparseMatrix<T, Options, StorageIndex> &matrix,
+        long rows,
+        long cols,
+        const std::vector<Eigen::Triplet<T, StorageIndex>> &triplets,
+        bool parallel = true);
+
     template<EigenTextFormat Format, typename Matrix>
     std::string
     EigenToString(const Matrix &matrix);
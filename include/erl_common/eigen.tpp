@@ -1,81 +1,229 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
 
 namespace erl::common {
+    namespace detail {
+        template<typename Scalar>
+        void
+        AppendEigenTextCoeff(std::string &buffer, const Scalar &value) {
+            if constexpr (std::is_same_v<Scalar, bool>) {
+                buffer.push_back(value ? '1' : '0');
+            } else if constexpr (std::is_arithmetic_v<Scalar>) {
+                AppendChars(buffer, value);
+            } else {  // e.g. std::complex
+                std::ostringstream ss;
+                ss.precision(
+                    std::numeric_limits<typename Eigen::NumTraits<Scalar>::Real>::max_digits10);
+                ss << value;
+                buffer.append(ss.str());
+            }
+        }
+
+        /**
+         * Format a matrix with the layout of an Eigen::IOFormat, block of rows by block of rows.
+         * @param sink Function void(const std::string &) receiving the text in order.
+         */
+        template<typename Derived, typename Sink>
+        void
+        FormatEigenText(
+            const Eigen::DenseBase<Derived> &matrix,
+            const Eigen::IOFormat &fmt,
+            const bool parallel,
+            Sink &&sink) {
+            sink(fmt.matPrefix);
+            const auto &m = matrix.eval();  // evaluate expressions once, like operator<<
+            const long rows = m.rows();
+            const long cols = m.cols();
+            auto append_rows = [&](std::string &buffer, const long r0, const long r1) {
+                for (long r = r0; r < r1; ++r) {
+                    if (r > 0) { buffer += fmt.rowSpacer; }
+                    buffer += fmt.rowPrefix;
+                    for (long c = 0; c < cols; ++c) {
+                        if (c > 0) { buffer += fmt.coeffSeparator; }
+                        AppendEigenTextCoeff(buffer, m.coeff(r, c));
+                    }
+                    buffer += fmt.rowSuffix;
+                    if (r < rows - 1) { buffer += fmt.rowSeparator; }
+                }
+            };
+            if (cols > 0) {
+                constexpr long kBlockRows = 1024;
+                constexpr long kBlocksPerBatch = 64;  // bounds the memory of formatted blocks
+                const long num_blocks = (rows + kBlockRows - 1) / kBlockRows;
+                std::vector<std::string> blocks(std::min(num_blocks, kBlocksPerBatch));
+                for (long b0 = 0; b0 < num_blocks; b0 += kBlocksPerBatch) {
+                    const long n = std::min(kBlocksPerBatch, num_blocks - b0);
+#pragma omp parallel for schedule(dynamic) if (parallel && n > 1)
+                    for (long b = 0; b < n; ++b) {
+                        blocks[b].clear();
+                        const long r0 = (b0 + b) * kBlockRows;
+                        append_rows(blocks[b], r0, std::min(r0 + kBlockRows, rows));
+                    }
+                    for (long b = 0; b < n; ++b) { sink(blocks[b]); }
+                }
+            }
+            sink(fmt.matSuffix);
+        }
+
+        template<typename T>
+        struct EigenTextChunk {
+            std::vector<T> values{};
+            long rows = 0;
+            long cols = -1;
+            long bad_row = -1;  // first row with a different number of columns
+            long bad_row_cols = 0;
+            const char *error = nullptr;  // first token that is not a number
+        };
+
+        /**
+         * Parse the numbers of the text lines in [p, end). Whitespace and the commas, semicolons,
+         * brackets and "<<" of the Eigen text formats separate numbers, lines without numbers
+         * are skipped.
+         */
+        template<typename T>
+        void
+        ParseEigenText(const char *p, const char *end, EigenTextChunk<T> &chunk) {
+            long row_cols = 0;
+            auto end_row = [&] {
+                if (row_cols == 0) { return; }
+                if (chunk.cols < 0) {
+                    chunk.cols = row_cols;
+                } else if (row_cols != chunk.cols && chunk.bad_row < 0) {
+                    chunk.bad_row = chunk.rows;
+                    chunk.bad_row_cols = row_cols;
+                }
+                ++chunk.rows;
+                row_cols = 0;
+            };
+            while (p < end) {
+                switch (*p) {
+                    case '\n':
+                        end_row();
+                        [[fallthrough]];
+                    case ' ':
+                    case '\t':
+                    case '\r':
+                    case ',':
+                    case ';':
+                    case '[':
+                    case ']':
+                    case '<':
+                        ++p;
+                        continue;
+                    case '+':  // not accepted by FromChars
+                        ++p;
+                        break;
+                    default:
+                        break;
+                }
+                // integers are read as double and cast, like std::stod did
+                std::conditional_t<std::is_floating_point_v<T>, T, double> value;
+                const auto result = FromChars(p, end, value);
+                if (result.ec != std::errc()) {
+                    chunk.error = p;
+                    return;
+                }
+                chunk.values.push_back(static_cast<T>(value));
+                ++row_cols;
+                p = result.ptr;
+            }
+            end_row();
+        }
+    }  // namespace detail
+
+    template<typename Derived>
+    void
+    AppendEigenText(
+        std::string &buffer,
+        const Eigen::DenseBase<Derived> &matrix,
+        const EigenTextFormat format,
+        const bool parallel) {
+        detail::FormatEigenText(
+            matrix,
+            GetEigenTextFormat(format),
+            parallel,
+            [&buffer](const std::string &text) { buffer += text; });
+    }
+
     template<typename T>
     void
     SaveEigenMatrixToTextFile(
         const std::string &file_path,
         const Eigen::Ref<const Eigen::MatrixX<T>> &matrix,
         const EigenTextFormat format) {
-        std::ofstream ofs(file_path);
+        std::ofstream ofs(file_path, std::ios::binary);
         if (!ofs.is_open()) { ERL_FATAL("Could not open file {}", file_path); }
-        ofs << matrix.format(GetEigenTextFormat(format));
+        detail::FormatEigenText(
+            matrix,
+            GetEigenTextFormat(format),
+            true,
+            [&ofs](const std::string &text) {
+                ofs.write(text.data(), static_cast<std::streamsize>(text.size()));
+            });
         ofs.close();
     }
 
     template<typename T, int Rows, int Cols, int RowMajor>
     Eigen::Matrix<T, Rows, Cols, RowMajor>
-    LoadEigenMatrixFromTextFile(
-        const std::string &file_path,
-        const EigenTextFormat format,
-        const bool transpose) {
-        std::vector<T> data;
-        std::ifstream ifs(file_path);
+    LoadEigenMatrixFromTextFile(const std::string &file_path, const bool transpose) {
+        const std::shared_ptr<const MappedFile> file =
+            MappedFile::Open(file_path, MappedFile::Advice::kSequential);
+        if (file == nullptr) { ERL_FATAL("Could not open file {}", file_path); }
 
-        if (!ifs.is_open()) { ERL_FATAL("Could not open file {}", file_path); }
+        // split the file into chunks of whole lines, parsed in parallel
+        constexpr std::size_t kChunkSize = 1 << 20;
+        const char *begin = file->GetData();
+        const char *end = begin + file->GetSize();
+        std::vector<const char *> bounds = {begin};
+        while (bounds.back() != end) {
+            const char *p = bounds.back() + std::min(kChunkSize, std::size_t(end - bounds.back()));
+            p = std::find(p, end, '\n');
+            bounds.push_back(p == end ? end : p + 1);
+        }
+        const long num_chunks = static_cast<long>(bounds.size()) - 1;
+        std::vector<detail::EigenTextChunk<T>> chunks(num_chunks);
+#pragma omp parallel for schedule(dynamic) if (num_chunks > 1)
+        for (long i = 0; i < num_chunks; ++i) {
+            detail::ParseEigenText(bounds[i], bounds[i + 1], chunks[i]);
+        }
 
-        std::string row_string;
-        std::string entry_string;
-        int cols = 0;
-        int rows = 0;
-
-        char delim = ',';
-        switch (format) {
-            case EigenTextFormat::kDefaultFmt:
-                delim = ' ';
-                break;
-            case EigenTextFormat::kCommaInitFmt:
-            case EigenTextFormat::kCleanFmt:
-            case EigenTextFormat::kOctaveFmt:
-            case EigenTextFormat::kNumpyFmt:
-            case EigenTextFormat::kCsvFmt:
-                delim = ',';
-                break;
-        }
-
-        while (std::getline(ifs, row_string)) {
-            std::stringstream row_stream(row_string);
-            int row_cols = 0;
-            while (std::getline(row_stream, entry_string, delim)) {
-                if (entry_string.empty()) { continue; }
-                if (entry_string == ";" || entry_string == "]" || entry_string == "[") { continue; }
-                data.push_back(T(std::stod(entry_string)));
-                if (rows == 0) {
-                    cols++;
-                } else {
-                    row_cols++;
-                }
-            }
-            if (rows == 0) {
-                ERL_ASSERTM(
-                    Cols == Eigen::Dynamic || cols == Cols,
-                    "Number of columns in file does not match template parameter. Expected {}, got "
-                    "{}",
-                    Cols,
-                    cols);
-            } else {
-                ERL_ASSERTM(
-                    cols == row_cols,
-                    "Invalid matrix file: row {} has {} columns, expected {}",
-                    rows,
-                    row_cols,
-                    cols);
+        long rows = 0;
+        long cols = 0;
+        std::size_t num_values = 0;
+        for (const detail::EigenTextChunk<T> &chunk: chunks) {
+            if (chunk.error != nullptr) {
+                const char *token_end = std::find_if(chunk.error, end, [](const char c) {
+                    return std::isspace(static_cast<unsigned char>(c)) || c == ',';
+                });
+                ERL_FATAL(
+                    "Invalid number \"{}\" in {}.",
+                    std::string(chunk.error, token_end),
+                    file_path);
             }
-            rows++;
+            if (chunk.rows == 0) { continue; }
+            if (rows == 0) { cols = chunk.cols; }
+            ERL_ASSERTM(
+                chunk.bad_row < 0 && chunk.cols == cols,
+                "Invalid matrix file: row {} has {} columns, expected {}",
+                rows + std::max(chunk.bad_row, 0l),
+                chunk.bad_row < 0 ? chunk.cols : chunk.bad_row_cols,
+                cols);
+            rows += chunk.rows;
+            num_values += chunk.values.size();
+        }
+        std::vector<T> data;
+        data.reserve(num_values);
+        for (detail::EigenTextChunk<T> &chunk: chunks) {
+            data.insert(data.end(), chunk.values.begin(), chunk.values.end());
+            chunk.values = {};
         }
-        ifs.close();
 
         if (rows == 0 || cols == 0) {
             ERL_WARN("Reading empty matrix from file {}.", file_path);
@@ -130,6 +278,15 @@ namespace erl::common {
         return matrix;
     }
 
+    template<typename T, int Rows, int Cols, int RowMajor>
+    Eigen::Matrix<T, Rows, Cols, RowMajor>
+    LoadEigenMatrixFromTextFile(
+        const std::string &file_path,
+        const EigenTextFormat /* format */,
+        const bool transpose) {
+        return LoadEigenMatrixFromTextFile<T, Rows, Cols, RowMajor>(file_path, transpose);
+    }
+
     template<typename T, int Rows, int Cols>
     bool
     SaveEigenMapToBinaryStream(
@@ -466,60 +623,614 @@ namespace erl::common {
         return s.good();
     }
 
+    namespace detail {
+        /**
+         * Check the header of a matrix stored by SaveEigenMatrixToBinaryStream. An empty matrix
+         * has no shape in the file, its shape is derived from the template parameters.
+         */
+        template<int Rows, int Cols>
+        bool
+        CheckEigenMatrixBinaryShape(const long matrix_size, long &rows, long &cols) {
+            if (matrix_size == 0) {
+                if (Rows != Eigen::Dynamic && Cols != Eigen::Dynamic) {
+                    ERL_WARN("Matrix size mismatch. Expected {}, got 0", Rows * Cols);
+                    return false;
+                }
+                rows = Rows == Eigen::Dynamic ? 0 : Rows;
+                cols = Cols == Eigen::Dynamic ? 0 : Cols;
+                return true;
+            }
+            if (Rows != Eigen::Dynamic && rows != Rows) {
+                ERL_WARN(
+                    "Number of rows in file does not match template parameter. Expected {}, got {}",
+                    Rows,
+                    rows);
+                return false;
+            }
+            if (Cols != Eigen::Dynamic && cols != Cols) {
+                ERL_WARN(
+                    "Number of columns in file does not match template parameter. Expected {}, got "
+                    "{}",
+                    Cols,
+                    cols);
+                return false;
+            }
+            if (rows < 0 || cols < 0 || matrix_size != rows * cols) {
+                ERL_WARN("Matrix size mismatch. Expected {}, got {}", matrix_size, rows * cols);
+                return false;
+            }
+            return true;
+        }
+    }  // namespace detail
+
+    template<typename T, int Rows, int Cols>
+    MappedEigenMatrix<T, Rows, Cols>
+    MapEigenMatrixFromMappedFile(
+        const std::shared_ptr<const MappedFile> &file,
+        std::size_t offset) {
+        if (file == nullptr) { return {}; }
+        const std::size_t file_size = file->GetSize();
+        long header[3] = {0, 0, 0};  // size, rows, cols
+        if (offset + sizeof(long) > file_size) {
+            ERL_WARN("No matrix at offset {} of {}.", offset, file->GetPath());
+            return {};
+        }
+        std::memcpy(header, file->GetData() + offset, sizeof(long));
+        offset += sizeof(long);
+        if (header[0] != 0) {
+            if (offset + 2 * sizeof(long) > file_size) {
+                ERL_WARN("Truncated matrix header in {}.", file->GetPath());
+                return {};
+            }
+            std::memcpy(header + 1, file->GetData() + offset, 2 * sizeof(long));
+            offset += 2 * sizeof(long);
+        }
+        if (!detail::CheckEigenMatrixBinaryShape<Rows, Cols>(header[0], header[1], header[2])) {
+            return {};
+        }
+        const std::size_t num_bytes = static_cast<std::size_t>(header[0]) * sizeof(T);
+        if (offset + num_bytes > file_size) {
+            ERL_WARN(
+                "Truncated matrix in {}: {} bytes expected, {} available.",
+                file->GetPath(),
+                num_bytes,
+                file_size - offset);
+            return {};
+        }
+        const char *data = file->GetData() + offset;
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0) {
+            ERL_WARN("Matrix data at offset {} of {} is misaligned.", offset, file->GetPath());
+            return {};
+        }
+        return {
+            file,
+            reinterpret_cast<const T *>(data),
+            header[1],
+            header[2],
+            offset + num_bytes};
+    }
+
+    template<typename T, int Rows, int Cols>
+    MappedEigenMatrix<T, Rows, Cols>
+    MapEigenMatrixFromBinaryFile(const std::string &file_path, const MappedFile::Advice advice) {
+        return MapEigenMatrixFromMappedFile<T, Rows, Cols>(
+            MappedFile::Open(file_path, advice),
+            0);
+    }
+
+    template<typename T, int Rows>
+    EigenBinaryColumnBlockReader<T, Rows>::EigenBinaryColumnBlockReader(
+        const std::string &file_path,
+        const long block_cols,
+        const std::streamoff offset)
+        : m_block_cols_(block_cols) {
+        ERL_ASSERTM(block_cols > 0, "block_cols must be positive, got {}.", block_cols);
+        m_ifs_.open(file_path, std::ios::binary);
+        if (!m_ifs_.is_open()) {
+            ERL_WARN("Could not open file {}", file_path);
+            return;
+        }
+        long header[3] = {0, 0, 0};  // size, rows, cols
+        m_ifs_.seekg(offset);
+        m_ifs_.read(reinterpret_cast<char *>(header), sizeof(long));
+        if (m_ifs_.good() && header[0] != 0) {
+            m_ifs_.read(reinterpret_cast<char *>(header + 1), 2 * sizeof(long));
+        }
+        if (!m_ifs_.good() ||
+            !detail::CheckEigenMatrixBinaryShape<Rows, Eigen::Dynamic>(
+                header[0],
+                header[1],
+                header[2])) {
+            ERL_WARN("Failed to read the matrix header from {}.", file_path);
+            m_ifs_.close();
+            return;
+        }
+        m_rows_ = header[1];
+        m_cols_ = header[2];
+        m_data_offset_ = m_ifs_.tellg();
+    }
+
+    template<typename T, int Rows>
+    bool
+    EigenBinaryColumnBlockReader<T, Rows>::Seek(const long col) {
+        if (!IsOpen() || col < 0 || col > m_cols_) { return false; }
+        m_ifs_.clear();
+        m_ifs_.seekg(m_data_offset_ + static_cast<std::streamoff>(col * m_rows_ * sizeof(T)));
+        m_next_col_ = col;
+        return m_ifs_.good();
+    }
+
+    template<typename T, int Rows>
+    bool
+    EigenBinaryColumnBlockReader<T, Rows>::Next() {
+        if (!HasNext()) { return false; }
+        const long num_cols = std::min(m_block_cols_, m_cols_ - m_next_col_);
+        // column-major storage: a block of columns is contiguous in the file
+        if (m_block_.cols() != num_cols) { m_block_.resize(m_rows_, num_cols); }
+        m_ifs_.read(
+            reinterpret_cast<char *>(m_block_.data()),
+            static_cast<std::streamsize>(m_block_.size() * sizeof(T)));
+        if (!m_ifs_.good()) {
+            ERL_WARN("Error reading columns [{}, {}).", m_next_col_, m_next_col_ + num_cols);
+            return false;
+        }
+        m_block_begin_ = m_next_col_;
+        m_next_col_ += num_cols;
+        return true;
+    }
+
+    namespace detail {
+        /**
+         * Check the header of a sparse matrix against the template parameters.
+         */
+        template<typename T, int Options, typename StorageIndex>
+        bool
+        CheckSparseEigenMatrixBinaryHeader(
+            const char *header,
+            const std::string &source,
+            long &rows,
+            long &cols,
+            long &non_zeros) {
+            if (std::memcmp(header, SparseEigenMatrixBinary::kMagic, 8) != 0) {
+                ERL_WARN("No sparse matrix in {}.", source);
+                return false;
+            }
+            std::uint32_t version;
+            std::memcpy(&version, header + 8, sizeof(version));
+            if (version > SparseEigenMatrixBinary::kVersion) {
+                ERL_WARN(
+                    "Sparse matrix version {} in {} is newer than the supported version {}.",
+                    version,
+                    source,
+                    SparseEigenMatrixBinary::kVersion);
+                return false;
+            }
+            const bool row_major = header[12] != 0;
+            if (row_major != ((Options & Eigen::RowMajorBit) != 0)) {
+                ERL_WARN("Storage order of the sparse matrix in {} does not match.", source);
+                return false;
+            }
+            if (static_cast<std::size_t>(header[13]) != sizeof(T) ||
+                static_cast<std::size_t>(header[14]) != sizeof(StorageIndex)) {
+                ERL_WARN(
+                    "Sparse matrix in {} has {}-byte values and {}-byte indices, expected {} and "
+                    "{}.",
+                    source,
+                    static_cast<int>(header[13]),
+                    static_cast<int>(header[14]),
+                    sizeof(T),
+                    sizeof(StorageIndex));
+                return false;
+            }
+            std::int64_t shape[3];  // rows, cols, non-zeros
+            std::memcpy(shape, header + 16, sizeof(shape));
+            if (shape[0] < 0 || shape[1] < 0 || shape[2] < 0 ||
+                shape[2] > std::numeric_limits<StorageIndex>::max()) {
+                ERL_WARN("Invalid sparse matrix shape in {}.", source);
+                return false;
+            }
+            rows = static_cast<long>(shape[0]);
+            cols = static_cast<long>(shape[1]);
+            non_zeros = static_cast<long>(shape[2]);
+            return true;
+        }
+
+        /**
+         * Check that the outer index starts at 0, never decreases and ends at non_zeros, and that
+         * the inner indices are in [0, inner_size).
+         */
+        template<typename StorageIndex>
+        bool
+        CheckSparseEigenMatrixIndices(
+            const StorageIndex *outer_index,
+            const StorageIndex *inner_index,
+            const long outer_size,
+            const long inner_size,
+            const long non_zeros) {
+            if (outer_index[0] != 0 || outer_index[outer_size] != non_zeros) { return false; }
+            for (long i = 0; i < outer_size; ++i) {
+                if (outer_index[i + 1] < outer_index[i]) { return false; }
+            }
+            for (long k = 0; k < non_zeros; ++k) {
+                if (inner_index[k] < 0 || inner_index[k] >= inner_size) { return false; }
+            }
+            return true;
+        }
+    }  // namespace detail
+
+    template<typename T, int Options, typename StorageIndex>
+    bool
+    SaveSparseEigenMatrixToBinaryFile(
+        const std::string &file_path,
+        const Eigen::SparseMatrix<T, Options, StorageIndex> &matrix) {
+        std::ofstream ofs(file_path, std::ios::binary);
+        if (!ofs.is_open()) {
+            ERL_WARN("Could not open file {}", file_path);
+            return false;
+        }
+        return SaveCompressedSparseEigenMatrixToBinaryStream(ofs, matrix);
+    }
+
+    template<typename T, int Options, typename StorageIndex>
+    bool
+    SaveCompressedSparseEigenMatrixToBinaryStream(
+        std::ostream &s,
+        const Eigen::SparseMatrix<T, Options, StorageIndex> &matrix) {
+        if (!matrix.isCompressed()) {
+            Eigen::SparseMatrix<T, Options, StorageIndex> compressed = matrix;
+            compressed.makeCompressed();
+            return SaveCompressedSparseEigenMatrixToBinaryStream(s, compressed);
+        }
+        using Binary = SparseEigenMatrixBinary;
+        char header[Binary::kHeaderSize] = {};
+        std::memcpy(header, Binary::kMagic, sizeof(Binary::kMagic));
+        std::memcpy(header + 8, &Binary::kVersion, sizeof(Binary::kVersion));
+        header[12] = static_cast<char>(matrix.IsRowMajor);
+        header[13] = static_cast<char>(sizeof(T));
+        header[14] = static_cast<char>(sizeof(StorageIndex));
+        const std::int64_t shape[3] = {matrix.rows(), matrix.cols(), matrix.nonZeros()};
+        std::memcpy(header + 16, shape, sizeof(shape));
+        s.write(header, sizeof(header));
+
+        std::size_t offset = sizeof(header);  // relative to the start of the record
+        auto write_array = [&](const char *data, const std::size_t num_bytes) {
+            static constexpr char kPadding[Binary::kAlignment] = {};
+            s.write(data, static_cast<std::streamsize>(num_bytes));
+            offset += num_bytes;
+            const std::size_t aligned = Binary::Align(offset);
+            s.write(kPadding, static_cast<std::streamsize>(aligned - offset));
+            offset = aligned;
+        };
+        const std::size_t non_zeros = matrix.nonZeros();
+        write_array(
+            reinterpret_cast<const char *>(matrix.outerIndexPtr()),
+            (matrix.outerSize() + 1) * sizeof(StorageIndex));
+        write_array(
+            reinterpret_cast<const char *>(matrix.innerIndexPtr()),
+            non_zeros * sizeof(StorageIndex));
+        write_array(reinterpret_cast<const char *>(matrix.valuePtr()), non_zeros * sizeof(T));
+        return s.good();
+    }
+
+    template<typename T, int Options, typename StorageIndex>
+    bool
+    LoadCompressedSparseEigenMatrixFromBinaryStream(
+        std::istream &s,
+        Eigen::SparseMatrix<T, Options, StorageIndex> &matrix) {
+        using Binary = SparseEigenMatrixBinary;
+        char header[Binary::kHeaderSize];
+        s.read(header, sizeof(header));
+        long rows, cols, non_zeros;
+        if (!s.good() || !detail::CheckSparseEigenMatrixBinaryHeader<T, Options, StorageIndex>(
+                             header,
+                             "stream",
+                             rows,
+                             cols,
+                             non_zeros)) {
+            matrix.resize(0, 0);
+            return false;
+        }
+        // bound the sizes by the rest of the stream before allocating anything
+        const std::istream::pos_type data_begin = s.tellg();
+        s.seekg(0, std::ios::end);
+        const std::istream::pos_type data_end = s.tellg();
+        s.seekg(data_begin);
+        if (data_begin == std::istream::pos_type(-1) ||
+            data_end == std::istream::pos_type(-1) || !s.good()) {
+            ERL_WARN("Sparse matrices can only be loaded from seekable streams.");
+            matrix.resize(0, 0);
+            return false;
+        }
+        const auto remaining = static_cast<std::size_t>(data_end - data_begin);
+        const long outer_size = (Options & Eigen::RowMajorBit) ? rows : cols;
+        if (static_cast<std::size_t>(outer_size) >= remaining / sizeof(StorageIndex) ||
+            static_cast<std::size_t>(non_zeros) >= remaining / sizeof(StorageIndex)) {
+            ERL_WARN("Truncated sparse matrix in stream.");
+            matrix.resize(0, 0);
+            return false;
+        }
+        const std::size_t value_offset = Binary::Align(
+            Binary::Align(Binary::kHeaderSize + (outer_size + 1) * sizeof(StorageIndex)) +
+            non_zeros * sizeof(StorageIndex));
+        if (Binary::Align(value_offset + non_zeros * sizeof(T)) >
+            Binary::kHeaderSize + remaining) {
+            ERL_WARN("Truncated sparse matrix in stream.");
+            matrix.resize(0, 0);
+            return false;
+        }
+        matrix.resize(rows, cols);  // compressed storage
+        matrix.resizeNonZeros(non_zeros);
+
+        std::size_t offset = sizeof(header);
+        auto read_array = [&](char *data, const std::size_t num_bytes) {
+            s.read(data, static_cast<std::streamsize>(num_bytes));
+            offset += num_bytes;
+            const std::size_t aligned = Binary::Align(offset);
+            s.ignore(static_cast<std::streamsize>(aligned - offset));
+            offset = aligned;
+        };
+        read_array(
+            reinterpret_cast<char *>(matrix.outerIndexPtr()),
+            (matrix.outerSize() + 1) * sizeof(StorageIndex));
+        read_array(
+            reinterpret_cast<char *>(matrix.innerIndexPtr()),
+            non_zeros * sizeof(StorageIndex));
+        read_array(reinterpret_cast<char *>(matrix.valuePtr()), non_zeros * sizeof(T));
+        if (!s.good()) {
+            ERL_WARN("Error reading sparse matrix from stream.");
+            matrix.resize(0, 0);
+            return false;
+        }
+        if (!detail::CheckSparseEigenMatrixIndices(
+                matrix.outerIndexPtr(),
+                matrix.innerIndexPtr(),
+                matrix.outerSize(),
+                matrix.innerSize(),
+                non_zeros)) {
+            ERL_WARN("Corrupted indices of sparse matrix.");
+            matrix.resize(0, 0);
+            return false;
+        }
+        return true;
+    }
+
+    template<typename T, int Options, typename StorageIndex>
+    bool
+    LoadSparseEigenMatrixFromBinaryFile(
+        const std::string &file_path,
+        Eigen::SparseMatrix<T, Options, StorageIndex> &matrix) {
+        std::ifstream ifs(file_path, std::ios::binary);
+        if (!ifs.is_open()) {
+            ERL_WARN("Could not open file {}", file_path);
+            return false;
+        }
+        return LoadCompressedSparseEigenMatrixFromBinaryStream(ifs, matrix);
+    }
+
+    template<typename T, int Options, typename StorageIndex>
+    MappedSparseEigenMatrix<T, Options, StorageIndex>
+    MapSparseEigenMatrixFromMappedFile(
+        const std::shared_ptr<const MappedFile> &file,
+        const std::size_t offset) {
+        using Binary = SparseEigenMatrixBinary;
+        if (file == nullptr) { return {}; }
+        if (offset % Binary::kAlignment != 0) {
+            ERL_WARN("Sparse matrix offset {} is not aligned.", offset);
+            return {};
+        }
+        const std::size_t file_size = file->GetSize();
+        if (offset + Binary::kHeaderSize > file_size) {
+            ERL_WARN("No sparse matrix at offset {} of {}.", offset, file->GetPath());
+            return {};
+        }
+        const char *begin = file->GetData() + offset;
+        long rows, cols, non_zeros;
+        if (!detail::CheckSparseEigenMatrixBinaryHeader<T, Options, StorageIndex>(
+                begin,
+                file->GetPath(),
+                rows,
+                cols,
+                non_zeros)) {
+            return {};
+        }
+        const long outer_size = (Options & Eigen::RowMajorBit) ? rows : cols;
+        const long inner_size = (Options & Eigen::RowMajorBit) ? cols : rows;
+        // bound the sizes before computing the offsets so that they cannot overflow
+        if (static_cast<std::size_t>(outer_size) >= file_size / sizeof(StorageIndex) ||
+            static_cast<std::size_t>(non_zeros) >= file_size / sizeof(StorageIndex)) {
+            ERL_WARN("Truncated sparse matrix in {}.", file->GetPath());
+            return {};
+        }
+        const std::size_t outer_offset = Binary::kHeaderSize;
+        const std::size_t inner_offset =
+            Binary::Align(outer_offset + (outer_size + 1) * sizeof(StorageIndex));
+        const std::size_t value_offset =
+            Binary::Align(inner_offset + non_zeros * sizeof(StorageIndex));
+        const std::size_t end_offset = Binary::Align(value_offset + non_zeros * sizeof(T));
+        // the padding after the values may be missing at the end of the file
+        if (offset + value_offset + non_zeros * sizeof(T) > file_size) {
+            ERL_WARN("Truncated sparse matrix in {}.", file->GetPath());
+            return {};
+        }
+        const auto *outer_index = reinterpret_cast<const StorageIndex *>(begin + outer_offset);
+        const auto *inner_index = reinterpret_cast<const StorageIndex *>(begin + inner_offset);
+        if (!detail::CheckSparseEigenMatrixIndices(
+                outer_index,
+                inner_index,
+                outer_size,
+                inner_size,
+                non_zeros)) {
+            ERL_WARN("Corrupted indices of sparse matrix in {}.", file->GetPath());
+            return {};
+        }
+        return {
+            file,
+            rows,
+            cols,
+            non_zeros,
+            outer_index,
+            inner_index,
+            reinterpret_cast<const T *>(begin + value_offset),
+            offset + end_offset};
+    }
+
+    template<typename T, int Options, typename StorageIndex>
+    MappedSparseEigenMatrix<T, Options, StorageIndex>
+    MapSparseEigenMatrixFromBinaryFile(
+        const std::string &file_path,
+        const MappedFile::Advice advice) {
+        return MapSparseEigenMatrixFromMappedFile<T, Options, StorageIndex>(
+            MappedFile::Open(file_path, advice),
+            0);
+    }
+
+    template<typename T, int Options, typename StorageIndex>
+    void
+    SetSparseEigenMatrixFromTriplets(
+        Eigen::SparseMatrix<T, Options, StorageIndex> &matrix,
+        const long rows,
+        const long cols,
+        const std::vector<Eigen::Triplet<T, StorageIndex>> &triplets,
+        const bool parallel) {
+        constexpr bool kRowMajor = (Options & Eigen::RowMajorBit) != 0;
+        const long outer_size = kRowMajor ? rows : cols;
+        const auto n = static_cast<long>(triplets.size());
+        auto get_outer = [](const Eigen::Triplet<T, StorageIndex> &t) {
+            return kRowMajor ? t.row() : t.col();
+        };
+        auto get_inner = [](const Eigen::Triplet<T, StorageIndex> &t) {
+            return kRowMajor ? t.col() : t.row();
+        };
+
+        // contiguous chunks of triplets, so that entries keep the order of the triplets
+        long num_chunks = 1;
+        if (parallel) {
+            const long num_threads = std::max(1u, std::thread::hardware_concurrency());
+            num_chunks = std::clamp(n / 65536, 1l, num_threads);
+        }
+        auto chunk_begin = [n, num_chunks](const long c) { return n * c / num_chunks; };
+
+        // count the entries of each outer vector in each chunk
+        std::vector<std::vector<StorageIndex>> cursors(num_chunks);
+#pragma omp parallel for schedule(static) if (num_chunks > 1)
+        for (long c = 0; c < num_chunks; ++c) {
+            std::vector<StorageIndex> &counts = cursors[c];
+            counts.assign(outer_size, 0);
+            for (long i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+                const Eigen::Triplet<T, StorageIndex> &t = triplets[i];
+                ERL_DEBUG_ASSERT(
+                    t.row() >= 0 && t.row() < rows && t.col() >= 0 && t.col() < cols,
+                    "Triplet ({}, {}) is out of the {}x{} matrix.",
+                    t.row(),
+                    t.col(),
+                    rows,
+                    cols);
+                ++counts[get_outer(t)];
+            }
+        }
+        // turn the counts into the positions where each chunk writes its entries
+        std::vector<StorageIndex> starts(outer_size + 1);
+        StorageIndex position = 0;
+        for (long o = 0; o < outer_size; ++o) {
+            starts[o] = position;
+            for (long c = 0; c < num_chunks; ++c) {
+                const StorageIndex count = cursors[c][o];
+                cursors[c][o] = position;
+                position += count;
+            }
+        }
+        starts[outer_size] = position;
+
+        std::vector<std::pair<StorageIndex, T>> entries(n);  // (inner index, value)
+#pragma omp parallel for schedule(static) if (num_chunks > 1)
+        for (long c = 0; c < num_chunks; ++c) {
+            std::vector<StorageIndex> &cursor = cursors[c];
+            for (long i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+                const Eigen::Triplet<T, StorageIndex> &t = triplets[i];
+                entries[cursor[get_outer(t)]++] = {get_inner(t), t.value()};
+            }
+        }
+        cursors.clear();
+
+        // sort each outer vector and sum the duplicated entries
+        std::vector<StorageIndex> sizes(outer_size);
+#pragma omp parallel for schedule(dynamic, 256) if (parallel)
+        for (long o = 0; o < outer_size; ++o) {
+            auto begin = entries.begin() + starts[o];
+            auto end = entries.begin() + starts[o + 1];
+            std::stable_sort(begin, end, [](const auto &a, const auto &b) {
+                return a.first < b.first;
+            });
+            auto last = begin;
+            for (auto it = begin; it != end; ++it) {
+                if (last != begin && (last - 1)->first == it->first) {
+                    (last - 1)->second += it->second;
+                } else {
+                    *last++ = *it;
+                }
+            }
+            sizes[o] = static_cast<StorageIndex>(last - begin);
+        }
+
+        matrix.resize(rows, cols);
+        StorageIndex *outer_index = matrix.outerIndexPtr();
+        outer_index[0] = 0;
+        for (long o = 0; o < outer_size; ++o) { outer_index[o + 1] = outer_index[o] + sizes[o]; }
+        matrix.resizeNonZeros(outer_index[outer_size]);
+        StorageIndex *inner_index = matrix.innerIndexPtr();
+        T *values = matrix.valuePtr();
+#pragma omp parallel for schedule(static) if (parallel)
+        for (long o = 0; o < outer_size; ++o) {
+            const std::pair<StorageIndex, T> *src = entries.data() + starts[o];
+            for (StorageIndex k = 0; k < sizes[o]; ++k) {
+                inner_index[outer_index[o] + k] = src[k].first;
+                values[outer_index[o] + k] = src[k].second;
+            }
+        }
+    }
+
     template<EigenTextFormat Format, typename Matrix>
     std::string
     EigenToString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(Format));
-        return ss.str();
+        std::string text;
+        AppendEigenText(text, matrix, Format);
+        return text;
     }
 
     template<typename Matrix>
     std::string
     EigenToDefaultFmtString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(EigenTextFormat::kDefaultFmt));
-        return ss.str();
+        return EigenToString<EigenTextFormat::kDefaultFmt>(matrix);
     }
 
     template<typename Matrix>
     std::string
     EigenToCommaInitFmtString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(EigenTextFormat::kCommaInitFmt));
-        return ss.str();
+        return EigenToString<EigenTextFormat::kCommaInitFmt>(matrix);
     }
 
     template<typename Matrix>
     std::string
     EigenToCleanFmtString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(EigenTextFormat::kCleanFmt));
-        return ss.str();
+        return EigenToString<EigenTextFormat::kCleanFmt>(matrix);
     }
 
     template<typename Matrix>
     std::string
     EigenToOctaveFmtString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(EigenTextFormat::kOctaveFmt));
-        return ss.str();
+        return EigenToString<EigenTextFormat::kOctaveFmt>(matrix);
     }
 
     template<typename Matrix>
     std::string
     EigenToNumPyFmtString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(EigenTextFormat::kNumpyFmt));
-        return ss.str();
+        return EigenToString<EigenTextFormat::kNumpyFmt>(matrix);
     }
 
     template<typename Matrix>
     std::string
     EigenToCsvFmtString(const Matrix &matrix) {
-        std::stringstream ss;
-        ss << matrix.format(GetEigenTextFormat(EigenTextFormat::kCsvFmt));
-        return ss.str();
+        return EigenToString<EigenTextFormat::kCsvFmt>(matrix);
     }
 
     template<typename IndexType, int Dim>
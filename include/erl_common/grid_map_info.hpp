@@ -928,11 +928,21 @@ namespace erl::common {
             const Eigen::Ref<const Eigen::VectorX<Dtype>> &start,
             const Eigen::Ref<const Eigen::VectorX<Dtype>> &end) const {
             if (!InMap(start)) {
-                ERL_WARN("start point ({}, {}, {}) is out of map.", start[0], start[1], start[2]);
+                ERL_WARN_EVERY_MS(
+                    1000,
+                    "start point ({}, {}, {}) is out of map.",
+                    start[0],
+                    start[1],
+                    start[2]);
                 return {};
             }
             if (!InMap(end)) {
-                ERL_WARN("end point ({}, {}, {}) is out of map.", end[0], end[1], end[2]);
+                ERL_WARN_EVERY_MS(
+                    1000,
+                    "end point ({}, {}, {}) is out of map.",
+                    end[0],
+                    end[1],
+                    end[2]);
                 return {};
             }
             Eigen::VectorX<Index> cur_grid = MeterToGridForPoints(start);
@@ -957,7 +967,7 @@ namespace erl::common {
                 }
             }
             if (step.isZero()) {
-                ERL_WARN("Ray casting in direction (0, 0, 0) is impossible!");
+                ERL_WARN_EVERY_MS(1000, "Ray casting in direction (0, 0, 0) is impossible!");
                 return {};
             }
 
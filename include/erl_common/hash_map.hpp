@@ -1,93 +1,536 @@
 #pragma once
 
+#include "compile_definitions.hpp"
+
+#include "logging.hpp"
+#include "occupancy_bitmap.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#ifdef ERL_USE_ABSL
+    #include <absl/container/flat_hash_map.h>
+#endif
+
 namespace erl::common {
 
+    enum class HashMapMode {
+        kHash = 0,      // always a flat hash map
+        kDense = 1,     // a paged array indexed by the key, keys it cannot hold go to the hash map
+        kAdaptive = 2,  // a flat hash map that is promoted to kDense once the keys are dense
+    };
+
+    /**
+     * A map that stores its entries either in a flat hash map or in a paged array indexed by the
+     * key. Pages of the array are allocated on the first write and released once empty, so a large
+     * but sparse key range only costs the pages it touches. In the adaptive mode, the map starts as
+     * a hash map and moves its entries into the paged array once
+     * size / (max key - min key + 1) reaches the density threshold. Only integral keys can use the
+     * paged array.
+     *
+     * The paged array covers a window of pages that starts at the page of the smallest key it
+     * holds, not at key 0. The window grows to take new keys, but its page table never has more
+     * than kMinPageTableSize + Size() slots. Keys outside the window (negative, not less than the
+     * key capacity, or too far from the other keys) stay in the hash map, and are moved into the
+     * paged array once the window grows over them.
+     * @tparam KeyType Key type.
+     * @tparam ValueType Value type, must be default constructible.
+     */
     template<typename KeyType, typename ValueType>
     class HashMap {
+    public:
+#ifdef ERL_USE_ABSL
+        using Map = absl::flat_hash_map<KeyType, ValueType>;
+#else
+        using Map = std::unordered_map<KeyType, ValueType>;
+#endif
+        static constexpr bool kDenseCapable = std::is_integral_v<KeyType>;
+        static constexpr std::size_t kDefaultPageSize = 4096;
+        static constexpr double kDefaultDensityThreshold = 0.5;
+        static constexpr std::size_t kMinPromotionSize = 1024;
+        static constexpr std::size_t kMinPageTableSize = 1024;
+
+    private:
+        struct Page {
+            std::vector<ValueType> values;
+            OccupancyBitmap occupancy;
 
-        bool m_use_vector_;
-        std::vector<ValueType> m_vector_;
-        std::unordered_map<KeyType, ValueType> m_map_;
+            explicit Page(const std::size_t size)
+                : values(size), occupancy(size) {}
+        };
+
+        using KeyRange = std::conditional_t<kDenseCapable, KeyType, int>;
+
+        HashMapMode m_mode_ = HashMapMode::kAdaptive;
+        bool m_dense_ = false;
+        std::size_t m_key_capacity_ = std::numeric_limits<std::size_t>::max();
+        std::size_t m_page_shift_ = 12;
+        std::size_t m_page_mask_ = kDefaultPageSize - 1;
+        double m_density_threshold_ = kDefaultDensityThreshold;
+        Map m_map_{};
+        std::vector<std::unique_ptr<Page>> m_pages_{};  // the window of the paged array
+        std::size_t m_base_page_ = 0;                   // absolute page of m_pages_[0]
+        std::size_t m_dense_size_ = 0;
+        KeyRange m_min_key_{};  // key range seen by m_map_ before the promotion, never shrinks
+        KeyRange m_max_key_{};
 
     public:
-        explicit HashMap(bool use_vector, std::size_t capacity = 1e7) {
-            // if ValueType is a pointer, memory for 1E7 elements is 76MB in a 64-bit system.
-            // memory for 1E9 elements is 7.6GB in a 64-bit system, too much.
-            if (capacity > static_cast<std::size_t>(1e9)) { use_vector = false; }
-            if (use_vector) { m_vector_.resize(capacity); }
-            m_use_vector_ = use_vector;
+        /**
+         *
+         * @param mode Storage mode.
+         * @param key_capacity Keys not less than this value are never stored in the paged array.
+         * @param page_size Number of entries per page, rounded up to a power of two.
+         * @param density_threshold Density at which the adaptive mode switches to the paged array.
+         */
+        explicit HashMap(
+            const HashMapMode mode = HashMapMode::kAdaptive,
+            const std::size_t key_capacity = std::numeric_limits<std::size_t>::max(),
+            const std::size_t page_size = kDefaultPageSize,
+            const double density_threshold = kDefaultDensityThreshold)
+            : m_mode_(mode),
+              m_key_capacity_(key_capacity),
+              m_density_threshold_(density_threshold) {
+            ERL_ASSERTM(
+                kDenseCapable || mode != HashMapMode::kDense,
+                "HashMapMode::kDense requires an integral key type.");
+            ERL_ASSERTM(page_size > 0, "page_size must be positive.");
+            m_page_shift_ = 0;
+            while ((std::size_t(1) << m_page_shift_) < page_size) { ++m_page_shift_; }
+            m_page_mask_ = (std::size_t(1) << m_page_shift_) - 1;
+            m_dense_ = mode == HashMapMode::kDense;
+        }
+
+        /**
+         * Kept for source compatibility: use_vector selects HashMapMode::kDense with keys in
+         * [0, capacity), otherwise HashMapMode::kHash. Unlike the former vector-backed map, nothing
+         * is allocated up front, Size() and Contains() report the inserted entries instead of the
+         * capacity, and the raw VectorBegin/VectorEnd/MapBegin/MapEnd iterators are gone: use
+         * ForEach instead.
+         */
+        explicit HashMap(const bool use_vector, const std::size_t capacity = 1e7)
+            : HashMap(use_vector ? HashMapMode::kDense : HashMapMode::kHash, capacity) {}
+
+        HashMap(const HashMap &other)
+            : m_mode_(other.m_mode_),
+              m_dense_(other.m_dense_),
+              m_key_capacity_(other.m_key_capacity_),
+              m_page_shift_(other.m_page_shift_),
+              m_page_mask_(other.m_page_mask_),
+              m_density_threshold_(other.m_density_threshold_),
+              m_map_(other.m_map_),
+              m_base_page_(other.m_base_page_),
+              m_dense_size_(other.m_dense_size_),
+              m_min_key_(other.m_min_key_),
+              m_max_key_(other.m_max_key_) {
+            m_pages_.reserve(other.m_pages_.size());
+            for (const auto &page: other.m_pages_) {
+                m_pages_.emplace_back(page == nullptr ? nullptr : std::make_unique<Page>(*page));
+            }
+        }
+
+        HashMap(HashMap &&other) noexcept = default;
+
+        HashMap &
+        operator=(const HashMap &other) {
+            if (this == &other) { return *this; }
+            HashMap tmp(other);
+            *this = std::move(tmp);
+            return *this;
+        }
+
+        HashMap &
+        operator=(HashMap &&other) noexcept = default;
+
+        [[nodiscard]] HashMapMode
+        GetMode() const {
+            return m_mode_;
+        }
+
+        /**
+         *
+         * @return true if the paged array is in use, i.e. HashMapMode::kDense or a promoted
+         * HashMapMode::kAdaptive.
+         */
+        [[nodiscard]] bool
+        IsDense() const {
+            return m_dense_;
         }
 
         [[nodiscard]] bool
         UseVector() const {
-            return m_use_vector_;
+            return IsDense();
         }
 
         [[nodiscard]] std::size_t
         Size() const {
-            if (m_use_vector_) { return m_vector_.size(); }
-            return m_map_.size();
+            return m_dense_size_ + m_map_.size();
+        }
+
+        [[nodiscard]] bool
+        IsEmpty() const {
+            return Size() == 0;
+        }
+
+        [[nodiscard]] std::size_t
+        GetPageSize() const {
+            return m_page_mask_ + 1;
+        }
+
+        [[nodiscard]] std::size_t
+        GetNumAllocatedPages() const {
+            return std::count_if(m_pages_.begin(), m_pages_.end(), [](const auto &page) {
+                return page != nullptr;
+            });
+        }
+
+        void
+        Reserve(const std::size_t size) {
+            if (!m_dense_) { m_map_.reserve(size); }
         }
 
         [[nodiscard]] bool
-        Contains(const KeyType& key) const {
-            if (m_use_vector_) { return true; }
-            return m_map_.contains(key);
+        Contains(const KeyType &key) const {
+            return Find(key) != nullptr;
+        }
+
+        /**
+         *
+         * @param key Key of the entry.
+         * @return Pointer to the value, nullptr if the key is absent.
+         */
+        ValueType *
+        Find(const KeyType &key) {
+            std::size_t page_idx, offset;
+            if (DenseSlot(key, page_idx, offset)) {
+                if (page_idx >= m_pages_.size() || m_pages_[page_idx] == nullptr) { return nullptr; }
+                Page &page = *m_pages_[page_idx];
+                return page.occupancy.Test(offset) ? &page.values[offset] : nullptr;
+            }
+            auto itr = m_map_.find(key);
+            return itr == m_map_.end() ? nullptr : &itr->second;
+        }
+
+        const ValueType *
+        Find(const KeyType &key) const {
+            return const_cast<HashMap *>(this)->Find(key);
+        }
+
+        /**
+         * Look up a batch of keys. Consecutive keys on the same page share the page lookup.
+         * @param keys Keys to look up.
+         * @return Pointers to the values, nullptr for absent keys.
+         */
+        std::vector<ValueType *>
+        Find(const std::vector<KeyType> &keys) {
+            std::vector<ValueType *> values(keys.size(), nullptr);
+            Page *page = nullptr;
+            std::size_t cached_page_idx = std::numeric_limits<std::size_t>::max();
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                std::size_t page_idx, offset;
+                if (!DenseSlot(keys[i], page_idx, offset)) {
+                    auto itr = m_map_.find(keys[i]);
+                    if (itr != m_map_.end()) { values[i] = &itr->second; }
+                    continue;
+                }
+                if (page_idx != cached_page_idx) {
+                    cached_page_idx = page_idx;
+                    page = page_idx < m_pages_.size() ? m_pages_[page_idx].get() : nullptr;
+                }
+                if (page != nullptr && page->occupancy.Test(offset)) {
+                    values[i] = &page->values[offset];
+                }
+            }
+            return values;
+        }
+
+        std::vector<const ValueType *>
+        Find(const std::vector<KeyType> &keys) const {
+            std::vector<ValueType *> values = const_cast<HashMap *>(this)->Find(keys);
+            return {values.begin(), values.end()};
+        }
+
+        /**
+         * Insert or assign a value.
+         * @return true if the key is new.
+         */
+        bool
+        Insert(const KeyType &key, ValueType value) {
+            auto [slot, inserted] = TryEmplace(key);
+            *slot = std::move(value);
+            return inserted;
+        }
+
+        /**
+         * Insert or assign a batch of values.
+         * @return The number of new keys.
+         */
+        std::size_t
+        Insert(const std::vector<KeyType> &keys, const std::vector<ValueType> &values) {
+            ERL_ASSERTM(
+                keys.size() == values.size(),
+                "{} keys but {} values.",
+                keys.size(),
+                values.size());
+            if (!m_dense_) { m_map_.reserve(m_map_.size() + keys.size()); }
+            std::size_t num_inserted = 0;
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                auto [slot, inserted] = TryEmplace(keys[i]);
+                *slot = values[i];
+                num_inserted += inserted;
+            }
+            return num_inserted;
+        }
+
+        /**
+         * Remove an entry. A page is released once its last entry is removed.
+         * @return true if the key was present.
+         */
+        bool
+        Erase(const KeyType &key) {
+            std::size_t page_idx, offset;
+            if (!DenseSlot(key, page_idx, offset)) { return m_map_.erase(key) > 0; }
+            if (page_idx >= m_pages_.size() || m_pages_[page_idx] == nullptr) { return false; }
+            Page &page = *m_pages_[page_idx];
+            if (!page.occupancy.Test(offset)) { return false; }
+            page.values[offset] = ValueType();
+            page.occupancy.Reset(offset);
+            --m_dense_size_;
+            if (page.occupancy.Count() == 0) { m_pages_[page_idx].reset(); }
+            return true;
+        }
+
+        /**
+         * Remove all entries. An adaptive map goes back to the hash map.
+         */
+        void
+        Clear() {
+            m_map_.clear();
+            m_pages_.clear();
+            m_base_page_ = 0;
+            m_dense_size_ = 0;
+            m_dense_ = m_mode_ == HashMapMode::kDense;
+            m_min_key_ = {};
+            m_max_key_ = {};
+        }
+
+        /**
+         * Move the entries of the hash map into the paged array. Called automatically in the
+         * adaptive mode, no-op if the paged array is already in use or the key is not integral.
+         */
+        void
+        Promote() {
+            if constexpr (kDenseCapable) {
+                if (m_dense_) { return; }
+                m_dense_ = true;
+                std::size_t lo = std::numeric_limits<std::size_t>::max();
+                std::size_t hi = 0;
+                for (const auto &[key, value]: m_map_) {
+                    std::size_t page;
+                    if (!DensePage(key, page)) { continue; }
+                    lo = std::min(lo, page);
+                    hi = std::max(hi, page + 1);
+                }
+                // with outliers, the window starts empty and grows with the following inserts
+                if (lo < hi && hi - lo <= MaxPageTableSize(Size())) { ResizeWindow(lo, hi); }
+            }
+        }
+
+        ValueType &
+        operator[](const KeyType &key) {
+            return *TryEmplace(key).first;
+        }
+
+        const ValueType &
+        operator[](const KeyType &key) const {
+            const ValueType *value = Find(key);
+            if (value == nullptr) { throw std::out_of_range("HashMap: key not found."); }
+            return *value;
+        }
+
+        /**
+         * Call func(key, value) for every entry, entries of the paged array first in ascending key
+         * order.
+         */
+        template<typename Func>
+        void
+        ForEach(Func func) {
+            ForEachImpl(*this, func);
         }
 
-        ValueType&
-        operator[](const KeyType& key) {
-            if (m_use_vector_) { return m_vector_[key]; }
-            return m_map_[key];
+        template<typename Func>
+        void
+        ForEach(Func func) const {
+            ForEachImpl(*this, func);
         }
 
-        const ValueType&
-        operator[](const KeyType& key) const {
-            if (m_use_vector_) { return m_vector_[key]; }
-            return m_map_.at(key);
+    private:
+        [[nodiscard]] static std::size_t
+        MaxPageTableSize(const std::size_t size) {
+            return kMinPageTableSize + size;
         }
 
-        typename std::vector<ValueType>::iterator
-        VectorBegin() {
-            return m_vector_.begin();
+        /**
+         *
+         * @param key Key of the entry.
+         * @param page Absolute page of the key, i.e. key / page size.
+         * @return true if the paged array is in use and the key may be stored in it.
+         */
+        bool
+        DensePage(const KeyType &key, std::size_t &page) const {
+            if constexpr (kDenseCapable) {
+                if (!m_dense_) { return false; }
+                if constexpr (std::is_signed_v<KeyType>) {
+                    if (key < 0) { return false; }
+                }
+                const auto index = static_cast<std::size_t>(key);
+                if (index >= m_key_capacity_) { return false; }
+                page = index >> m_page_shift_;
+                return true;
+            } else {
+                (void) key;
+                (void) page;
+                return false;
+            }
         }
 
-        typename std::vector<ValueType>::const_iterator
-        VectorBegin() const {
-            return m_vector_.begin();
+        /**
+         *
+         * @return true if the key is inside the window of the paged array, where page_idx indexes
+         * m_pages_.
+         */
+        bool
+        DenseSlot(const KeyType &key, std::size_t &page_idx, std::size_t &offset) const {
+            std::size_t page;
+            if (!DensePage(key, page)) { return false; }
+            if (page < m_base_page_ || page - m_base_page_ >= m_pages_.size()) { return false; }
+            page_idx = page - m_base_page_;
+            if constexpr (kDenseCapable) { offset = static_cast<std::size_t>(key) & m_page_mask_; }
+            return true;
         }
 
-        typename std::vector<ValueType>::iterator
-        VectorEnd() {
-            return m_vector_.end();
+        /**
+         * Grow the window to cover the given page, unless that would exceed the page table bound.
+         * The window at least doubles so that a run of new pages does not rescan the hash map for
+         * every page.
+         * @return true if the page is in the window afterwards.
+         */
+        bool
+        GrowWindow(const std::size_t page) {
+            const std::size_t max_pages = MaxPageTableSize(Size() + 1);
+            if (m_pages_.empty()) {
+                ResizeWindow(page, page + 1);
+                return true;
+            }
+            const std::size_t end = m_base_page_ + m_pages_.size();
+            const std::size_t lo = std::min(m_base_page_, page);
+            const std::size_t hi = std::max(end, page + 1);
+            if (hi - lo > max_pages) { return false; }
+            const std::size_t len = std::min(max_pages, std::max(hi - lo, 2 * m_pages_.size()));
+            if (page < m_base_page_) {
+                ResizeWindow(hi > len ? hi - len : 0, hi);
+            } else {
+                const std::size_t end_limit = ((m_key_capacity_ - 1) >> m_page_shift_) + 1;
+                ResizeWindow(lo, std::min(lo + len, end_limit));
+            }
+            return true;
         }
 
-        typename std::vector<ValueType>::const_iterator
-        VectorEnd() const {
-            return m_vector_.end();
+        /**
+         * Move the window to the pages [lo, hi), which must contain the current window, and move
+         * the entries of the hash map that fall into it to the paged array.
+         */
+        void
+        ResizeWindow(const std::size_t lo, const std::size_t hi) {
+            std::vector<std::unique_ptr<Page>> pages(hi - lo);
+            for (std::size_t i = 0; i < m_pages_.size(); ++i) {
+                pages[m_base_page_ + i - lo] = std::move(m_pages_[i]);
+            }
+            m_pages_ = std::move(pages);
+            m_base_page_ = lo;
+            if (m_map_.empty()) { return; }
+            Map rest;
+            for (auto &[key, value]: m_map_) {
+                std::size_t page_idx, offset;
+                if (DenseSlot(key, page_idx, offset)) {
+                    *DenseEmplace(page_idx, offset).first = std::move(value);
+                } else {
+                    rest.emplace(key, std::move(value));
+                }
+            }
+            m_map_ = std::move(rest);
         }
 
-        typename std::unordered_map<KeyType, ValueType>::iterator
-        MapBegin() {
-            return m_map_.begin();
+        std::pair<ValueType *, bool>
+        DenseEmplace(const std::size_t page_idx, const std::size_t offset) {
+            std::unique_ptr<Page> &page = m_pages_[page_idx];
+            if (page == nullptr) { page = std::make_unique<Page>(m_page_mask_ + 1); }
+            const bool inserted = !page->occupancy.Test(offset);
+            if (inserted) {
+                page->occupancy.Set(offset);
+                ++m_dense_size_;
+            }
+            return {&page->values[offset], inserted};
         }
 
-        typename std::unordered_map<KeyType, ValueType>::const_iterator
-        MapBegin() const {
-            return m_map_.begin();
+        std::pair<ValueType *, bool>
+        TryEmplace(const KeyType &key) {
+            std::size_t page_idx, offset;
+            if (DenseSlot(key, page_idx, offset)) { return DenseEmplace(page_idx, offset); }
+            std::size_t page;
+            if (DensePage(key, page) && GrowWindow(page) && DenseSlot(key, page_idx, offset)) {
+                return DenseEmplace(page_idx, offset);
+            }
+            auto [itr, inserted] = m_map_.try_emplace(key);
+            if (inserted && ShouldPromote(key)) {
+                Promote();
+                return {Find(key), true};
+            }
+            return {&itr->second, inserted};
         }
 
-        typename std::unordered_map<KeyType, ValueType>::iterator
-        MapEnd() {
-            return m_map_.end();
+        bool
+        ShouldPromote(const KeyType &key) {
+            if constexpr (kDenseCapable) {
+                if (m_mode_ != HashMapMode::kAdaptive || m_dense_) { return false; }
+                if (m_map_.size() == 1) {
+                    m_min_key_ = key;
+                    m_max_key_ = key;
+                } else {
+                    m_min_key_ = std::min(m_min_key_, key);
+                    m_max_key_ = std::max(m_max_key_, key);
+                }
+                if (m_map_.size() < kMinPromotionSize) { return false; }
+                if constexpr (std::is_signed_v<KeyType>) {
+                    if (m_min_key_ < 0) { return false; }
+                }
+                const double range =
+                    static_cast<double>(m_max_key_) - static_cast<double>(m_min_key_) + 1.0;
+                return static_cast<double>(m_map_.size()) >= m_density_threshold_ * range;
+            } else {
+                (void) key;
+                return false;
+            }
         }
 
-        typename std::unordered_map<KeyType, ValueType>::const_iterator
-        MapEnd() const {
-            return m_map_.end();
+        template<typename Self, typename Func>
+        static void
+        ForEachImpl(Self &self, Func &func) {
+            for (std::size_t page_idx = 0; page_idx < self.m_pages_.size(); ++page_idx) {
+                if (self.m_pages_[page_idx] == nullptr) { continue; }
+                std::conditional_t<std::is_const_v<Self>, const Page, Page> &page =
+                    *self.m_pages_[page_idx];
+                const std::size_t base = (self.m_base_page_ + page_idx) << self.m_page_shift_;
+                page.occupancy.ForEach([&](const std::size_t offset) {
+                    func(static_cast<KeyType>(base + offset), page.values[offset]);
+                });
+            }
+            for (auto &[key, value]: self.m_map_) { func(key, value); }
         }
     };
 
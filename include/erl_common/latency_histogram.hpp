@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace erl::common {
+
+    /**
+     * Log-linear histogram of non-negative values such as latencies, in the manner of
+     * HdrHistogram: every power of two is split into kSubBucketCount linear buckets, so a
+     * percentile is off by at most 1 / kSubBucketCount of its value, whatever the range. The
+     * bucket of a value is read from the bits of its double representation, so recording is a
+     * few instructions and lock-free: Record may be called from several threads, although one
+     * instance per thread merged afterward avoids the contention on the counters.
+     */
+    class LatencyHistogram {
+    public:
+        static constexpr int kSubBucketBits = 5;
+        static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+        // values below 2^kMinExponent (zero and negative values) go to the first bucket, values
+        // from 2^kMaxExponent to the last one
+        static constexpr int kMinExponent = -32;
+        static constexpr int kMaxExponent = 64;
+        static constexpr std::size_t kNumBuckets =
+            (kMaxExponent - kMinExponent) * kSubBucketCount + 2;
+        static constexpr double kMinValue =
+            1.0 / static_cast<double>(std::uint64_t{1} << -kMinExponent);
+
+    private:
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_buckets_;
+        std::atomic<std::uint64_t> m_count_{0};
+        std::atomic<double> m_min_{std::numeric_limits<double>::infinity()};
+        std::atomic<double> m_max_{-std::numeric_limits<double>::infinity()};
+
+    public:
+        LatencyHistogram();
+
+        LatencyHistogram(const LatencyHistogram &other);
+
+        LatencyHistogram &
+        operator=(const LatencyHistogram &other);
+
+        [[nodiscard]] static std::size_t
+        GetBucketIndex(const double value) {
+            if (!(value >= kMinValue)) { return 0; }  // also NaN
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            const int exponent = static_cast<int>(bits >> 52) - 1023;
+            if (exponent >= kMaxExponent) { return kNumBuckets - 1; }
+            const auto sub_bucket = static_cast<std::size_t>(bits >> (52 - kSubBucketBits)) &
+                                    (kSubBucketCount - 1);
+            return 1 + static_cast<std::size_t>(exponent - kMinExponent) * kSubBucketCount +
+                   sub_bucket;
+        }
+
+        /**
+         * @return The smallest value of a bucket, the largest one is the lower bound of the next.
+         */
+        [[nodiscard]] static double
+        GetBucketLowerBound(std::size_t index);
+
+        void
+        Record(const double value, const std::uint64_t count = 1) {
+            m_buckets_[GetBucketIndex(value)].fetch_add(count, std::memory_order_relaxed);
+            m_count_.fetch_add(count, std::memory_order_relaxed);
+            double min = m_min_.load(std::memory_order_relaxed);
+            while (value < min &&
+                   !m_min_.compare_exchange_weak(min, value, std::memory_order_relaxed)) {}
+            double max = m_max_.load(std::memory_order_relaxed);
+            while (value > max &&
+                   !m_max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+        }
+
+        void
+        Merge(const LatencyHistogram &other);
+
+        void
+        Reset();
+
+        [[nodiscard]] std::uint64_t
+        GetCount() const {
+            return m_count_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] std::uint64_t
+        GetBucketCount(const std::size_t index) const {
+            return m_buckets_[index].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return The smallest recorded value, 0 if nothing is recorded.
+         */
+        [[nodiscard]] double
+        GetMin() const;
+
+        /**
+         * @return The largest recorded value, 0 if nothing is recorded.
+         */
+        [[nodiscard]] double
+        GetMax() const;
+
+        /**
+         * @param p Percentile in [0, 100].
+         * @return The upper bound of the bucket that holds the percentile, clamped to the
+         * recorded range. 0 if nothing is recorded.
+         */
+        [[nodiscard]] double
+        GetPercentile(double p) const;
+
+        /**
+         * @return "count N, min x, p50 x, p90 x, p99 x, p999 x, max x"
+         */
+        [[nodiscard]] std::string
+        ToString() const;
+
+        /**
+         * Only the non-empty buckets are written.
+         */
+        [[nodiscard]] bool
+        Write(std::ostream &s) const;
+
+        [[nodiscard]] bool
+        Read(std::istream &s);
+    };
+}  // namespace erl::common
@@ -3,111 +3,269 @@
 #ifdef ERL_USE_LIBZIP
 
     #include "logging.hpp"
+    #include "serialization.hpp"
 
     #include <zip.h>
 
     #include <filesystem>
+    #include <list>
+    #include <memory>
+    #include <sstream>
 
 namespace erl::common {
     class LibZip {
+    public:
+        struct Setting {
+            bool overwrite = false;     // replace an existing archive instead of failing
+            int compression_level = 0;  // deflate level from 1 (fast) to 9 (small), 0 for default
+            // compress the entries on worker threads before they are added to the archive
+            bool parallel = true;
+            // pending entries are compressed when their total size reaches this, and the archive
+            // is written out once the data held for it in memory reaches this
+            std::size_t max_pending_bytes = 256 << 20;
+        };
+
+    private:
+        struct PendingEntry {
+            std::string name_in_zip{};
+            std::string filepath{};  // empty for in-memory entries
+            std::string data{};
+        };
 
+        Setting m_setting_{};
         int m_error_ = 0;
         zip_t *m_zip_ = nullptr;
         std::string m_zip_filepath_;
+        std::vector<PendingEntry> m_pending_entries_{};
+        std::size_t m_pending_bytes_ = 0;
+        // one in-memory archive per precompressed entry, copied into m_zip_ when it is written
+        std::vector<zip_t *> m_compressed_entries_{};
+        std::list<std::string> m_buffers_{};  // in-memory entries added without precompression
+        std::size_t m_held_bytes_ = 0;        // size of the two above
 
     public:
-        explicit LibZip(const std::string &zip_filepath)
-            : m_zip_(zip_open(zip_filepath.c_str(), ZIP_CREATE | ZIP_EXCL, &m_error_)),
-              m_zip_filepath_(zip_filepath) {
-            if (m_zip_ == nullptr) {
-                zip_error_t zip_error;
-                zip_error_init_with_code(&zip_error, m_error_);
-                const std::string error_msg = fmt::format(
-                    "Failed to create zip file {}: {}",
-                    zip_filepath,
-                    zip_error_strerror(&zip_error));
-                zip_error_fini(&zip_error);
-                ERL_FATAL(error_msg);  // throw error
-            }
-        }
+        explicit LibZip(const std::string &zip_filepath);
 
-        ~LibZip() {
-            if (m_zip_ != nullptr) {
-                if (zip_close(m_zip_) < 0) {
-                    ERL_ERROR(
-                        "Failed to close zip file {}: {}",
-                        m_zip_filepath_,
-                        zip_strerror(m_zip_));
-                }
-                m_zip_ = nullptr;
-            }
-        }
+        LibZip(const std::string &zip_filepath, const Setting &setting);
+
+        LibZip(const LibZip &) = delete;
+        LibZip &
+        operator=(const LibZip &) = delete;
+        LibZip(LibZip &&) = delete;
+        LibZip &
+        operator=(LibZip &&) = delete;
+
+        ~LibZip() { Close(); }
 
         [[nodiscard]] bool
-        AddFile(const std::string &filepath, const std::string &filename_in_zip) const {
-            zip_source_t *source = zip_source_file(m_zip_, filepath.c_str(), 0, 0);
-            if (source == nullptr) {
-                ERL_ERROR("Failed to add file {} as {} in zip", filepath, filename_in_zip);
-                return false;
-            }
-            if (zip_file_add(
-                    m_zip_,
-                    filename_in_zip.c_str(),
-                    source,
-                    ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE) < 0) {
-                ERL_ERROR(
-                    "Failed to add file {} as {} in zip: {}",
-                    filepath,
-                    filename_in_zip,
-                    zip_strerror(m_zip_));
-                zip_source_free(source);
+        AddFile(const std::string &filepath, const std::string &filename_in_zip);
+
+        /**
+         * Add an entry from memory, e.g. a serialized object, without a temporary file.
+         */
+        [[nodiscard]] bool
+        AddBuffer(const std::string &filename_in_zip, std::string data);
+
+        /**
+         * Add an object in the format of Serialization<T>::Write, so that the entry can be
+         * loaded by LibZipReader::ReadObject or extracted and read as a file.
+         */
+        template<typename T>
+        [[nodiscard]] bool
+        AddObject(
+            const std::string &filename_in_zip,
+            const T *data,
+            const serialization::Format format = serialization::Format::kAuto) {
+            std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+            if (!serialization::Serialization<T>::Write(stream, data, format)) {
+                ERL_ERROR("Failed to serialize {} for zip.", filename_in_zip);
                 return false;
             }
-            return true;
+            return AddBuffer(filename_in_zip, std::move(stream).str());
         }
 
         [[nodiscard]] bool
-        AddDirectory(const std::string &dirpath, const std::string &dirname_in_zip)
-            const {  // NOLINT(*-no-recursion)
-            ERL_ASSERTM(std::filesystem::is_directory(dirpath), "Not a directory: {}", dirpath);
-            auto directory_itr = std::filesystem::directory_iterator(dirpath);
-            return std::all_of(
-                std::filesystem::begin(directory_itr),
-                std::filesystem::end(directory_itr),
-                [this, &dirname_in_zip](const auto &entry) {  // NOLINT(*-no-recursion)
-                    const std::string entry_path = entry.path().string();
-                    const std::string entry_name = entry.path().filename().string();
-                    const std::string next_dirname_in_zip =
-                        dirname_in_zip + "/" +
-                        entry_name;  // NOLINT(*-inefficient-string-concatenation)
-                    if (entry.is_directory()) {
-                        return AddDirectory(entry_path, next_dirname_in_zip);
-                    }
-                    if (entry.is_regular_file()) {
-                        return AddFile(entry_path, next_dirname_in_zip);
-                    }
-                    ERL_ERROR("Unsupported file {}.", entry_path);
-                    return false;
-                });
+        AddDirectory(const std::string &dirpath, const std::string &dirname_in_zip);
+
+        [[nodiscard]] bool
+        AddItems(const std::vector<std::pair<std::string, std::string>> &item_and_name_in_zip);
+
+        /**
+         * Compress the pending entries, in parallel if enabled. libzip reads the data of the
+         * entries only when the archive is written, so the compressed data is held in memory
+         * until then. Once it reaches Setting::max_pending_bytes, the archive is written and
+         * reopened to release it. libzip cannot append in place, so each such write copies the
+         * entries written before; raise max_pending_bytes to write large archives less often.
+         */
+        [[nodiscard]] bool
+        Flush();
+
+        /**
+         * Write the archive. Called by the destructor.
+         */
+        bool
+        Close();
+
+    private:
+        [[nodiscard]] bool
+        AddPending(PendingEntry entry, std::size_t size);
+
+        /**
+         * Write the archive to release the entry data held in memory, then reopen it to add more
+         * entries.
+         */
+        [[nodiscard]] bool
+        Commit();
+
+        [[nodiscard]] bool
+        CheckOpen() const;
+
+        [[nodiscard]] bool
+        AddSource(zip_source_t *source, const std::string &filename_in_zip);
+
+        /**
+         * Compress one entry into an in-memory archive.
+         * @return The archive opened for reading, nullptr on failure.
+         */
+        [[nodiscard]] zip_t *
+        CompressEntry(const PendingEntry &entry) const;
+    };
+
+    /**
+     * Stream buffer over an entry of an archive, decompressed on the fly. Seeking forward skips
+     * data, seeking backward reopens the entry, so readers that need a seekable stream (e.g. the
+     * binary container) work on compressed entries.
+     */
+    class LibZipEntryStreamBuf : public std::streambuf {
+        zip_t *m_zip_ = nullptr;
+        zip_uint64_t m_index_ = 0;
+        zip_uint64_t m_size_ = 0;
+        zip_file_t *m_file_ = nullptr;
+        std::vector<char> m_buffer_;
+        zip_uint64_t m_buffer_pos_ = 0;  // position of eback() in the entry
+
+    public:
+        LibZipEntryStreamBuf(zip_t *zip, zip_uint64_t index, zip_uint64_t size);
+
+        LibZipEntryStreamBuf(const LibZipEntryStreamBuf &) = delete;
+        LibZipEntryStreamBuf &
+        operator=(const LibZipEntryStreamBuf &) = delete;
+
+        ~LibZipEntryStreamBuf() override;
+
+        [[nodiscard]] bool
+        IsOpen() const {
+            return m_file_ != nullptr;
+        }
+
+    protected:
+        int_type
+        underflow() override;
+
+        pos_type
+        seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+        pos_type
+        seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+    private:
+        bool
+        Reopen();
+    };
+
+    class LibZipEntryIStream : public std::istream {
+        LibZipEntryStreamBuf m_buf_;
+
+    public:
+        LibZipEntryIStream(zip_t *zip, const zip_uint64_t index, const zip_uint64_t size)
+            : std::istream(nullptr),
+              m_buf_(zip, index, size) {
+            rdbuf(&m_buf_);
+            if (!m_buf_.IsOpen()) { setstate(std::ios_base::badbit); }
         }
+    };
+
+    /**
+     * Read-only access to the entries of an archive.
+     */
+    class LibZipReader {
+        int m_error_ = 0;
+        zip_t *m_zip_ = nullptr;
+        std::string m_zip_filepath_;
+
+    public:
+        explicit LibZipReader(const std::string &zip_filepath);
+
+        LibZipReader(const LibZipReader &) = delete;
+        LibZipReader &
+        operator=(const LibZipReader &) = delete;
+        LibZipReader(LibZipReader &&) = delete;
+        LibZipReader &
+        operator=(LibZipReader &&) = delete;
+
+        ~LibZipReader();
+
+        [[nodiscard]] std::vector<std::string>
+        GetEntryNames() const;
 
         [[nodiscard]] bool
-        AddItems(
-            const std::vector<std::pair<std::string, std::string>> &item_and_name_in_zip) const {
-            return std::all_of(
-                item_and_name_in_zip.begin(),
-                item_and_name_in_zip.end(),
-                [this](const auto &pair) {
-                    if (std::filesystem::is_directory(pair.first)) {
-                        return AddDirectory(pair.first, pair.second);
-                    }
-                    if (std::filesystem::is_regular_file(pair.first)) {
-                        return AddFile(pair.first, pair.second);
-                    }
-                    ERL_ERROR("Unsupported file {}.", pair.first);
-                    return false;
-                });
+        HasEntry(const std::string &filename_in_zip) const;
+
+        /**
+         *
+         * @return Uncompressed size of the entry, 0 if it does not exist.
+         */
+        [[nodiscard]] std::size_t
+        GetEntrySize(const std::string &filename_in_zip) const;
+
+        /**
+         * Decompress a whole entry into memory. The buffer grows as data is read, so a wrong size
+         * in the archive makes the call fail instead of allocating that size.
+         */
+        [[nodiscard]] bool
+        Extract(const std::string &filename_in_zip, std::string &data) const;
+
+        /**
+         * Decompress an entry to a file, without holding the entry in memory.
+         */
+        [[nodiscard]] bool
+        ExtractFile(const std::string &filename_in_zip, const std::string &filepath) const;
+
+        /**
+         * Extract all entries under a directory. Fails without extracting anything if an entry
+         * name is absolute or contains a ".." component, which would write outside the
+         * directory.
+         */
+        [[nodiscard]] bool
+        ExtractAll(const std::string &dirpath) const;
+
+        /**
+         * Open an entry as a stream. Only one entry can be read at a time, the stream must not
+         * outlive the reader.
+         * @return The stream, nullptr if the entry does not exist.
+         */
+        [[nodiscard]] std::unique_ptr<LibZipEntryIStream>
+        OpenEntry(const std::string &filename_in_zip) const;
+
+        /**
+         * Read an object written by LibZip::AddObject or added from a file written by
+         * Serialization<T>::Write.
+         */
+        template<typename T>
+        [[nodiscard]] bool
+        ReadObject(const std::string &filename_in_zip, T *data) const {
+            const std::unique_ptr<LibZipEntryIStream> stream = OpenEntry(filename_in_zip);
+            if (stream == nullptr) { return false; }
+            if (!serialization::Serialization<T>::Read(*stream, data)) {
+                ERL_ERROR("Failed to read {} from {}.", filename_in_zip, m_zip_filepath_);
+                return false;
+            }
+            return true;
         }
+
+    private:
+        [[nodiscard]] zip_int64_t
+        Locate(const std::string &filename_in_zip) const;
     };
 }  // namespace erl::common
 
@@ -4,17 +4,73 @@
 
 #include "logging_level.hpp"
 
+// drops the statement of a level below ERL_LOG_ACTIVE_LEVEL at compile time
+#define ERL_LOG_IF_ACTIVE(macro_level, ...)                          \
+    do {                                                             \
+        if (ERL_LOG_ACTIVE_LEVEL <= (macro_level)) { __VA_ARGS__; } \
+    } while (false)
+
 #ifdef ERL_USE_FMT
     #include "fmt.hpp"
     #include "progress_bar.hpp"
 
+    #include <atomic>
+    #include <chrono>
+    #include <cstdint>
+    #include <ctime>
     #include <mutex>
 
 namespace erl::common {
 
     class Logging {
+    public:
+        /**
+         * What the asynchronous backend does when the queue of a thread is full.
+         */
+        enum class Overflow {
+            kBlock = 0,  // wait until the background thread makes room
+            kDrop = 1,   // drop the record
+            kCount = 2,  // drop the record and report the number of dropped records
+        };
+
+        struct AsyncSetting {
+            std::size_t queue_capacity = 1024;  // records per thread, rounded up to a power of 2
+            Overflow overflow = Overflow::kCount;
+            // how long the background thread sleeps between two batches
+            std::chrono::milliseconds flush_interval{1};
+        };
+
+        /**
+         * Timestamp in the prefix of the messages.
+         */
+        enum class TimeFormat {
+            kSeconds = 0,       // local time, HH:MM:SS
+            kMicroseconds = 1,  // local time, HH:MM:SS.uuuuuu
+            kMonotonic = 2,     // seconds since the program started on the steady clock, to 1 us
+        };
+
+    private:
+        enum class Tag {
+            kDebug = 0,
+            kInfo = 1,
+            kWarn = 2,
+            kError = 3,
+            kFatal = 4,
+            kSuccess = 5,
+            kFailure = 6,
+        };
+
+        struct Async;  // background thread and per-thread queues, defined in logging.cpp
+
+        struct Timestamp {
+            TimeFormat format = TimeFormat::kSeconds;
+            std::int64_t ns = 0;  // since the epoch, or since the program started for kMonotonic
+        };
+
         static LoggingLevel s_level_;
         static std::mutex g_print_mutex;
+        static std::atomic<bool> s_async_;
+        static std::atomic<TimeFormat> s_time_format_;
 
     public:
         static void
@@ -23,6 +79,12 @@ namespace erl::common {
         static LoggingLevel
         GetLevel();
 
+        static void
+        SetTimeFormat(TimeFormat format);
+
+        static TimeFormat
+        GetTimeFormat();
+
         static std::string
         GetDateStr();
 
@@ -35,65 +97,84 @@ namespace erl::common {
         static std::string
         GetTimeStamp();
 
+        /**
+         * Move the output of Debug, Info, Warn, Error and Success to a background thread. The
+         * message is still formatted by the caller, which then only pushes it into a lock-free
+         * queue of its thread. The background thread adds the prefix, orders the records of all
+         * threads as they were logged and writes them in batches. Fatal, Failure and Write flush
+         * the queues and write on the calling thread. Restarts the backend if it is running.
+         */
+        static void
+        StartAsync(const AsyncSetting &setting);
+
+        static void
+        StartAsync();
+
+        /**
+         * Write the queued records and stop the background thread. Records logged by other
+         * threads while it stops may be lost. Called at exit.
+         */
+        static void
+        StopAsync();
+
+        [[nodiscard]] static bool
+        IsAsync() {
+            return s_async_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Block until the records logged before are written.
+         */
+        static void
+        Flush();
+
+        /**
+         * @return Number of records dropped because a queue was full, since StartAsync.
+         */
+        [[nodiscard]] static std::size_t
+        GetNumDroppedRecords();
+
+        /**
+         * Whether messages of the level are written at the current logging level.
+         */
+        [[nodiscard]] static bool
+        IsEnabled(const LoggingLevel level) {
+            return s_level_ <= level;
+        }
+
+        /**
+         * Write a message prefixed by its source location, formatted in one pass. Used by the
+         * ERL_* macros, which check the level before the arguments are evaluated.
+         */
         template<typename... Args>
         static void
-        Info(Args... args) {
+        LogAt(const LoggingLevel level, const char *file, const int line, Args &&...args) {
+            if (!IsEnabled(level)) { return; }
+            std::string msg = fmt::format("{}:{}: ", file, line);
+            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
+            Submit(ToTag(level), std::move(msg));
+        }
+
+        template<typename... Args>
+        static void
+        Info(Args &&...args) {
             if (s_level_ > kInfo) { return; }
             // https://fmt.dev/latest/syntax.html
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            std::string msg = fmt::format(
-                fmt::fg(fmt::color::deep_sky_blue) | fmt::emphasis::bold,
-                "[{:%X}][INFO]: ",
-                time);
-            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
-            ProgressBar::Write(msg);
+            Submit(Tag::kInfo, fmt::format(std::forward<Args>(args)...));
         }
 
         template<typename... Args>
         static void
-        Debug(Args... args) {
+        Debug(Args &&...args) {
             if (s_level_ > kDebug) { return; }
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            std::string msg = fmt::format(  //
-                fmt::fg(fmt::color::orange) | fmt::emphasis::bold,
-                "[{:%X}][DEBUG]: ",
-                time);
-            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
-            ProgressBar::Write(msg);
+            Submit(Tag::kDebug, fmt::format(std::forward<Args>(args)...));
         }
 
         template<typename... Args>
         static void
-        Warn(Args... args) {
+        Warn(Args &&...args) {
             if (s_level_ > kWarn) { return; }
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            std::string msg = fmt::format(
-                fmt::fg(fmt::color::orange_red) | fmt::emphasis::bold,
-                "[{:%X}][WARN]: ",
-                time);
-            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
-            ProgressBar::Write(msg);
+            Submit(Tag::kWarn, fmt::format(std::forward<Args>(args)...));
         }
 
         /**
@@ -104,22 +185,9 @@ namespace erl::common {
          */
         template<typename... Args>
         static void
-        Error(Args... args) {
+        Error(Args &&...args) {
             if (s_level_ > kError) { return; }
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            std::string msg = fmt::format(  //
-                fmt::fg(fmt::color::red) | fmt::emphasis::bold,
-                "[{:%X}][ERROR]: ",
-                time);
-            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
-            ProgressBar::Write(msg);
+            Submit(Tag::kError, fmt::format(std::forward<Args>(args)...));
         }
 
         /**
@@ -129,21 +197,8 @@ namespace erl::common {
          */
         template<typename... Args>
         static void
-        Fatal(Args... args) {
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            std::string msg = fmt::format(
-                fmt::fg(fmt::color::dark_red) | fmt::emphasis::bold,
-                "[{:%X}][FATAL]: ",
-                time);
-            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
-            ProgressBar::Write(msg);
+        Fatal(Args &&...args) {
+            Submit(Tag::kFatal, fmt::format(std::forward<Args>(args)...));
         }
 
         /**
@@ -153,21 +208,8 @@ namespace erl::common {
          */
         template<typename... Args>
         static void
-        Success(Args... args) {
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            std::string msg = fmt::format(
-                fmt::fg(fmt::color::spring_green) | fmt::emphasis::bold,
-                "[{:%X}][SUCCESS]: ",
-                time);
-            fmt::format_to(std::back_inserter(msg), std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
-            ProgressBar::Write(msg);
+        Success(Args &&...args) {
+            Submit(Tag::kSuccess, fmt::format(std::forward<Args>(args)...));
         }
 
         /**
@@ -178,46 +220,69 @@ namespace erl::common {
          */
         template<typename... Args>
         static std::string
-        Failure(Args... args) {
-            const std::scoped_lock lock(g_print_mutex);
-            const time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-            auto time = *std::localtime(&now);
-    #else
-            auto time = fmt::localtime(now);
-    #endif
-            const std::string msg = fmt::format(  //
-                fmt::fg(fmt::color::red) | fmt::emphasis::bold,
-                "[{:%X}][FAILURE]: ",
-                time);
-            std::string failure_msg = fmt::format(std::forward<Args>(args)...);
-            if (ProgressBar::GetNumBars() == 0) { failure_msg += "\n"; }
-            ProgressBar::Write(msg + failure_msg);
-            return failure_msg;
+        Failure(Args &&...args) {
+            return SubmitFailure(fmt::format(std::forward<Args>(args)...));
         }
 
         static void
-        Write(const std::string &msg) {
-            const std::scoped_lock lock(g_print_mutex);
-            ProgressBar::Write(msg);
+        Write(const std::string &msg);
+
+    private:
+        static constexpr Tag
+        ToTag(const LoggingLevel level) {
+            switch (level) {
+                case kDebug:
+                    return Tag::kDebug;
+                case kInfo:
+                    return Tag::kInfo;
+                case kWarn:
+                    return Tag::kWarn;
+                default:
+                    return Tag::kError;
+            }
         }
+
+        /**
+         * Queue the message if the asynchronous backend is running, write it otherwise.
+         */
+        static void
+        Submit(Tag tag, std::string msg);
+
+        static std::string
+        SubmitFailure(std::string msg);
+
+        static Timestamp
+        Now();
+
+        /**
+         * Append the styled "[time][LABEL]: ". The local time is cached per thread and only
+         * reformatted when the second changes.
+         */
+        static void
+        AppendPrefix(std::string &out, Tag tag, const Timestamp &time);
     };
 }  // namespace erl::common
 
     #define LOGGING_LABELS           fmt::format("{}:{}", __FILE__, __LINE__)
     #define LOGGING_LABELED_MSG(msg) fmt::format("{}:{}: {}", __FILE__, __LINE__, msg)
+    #define ERL_LOG_SUPPRESSED(log_macro, n) \
+        log_macro("{} similar messages were suppressed by the rate limit.", n)
 
     #ifdef ERL_ROS_VERSION_1
         #include <ros/assert.h>
         #include <ros/console.h>
         #define ERL_FATAL(...)     ROS_FATAL(fmt::format(__VA_ARGS__).c_str())
-        #define ERL_ERROR(...)     ROS_ERROR(fmt::format(__VA_ARGS__).c_str())
-        #define ERL_WARN(...)      ROS_WARN(fmt::format(__VA_ARGS__).c_str())
+        #define ERL_ERROR(...) \
+            ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_ERROR, ROS_ERROR(fmt::format(__VA_ARGS__).c_str()))
+        #define ERL_WARN(...) \
+            ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_WARN, ROS_WARN(fmt::format(__VA_ARGS__).c_str()))
         #define ERL_WARN_ONCE(...) ROS_WARN_ONCE(fmt::format(__VA_ARGS__).c_str())
         #define ERL_WARN_COND(condition, ...) \
             ROS_WARN_COND(condition, fmt::format(__VA_ARGS__).c_str())
-        #define ERL_INFO(...)  ROS_INFO(fmt::format(__VA_ARGS__).c_str())
-        #define ERL_DEBUG(...) ROS_DEBUG(fmt::format(__VA_ARGS__).c_str())
+        #define ERL_INFO(...) \
+            ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_INFO, ROS_INFO(fmt::format(__VA_ARGS__).c_str()))
+        #define ERL_DEBUG(...) \
+            ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_DEBUG, ROS_DEBUG(fmt::format(__VA_ARGS__).c_str()))
         #ifdef ROS_ASSERT_ENABLED
             #define ERL_ASSERT(expr) ROS_ASSERT(expr)
             #define ERL_ASSERTM(expr, ...) \
@@ -227,10 +292,14 @@ namespace erl::common {
         #include <rclcpp/rclcpp.hpp>
         #define ERL_FATAL(...) \
             RCLCPP_FATAL(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str())
-        #define ERL_ERROR(...) \
-            RCLCPP_ERROR(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str())
-        #define ERL_WARN(...) \
-            RCLCPP_WARN(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str())
+        #define ERL_ERROR(...)       \
+            ERL_LOG_IF_ACTIVE(       \
+                ERL_LOG_LEVEL_ERROR, \
+                RCLCPP_ERROR(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str()))
+        #define ERL_WARN(...)       \
+            ERL_LOG_IF_ACTIVE(      \
+                ERL_LOG_LEVEL_WARN, \
+                RCLCPP_WARN(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str()))
         #define ERL_WARN_ONCE(...) \
             RCLCPP_WARN_ONCE(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str())
         #define ERL_WARN_COND(condition, ...)                                                    \
@@ -238,12 +307,25 @@ namespace erl::common {
                 if (condition)                                                                   \
                     RCLCPP_WARN(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str()); \
             } while (false)
-        #define ERL_INFO(...) \
-            RCLCPP_INFO(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str())
-        #define ERL_DEBUG(...) \
-            RCLCPP_DEBUG(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str())
+        #define ERL_INFO(...)       \
+            ERL_LOG_IF_ACTIVE(      \
+                ERL_LOG_LEVEL_INFO, \
+                RCLCPP_INFO(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str()))
+        #define ERL_DEBUG(...)       \
+            ERL_LOG_IF_ACTIVE(       \
+                ERL_LOG_LEVEL_DEBUG, \
+                RCLCPP_DEBUG(rclcpp::get_logger("rclcpp"), fmt::format(__VA_ARGS__).c_str()))
     #else
 
+        // the arguments are evaluated only if the level is enabled
+        #define ERL_LOG_AT(level, macro_level, ...)                                      \
+            do {                                                                         \
+                if (ERL_LOG_ACTIVE_LEVEL <= (macro_level) &&                             \
+                    erl::common::Logging::IsEnabled(level)) {                            \
+                    erl::common::Logging::LogAt(level, __FILE__, __LINE__, __VA_ARGS__); \
+                }                                                                        \
+            } while (false)
+
         #define ERL_FATAL(...)                 \
             do {                               \
                 erl::common::Logging::Fatal(   \
@@ -254,23 +336,9 @@ namespace erl::common {
                 exit(1);                       \
             } while (false)
 
-        #define ERL_ERROR(...)                 \
-            do {                               \
-                erl::common::Logging::Error(   \
-                    "{}:{}: {}",               \
-                    __FILE__,                  \
-                    __LINE__,                  \
-                    fmt::format(__VA_ARGS__)); \
-            } while (false)
+        #define ERL_ERROR(...) ERL_LOG_AT(erl::common::kError, ERL_LOG_LEVEL_ERROR, __VA_ARGS__)
 
-        #define ERL_WARN(...)                  \
-            do {                               \
-                erl::common::Logging::Warn(    \
-                    "{}:{}: {}",               \
-                    __FILE__,                  \
-                    __LINE__,                  \
-                    fmt::format(__VA_ARGS__)); \
-            } while (false)
+        #define ERL_WARN(...) ERL_LOG_AT(erl::common::kWarn, ERL_LOG_LEVEL_WARN, __VA_ARGS__)
 
         #define ERL_WARN_ONCE(...)          \
             do {                            \
@@ -286,23 +354,9 @@ namespace erl::common {
                 if (condition) { ERL_WARN(__VA_ARGS__); } \
             } while (false)
 
-        #define ERL_INFO(...)                  \
-            do {                               \
-                erl::common::Logging::Info(    \
-                    "{}:{}: {}",               \
-                    __FILE__,                  \
-                    __LINE__,                  \
-                    fmt::format(__VA_ARGS__)); \
-            } while (false)
+        #define ERL_INFO(...) ERL_LOG_AT(erl::common::kInfo, ERL_LOG_LEVEL_INFO, __VA_ARGS__)
 
-        #define ERL_DEBUG(...)                 \
-            do {                               \
-                erl::common::Logging::Debug(   \
-                    "{}:{}: {}",               \
-                    __FILE__,                  \
-                    __LINE__,                  \
-                    fmt::format(__VA_ARGS__)); \
-            } while (false)
+        #define ERL_DEBUG(...) ERL_LOG_AT(erl::common::kDebug, ERL_LOG_LEVEL_DEBUG, __VA_ARGS__)
 
         #ifndef NDEBUG
             #define ERL_DEBUG_ASSERT(expr, ...) ERL_ASSERTM(expr, __VA_ARGS__)
@@ -366,15 +420,17 @@ namespace erl::common {
     using Logging = LoggingNoFmt;
 }
 
+    #define ERL_LOG_SUPPRESSED(log_macro, n) \
+        log_macro(n, " similar messages were suppressed by the rate limit.")
     #define ERL_FATAL(...)                      ERL_NO_FMT_FATAL(__VA_ARGS__)
-    #define ERL_ERROR(...)                      ERL_NO_FMT_ERROR(__VA_ARGS__)
-    #define ERL_WARN(...)                       ERL_NO_FMT_WARN(__VA_ARGS__)
+    #define ERL_ERROR(...) ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_ERROR, ERL_NO_FMT_ERROR(__VA_ARGS__))
+    #define ERL_WARN(...)  ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_WARN, ERL_NO_FMT_WARN(__VA_ARGS__))
     #define ERL_WARN_ONCE(...)                  ERL_NO_FMT_WARN_ONCE(__VA_ARGS__)
     #define ERL_WARN_COND(condition, ...)       ERL_NO_FMT_WARN_COND(condition, __VA_ARGS__)
     #define ERL_WARN_ONCE_COND(condition, ...)  ERL_NO_FMT_WARN_ONCE_COND(condition, __VA_ARGS__)
-    #define ERL_INFO(...)                       ERL_NO_FMT_INFO(__VA_ARGS__)
+    #define ERL_INFO(...)  ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_INFO, ERL_NO_FMT_INFO(__VA_ARGS__))
     #define ERL_INFO_ONCE(...)                  ERL_NO_FMT_INFO_ONCE(__VA_ARGS__)
-    #define ERL_DEBUG(...)                      ERL_NO_FMT_DEBUG(__VA_ARGS__)
+    #define ERL_DEBUG(...) ERL_LOG_IF_ACTIVE(ERL_LOG_LEVEL_DEBUG, ERL_NO_FMT_DEBUG(__VA_ARGS__))
     #define ERL_ASSERT(expr)                    ERL_NO_FMT_ASSERT(expr)
     #define ERL_ASSERTM(expr, ...)              ERL_NO_FMT_ASSERTM(expr, __VA_ARGS__)
     #define ERL_DEBUG_ASSERT(condition, ...)    ERL_NO_FMT_DEBUG_ASSERT(condition, __VA_ARGS__)
@@ -430,3 +486,5 @@ namespace erl::common {
             return retval;                    \
         }                                     \
     } while (false)
+
+#include "logging_rate_limit.hpp"
@@ -1,11 +1,27 @@
 #pragma once
 
+// the levels of LoggingLevel for the preprocessor
+#define ERL_LOG_LEVEL_DEBUG  1
+#define ERL_LOG_LEVEL_INFO   2
+#define ERL_LOG_LEVEL_WARN   3
+#define ERL_LOG_LEVEL_ERROR  4
+#define ERL_LOG_LEVEL_SILENT 5
+
+/**
+ * Lowest level compiled in. ERL_DEBUG, ERL_INFO, ERL_WARN and ERL_ERROR below it expand to code
+ * that is never executed and is removed by the compiler, e.g. build with
+ * -DERL_LOG_ACTIVE_LEVEL=ERL_LOG_LEVEL_INFO to remove ERL_DEBUG.
+ */
+#ifndef ERL_LOG_ACTIVE_LEVEL
+    #define ERL_LOG_ACTIVE_LEVEL ERL_LOG_LEVEL_DEBUG
+#endif
+
 namespace erl::common {
     enum LoggingLevel {
-        kDebug = 1,
-        kInfo = 2,
-        kWarn = 3,
-        kError = 4,
-        kSilent = 5,
+        kDebug = ERL_LOG_LEVEL_DEBUG,
+        kInfo = ERL_LOG_LEVEL_INFO,
+        kWarn = ERL_LOG_LEVEL_WARN,
+        kError = ERL_LOG_LEVEL_ERROR,
+        kSilent = ERL_LOG_LEVEL_SILENT,
     };
 }
@@ -41,6 +41,11 @@ namespace erl::common {
         static LoggingLevel
         GetLevel();
 
+        [[nodiscard]] static bool
+        IsEnabled(const LoggingLevel level) {
+            return s_level_ <= level;
+        }
+
         static std::string
         GetDateStr();
 
@@ -333,24 +338,28 @@ namespace erl::common::detail {
             exit(1);                                           \
         } while (false)
 
-    #define ERL_NO_FMT_ERROR(...)                              \
-        do {                                                   \
-            erl::common::LoggingNoFmt::Error(                  \
-                __FILE__,                                      \
-                ":",                                           \
-                __LINE__,                                      \
-                ": ",                                          \
-                erl::common::detail::FormatArgs(__VA_ARGS__)); \
+    #define ERL_NO_FMT_ERROR(...)                                            \
+        do {                                                                 \
+            if (erl::common::LoggingNoFmt::IsEnabled(erl::common::kError)) { \
+                erl::common::LoggingNoFmt::Error(                            \
+                    __FILE__,                                                \
+                    ":",                                                     \
+                    __LINE__,                                                \
+                    ": ",                                                    \
+                    erl::common::detail::FormatArgs(__VA_ARGS__));           \
+            }                                                                \
         } while (false)
 
-    #define ERL_NO_FMT_WARN(...)                               \
-        do {                                                   \
-            erl::common::LoggingNoFmt::Warn(                   \
-                __FILE__,                                      \
-                ":",                                           \
-                __LINE__,                                      \
-                ": ",                                          \
-                erl::common::detail::FormatArgs(__VA_ARGS__)); \
+    #define ERL_NO_FMT_WARN(...)                                            \
+        do {                                                                \
+            if (erl::common::LoggingNoFmt::IsEnabled(erl::common::kWarn)) { \
+                erl::common::LoggingNoFmt::Warn(                            \
+                    __FILE__,                                               \
+                    ":",                                                    \
+                    __LINE__,                                               \
+                    ": ",                                                   \
+                    erl::common::detail::FormatArgs(__VA_ARGS__));          \
+            }                                                               \
         } while (false)
 
     #define ERL_NO_FMT_WARN_ONCE(...)         \
@@ -367,24 +376,28 @@ namespace erl::common::detail {
             if (condition) { ERL_NO_FMT_WARN(__VA_ARGS__); } \
         } while (false)
 
-    #define ERL_NO_FMT_INFO(...)                               \
-        do {                                                   \
-            erl::common::LoggingNoFmt::Info(                   \
-                __FILE__,                                      \
-                ":",                                           \
-                __LINE__,                                      \
-                ": ",                                          \
-                erl::common::detail::FormatArgs(__VA_ARGS__)); \
+    #define ERL_NO_FMT_INFO(...)                                            \
+        do {                                                                \
+            if (erl::common::LoggingNoFmt::IsEnabled(erl::common::kInfo)) { \
+                erl::common::LoggingNoFmt::Info(                            \
+                    __FILE__,                                               \
+                    ":",                                                    \
+                    __LINE__,                                               \
+                    ": ",                                                   \
+                    erl::common::detail::FormatArgs(__VA_ARGS__));          \
+            }                                                               \
         } while (false)
 
-    #define ERL_NO_FMT_DEBUG(...)                              \
-        do {                                                   \
-            erl::common::LoggingNoFmt::Debug(                  \
-                __FILE__,                                      \
-                ":",                                           \
-                __LINE__,                                      \
-                ": ",                                          \
-                erl::common::detail::FormatArgs(__VA_ARGS__)); \
+    #define ERL_NO_FMT_DEBUG(...)                                            \
+        do {                                                                 \
+            if (erl::common::LoggingNoFmt::IsEnabled(erl::common::kDebug)) { \
+                erl::common::LoggingNoFmt::Debug(                            \
+                    __FILE__,                                                \
+                    ":",                                                     \
+                    __LINE__,                                                \
+                    ": ",                                                    \
+                    erl::common::detail::FormatArgs(__VA_ARGS__));           \
+            }                                                                \
         } while (false)
 
     #ifndef NDEBUG
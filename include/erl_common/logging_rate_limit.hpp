@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace erl::common {
+
+    /**
+     * Counter of a log statement that is written every n-th time, one static instance per call
+     * site.
+     */
+    class LogEveryN {
+        std::atomic<std::uint64_t> m_count_{0};
+
+    public:
+        [[nodiscard]] bool
+        ShouldLog(const std::uint64_t n) {
+            return m_count_.fetch_add(1, std::memory_order_relaxed) % (n == 0 ? 1 : n) == 0;
+        }
+    };
+
+    /**
+     * State of a log statement that is written at most once per period. The statements skipped
+     * during a period are counted, so that the next written one can report them. Nothing reports
+     * them if no statement is written after the period.
+     */
+    class LogEveryMs {
+        std::atomic<std::int64_t> m_next_ns_{std::numeric_limits<std::int64_t>::min()};
+        std::atomic<std::uint64_t> m_num_suppressed_{0};
+
+    public:
+        /**
+         * @param period_ms Minimum time between two written statements.
+         * @return true if the statement should be written.
+         */
+        [[nodiscard]] bool
+        ShouldLog(const std::int64_t period_ms) {
+            const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count();
+            std::int64_t next = m_next_ns_.load(std::memory_order_relaxed);
+            if (now < next || !m_next_ns_.compare_exchange_strong(
+                                  next,
+                                  now + period_ms * 1000000,
+                                  std::memory_order_relaxed)) {
+                m_num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @return Number of statements skipped since the last call.
+         */
+        [[nodiscard]] std::uint64_t
+        TakeNumSuppressed() {
+            return m_num_suppressed_.exchange(0, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Token bucket of a log statement: on average at most `rate` statements per second are
+     * written, with bursts of up to `burst` statements. Implemented as a generic cell rate
+     * algorithm, so that the whole bucket is one atomic timestamp. The skipped statements are
+     * counted like those of LogEveryMs.
+     */
+    class LogThrottle {
+        // time at which the bucket is full again
+        std::atomic<std::int64_t> m_full_ns_{std::numeric_limits<std::int64_t>::min()};
+        std::atomic<std::uint64_t> m_num_suppressed_{0};
+
+    public:
+        /**
+         * @param rate Tokens added per second. Nothing is written if it is not positive.
+         * @param burst Capacity of the bucket, at least 1.
+         * @return true if the statement should be written.
+         */
+        [[nodiscard]] bool
+        ShouldLog(const double rate, const double burst) {
+            if (!(rate > 0.0)) {  // also NaN
+                m_num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count();
+            // about 30 years, keeps the sums below in range for tiny rates or huge bursts
+            constexpr double kMaxNs = 1.0e18;
+            const auto interval = static_cast<std::int64_t>(std::min(1.0e9 / rate, kMaxNs));
+            const auto capacity =
+                static_cast<std::int64_t>(std::min(1.0e9 * std::max(1.0, burst) / rate, kMaxNs));
+            std::int64_t full = m_full_ns_.load(std::memory_order_relaxed);
+            while (true) {
+                const std::int64_t start = full < now ? now : full;  // the bucket is not overfull
+                if (start + interval - now > capacity) {            // not enough tokens
+                    m_num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (m_full_ns_.compare_exchange_weak(
+                        full,
+                        start + interval,
+                        std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @return Number of statements skipped since the last call.
+         */
+        [[nodiscard]] std::uint64_t
+        TakeNumSuppressed() {
+            return m_num_suppressed_.exchange(0, std::memory_order_relaxed);
+        }
+    };
+}  // namespace erl::common
+
+// the limiter is only touched if the level is compiled in
+#define ERL_LOG_EVERY_N(log_macro, macro_level, n, ...)                   \
+    do {                                                                  \
+        if (ERL_LOG_ACTIVE_LEVEL <= (macro_level)) {                      \
+            static erl::common::LogEveryN erl_log_limiter;                \
+            if (erl_log_limiter.ShouldLog(n)) { log_macro(__VA_ARGS__); } \
+        }                                                                 \
+    } while (false)
+
+// limits are the parenthesized arguments of limiter_type::ShouldLog
+#define ERL_LOG_LIMITED(log_macro, macro_level, limiter_type, limits, ...)                    \
+    do {                                                                                      \
+        if (ERL_LOG_ACTIVE_LEVEL <= (macro_level)) {                                          \
+            static limiter_type erl_log_limiter;                                              \
+            if (erl_log_limiter.ShouldLog limits) {                                           \
+                const std::uint64_t erl_num_suppressed = erl_log_limiter.TakeNumSuppressed(); \
+                if (erl_num_suppressed > 0) {                                                 \
+                    ERL_LOG_SUPPRESSED(log_macro, erl_num_suppressed);                        \
+                }                                                                             \
+                log_macro(__VA_ARGS__);                                                       \
+            }                                                                                 \
+        }                                                                                     \
+    } while (false)
+
+/**
+ * Write every n-th occurrence of the statement, starting with the first one.
+ */
+#define ERL_DEBUG_EVERY_N(n, ...) ERL_LOG_EVERY_N(ERL_DEBUG, ERL_LOG_LEVEL_DEBUG, n, __VA_ARGS__)
+#define ERL_INFO_EVERY_N(n, ...)  ERL_LOG_EVERY_N(ERL_INFO, ERL_LOG_LEVEL_INFO, n, __VA_ARGS__)
+#define ERL_WARN_EVERY_N(n, ...)  ERL_LOG_EVERY_N(ERL_WARN, ERL_LOG_LEVEL_WARN, n, __VA_ARGS__)
+#define ERL_ERROR_EVERY_N(n, ...) ERL_LOG_EVERY_N(ERL_ERROR, ERL_LOG_LEVEL_ERROR, n, __VA_ARGS__)
+
+/**
+ * Write the statement at most once per ms milliseconds. The number of skipped statements is
+ * written before the next written one, it is not written if none follows.
+ */
+#define ERL_DEBUG_EVERY_MS(ms, ...) \
+    ERL_LOG_LIMITED(ERL_DEBUG, ERL_LOG_LEVEL_DEBUG, erl::common::LogEveryMs, (ms), __VA_ARGS__)
+#define ERL_INFO_EVERY_MS(ms, ...) \
+    ERL_LOG_LIMITED(ERL_INFO, ERL_LOG_LEVEL_INFO, erl::common::LogEveryMs, (ms), __VA_ARGS__)
+#define ERL_WARN_EVERY_MS(ms, ...) \
+    ERL_LOG_LIMITED(ERL_WARN, ERL_LOG_LEVEL_WARN, erl::common::LogEveryMs, (ms), __VA_ARGS__)
+#define ERL_ERROR_EVERY_MS(ms, ...) \
+    ERL_LOG_LIMITED(ERL_ERROR, ERL_LOG_LEVEL_ERROR, erl::common::LogEveryMs, (ms), __VA_ARGS__)
+
+/**
+ * Write the statement at most rate times per second on average and burst times at once. The
+ * number of skipped statements is written before the next written one, it is not written if none
+ * follows.
+ */
+#define ERL_DEBUG_THROTTLED(rate, burst, ...) \
+    ERL_LOG_LIMITED(                          \
+        ERL_DEBUG,                            \
+        ERL_LOG_LEVEL_DEBUG,                  \
+        erl::common::LogThrottle,             \
+        (rate, burst),                        \
+        __VA_ARGS__)
+#define ERL_INFO_THROTTLED(rate, burst, ...) \
+    ERL_LOG_LIMITED(                         \
+        ERL_INFO,                            \
+        ERL_LOG_LEVEL_INFO,                  \
+        erl::common::LogThrottle,            \
+        (rate, burst),                       \
+        __VA_ARGS__)
+#define ERL_WARN_THROTTLED(rate, burst, ...) \
+    ERL_LOG_LIMITED(                         \
+        ERL_WARN,                            \
+        ERL_LOG_LEVEL_WARN,                  \
+        erl::common::LogThrottle,            \
+        (rate, burst),                       \
+        __VA_ARGS__)
+#define ERL_ERROR_THROTTLED(rate, burst, ...) \
+    ERL_LOG_LIMITED(                          \
+        ERL_ERROR,                            \
+        ERL_LOG_LEVEL_ERROR,                  \
+        erl::common::LogThrottle,             \
+        (rate, burst),                        \
+        __VA_ARGS__)
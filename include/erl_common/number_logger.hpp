@@ -1,26 +1,102 @@
 #pragma once
+#include "csv.hpp"
+#include "latency_histogram.hpp"
 #include "logging.hpp"
+#include "running_statistics.hpp"
 
+#include <array>
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace erl::common {
 
+    /**
+     * Accumulate the values of named columns over a step and write their statistics as a row of
+     * a CSV file and/or of a table on screen at every Print. The mean and the std are updated by
+     * Welford's algorithm in every shard and the shards are merged by the formula of Chan et al.;
+     * columns added with percentiles also keep a LatencyHistogram and report p50, p99 and p999.
+     *
+     * Log may be called from several threads. Every thread accumulates into its own shard, which
+     * is guarded by a spin lock that only Print contends for, and the shards are merged at Print.
+     * Logging by the column id returned by AddColumn avoids hashing the name, and the cost of a
+     * sample does not depend on the number of columns.
+     */
     class NumberLogger {
-        std::ofstream m_file_;
+    public:
+        using ColumnId = std::size_t;
+
+        struct ColumnStatistics {
+            std::string name{};
+            RunningStatistics stats{};
+            std::shared_ptr<const LatencyHistogram> histogram{};  // nullptr without percentiles
+
+            [[nodiscard]] double
+            GetPercentile(const double p) const {
+                return histogram == nullptr ? std::numeric_limits<double>::quiet_NaN()
+                                            : histogram->GetPercentile(p);
+            }
+        };
+
+    private:
+        struct Column {
+            RunningStatistics stats{};
+            std::unique_ptr<LatencyHistogram> histogram{};
+        };
+
+        struct Shard {
+            struct Column {
+                RunningStatistics stats{};
+                std::unique_ptr<LatencyHistogram> histogram{};
+            };
+
+            std::atomic<bool> locked{false};
+            std::vector<Column> columns{};
+
+            void
+            Lock() {
+                while (locked.exchange(true, std::memory_order_acquire)) {
+                    while (locked.load(std::memory_order_relaxed)) { std::this_thread::yield(); }
+                }
+            }
+
+            void
+            Unlock() {
+                locked.store(false, std::memory_order_release);
+            }
+        };
+
+        // shards of the thread by the id of the logger, ids are never reused
+        static constexpr std::size_t kShardCacheSize = 8;
+        inline static std::atomic<std::uint64_t> s_next_id_{1};
+
+        CsvWriter m_writer_;
         std::string m_step_name_{};
         int m_step_idx_ = 0;
         bool m_append_ = false;
         bool m_on_screen_ = false;
         bool m_header_written_ = false;
-        bool m_log_called_ = false;
+        const std::uint64_t m_id_ = s_next_id_.fetch_add(1, std::memory_order_relaxed);
         std::vector<std::string> m_column_names_{};
-        std::unordered_map<std::string, double> m_value_sum_{};
-        std::unordered_map<std::string, double> m_weight_sum_{};
-        std::unordered_map<std::string, double> m_squared_value_sum_{};
+        std::unordered_map<std::string, ColumnId> m_column_indices_{};
+        mutable std::mutex m_mutex_{};             // guards m_columns_ and m_shards_
+        mutable std::vector<Column> m_columns_{};  // statistics merged from the shards
+        std::unordered_map<std::thread::id, std::unique_ptr<Shard>> m_shards_{};
+        std::vector<double> m_row_{};
+
+        static CsvWriter::Setting
+        GetWriterSetting() {
+            CsvWriter::Setting setting;
+            setting.buffer_size = 64 << 10;
+            setting.flush_period = 1.0;
+            return setting;
+        }
 
     public:
         explicit NumberLogger(
@@ -29,18 +105,22 @@ namespace erl::common {
             const int init_step_idx = 0,
             const bool append = false,
             const bool on_screen = false)
-            : m_step_name_(std::move(step_name)),
+            : m_writer_(GetWriterSetting()),
+              m_step_name_(std::move(step_name)),
               m_step_idx_(init_step_idx),
               m_append_(append),
               m_on_screen_(on_screen) {
             if (filename.empty()) { return; }
-            m_file_.open(filename, append ? std::ios_base::app : std::ios_base::out);
+            if (!m_writer_.Open(filename, append)) { ERL_WARN("Failed to open {}.", filename); }
         }
 
-        ~NumberLogger() {
-            if (!m_file_.is_open()) { return; }
-            m_file_.flush();
-            m_file_.close();
+        /**
+         * Write the buffered rows to the file. Rows are also written when the buffer is full, by
+         * the first Print at least one second after the last write, and on destruction.
+         */
+        void
+        Flush() {
+            if (m_writer_.IsOpen()) { m_writer_.Flush(); }
         }
 
         int
@@ -53,37 +133,94 @@ namespace erl::common {
             m_step_idx_ = row_idx;
         }
 
-        void
-        AddColumn(const std::string &column_name) {
+        /**
+         * @param column_name Name of the column.
+         * @param percentiles Whether to also report the p50, p99 and p999 of the column. The
+         * values are expected to be non-negative, see LatencyHistogram.
+         * @return The id of the column for Log.
+         */
+        ColumnId
+        AddColumn(const std::string &column_name, const bool percentiles = false) {
+            const std::scoped_lock lock(m_mutex_);
             ERL_ASSERTM(
-                !m_header_written_ && !m_log_called_,
+                !m_header_written_ && m_shards_.empty(),
                 "AddColumn must be called before Log and Print");
+            const ColumnId id = m_columns_.size();
+            const bool inserted = m_column_indices_.emplace(column_name, id).second;
+            ERL_ASSERTM(inserted, "Column {} already exists", column_name);
+            (void) inserted;
             m_column_names_.push_back(column_name);
-            m_value_sum_[column_name] = 0.0;
-            m_weight_sum_[column_name] = 0.0;
-            m_squared_value_sum_[column_name] = 0.0;
+            Column &column = m_columns_.emplace_back();
+            if (percentiles) { column.histogram = std::make_unique<LatencyHistogram>(); }
+            return id;
         }
 
-        void
-        AddColumns(const std::vector<std::string> &column_names) {
-            for (const std::string &column_name: column_names) { AddColumn(column_name); }
+        std::vector<ColumnId>
+        AddColumns(const std::vector<std::string> &column_names, const bool percentiles = false) {
+            std::vector<ColumnId> ids;
+            ids.reserve(column_names.size());
+            for (const std::string &column_name: column_names) {
+                ids.push_back(AddColumn(column_name, percentiles));
+            }
+            return ids;
+        }
+
+        [[nodiscard]] ColumnId
+        GetColumnId(const std::string &column_name) const {
+            const auto it = m_column_indices_.find(column_name);
+            ERL_ASSERTM(
+                it != m_column_indices_.end(),
+                "Column name not found, call AddColumn first");
+            return it->second;
         }
 
         void
-        Log(const std::string &column_name, const double value, const double weight = 1.0) {
+        Log(const ColumnId column_id, const double value, const double weight = 1.0) {
             ERL_WARN_COND(std::isnan(value) || std::isinf(value), "Value is NaN or Inf");
             ERL_WARN_COND(std::isnan(weight) || std::isinf(weight), "Weight is NaN or Inf");
 
             ERL_DEBUG_ASSERT(!std::isnan(value) && !std::isinf(value), "Value is NaN or Inf");
             ERL_DEBUG_ASSERT(!std::isnan(weight) && !std::isinf(weight), "Weight is NaN or Inf");
+            ERL_DEBUG_ASSERT(column_id < m_column_names_.size(), "Invalid column id");
 
-            m_log_called_ = true;
-            ERL_ASSERTM(
-                m_value_sum_.find(column_name) != m_value_sum_.end(),
-                "Column name not found, call AddColumn first");
-            m_value_sum_[column_name] += value * weight;
-            m_weight_sum_[column_name] += weight;
-            m_squared_value_sum_[column_name] += value * value * weight;
+            Shard &shard = GetShard();
+            shard.Lock();
+            Shard::Column &column = shard.columns[column_id];
+            column.stats.Add(value, weight);
+            if (column.histogram != nullptr) { column.histogram->Record(value); }
+            shard.Unlock();
+        }
+
+        /**
+         * Log n values of unit weight to a column at once.
+         */
+        void
+        Log(const ColumnId column_id, const double *values, const std::size_t n) {
+            ERL_DEBUG_ASSERT(column_id < m_column_names_.size(), "Invalid column id");
+            RunningStatistics batch;
+            batch.Add(values, n);
+            ERL_WARN_COND(
+                std::isnan(batch.mean) || std::isinf(batch.mean),
+                "Value is NaN or Inf");
+
+            Shard &shard = GetShard();
+            shard.Lock();
+            Shard::Column &column = shard.columns[column_id];
+            column.stats.Merge(batch);
+            if (column.histogram != nullptr) {
+                for (std::size_t i = 0; i < n; ++i) { column.histogram->Record(values[i]); }
+            }
+            shard.Unlock();
+        }
+
+        void
+        Log(const ColumnId column_id, const std::vector<double> &values) {
+            Log(column_id, values.data(), values.size());
+        }
+
+        void
+        Log(const std::string &column_name, const double value, const double weight = 1.0) {
+            Log(GetColumnId(column_name), value, weight);
         }
 
         void
@@ -98,44 +235,59 @@ namespace erl::common {
             for (const auto &[column_name, value]: values) { Log(column_name, value); }
         }
 
+        /**
+         * @return The statistics of every column since the last Print, including the min, the max
+         * and the percentiles.
+         */
+        std::vector<ColumnStatistics>
+        GetColumnStatistics() const {
+            return CollectStatistics(false);
+        }
+
+        /**
+         * @return The name, the mean and the std of every column since the last Print.
+         */
         std::vector<std::tuple<std::string, double, double>>
         GetStatistics() const {
-            std::vector<std::tuple<std::string, double, double>> statistics;
-            for (const std::string &column_name: m_column_names_) {
-                ERL_WARN_COND(
-                    m_weight_sum_.at(column_name) == 0.0,
-                    "Weight sum is zero for column {}",
-                    column_name);
-                const double mean = m_value_sum_.at(column_name) / m_weight_sum_.at(column_name);
-                const double std = std::sqrt(
-                    m_squared_value_sum_.at(column_name) / m_weight_sum_.at(column_name) -
-                    mean * mean);
-                statistics.emplace_back(column_name, mean, std);
-            }
-            return statistics;
+            return ToTuples(CollectStatistics(false));
         }
 
         std::vector<std::tuple<std::string, double, double>>
         Print() {
-            auto statistics = GetStatistics();
-            if (m_file_.is_open()) {
+            const std::vector<ColumnStatistics> column_statistics = CollectStatistics(true);
+            // names and values of the printed fields of every column
+            std::vector<std::vector<std::pair<std::string, double>>> fields;
+            fields.reserve(column_statistics.size());
+            for (const ColumnStatistics &s: column_statistics) {
+                auto &column_fields = fields.emplace_back();
+                column_fields.emplace_back(s.name + "_mean", s.stats.GetMean());
+                column_fields.emplace_back(s.name + "_std", s.stats.GetStd());
+                if (s.histogram == nullptr) { continue; }
+                column_fields.emplace_back(s.name + "_p50", s.GetPercentile(50));
+                column_fields.emplace_back(s.name + "_p99", s.GetPercentile(99));
+                column_fields.emplace_back(s.name + "_p999", s.GetPercentile(99.9));
+            }
+
+            if (m_writer_.IsOpen()) {
                 if (!m_header_written_) {
                     ERL_ASSERTM(!m_column_names_.empty(), "AddColumn must be called before Print");
                     if (!m_append_) {  // write header only if not appending
-                        m_file_ << m_step_name_;
-                        for (const std::string &column_name: m_column_names_) {
-                            m_file_ << "," << column_name << "_mean," << column_name << "_std";
+                        std::vector<std::string> header = {m_step_name_};
+                        for (const auto &column_fields: fields) {
+                            for (const auto &field: column_fields) {
+                                header.push_back(field.first);
+                            }
                         }
-                        m_file_ << std::endl;
+                        m_writer_.WriteRange(header);
                     }
                     m_header_written_ = true;
                 }
-                m_file_ << m_step_idx_;
-                for (const auto &[column_name, mean, std]: statistics) {
-                    m_file_ << "," << mean << "," << std;
+                m_row_.clear();
+                m_row_.push_back(m_step_idx_);
+                for (const auto &column_fields: fields) {
+                    for (const auto &field: column_fields) { m_row_.push_back(field.second); }
                 }
-                m_file_ << std::endl;
-                m_file_.flush();
+                m_writer_.WriteRange(m_row_);
             }
             if (m_on_screen_) {
                 std::stringstream ss;
@@ -144,55 +296,120 @@ namespace erl::common {
                     std::max(static_cast<int>(m_step_name_.size()) + 4, min_column_width);
                 ss << fmt::format("|{:^{}}|", m_step_name_, step_column_width);
 
-                std::vector<std::pair<int, int>> column_widths;
-                for (const std::string &column_name: m_column_names_) {
-                    const int mean_column_width =
-                        std::max(static_cast<int>(column_name.size()) + 9, min_column_width);
-                    const int std_column_width =
-                        std::max(static_cast<int>(column_name.size()) + 8, min_column_width);
-                    column_widths.emplace_back(mean_column_width, std_column_width);
-                    ss << fmt::format(
-                        "{:^{}}|{:^{}}|",
-                        column_name + "_mean",
-                        mean_column_width,
-                        column_name + "_std",
-                        std_column_width);
+                std::vector<int> column_widths;
+                for (const auto &column_fields: fields) {
+                    for (const auto &field: column_fields) {
+                        const int width =
+                            std::max(static_cast<int>(field.first.size()) + 4, min_column_width);
+                        column_widths.push_back(width);
+                        ss << fmt::format("{:^{}}|", field.first, width);
+                    }
                 }
                 ss << std::endl;
 
                 ss << fmt::format("|{:^{}}|", m_step_idx_, min_column_width);
-                for (std::size_t i = 0; i < column_widths.size(); ++i) {
-                    const auto &[mean_column_width, std_column_width] = column_widths[i];
-                    const auto &[column_name, mean, std] = statistics[i];
-                    ss << fmt::format(
-                        "{:^{}}|{:^{}}|",
-                        fmt::format("{:.2e}", mean),
-                        mean_column_width,
-                        fmt::format("{:.2e}", std),
-                        std_column_width);
+                std::size_t field_idx = 0;
+                for (const auto &column_fields: fields) {
+                    for (const auto &field: column_fields) {
+                        ss << fmt::format(
+                            "{:^{}}|",
+                            fmt::format("{:.2e}", field.second),
+                            column_widths[field_idx++]);
+                    }
                 }
                 ss << std::endl;
                 ss << "|" << std::string(step_column_width, '-');
-                for (const auto &[mean_column_width, std_column_width]: column_widths) {
-                    ss << "|" << std::string(mean_column_width, '-');
-                    ss << "|" << std::string(std_column_width, '-');
-                }
+                for (const int width: column_widths) { ss << "|" << std::string(width, '-'); }
                 ss << "|";
                 if (ProgressBar::GetNumBars() == 0) { ss << std::endl; }
                 ProgressBar::Write(ss.str());
             }
             ++m_step_idx_;
-            ResetStatistics();
-            return statistics;
+            return ToTuples(column_statistics);
         }
 
         void
         ResetStatistics() {
-            for (const auto &column_name: m_column_names_) {
-                m_value_sum_[column_name] = 0.0;
-                m_weight_sum_[column_name] = 0.0;
-                m_squared_value_sum_[column_name] = 0.0;
+            CollectStatistics(true);
+        }
+
+    private:
+        Shard &
+        GetShard() {
+            struct CacheEntry {
+                std::uint64_t logger_id = 0;
+                Shard *shard = nullptr;
+            };
+
+            thread_local std::array<CacheEntry, kShardCacheSize> cache{};
+            CacheEntry &entry = cache[m_id_ % kShardCacheSize];
+            if (entry.logger_id == m_id_) { return *entry.shard; }
+
+            const std::scoped_lock lock(m_mutex_);
+            std::unique_ptr<Shard> &shard = m_shards_[std::this_thread::get_id()];
+            if (shard == nullptr) {
+                shard = std::make_unique<Shard>();
+                shard->columns.resize(m_columns_.size());
+                for (std::size_t i = 0; i < m_columns_.size(); ++i) {
+                    if (m_columns_[i].histogram == nullptr) { continue; }
+                    shard->columns[i].histogram = std::make_unique<LatencyHistogram>();
+                }
+            }
+            entry.logger_id = m_id_;
+            entry.shard = shard.get();
+            return *shard;
+        }
+
+        /**
+         * Move the statistics of the shards into m_columns_ and copy them out.
+         * @param reset Whether to clear the statistics afterward.
+         */
+        std::vector<ColumnStatistics>
+        CollectStatistics(const bool reset) const {
+            const std::scoped_lock lock(m_mutex_);
+            for (const auto &[thread_id, shard]: m_shards_) {
+                shard->Lock();
+                for (std::size_t i = 0; i < m_columns_.size(); ++i) {
+                    Shard::Column &src = shard->columns[i];
+                    Column &dst = m_columns_[i];
+                    dst.stats.Merge(src.stats);
+                    src.stats.Reset();
+                    if (src.histogram == nullptr || src.histogram->GetCount() == 0) { continue; }
+                    dst.histogram->Merge(*src.histogram);
+                    src.histogram->Reset();
+                }
+                shard->Unlock();
+            }
+
+            std::vector<ColumnStatistics> statistics;
+            statistics.reserve(m_columns_.size());
+            for (std::size_t i = 0; i < m_columns_.size(); ++i) {
+                Column &column = m_columns_[i];
+                ColumnStatistics &s = statistics.emplace_back();
+                s.name = m_column_names_[i];
+                s.stats = column.stats;
+                if (column.histogram != nullptr) {
+                    s.histogram = std::make_shared<LatencyHistogram>(*column.histogram);
+                }
+                if (!reset) { continue; }
+                column.stats.Reset();
+                if (column.histogram != nullptr) { column.histogram->Reset(); }
             }
+            return statistics;
+        }
+
+        static std::vector<std::tuple<std::string, double, double>>
+        ToTuples(const std::vector<ColumnStatistics> &column_statistics) {
+            std::vector<std::tuple<std::string, double, double>> statistics;
+            statistics.reserve(column_statistics.size());
+            for (const ColumnStatistics &s: column_statistics) {
+                ERL_WARN_COND(
+                    s.stats.weight_sum == 0.0,
+                    "Weight sum is zero for column {}",
+                    s.name);
+                statistics.emplace_back(s.name, s.stats.GetMean(), s.stats.GetStd());
+            }
+            return statistics;
         }
     };
 
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace erl::common {
+
+    /**
+     * A growable bitmap that marks occupied slots of a container. Scanning for the next occupied
+     * slot tests 64 slots per step, so long runs of empty slots are skipped cheaply.
+     */
+    class OccupancyBitmap {
+        std::vector<std::uint64_t> m_words_{};
+        std::size_t m_size_ = 0;   // number of slots
+        std::size_t m_count_ = 0;  // number of occupied slots
+
+    public:
+        static constexpr std::size_t kBitsPerWord = 64;
+
+        OccupancyBitmap() = default;
+
+        explicit OccupancyBitmap(const std::size_t size, const bool occupied = false) {
+            Resize(size, occupied);
+        }
+
+        [[nodiscard]] std::size_t
+        Size() const {
+            return m_size_;
+        }
+
+        [[nodiscard]] std::size_t
+        Count() const {
+            return m_count_;
+        }
+
+        [[nodiscard]] const std::vector<std::uint64_t> &
+        GetWords() const {
+            return m_words_;
+        }
+
+        void
+        Reserve(const std::size_t size) {
+            m_words_.reserve((size + kBitsPerWord - 1) / kBitsPerWord);
+        }
+
+        /**
+         * Resize the bitmap. New slots are marked as occupied or empty by `occupied`.
+         */
+        void
+        Resize(const std::size_t size, const bool occupied = false) {
+            if (size < m_size_) {
+                for (std::size_t i = size; i < m_size_; ++i) { Reset(i); }  // keep m_count_ right
+                m_words_.resize((size + kBitsPerWord - 1) / kBitsPerWord);
+                m_size_ = size;
+                return;
+            }
+            const std::size_t old_size = m_size_;
+            m_words_.resize((size + kBitsPerWord - 1) / kBitsPerWord, 0);
+            m_size_ = size;
+            if (!occupied) { return; }
+            for (std::size_t i = old_size; i < size; ++i) { Set(i); }
+        }
+
+        /**
+         * Append one slot.
+         */
+        void
+        PushBack(const bool occupied) {
+            if (m_size_ % kBitsPerWord == 0) { m_words_.push_back(0); }
+            ++m_size_;
+            if (occupied) { Set(m_size_ - 1); }
+        }
+
+        void
+        Clear() {
+            m_words_.clear();
+            m_size_ = 0;
+            m_count_ = 0;
+        }
+
+        /**
+         * Mark all slots as empty except the first n ones, i.e. the layout after compaction.
+         */
+        void
+        SetFirst(const std::size_t n) {
+            const std::size_t full_words = n / kBitsPerWord;
+            std::fill(m_words_.begin(), m_words_.end(), 0);
+            std::fill(m_words_.begin(), m_words_.begin() + full_words, ~std::uint64_t(0));
+            if (const std::size_t rest = n % kBitsPerWord; rest > 0) {
+                m_words_[full_words] = (std::uint64_t(1) << rest) - 1;
+            }
+            m_count_ = n;
+        }
+
+        [[nodiscard]] bool
+        Test(const std::size_t i) const {
+            return (m_words_[i / kBitsPerWord] >> (i % kBitsPerWord)) & 1;
+        }
+
+        void
+        Set(const std::size_t i) {
+            std::uint64_t &word = m_words_[i / kBitsPerWord];
+            const std::uint64_t bit = std::uint64_t(1) << (i % kBitsPerWord);
+            m_count_ += (word & bit) == 0;
+            word |= bit;
+        }
+
+        void
+        Reset(const std::size_t i) {
+            std::uint64_t &word = m_words_[i / kBitsPerWord];
+            const std::uint64_t bit = std::uint64_t(1) << (i % kBitsPerWord);
+            m_count_ -= (word & bit) != 0;
+            word &= ~bit;
+        }
+
+        /**
+         * Find the first occupied slot at or after i.
+         * @param i The slot to start searching from.
+         * @return The index of the occupied slot, or Size() if there is none.
+         */
+        [[nodiscard]] std::size_t
+        FindNext(const std::size_t i) const {
+            if (i >= m_size_) { return m_size_; }
+            std::size_t w = i / kBitsPerWord;
+            std::uint64_t word = m_words_[w] & (~std::uint64_t(0) << (i % kBitsPerWord));
+            while (word == 0) {
+                if (++w == m_words_.size()) { return m_size_; }
+                word = m_words_[w];
+            }
+            const std::size_t next = w * kBitsPerWord + CountTrailingZeros(word);
+            return next < m_size_ ? next : m_size_;
+        }
+
+        /**
+         * Find the first empty slot at or after i.
+         * @param i The slot to start searching from.
+         * @return The index of the empty slot, or Size() if there is none.
+         */
+        [[nodiscard]] std::size_t
+        FindNextEmpty(const std::size_t i) const {
+            if (i >= m_size_) { return m_size_; }
+            std::size_t w = i / kBitsPerWord;
+            std::uint64_t word = ~m_words_[w] & (~std::uint64_t(0) << (i % kBitsPerWord));
+            while (word == 0) {
+                if (++w == m_words_.size()) { return m_size_; }
+                word = ~m_words_[w];
+            }
+            const std::size_t next = w * kBitsPerWord + CountTrailingZeros(word);
+            return next < m_size_ ? next : m_size_;
+        }
+
+        /**
+         * Call func(i) for every occupied slot i in ascending order.
+         */
+        template<typename Func>
+        void
+        ForEach(Func func) const {
+            for (std::size_t w = 0; w < m_words_.size(); ++w) {
+                std::uint64_t word = m_words_[w];
+                while (word != 0) {
+                    func(w * kBitsPerWord + CountTrailingZeros(word));
+                    word &= word - 1;  // clear the lowest set bit
+                }
+            }
+        }
+
+    private:
+        static std::size_t
+        CountTrailingZeros(const std::uint64_t word) {
+            return static_cast<std::size_t>(__builtin_ctzll(word));
+        }
+    };
+}  // namespace erl::common
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "tracy.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace erl::common {
+
+    /**
+     * Static description of a profiled scope, one per call site of the ERL_PROFILE_* and
+     * ERL_BLOCK_TIMER* macros. Scopes are identified by the address of their site.
+     */
+    struct ProfileSite {
+        std::string name;
+        const char *function;
+        const char *file;
+        int line;
+#ifdef TRACY_ENABLE
+        tracy::SourceLocationData tracy_location;
+#endif
+
+        ProfileSite(std::string name_in, const char *function_in, const char *file_in, int line_in);
+
+        ProfileSite(const ProfileSite &) = delete;
+        ProfileSite &
+        operator=(const ProfileSite &) = delete;
+    };
+
+    /**
+     * @return The site of a call site of the macros, created by the first call. CallSite is the
+     * type of a lambda written at the call site, which gives every call site its own site within
+     * a single declaration.
+     */
+    template<typename CallSite, typename Name>
+    const ProfileSite &
+    GetProfileSite(CallSite, const Name &name, const char *function, const char *file, int line) {
+        static const ProfileSite site(name, function, file, line);
+        return site;
+    }
+
+    /**
+     * Hierarchical profiler. Every thread has a stack of the scopes it is in and a tree of the
+     * scopes it has been in, so that the same scope entered from different parents is counted
+     * separately. The statistics of a scope (count, total, min, max and a histogram) are only
+     * written by its thread with relaxed atomics, without locks; the tree is only locked when a
+     * scope is entered from a new parent for the first time. The reports merge the trees of all
+     * threads.
+     */
+    class Profiler {
+    public:
+        // bucket i counts the durations in [2^(i-1), 2^i) ns, bucket 0 the zero durations
+        static constexpr std::size_t kNumHistogramBuckets = 64;
+
+        struct Stats {
+            std::uint64_t count = 0;
+            std::uint64_t total_ns = 0;
+            std::uint64_t min_ns = 0;
+            std::uint64_t max_ns = 0;
+            std::array<std::uint64_t, kNumHistogramBuckets> histogram{};
+
+            [[nodiscard]] double
+            GetMeanNs() const {
+                return count == 0 ? 0.0 : static_cast<double>(total_ns) / count;
+            }
+
+            /**
+             * @param p Percentile in [0, 100].
+             * @return Upper bound of the histogram bucket of the percentile, at most max_ns.
+             */
+            [[nodiscard]] std::uint64_t
+            GetPercentileNs(double p) const;
+
+            void
+            Merge(const Stats &other);
+        };
+
+        struct Node {
+            const ProfileSite *site = nullptr;  // nullptr for the root
+            Stats stats{};
+            std::vector<Node> children{};  // sorted by total time, the largest first
+        };
+
+    private:
+        struct ThreadProfile;
+        struct Registry;
+        static std::atomic<bool> s_enabled_;
+
+    public:
+        static void
+        SetEnabled(bool enabled);
+
+        [[nodiscard]] static bool
+        IsEnabled() {
+            return s_enabled_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Push a scope onto the stack of the calling thread. Used by ProfileScope.
+         */
+        static void
+        Enter(const ProfileSite &site);
+
+        /**
+         * Pop the scope on the top of the stack of the calling thread and account its duration.
+         */
+        static void
+        Leave();
+
+        /**
+         * @return The tree of all scopes merged over the threads, including the threads that
+         * have exited.
+         */
+        [[nodiscard]] static Node
+        GetTree();
+
+        /**
+         * Clear the statistics. Every thread clears its own when it next leaves a scope, until
+         * then they are left out of the reports. The scopes that are running are still accounted
+         * when they end.
+         */
+        static void
+        Reset();
+
+        /**
+         * @return The tree as an indented table, one row per scope.
+         */
+        [[nodiscard]] static std::string
+        ToString();
+
+        /**
+         * @return One row per scope, the path of a scope is the names from the root joined by
+         * ';', as in the folded stacks of flame graph tools.
+         */
+        [[nodiscard]] static std::string
+        ToCsv();
+
+        [[nodiscard]] static bool
+        WriteCsv(const std::string &path);
+
+        /**
+         * Write the report by Logging::Write when the program exits.
+         */
+        static void
+        SetReportAtExit(bool report);
+
+    private:
+        static ThreadProfile &
+        GetThreadProfile();
+    };
+
+    /**
+     * Profiled scope, from construction to destruction. Also a Tracy zone if TRACY_ENABLE is
+     * defined.
+     */
+    class ProfileScope {
+        bool m_active_;
+#ifdef TRACY_ENABLE
+        tracy::ScopedZone m_zone_;
+#endif
+
+    public:
+        explicit ProfileScope(const ProfileSite &site)
+            : m_active_(Profiler::IsEnabled())
+#ifdef TRACY_ENABLE
+              ,
+              m_zone_(&site.tracy_location, true)
+#endif
+        {
+            if (m_active_) { Profiler::Enter(site); }
+        }
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &
+        operator=(const ProfileScope &) = delete;
+
+        ~ProfileScope() {
+            if (m_active_) { Profiler::Leave(); }
+        }
+    };
+}  // namespace erl::common
+
+#define ERL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ERL_PROFILE_CONCAT(a, b)      ERL_PROFILE_CONCAT_IMPL(a, b)
+
+/**
+ * Profile the rest of the enclosing block. The name is only used by the first call. Scopes can be
+ * nested in the same block. Expands to a single declaration.
+ */
+#define ERL_PROFILE_SCOPE(name)                                                      \
+    const erl::common::ProfileScope ERL_PROFILE_CONCAT(erl_profile_scope_, __LINE__)( \
+        erl::common::GetProfileSite([] {}, name, __PRETTY_FUNCTION__, __FILE__, __LINE__))
+#define ERL_PROFILE_FUNCTION() ERL_PROFILE_SCOPE(__func__)
@@ -1,17 +1,23 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
-#include <numeric>
 #include <sstream>
+#include <string>
 #include <vector>
 
 namespace erl::common {
 
+    /**
+     * Terminal progress bars drawn below the output of Write. Update is a relaxed atomic
+     * increment that may be called from any thread; a background thread redraws the bars at most
+     * GetRefreshRate() times per second, and only when something changed.
+     */
     class ProgressBar : public std::enable_shared_from_this<ProgressBar> {
     public:
         struct Setting {
@@ -31,20 +37,25 @@ namespace erl::common {
         };
 
     private:
-        static std::vector<std::weak_ptr<const ProgressBar>> s_progress_bars_;
+        struct Registry;
+        static std::atomic<std::size_t> s_num_bars_;
 
-        std::shared_ptr<Setting> m_setting_ = nullptr;
-        double m_fraction_ = 0.0;
-        std::size_t m_prev_count_ = -1;
-        std::size_t m_count_ = 0;
-        std::chrono::high_resolution_clock::time_point m_t0_ =
-            std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> m_prev_duration_{};
-        std::chrono::duration<double> m_duration_{};
+        std::atomic<std::size_t> m_count_{0};
         std::ostream &m_out_;
-        bool m_displayed_ = false;
+        // guarded by the registry
+        Setting m_setting_{};  // copied at Open, the renderer never reads the caller's setting
+        std::chrono::steady_clock::time_point m_t0_ = std::chrono::steady_clock::now();
+        std::size_t m_rendered_count_ = 0;
+        double m_rendered_seconds_ = 0.0;
+        double m_fps_ = 0.0;
 
     public:
+        /**
+         * Create a bar and draw it. The bars are redrawn by a background thread at the refresh
+         * rate when their counts change, and by every Write.
+         * @param setting Copied by the bar, later changes to it are not drawn. Use SetDescription
+         * and SetTotal instead.
+         */
         static std::shared_ptr<ProgressBar>
         Open(std::shared_ptr<Setting> setting = nullptr, std::ostream &out = std::cout);
 
@@ -57,34 +68,48 @@ namespace erl::common {
 
         ~ProgressBar() { Close(); }
 
+        /**
+         * Draw the final state of the bar and stop drawing it.
+         */
         void
-        Close() {
-            for (auto itr = s_progress_bars_.begin(); itr != s_progress_bars_.end(); ++itr) {
-                if (itr->expired()) {
-                    s_progress_bars_.erase(itr--);  // erase and decrement iterator
-                    continue;
-                }
-                if (itr->lock().get() == this) {
-                    s_progress_bars_.erase(itr);
-                    break;
-                }
-            }
-            m_displayed_ = false;
-        }
+        Close();
 
         static std::size_t
         GetNumBars() {
-            return s_progress_bars_.size();
+            return s_num_bars_.load(std::memory_order_relaxed);
         }
 
+        /**
+         * @param hz How many times per second the background thread may redraw the bars.
+         */
+        static void
+        SetRefreshRate(double hz);
+
+        [[nodiscard]] static double
+        GetRefreshRate();
+
+        /**
+         * Redraw the bars now instead of at the next refresh.
+         */
+        static void
+        Refresh();
+
         void
-        SetDescription(const std::string &description) const {
-            m_setting_->description = description;
-        }
+        SetDescription(const std::string &description);
 
         void
-        SetTotal(const std::size_t total) const {
-            m_setting_->total = total;
+        SetTotal(std::size_t total);
+
+        /**
+         *
+         * @return A copy of the setting drawn by the bar.
+         */
+        [[nodiscard]] Setting
+        GetSetting() const;
+
+        [[nodiscard]] std::size_t
+        GetCount() const {
+            return m_count_.load(std::memory_order_relaxed);
         }
 
         void
@@ -100,80 +125,56 @@ namespace erl::common {
             Write(ss.str(), out);
         }
 
+        /**
+         * Write a message above the bars and redraw them, or just the message if there is no
+         * bar. Thread-safe.
+         */
         static void
-        Write(const std::string &str = "", std::ostream &out = std::cout) {
-            if (s_progress_bars_.empty()) {
-                out << str << std::flush;
-                return;
-            }
-            std::vector<std::size_t> idx = ArgSortProgressBars();
-            if (const std::size_t num_displayed = std::count_if(  //
-                    s_progress_bars_.begin(),
-                    s_progress_bars_.end(),
-                    [](const auto& pbar) -> bool {
-                        return !pbar.expired() && pbar.lock()->m_displayed_;
-                    });
-                num_displayed >= 1) {
-                GoBackLines(out, num_displayed);
-            }
-            auto idx_itr = idx.begin();
-            if (str.empty()) {
-                out << s_progress_bars_[*idx_itr++].lock()->AsString();
-            } else {
-                out << str << std::endl << s_progress_bars_[*idx_itr++].lock()->AsString();
-            }
-
-            for (; idx_itr != idx.end(); ++idx_itr) {
-                out << std::endl << s_progress_bars_[*idx_itr].lock()->AsString();
-            }
-            out << std::flush;
-        }
+        Write(const std::string &str = "", std::ostream &out = std::cout);
 
+        /**
+         * Add n to the count. Thread-safe and lock-free unless a message is given, which is
+         * written by Write.
+         */
         void
         Update(const std::size_t n = 1, const std::string &msg = "") {
-            UpdateCount(n);
-            UpdateFraction();
-            Write(msg, m_out_);
+            m_count_.fetch_add(n, std::memory_order_relaxed);
+            if (!msg.empty()) { Write(msg, m_out_); }
         }
 
+        /**
+         * Set the count to n. Thread-safe.
+         */
         void
         UpdateProgress(const std::size_t n, const std::string &msg = "") {
-            m_prev_count_ = m_count_;
-            m_count_ = n;
-            UpdateDuration();
-            UpdateFraction();
-            Write(msg, m_out_);
+            m_count_.store(n, std::memory_order_relaxed);
+            if (!msg.empty()) { Write(msg, m_out_); }
         }
 
+        /**
+         * Restart the count and the clock, and draw the bar again if it was closed.
+         */
         void
-        Reset() {
-            Register();
-            m_prev_duration_ = std::chrono::duration<double>{};
-            m_duration_ = std::chrono::duration<double>{};
-            m_prev_count_ = 0;
-            m_count_ = 0;
-            m_fraction_ = 0.0;
-            m_t0_ = std::chrono::high_resolution_clock::now();
-        }
+        Reset();
 
     private:
-        explicit ProgressBar(
-            std::shared_ptr<Setting> setting = nullptr,
-            std::ostream &out = std::cout)
-            : m_setting_(std::move(setting)), m_out_(out) {
-            if (m_setting_ == nullptr) { m_setting_ = std::make_shared<Setting>(); }
+        explicit ProgressBar(const Setting *setting = nullptr, std::ostream &out = std::cout)
+            : m_out_(out) {
+            if (setting != nullptr) { m_setting_ = *setting; }
         }
 
-        static std::vector<std::size_t>
-        ArgSortProgressBars() {
-            std::vector<std::size_t> idx(s_progress_bars_.size());
-            std::iota(idx.begin(), idx.end(), 0);
-            std::sort(idx.begin(), idx.end(), [](const std::size_t i, const std::size_t j) {
-                return s_progress_bars_[i].lock()->m_setting_->position <
-                       s_progress_bars_[j].lock()->m_setting_->position;
-            });
-            return idx;
-        }
+        static Registry &
+        GetRegistry();
+
+        /**
+         * Move the cursor back over the drawn bars, write the message and draw the bars. The
+         * registry must be locked.
+         */
+        static void
+        Draw(Registry &registry, const std::string &str, std::ostream &out);
+
+        static void
+        RenderLoop();
 
         static void
         GoBackLines(std::ostream &out, const std::size_t num_lines) {
@@ -212,82 +213,10 @@ namespace erl::common {
             return ss.str();
         }
 
-        void
-        UpdateFraction() {
-            if (m_setting_->total == 0) { return; }
-            m_fraction_ = static_cast<double>(m_count_) / static_cast<double>(m_setting_->total);
-            if (m_fraction_ < 0) { m_fraction_ = 0; }
-            if (m_fraction_ > 1) { m_fraction_ = 1; }
-        }
-
-        void
-        UpdateCount(const std::size_t n) {
-            if (n == 0) { return; }
-            m_prev_count_ = m_count_;
-            m_count_ += n;
-            UpdateDuration();
-        }
-
-        void
-        UpdateDuration() {
-            m_prev_duration_ = m_duration_;
-            m_duration_ = std::chrono::high_resolution_clock::now() - m_t0_;
-        }
-
-        [[nodiscard]] double
-        ComputeFps() const {
-            if (m_count_ == m_prev_count_) {
-                return static_cast<double>(m_count_) / (m_duration_.count() + 0.001);
-            }
-            return static_cast<double>(m_count_ - m_prev_count_) /
-                   (m_duration_.count() - m_prev_duration_.count());
-        }
-
+        /**
+         * @return The bar as a line. Updates the rate, so the registry must be locked.
+         */
         [[nodiscard]] std::string
-        AsString() const {
-            std::stringstream ss_time;
-            double passed_seconds = m_duration_.count();
-            double remaining_seconds = passed_seconds / m_fraction_ - passed_seconds;
-            ss_time << "| [" << DurationToString(remaining_seconds) << "/"
-                    << DurationToString(passed_seconds) << "]";
-            std::string time_str = ss_time.str();
-
-            std::stringstream ss_count;
-            if (m_setting_->total > 0) {
-                ss_count << "[" << std::setw(3) << m_count_ << "/" << m_setting_->total << ": "
-                         << std::setprecision(2) << ComputeFps() << "it/s]";
-            }
-            std::string count_str = ss_count.str();
-
-            std::stringstream ss_desc;
-            ss_desc << m_setting_->description << ": ";
-            std::string desc_str = ss_desc.str();
-
-            std::string symbol_buffer = m_setting_->GetSymbolBuffer();
-            std::size_t n = symbol_buffer.size() / 2;
-            std::size_t bar_width = n - count_str.size() - time_str.size();
-            std::size_t offset =  // static_cast from positive real to unsigned integer is fine.
-                n - static_cast<std::size_t>(static_cast<double>(bar_width) * m_fraction_);
-
-            std::stringstream ss_bar;
-            ss_bar << desc_str;  // write description
-            ss_bar.write(
-                symbol_buffer.data() + offset,
-                static_cast<std::streamsize>(bar_width));  // write bar
-            ss_bar << time_str << count_str;               // write time and count
-            ss_bar << "[" << std::fixed << std::setprecision(2) << std::setw(6) << 100 * m_fraction_
-                   << "%]";  // write time and count
-            return ss_bar.str();
-        }
-
-        void
-        Register() const {
-            if (std::none_of(
-                    s_progress_bars_.begin(),
-                    s_progress_bars_.end(),
-                    [this](const auto &bar) { return bar.lock().get() == this; })) {
-                s_progress_bars_.push_back(shared_from_this());
-            }
-        }
+        Render(std::chrono::steady_clock::time_point now);
     };
 }  // namespace erl::common
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <tuple>
+#include <type_traits>
 
 template<typename T, typename Member>
 struct MemberInfo {
@@ -4,6 +4,7 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <optional>
 #include <vector>
@@ -20,29 +21,70 @@ namespace erl::common {
             std::vector<T, Allocator>        // dynamic vector if N == -1
             >;
 
+        // a static power-of-two capacity is resolved at compile time
+        static constexpr bool kStaticPowerOfTwo = N > 0 && (N & (N - 1)) == 0;
+
         Storage m_buffer_;                          // static array or dynamic vector
         bool m_reject_on_full_ = false;             // whether to reject new data when full
-        std::size_t m_write_ = 0;                   // write position
-        std::size_t m_read_ = 0;                    // read position
-        std::size_t m_size_ = 0;                    // current size
+        bool m_power_of_two_ = kStaticPowerOfTwo;   // whether to index with m_mask_
+        std::uint64_t m_write_ = 0;                 // monotonic count of written elements
+        std::uint64_t m_read_ = 0;                  // monotonic count of read elements
         std::size_t m_capacity_ = (N > 0 ? N : 0);  // capacity
+        std::size_t m_mask_ = 0;                    // m_capacity_ - 1 if it is a power of two
+        std::size_t m_reserved_ = 0;                // slots handed out by ReserveWrite
 
     public:
+        /**
+         * A view of up to two contiguous ranges of the buffer. The second range is non-empty only
+         * when the view wraps around the end of the storage.
+         * @tparam U T or const T.
+         */
+        template<typename U>
+        struct Spans {
+            U *first = nullptr;
+            std::size_t first_size = 0;
+            U *second = nullptr;
+            std::size_t second_size = 0;
+
+            [[nodiscard]] std::size_t
+            Size() const {
+                return first_size + second_size;
+            }
+
+            [[nodiscard]] bool
+            IsEmpty() const {
+                return Size() == 0;
+            }
+
+            U &
+            operator[](const std::size_t i) const {
+                return i < first_size ? first[i] : second[i - first_size];
+            }
+        };
+
+        using WriteSpans = Spans<T>;
+        using ReadSpans = Spans<const T>;
+
         /**
          * Constructs a RingBuffer with static Capacity N.
          */
         RingBuffer() {
             static_assert(N > 0, "Dynamic RingBuffer requires Capacity in constructor");
-            m_capacity_ = N;
+            SetCapacity(N);
         }
 
         /**
-         * Constructs a RingBuffer with dynamic Capacity.
+         * Constructs a RingBuffer with dynamic Capacity. Indexing uses mask arithmetic instead of
+         * the modulo operation when the capacity is a power of two.
          * @param capacity The capacity of the RingBuffer.
+         * @param round_up_to_power_of_two If true, the capacity is rounded up to the next power of
+         * two to enable the mask-based indexing.
          */
-        explicit RingBuffer(std::size_t capacity)
-            : m_buffer_(capacity), m_capacity_(capacity) {
+        explicit RingBuffer(std::size_t capacity, const bool round_up_to_power_of_two = false) {
             static_assert(N == -1, "Static RingBuffer does not take Capacity in constructor");
+            if (round_up_to_power_of_two) { capacity = CeilPowerOfTwo(capacity); }
+            m_buffer_.resize(capacity);
+            SetCapacity(capacity);
         }
 
         [[nodiscard]] bool
@@ -55,6 +97,15 @@ namespace erl::common {
             m_reject_on_full_ = reject;
         }
 
+        /**
+         *
+         * @return true if the capacity is a power of two and indices are computed by masking.
+         */
+        [[nodiscard]] bool
+        IsPowerOfTwoCapacity() const {
+            return m_power_of_two_;
+        }
+
         const Storage &
         GetBuffer() const {
             return m_buffer_;
@@ -66,14 +117,11 @@ namespace erl::common {
          */
         void
         Push(const T &val) {
-            if (m_reject_on_full_ && IsFull()) { return; }  // reject new data when full
-            m_buffer_[m_write_] = val;
             if (IsFull()) {
-                m_read_ = (m_read_ + 1) % m_capacity_;
-            } else {
-                ++m_size_;
+                if (m_reject_on_full_) { return; }  // reject new data when full
+                ++m_read_;                          // drop the oldest element
             }
-            m_write_ = (m_write_ + 1) % m_capacity_;
+            m_buffer_[Index(m_write_++)] = val;
         }
 
         /**
@@ -82,14 +130,11 @@ namespace erl::common {
          */
         void
         Push(T &&val) {
-            if (m_reject_on_full_ && IsFull()) { return; }  // reject new data when full
-            m_buffer_[m_write_] = std::move(val);
             if (IsFull()) {
-                m_read_ = (m_read_ + 1) % m_capacity_;
-            } else {
-                ++m_size_;
+                if (m_reject_on_full_) { return; }  // reject new data when full
+                ++m_read_;                          // drop the oldest element
             }
-            m_write_ = (m_write_ + 1) % m_capacity_;
+            m_buffer_[Index(m_write_++)] = std::move(val);
         }
 
         /**
@@ -102,50 +147,34 @@ namespace erl::common {
         template<typename It>
         std::size_t
         PushRange(It first, It last) {
-            if (m_reject_on_full_ && IsFull()) { return 0; }  // reject new data when full
-
-            size_t n = std::distance(first, last);
+            std::size_t n = std::distance(first, last);
+            if (m_reject_on_full_ && n > AvailableSpace()) {  // reject what does not fit
+                n = AvailableSpace();
+                last = std::next(first, n);
+            }
             if (n == 0) { return 0; }
 
             // The new data exceeds capacity, keep only the last 'm_capacity_' elements
-            if (n >= m_capacity_) {
+            if (n > m_capacity_) {
                 std::advance(first, n - m_capacity_);  // in-place advance
                 n = m_capacity_;
-                if (m_reject_on_full_) {  // skip some elements
-                    std::advance(first, m_size_);
-                    n -= m_size_;
-                }
-                std::copy(first, last, m_buffer_.data());
-                m_write_ = 0;
-                m_read_ = 0;
-                m_size_ = m_capacity_;
-                return n;
             }
 
-            // Calculate how many elements will be overwritten.
-            const std::size_t free_space = AvailableSpace();  // m_capacity_ - m_size_
-            const std::size_t overwrite_count = (n > free_space) ? (n - free_space) : 0;
-
             // Check for wrap-around
-            std::size_t available_at_end = m_capacity_ - m_write_;
+            const std::size_t write = Index(m_write_);
+            const std::size_t available_at_end = m_capacity_ - write;
             if (n <= available_at_end) {  // No wrap-around
-                std::copy(first, last, m_buffer_.data() + m_write_);
+                std::copy(first, last, m_buffer_.data() + write);
             } else {
                 // Wrap-around occurs
                 It mid = std::next(first, available_at_end);
-                std::copy(first, mid, m_buffer_.data() + m_write_);
+                std::copy(first, mid, m_buffer_.data() + write);
                 std::copy(mid, last, m_buffer_.data());
             }
 
-            // Update write and read indices and size
-            m_write_ = (m_write_ + n) % m_capacity_;
-            if (overwrite_count > 0) {
-                m_read_ = (m_read_ + overwrite_count) % m_capacity_;
-                m_size_ = m_capacity_;  // buffer is full
-            } else {
-                m_size_ += n;
-            }
-
+            // Update the counters, the oldest elements are overwritten if the buffer overflows
+            m_write_ += n;
+            if (m_write_ - m_read_ > m_capacity_) { m_read_ = m_write_ - m_capacity_; }
             return n;
         }
 
@@ -165,20 +194,18 @@ namespace erl::common {
         std::optional<T>
         Pop() {
             if (IsEmpty()) { return std::nullopt; }
-            T item = std::move(m_buffer_[m_read_]);
-            m_read_ = (m_read_ + 1) % m_capacity_;
-            --m_size_;
+            T item = std::move(m_buffer_[Index(m_read_++)]);
             return item;
         }
 
         std::size_t
         PopAll(std::vector<T> &output) {
-            return PopRange(output, m_size_);
+            return PopRange(output, Size());
         }
 
         std::size_t
         PopRange(std::vector<T> &output, const std::size_t n) {
-            output.reserve(output.size() + m_size_);
+            output.reserve(output.size() + std::min(n, Size()));
             auto dest = std::back_inserter(output);
             return PopRange<decltype(dest)>(dest, n);
         }
@@ -186,14 +213,15 @@ namespace erl::common {
         template<typename OutputIt>
         std::size_t
         PopRange(OutputIt dest, const std::size_t n) {
-            const std::size_t actual_count = std::min(n, m_size_);
+            const std::size_t actual_count = std::min(n, Size());
             if (actual_count == 0) { return 0; }
 
             // Check for wrap-around
-            const std::size_t available_to_end = m_capacity_ - m_read_;
+            const std::size_t read = Index(m_read_);
+            const std::size_t available_to_end = m_capacity_ - read;
             std::size_t part1_count = std::min(actual_count, available_to_end);
             std::size_t part2_count = actual_count - part1_count;
-            T *data_ptr = m_buffer_.data() + m_read_;
+            T *data_ptr = m_buffer_.data() + read;
             dest = std::copy(data_ptr, data_ptr + part1_count, dest);
             if (part2_count > 0) {
                 // Wrap-around occurs
@@ -201,71 +229,120 @@ namespace erl::common {
                 std::copy(data_ptr, data_ptr + part2_count, dest);
             }
 
-            // Update read index and size
-            m_read_ = (m_read_ + actual_count) % m_capacity_;
-            m_size_ -= actual_count;
+            m_read_ += actual_count;
             return actual_count;
         }
 
+        /**
+         * Reserve up to n slots after the last element so that the producer can write into them in
+         * place. Nothing becomes visible to the consumer until CommitWrite is called. When
+         * RejectOnFull() is false, the reserved slots may cover the oldest elements, which are
+         * dropped right away, even if fewer slots are committed, so that the consumer never sees
+         * a slot the producer is writing.
+         * @param n Number of slots to reserve.
+         * @return Up to two contiguous spans covering the reserved slots.
+         */
+        WriteSpans
+        ReserveWrite(std::size_t n) {
+            n = std::min(n, m_reject_on_full_ ? AvailableSpace() : m_capacity_);
+            if (n > AvailableSpace()) { m_read_ = m_write_ + n - m_capacity_; }
+            m_reserved_ = n;
+            return MakeSpans<T>(m_buffer_.data(), Index(m_write_), n);
+        }
+
+        /**
+         * Publish the first n slots returned by the last ReserveWrite call.
+         * @param n Number of slots written by the producer, must not exceed the reserved count.
+         */
         void
-        Resize(std::size_t new_capacity) {
+        CommitWrite(std::size_t n) {
+            ERL_DEBUG_ASSERT(n <= m_reserved_, "Commit {} > reserved {}.", n, m_reserved_);
+            n = std::min(n, m_reserved_);
+            m_reserved_ = 0;
+            m_write_ += n;  // the overlapped elements were dropped by ReserveWrite
+        }
+
+        /**
+         * Get the oldest n elements without removing them.
+         * @param n Maximum number of elements to view.
+         * @return Up to two contiguous spans covering min(n, Size()) elements in FIFO order.
+         */
+        [[nodiscard]] ReadSpans
+        PeekRead(const std::size_t n) const {
+            return MakeSpans<const T>(m_buffer_.data(), Index(m_read_), std::min(n, Size()));
+        }
+
+        [[nodiscard]] ReadSpans
+        PeekRead() const {
+            return PeekRead(Size());
+        }
+
+        /**
+         * Drop the oldest n elements, typically after they were processed through PeekRead.
+         * @param n Number of elements to drop.
+         * @return The number of elements dropped.
+         */
+        std::size_t
+        Consume(std::size_t n) {
+            n = std::min(n, Size());
+            m_read_ += n;
+            return n;
+        }
+
+        /**
+         * Change the capacity, keeping the newest elements that fit.
+         * @param new_capacity The new capacity.
+         * @param round_up_to_power_of_two If true, the capacity is rounded up to the next power of
+         * two.
+         */
+        void
+        Resize(std::size_t new_capacity, const bool round_up_to_power_of_two = false) {
             static_assert(N == -1, "Resize is only available for dynamic RingBuffer");
+            if (round_up_to_power_of_two) { new_capacity = CeilPowerOfTwo(new_capacity); }
             if (new_capacity == m_capacity_) { return; }
-            if (new_capacity > m_capacity_) {
-                Storage new_buffer(new_capacity);
-                PopRange(new_buffer.data(), m_size_);
-                m_buffer_ = std::move(new_buffer);
-                m_write_ = m_size_;
-                m_read_ = 0;
-                m_capacity_ = new_capacity;
-                return;
-            }
-            // new_capacity < m_capacity_
             Storage new_buffer(new_capacity);
-            std::size_t elements_to_copy = std::min(m_size_, new_capacity);
-            if (m_size_ > elements_to_copy) {  // need to drop some elements
-                PopRange(new_buffer.data(), m_size_ - elements_to_copy);
-            }
+            const std::size_t elements_to_copy = std::min(Size(), new_capacity);
+            Consume(Size() - elements_to_copy);  // drop the oldest elements that do not fit
             PopRange(new_buffer.data(), elements_to_copy);
             m_buffer_ = std::move(new_buffer);
-            m_write_ = elements_to_copy % new_capacity;
+            m_write_ = elements_to_copy;
             m_read_ = 0;
-            m_size_ = elements_to_copy;
-            m_capacity_ = new_capacity;
+            m_reserved_ = 0;
+            SetCapacity(new_capacity);
         }
 
         void
         Reset() {
             m_write_ = 0;
             m_read_ = 0;
-            m_size_ = 0;
+            m_reserved_ = 0;
         }
 
         T *
         Front() {
             if (IsEmpty()) { return nullptr; }
-            return &m_buffer_[m_read_];
+            return &m_buffer_[Index(m_read_)];
         }
 
         [[nodiscard]] const T *
         Front() const {
             if (IsEmpty()) { return nullptr; }
-            return &m_buffer_[m_read_];
+            return &m_buffer_[Index(m_read_)];
         }
 
         [[nodiscard]] bool
         IsEmpty() const {
-            return m_size_ == 0;
+            return m_write_ == m_read_;
         }
 
         [[nodiscard]] bool
         IsFull() const {
-            return m_size_ == m_capacity_;
+            return Size() == m_capacity_;
         }
 
         [[nodiscard]] std::size_t
         Size() const {
-            return m_size_;
+            return static_cast<std::size_t>(m_write_ - m_read_);
         }
 
         [[nodiscard]] std::size_t
@@ -275,15 +352,16 @@ namespace erl::common {
 
         [[nodiscard]] std::size_t
         AvailableSpace() const {
-            return m_capacity_ - m_size_;
+            return m_capacity_ - Size();
         }
 
         [[nodiscard]] bool
         operator==(const RingBuffer &other) const {
-            if (m_size_ != other.m_size_) { return false; }
-            for (std::size_t i = 0; i < m_size_; ++i) {
-                std::size_t index1 = (m_read_ + i) % m_capacity_;
-                std::size_t index2 = (other.m_read_ + i) % other.m_capacity_;
+            const std::size_t size = Size();
+            if (size != other.Size()) { return false; }
+            for (std::size_t i = 0; i < size; ++i) {
+                std::size_t index1 = Index(m_read_ + i);
+                std::size_t index2 = other.Index(other.m_read_ + i);
                 if (m_buffer_[index1] != other.m_buffer_[index2]) { return false; }
             }
             return true;
@@ -301,10 +379,11 @@ namespace erl::common {
                 {
                     "info",
                     [](const RingBuffer *self, std::ostream &s) {
+                        // positions are stored as indices into the buffer
                         const bool &rej_on_full = self->m_reject_on_full_;
-                        const std::size_t &write = self->m_write_;
-                        const std::size_t &read = self->m_read_;
-                        const std::size_t &size = self->m_size_;
+                        const std::size_t write = self->Index(self->m_write_);
+                        const std::size_t read = self->Index(self->m_read_);
+                        const std::size_t size = self->Size();
                         const std::size_t &capacity = self->m_capacity_;
                         s.write(reinterpret_cast<const char *>(&rej_on_full), sizeof(rej_on_full));
                         s.write(reinterpret_cast<const char *>(&write), sizeof(write));
@@ -317,8 +396,9 @@ namespace erl::common {
                 {
                     "buffer",
                     [](const RingBuffer *self, std::ostream &s) {
-                        for (std::size_t i = 0; i < self->m_size_; ++i) {
-                            std::size_t index = (self->m_read_ + i) % self->m_capacity_;
+                        const std::size_t size = self->Size();
+                        for (std::size_t i = 0; i < size; ++i) {
+                            std::size_t index = self->Index(self->m_read_ + i);
                             if (!Writer<T>::Run(&self->m_buffer_[index], s)) {
                                 ERL_WARN("Failed to write item {}.", i);
                                 return false;
@@ -339,25 +419,36 @@ namespace erl::common {
                     "info",
                     [](RingBuffer *self, std::istream &s) {
                         bool &rej_on_full = self->m_reject_on_full_;
-                        std::size_t &write = self->m_write_;
-                        std::size_t &read = self->m_read_;
-                        std::size_t &size = self->m_size_;
-                        std::size_t &capacity = self->m_capacity_;
+                        std::size_t write = 0;
+                        std::size_t read = 0;
+                        std::size_t size = 0;
+                        std::size_t capacity = 0;
                         s.read(reinterpret_cast<char *>(&rej_on_full), sizeof(rej_on_full));
                         s.read(reinterpret_cast<char *>(&write), sizeof(write));
                         s.read(reinterpret_cast<char *>(&read), sizeof(read));
                         s.read(reinterpret_cast<char *>(&size), sizeof(size));
                         s.read(reinterpret_cast<char *>(&capacity), sizeof(capacity));
+                        if (N > 0 && capacity != static_cast<std::size_t>(N)) {
+                            ERL_WARN("Capacity mismatch. Expected {}, got {}.", N, capacity);
+                            return false;
+                        }
+                        self->SetCapacity(capacity);
+                        self->m_read_ = read;
+                        self->m_write_ = read + size;
+                        self->m_reserved_ = 0;
                         return s.good();
                     },
                 },
                 {
                     "buffer",
                     [](RingBuffer *self, std::istream &s) {
-                        self->m_buffer_.clear();
-                        self->m_buffer_.resize(self->m_capacity_);
-                        for (std::size_t i = 0; i < self->m_size_; ++i) {
-                            std::size_t index = (self->m_read_ + i) % self->m_capacity_;
+                        if constexpr (N == -1) {
+                            self->m_buffer_.clear();
+                            self->m_buffer_.resize(self->m_capacity_);
+                        }
+                        const std::size_t size = self->Size();
+                        for (std::size_t i = 0; i < size; ++i) {
+                            std::size_t index = self->Index(self->m_read_ + i);
                             if (!Reader<T>::Run(&self->m_buffer_[index], s)) {
                                 ERL_WARN("Failed to read item {}.", i);
                                 return false;
@@ -369,5 +460,47 @@ namespace erl::common {
             };
             return ReadTokens(stream, this, token_function_pairs);
         }
+
+    private:
+        static std::size_t
+        CeilPowerOfTwo(const std::size_t n) {
+            std::size_t p = 1;
+            while (p < n) { p <<= 1; }
+            return p;
+        }
+
+        void
+        SetCapacity(const std::size_t capacity) {
+            m_capacity_ = capacity;
+            m_power_of_two_ = capacity > 0 && (capacity & (capacity - 1)) == 0;
+            m_mask_ = m_power_of_two_ ? capacity - 1 : 0;
+        }
+
+        /**
+         * Map a monotonic counter to a position in the buffer.
+         */
+        [[nodiscard]] std::size_t
+        Index(const std::uint64_t counter) const {
+            if constexpr (kStaticPowerOfTwo) {
+                return static_cast<std::size_t>(counter & static_cast<std::uint64_t>(N - 1));
+            } else if constexpr (N > 0) {
+                return static_cast<std::size_t>(counter % static_cast<std::uint64_t>(N));
+            } else {
+                if (m_power_of_two_) { return static_cast<std::size_t>(counter & m_mask_); }
+                return static_cast<std::size_t>(counter % m_capacity_);
+            }
+        }
+
+        template<typename U, typename Ptr>
+        Spans<U>
+        MakeSpans(Ptr data, const std::size_t start, const std::size_t n) const {
+            Spans<U> spans;
+            if (n == 0) { return spans; }
+            spans.first = data + start;
+            spans.first_size = std::min(n, m_capacity_ - start);
+            spans.second_size = n - spans.first_size;
+            if (spans.second_size > 0) { spans.second = data; }
+            return spans;
+        }
     };
 }  // namespace erl::common
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace erl::common {
+
+    /**
+     * Weighted mean and variance updated one sample at a time by Welford's algorithm, which does
+     * not lose precision like E[x^2] - E[x]^2 when the mean is large compared to the spread.
+     * Instances are merged by the parallel formula of Chan et al.
+     */
+    struct RunningStatistics {
+        std::uint64_t count = 0;
+        double weight_sum = 0.0;
+        double mean = 0.0;
+        double m2 = 0.0;  // sum of weight * (value - mean)^2
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+
+        void
+        Add(const double value, const double weight = 1.0) {
+            ++count;
+            min = std::min(min, value);
+            max = std::max(max, value);
+            if (weight == 0.0) { return; }
+            weight_sum += weight;
+            const double delta = value - mean;
+            mean += delta * weight / weight_sum;
+            m2 += weight * delta * (value - mean);
+        }
+
+        /**
+         * Add samples of unit weight. The mean and the spread of the batch are computed by two
+         * plain passes, which are cheaper than one Welford update per sample, and merged.
+         */
+        void
+        Add(const double *values, const std::size_t n) {
+            if (n == 0) { return; }
+            RunningStatistics batch;
+            batch.count = n;
+            batch.weight_sum = static_cast<double>(n);
+            double sum = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                sum += values[i];
+                batch.min = std::min(batch.min, values[i]);
+                batch.max = std::max(batch.max, values[i]);
+            }
+            batch.mean = sum / batch.weight_sum;
+            for (std::size_t i = 0; i < n; ++i) {
+                const double delta = values[i] - batch.mean;
+                batch.m2 += delta * delta;
+            }
+            Merge(batch);
+        }
+
+        void
+        Merge(const RunningStatistics &other) {
+            count += other.count;
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+            if (other.weight_sum == 0.0) { return; }
+            if (weight_sum == 0.0) {
+                weight_sum = other.weight_sum;
+                mean = other.mean;
+                m2 = other.m2;
+                return;
+            }
+            const double total = weight_sum + other.weight_sum;
+            const double delta = other.mean - mean;
+            mean += delta * other.weight_sum / total;
+            m2 += other.m2 + delta * delta * weight_sum * other.weight_sum / total;
+            weight_sum = total;
+        }
+
+        void
+        Reset() {
+            *this = RunningStatistics();
+        }
+
+        /**
+         * @return The weighted mean, NaN if the weight sum is zero.
+         */
+        [[nodiscard]] double
+        GetMean() const {
+            return weight_sum == 0.0 ? std::numeric_limits<double>::quiet_NaN() : mean;
+        }
+
+        /**
+         * @return The weighted population variance, NaN if the weight sum is zero.
+         */
+        [[nodiscard]] double
+        GetVariance() const {
+            if (weight_sum == 0.0) { return std::numeric_limits<double>::quiet_NaN(); }
+            return std::max(m2 / weight_sum, 0.0);
+        }
+
+        [[nodiscard]] double
+        GetStd() const {
+            return std::sqrt(GetVariance());
+        }
+    };
+}  // namespace erl::common
@@ -1,11 +1,23 @@
 #pragma once
 
+#include "binary_container.hpp"
 #include "logging.hpp"
+#include "reflection.hpp"
 #include "string_utils.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <istream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace erl::common::serialization {
@@ -21,12 +33,150 @@ namespace erl::common::serialization {
     }
 
     /**
-     * Write tokens to an output stream.
+     * Write the sections of an object as a binary container, one section per token. By default,
+     * the sections are streamed straight into the stream if it can seek, otherwise they are
+     * buffered. If parallel_encoding is true, the write functions run in parallel, each into its
+     * own buffer. The container starts at a multiple of BinaryContainer::kAlignment if the stream
+     * reports its position, the gap is filled with newlines that readers skip as whitespace.
      * @tparam T Object type
      * @tparam TokenFunctionPair Pair of token and function to write.
      * @param s The output stream to write to.
      * @param obj The object to write.
      * @param token_function_pairs The pairs of tokens and function to execute.
+     * @param parallel_encoding Whether to run the write functions in parallel.
+     * @return true if successful.
+     */
+    template<typename T, typename TokenFunctionPair>
+    bool
+    WriteSections(
+        std::ostream &s,
+        const T *obj,
+        const std::vector<TokenFunctionPair> &token_function_pairs,
+        const bool parallel_encoding = false) {
+        const auto num_sections = static_cast<long>(token_function_pairs.size());
+        auto encode = [&](const long i, std::ostream &stream) -> bool {
+            const char *token = token_function_pairs[i].first;
+            try {
+                if (token_function_pairs[i].second(obj, stream) && stream.good()) { return true; }
+                ERL_WARN("Failed to write {}.", token);
+            } catch (const std::exception &e) {
+                ERL_WARN("Exception while writing {}: {}", token, e.what());
+            }
+            return false;
+        };
+        if (const std::streampos pos = s.tellp(); pos != std::streampos(-1)) {
+            const auto offset = static_cast<std::uint64_t>(pos);
+            s << std::string(BinaryContainer::AlignUp(offset) - offset, '\n');
+        }
+
+        std::vector<std::string> tags(num_sections);
+        for (long i = 0; i < num_sections; ++i) { tags[i] = token_function_pairs[i].first; }
+        if (!parallel_encoding && BinaryContainerWriter::IsSeekable(s)) {
+            return BinaryContainerWriter::Encode(
+                s,
+                tags,
+                [&](const std::size_t i, std::ostream &stream) {
+                    return encode(static_cast<long>(i), stream);
+                });
+        }
+
+        std::vector<ChunkedBuffer> payloads(num_sections);
+        std::vector<char> success(num_sections, 0);
+#pragma omp parallel for schedule(dynamic) if (parallel_encoding && num_sections > 1)
+        for (long i = 0; i < num_sections; ++i) {
+            ChunkedOStream stream(payloads[i]);
+            stream.copyfmt(s);  // keep the format flag for nested objects
+            success[i] = encode(i, stream);
+        }
+        BinaryContainerWriter writer;
+        for (long i = 0; i < num_sections; ++i) {
+            if (!success[i]) { return false; }
+            writer.AddSection(std::move(tags[i]), std::move(payloads[i]));
+        }
+        return writer.Write(s);
+    }
+
+    /**
+     * Read the sections of an object from a binary container. Sections of the container that are
+     * not listed are skipped. By default, the listed sections are decoded in order, straight from
+     * the stream. If parallel_decoding is true, all listed payloads are read into memory first,
+     * then verified and decoded in parallel. Only enable it when the read functions do not depend
+     * on each other.
+     * @tparam T Object type.
+     * @tparam TokenFunctionPair Pair of token and function to read.
+     * @param s The input stream to read from, positioned at the start of the container.
+     * @param obj The object to store the read data.
+     * @param token_function_pairs The pairs of tokens and function to execute.
+     * @param parallel_decoding Whether to run the read functions in parallel.
+     * @return true if successful.
+     */
+    template<typename T, typename TokenFunctionPair>
+    bool
+    ReadSections(
+        std::istream &s,
+        T *obj,
+        const std::vector<TokenFunctionPair> &token_function_pairs,
+        const bool parallel_decoding = false) {
+        BinaryContainerReader reader;
+        if (!reader.Open(s)) { return false; }
+        const auto num_sections = static_cast<long>(token_function_pairs.size());
+        std::vector<std::size_t> indices(num_sections);
+        for (long i = 0; i < num_sections; ++i) {
+            indices[i] = reader.FindSection(token_function_pairs[i].first);
+            if (indices[i] == BinaryContainer::kNotFound) {
+                ERL_WARN("Section {} not found.", token_function_pairs[i].first);
+                return false;
+            }
+        }
+
+        auto decode = [&](const long i, std::istream &stream) -> bool {
+            const char *token = token_function_pairs[i].first;
+            try {
+                if (token_function_pairs[i].second(obj, stream)) { return true; }
+                ERL_WARN("Failed to read {}.", token);
+            } catch (const std::exception &e) {
+                ERL_WARN("Exception while reading {}: {}", token, e.what());
+            }
+            return false;
+        };
+        if (!parallel_decoding) {  // stream each payload straight into the object
+            for (long i = 0; i < num_sections; ++i) {
+                if (!reader.DecodeSection(indices[i], [&](std::istream &stream) {
+                        return decode(i, stream);
+                    })) {
+                    return false;
+                }
+            }
+            return reader.SeekToEnd();
+        }
+
+        // read the payloads one after another, then verify and decode them in parallel
+        std::vector<std::string> payloads(num_sections);
+        for (long i = 0; i < num_sections; ++i) {
+            if (!reader.ReadSection(indices[i], payloads[i], false)) { return false; }
+        }
+        if (!reader.SeekToEnd()) { return false; }
+        std::vector<char> success(num_sections, 0);
+#pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < num_sections; ++i) {
+            if (!reader.VerifySection(indices[i], payloads[i])) { continue; }
+            MemoryIStream stream(payloads[i].data(), payloads[i].size());
+            success[i] = decode(i, stream);
+        }
+        return std::all_of(success.begin(), success.end(), [](const char ok) { return ok; });
+    }
+
+    /**
+     * Write tokens to an output stream. If the stream is marked with Format::kBinaryContainer or
+     * Format::kBinarySchema (see SetFormat), the tokens are written as the sections of a binary
+     * container instead.
+     * @tparam T Object type
+     * @tparam TokenFunctionPair Pair of token and function to write.
+     * @param s The output stream to write to.
+     * @param obj The object to write.
+     * @param token_function_pairs The pairs of tokens and function to execute.
+     * @param parallel_encoding Whether to encode the sections of a binary container in parallel,
+     * see WriteSections. Ignored for text tokens.
      * @return
      */
     template<typename T, typename TokenFunctionPair>
@@ -34,7 +184,12 @@ namespace erl::common::serialization {
     WriteTokens(
         std::ostream &s,
         const T *obj,
-        const std::vector<TokenFunctionPair> &token_function_pairs) {
+        const std::vector<TokenFunctionPair> &token_function_pairs,
+        const bool parallel_encoding = false) {
+        if (const Format format = GetFormat(s);
+            format == Format::kBinaryContainer || format == Format::kBinarySchema) {
+            return WriteSections(s, obj, token_function_pairs, parallel_encoding);
+        }
         for (const auto &[token, write_func]: token_function_pairs) {
             s << token << '\n';  // write token, add newline so that the reader stops properly.
             if (!write_func(obj, s) || !s.good()) {
@@ -47,12 +202,15 @@ namespace erl::common::serialization {
     }
 
     /**
-     * Read tokens from an input stream.
+     * Read tokens from an input stream. Both the text tokens and the binary container written by
+     * WriteTokens are accepted, the format is detected from the stream.
      * @tparam T Object type.
      * @tparam TokenFunctionPair Pair of token and function to read.
      * @param s The input stream to read from.
      * @param obj The object to store the read data.
      * @param token_function_pairs The pairs of tokens and function to execute.
+     * @param parallel_decoding Whether to decode the sections of a binary container in parallel,
+     * see ReadSections. Ignored for text tokens.
      * @return
      */
     template<typename T, typename TokenFunctionPair>
@@ -60,7 +218,16 @@ namespace erl::common::serialization {
     ReadTokens(
         std::istream &s,
         T *obj,
-        const std::vector<TokenFunctionPair> &token_function_pairs) {
+        const std::vector<TokenFunctionPair> &token_function_pairs,
+        const bool parallel_decoding = false) {
+        while (true) {  // skip whitespaces and comment lines
+            s >> std::ws;
+            if (s.peek() != '#') { break; }
+            SkipLine(s);
+        }
+        if (BinaryContainerReader::Detect(s)) {
+            return ReadSections(s, obj, token_function_pairs, parallel_decoding);
+        }
         std::string token;
         std::size_t token_idx = 0;
         for (const auto &[expected_token, read_func]: token_function_pairs) {
@@ -98,6 +265,37 @@ namespace erl::common::serialization {
         return false;  // should not reach here
     }
 
+    template<typename T, typename = void>
+    struct HasWriteMethod : std::false_type {};
+
+    template<typename T>
+    struct HasWriteMethod<
+        T,
+        std::void_t<decltype(std::declval<const T &>().Write(std::declval<std::ostream &>()))>>
+        : std::true_type {};
+
+    template<typename T, typename = void>
+    struct HasReadMethod : std::false_type {};
+
+    template<typename T>
+    struct HasReadMethod<
+        T,
+        std::void_t<decltype(std::declval<T &>().Read(std::declval<std::istream &>()))>>
+        : std::true_type {};
+
+    /**
+     * Whether an array of T can be written / read with a single stream call. True by default if T
+     * is trivially copyable, even if it defines its own Write / Read, because Writer / Reader
+     * have always copied the bytes of such types and existing files hold that layout. Specialize
+     * it for types whose bytes can be copied although they are not trivially copyable, e.g.
+     * fixed-size Eigen matrices.
+     */
+    template<typename T, typename = void>
+    struct IsBulkSerializable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+    template<typename T>
+    inline constexpr bool kIsBulkSerializable = IsBulkSerializable<T>::value;
+
     template<typename T, typename = void>
     struct Writer {
         static bool
@@ -107,8 +305,11 @@ namespace erl::common::serialization {
         }
     };
 
+    // trivially copyable types keep the byte copy above, see IsBulkSerializable
     template<typename T>
-    struct Writer<T, std::void_t<decltype(std::declval<T>().Write())>> {
+    struct Writer<
+        T,
+        std::enable_if_t<HasWriteMethod<T>::value && !std::is_trivially_copyable_v<T>>> {
         static bool
         Run(const T *entry, std::ostream &stream) {
             return entry->Write(stream);
@@ -125,42 +326,601 @@ namespace erl::common::serialization {
     };
 
     template<typename T>
-    struct Reader<T, std::void_t<decltype(std::declval<T>().Read())>> {
+    struct Reader<
+        T,
+        std::enable_if_t<HasReadMethod<T>::value && !std::is_trivially_copyable_v<T>>> {
         static bool
         Run(T *entry, std::istream &stream) {
             return entry->Read(stream);
         }
     };
 
+    inline constexpr char kSchemaMagic[] = "\x7f"
+                                           "ERLSCH\n";  // 8 bytes without the terminator
+    inline constexpr std::uint32_t kSchemaVersion = 1;
+    inline constexpr std::uint64_t kSchemaHashSeed = 0xcbf29ce484222325ull;  // FNV-1a basis
+
+    template<typename T>
+    std::uint64_t
+    GetSchemaHash(std::uint64_t seed = kSchemaHashSeed);
+
+    namespace detail {
+        template<typename T>
+        struct IsStdPair : std::false_type {};
+
+        template<typename T1, typename T2>
+        struct IsStdPair<std::pair<T1, T2>> : std::true_type {};
+
+        template<typename T>
+        struct IsStdVector : std::false_type {};
+
+        template<typename T, typename Alloc>
+        struct IsStdVector<std::vector<T, Alloc>> : std::bool_constant<!std::is_same_v<T, bool>> {};
+
+        template<typename T>
+        struct IsStdArray : std::false_type {};
+
+        template<typename T, std::size_t N>
+        struct IsStdArray<std::array<T, N>> : std::true_type {};
+
+        template<typename T>
+        struct IsSmartPointer : std::false_type {};
+
+        template<typename T>
+        struct IsSmartPointer<std::shared_ptr<T>> : std::true_type {};
+
+        template<typename T>
+        struct IsSmartPointer<std::unique_ptr<T>> : std::true_type {};
+
+        // dense Eigen matrices and arrays, detected without including Eigen
+        template<typename T, typename = void>
+        struct IsDenseEigenMatrix : std::false_type {};
+
+        template<typename T>
+        struct IsDenseEigenMatrix<
+            T,
+            std::void_t<
+                typename T::Scalar,
+                decltype(T::RowsAtCompileTime),
+                decltype(T::ColsAtCompileTime),
+                decltype(std::declval<T &>().resize(0l, 0l))>>
+            : std::bool_constant<
+                  std::is_same_v<decltype(std::declval<T &>().data()), typename T::Scalar *> &&
+                  std::is_arithmetic_v<typename T::Scalar>> {};
+
+        template<typename T>
+        constexpr bool
+        CheckSchemaValue();
+
+        template<typename T, typename... Members>
+        constexpr bool
+        CheckSchemaMembers(const std::tuple<MemberInfo<T, Members>...> * /*schema*/) {
+            return (CheckSchemaValue<Members>() && ...);
+        }
+
+        template<typename T>
+        constexpr bool
+        CheckSchema() {
+            if constexpr (has_static_schema_v<T>) {
+                using Schema = std::remove_const_t<decltype(T::Schema)>;
+                // polymorphic members need a factory to be created, see YamlableBase
+                const bool polymorphic = std::apply(
+                    [](const auto &...member_info) {
+                        return ((member_info.type_ptr != nullptr) || ...);
+                    },
+                    T::Schema);
+                return !polymorphic && CheckSchemaMembers(static_cast<const Schema *>(nullptr));
+            } else {
+                return false;
+            }
+        }
+
+        template<typename T>
+        constexpr bool
+        CheckSchemaValue() {
+            if constexpr (std::is_pointer_v<T> || std::is_member_pointer_v<T>) {
+                return false;
+            } else if constexpr (HasWriteMethod<T>::value && HasReadMethod<T>::value) {
+                return true;
+            } else if constexpr (kIsBulkSerializable<T> || std::is_same_v<T, std::string>) {
+                return true;
+            } else if constexpr (IsStdPair<T>::value) {
+                return CheckSchemaValue<typename T::first_type>() &&
+                       CheckSchemaValue<typename T::second_type>();
+            } else if constexpr (IsStdVector<T>::value || IsStdArray<T>::value) {
+                return CheckSchemaValue<typename T::value_type>();
+            } else if constexpr (IsDenseEigenMatrix<T>::value) {
+                return true;
+            } else if constexpr (IsSmartPointer<T>::value) {
+                using Element = typename T::element_type;
+                return std::is_default_constructible_v<Element> && CheckSchemaValue<Element>();
+            } else {
+                return CheckSchema<T>();
+            }
+        }
+
+        // changes when a member is renamed, reordered or changes its kind or bulk size, nested
+        // schema types are hashed by HashNestedSchema
+        template<typename T>
+        constexpr std::uint64_t
+        GetSchemaTypeTag() {
+            if constexpr (HasWriteMethod<T>::value) {
+                return 1;
+            } else if constexpr (kIsBulkSerializable<T>) {
+                return sizeof(T) << 8 | 2;
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                return 3;
+            } else if constexpr (IsStdPair<T>::value) {
+                return GetSchemaTypeTag<typename T::first_type>() * 31 +
+                       GetSchemaTypeTag<typename T::second_type>();
+            } else if constexpr (IsStdVector<T>::value) {
+                return GetSchemaTypeTag<typename T::value_type>() << 8 | 4;
+            } else if constexpr (IsStdArray<T>::value) {
+                return (GetSchemaTypeTag<typename T::value_type>() * std::tuple_size_v<T>) << 8 | 5;
+            } else if constexpr (IsDenseEigenMatrix<T>::value) {
+                return sizeof(typename T::Scalar) << 8 | 6;
+            } else if constexpr (IsSmartPointer<T>::value) {
+                return GetSchemaTypeTag<typename T::element_type>() << 8 | 7;
+            } else {
+                return 8;
+            }
+        }
+
+        inline std::uint64_t
+        HashSchemaBytes(std::uint64_t hash, const void *data, const std::size_t size) {
+            const auto *bytes = static_cast<const unsigned char *>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= 0x100000001b3ull;  // FNV-1a prime
+            }
+            return hash;
+        }
+
+        // mixes in the members of the schema types nested in T, in the order of GetSchemaTypeTag
+        template<typename T>
+        std::uint64_t
+        HashNestedSchema(const std::uint64_t hash) {
+            if constexpr (
+                HasWriteMethod<T>::value || kIsBulkSerializable<T> ||
+                std::is_same_v<T, std::string> || IsDenseEigenMatrix<T>::value) {
+                return hash;
+            } else if constexpr (IsStdPair<T>::value) {
+                return HashNestedSchema<typename T::second_type>(
+                    HashNestedSchema<typename T::first_type>(hash));
+            } else if constexpr (IsStdVector<T>::value || IsStdArray<T>::value) {
+                return HashNestedSchema<typename T::value_type>(hash);
+            } else if constexpr (IsSmartPointer<T>::value) {
+                return HashNestedSchema<typename T::element_type>(hash);
+            } else {
+                return GetSchemaHash<T>(hash);
+            }
+        }
+
+        template<typename Member>
+        std::uint64_t
+        HashSchemaMember(std::uint64_t hash, const char *name) {
+            constexpr std::uint64_t tag = GetSchemaTypeTag<Member>();
+            hash = HashSchemaBytes(hash, name, std::char_traits<char>::length(name));
+            hash = HashSchemaBytes(hash, &tag, sizeof(tag));
+            return HashNestedSchema<Member>(hash);
+        }
+    }  // namespace detail
+
+    /**
+     * Whether WriteSchemaValue / ReadSchemaValue support T: types with their own Write / Read,
+     * bulk-serializable types, std::string, std::pair, std::vector, std::array, dense Eigen
+     * matrices, std::shared_ptr / std::unique_ptr of supported types, and types declared with
+     * ERL_REFLECT_SCHEMA whose members are all supported.
+     */
+    template<typename T>
+    inline constexpr bool kIsSchemaSerializable = detail::CheckSchemaValue<T>();
+
+    /**
+     * Whether all members of T::Schema are supported by WriteSchemaMembers. Members declared with
+     * ERL_REFLECT_MEMBER_POLY are not, because their type is only known at runtime.
+     */
+    template<typename T>
+    inline constexpr bool kHasSerializableSchema = detail::CheckSchema<T>();
+
+    /**
+     * Hash of the names and kinds of the members of T::Schema and of the schema types nested in
+     * them, stored in the header to reject data written with another layout instead of
+     * misreading it.
+     * @param seed Hash of the members written before, e.g. those of a base class.
+     */
+    template<typename T>
+    std::uint64_t
+    GetSchemaHash(std::uint64_t seed) {
+        std::apply(
+            [&seed](const auto &...member_info) {
+                ((seed = detail::HashSchemaMember<
+                      typename std::remove_reference_t<decltype(member_info)>::MemberType>(
+                      seed,
+                      member_info.name)),
+                 ...);
+            },
+            T::Schema);
+        return seed;
+    }
+
+    inline bool
+    WriteSchemaHeader(std::ostream &s, const std::uint64_t hash) {
+        s.write(kSchemaMagic, sizeof(kSchemaMagic) - 1);
+        s.write(reinterpret_cast<const char *>(&kSchemaVersion), sizeof(kSchemaVersion));
+        s.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+        return s.good();
+    }
+
+    /**
+     * Read the rest of the header after its magic, which the caller reads to tell the format.
+     */
+    inline bool
+    ReadSchemaHeaderAfterMagic(std::istream &s, const std::uint64_t hash) {
+        std::uint32_t version = 0;
+        std::uint64_t stored_hash = 0;
+        s.read(reinterpret_cast<char *>(&version), sizeof(version));
+        s.read(reinterpret_cast<char *>(&stored_hash), sizeof(stored_hash));
+        if (!s.good()) { return false; }
+        if (version != kSchemaVersion) {
+            ERL_WARN("Unsupported schema layout version {}, expected {}.", version, kSchemaVersion);
+            return false;
+        }
+        if (stored_hash != hash) {
+            ERL_WARN("Schema hash mismatch, the data was written with different members.");
+            return false;
+        }
+        return true;
+    }
+
+    inline bool
+    IsSchemaMagic(const char *bytes) {
+        return std::char_traits<char>::compare(bytes, kSchemaMagic, sizeof(kSchemaMagic) - 1) == 0;
+    }
+
+    template<typename T>
+    bool
+    WriteSchemaMembers(std::ostream &s, const T &obj);
+
+    template<typename T>
+    bool
+    ReadSchemaMembers(std::istream &s, T &obj);
+
+    template<typename T>
+    bool
+    WriteSchemaValues(std::ostream &s, const T *values, std::size_t n);
+
+    template<typename T>
+    bool
+    ReadSchemaValues(std::istream &s, T *values, std::size_t n);
+
+    namespace detail {
+        inline constexpr std::uint64_t kSchemaReadChunkBytes = 1 << 20;
+
+        /**
+         * Read the elements of a string or vector whose length was read from the stream. The
+         * container grows one chunk at a time and each chunk is read before the next, so a
+         * corrupt length fails at the end of the data instead of allocating it all up front.
+         */
+        template<typename Container>
+        bool
+        ReadSchemaSequence(std::istream &s, Container &container, const std::uint64_t size) {
+            using Value = typename Container::value_type;
+            constexpr std::uint64_t kChunk =
+                std::max<std::uint64_t>(1, kSchemaReadChunkBytes / sizeof(Value));
+            container.clear();
+            for (std::uint64_t begin = 0; begin < size; begin += kChunk) {
+                const std::uint64_t n = std::min(kChunk, size - begin);
+                container.resize(begin + n);
+                if (!ReadSchemaValues(s, container.data() + begin, n)) { return false; }
+            }
+            return s.good();
+        }
+    }  // namespace detail
+
+    /**
+     * Write a value in the compact binary layout of the schema serialization: bulk-serializable
+     * values as their bytes, strings, vectors and dynamic Eigen matrices with their size first,
+     * smart pointers with a presence byte, and other schema types member by member.
+     */
+    template<typename T>
+    bool
+    WriteSchemaValue(std::ostream &s, const T &value) {
+        static_assert(kIsSchemaSerializable<T>, "T is not supported by the schema serialization.");
+        if constexpr (HasWriteMethod<T>::value) {
+            return value.Write(s);
+        } else if constexpr (kIsBulkSerializable<T>) {
+            s.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            const auto size = static_cast<std::uint64_t>(value.size());
+            s.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            s.write(value.data(), static_cast<std::streamsize>(size));
+        } else if constexpr (detail::IsStdPair<T>::value) {
+            return WriteSchemaValue(s, value.first) && WriteSchemaValue(s, value.second);
+        } else if constexpr (detail::IsStdVector<T>::value) {
+            const auto size = static_cast<std::uint64_t>(value.size());
+            s.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            return WriteSchemaValues(s, value.data(), value.size());
+        } else if constexpr (detail::IsStdArray<T>::value) {
+            return WriteSchemaValues(s, value.data(), value.size());
+        } else if constexpr (detail::IsDenseEigenMatrix<T>::value) {
+            const std::int64_t shape[2] = {value.rows(), value.cols()};
+            s.write(reinterpret_cast<const char *>(shape), sizeof(shape));
+            s.write(
+                reinterpret_cast<const char *>(value.data()),
+                static_cast<std::streamsize>(value.size() * sizeof(typename T::Scalar)));
+        } else if constexpr (detail::IsSmartPointer<T>::value) {
+            s.put(static_cast<char>(value != nullptr));
+            if (value != nullptr) { return WriteSchemaValue(s, *value); }
+        } else {
+            return WriteSchemaMembers(s, value);
+        }
+        return s.good();
+    }
+
+    /**
+     * Read a value written by WriteSchemaValue. Null smart pointers are filled with a default
+     * constructed object before it is read.
+     */
+    template<typename T>
+    bool
+    ReadSchemaValue(std::istream &s, T &value) {
+        static_assert(kIsSchemaSerializable<T>, "T is not supported by the schema serialization.");
+        if constexpr (HasReadMethod<T>::value) {
+            return value.Read(s);
+        } else if constexpr (kIsBulkSerializable<T>) {
+            s.read(reinterpret_cast<char *>(&value), sizeof(T));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            std::uint64_t size = 0;
+            s.read(reinterpret_cast<char *>(&size), sizeof(size));
+            return s.good() && detail::ReadSchemaSequence(s, value, size);
+        } else if constexpr (detail::IsStdPair<T>::value) {
+            return ReadSchemaValue(s, value.first) && ReadSchemaValue(s, value.second);
+        } else if constexpr (detail::IsStdVector<T>::value) {
+            std::uint64_t size = 0;
+            s.read(reinterpret_cast<char *>(&size), sizeof(size));
+            return s.good() && detail::ReadSchemaSequence(s, value, size);
+        } else if constexpr (detail::IsStdArray<T>::value) {
+            return ReadSchemaValues(s, value.data(), value.size());
+        } else if constexpr (detail::IsDenseEigenMatrix<T>::value) {
+            std::int64_t shape[2] = {0, 0};
+            s.read(reinterpret_cast<char *>(shape), sizeof(shape));
+            if (!s.good()) { return false; }
+            if ((T::RowsAtCompileTime >= 0 && shape[0] != T::RowsAtCompileTime) ||
+                (T::ColsAtCompileTime >= 0 && shape[1] != T::ColsAtCompileTime)) {
+                ERL_WARN(
+                    "Matrix shape mismatch: expected ({}, {}), got ({}, {}).",
+                    T::RowsAtCompileTime,
+                    T::ColsAtCompileTime,
+                    shape[0],
+                    shape[1]);
+                return false;
+            }
+            using Scalar = typename T::Scalar;
+            constexpr auto kMaxSize = std::numeric_limits<std::uint64_t>::max() / sizeof(Scalar);
+            if (shape[0] < 0 || shape[1] < 0 ||
+                (shape[1] > 0 && static_cast<std::uint64_t>(shape[0]) > kMaxSize / shape[1])) {
+                ERL_WARN("Invalid matrix shape ({}, {}).", shape[0], shape[1]);
+                return false;
+            }
+            const std::uint64_t size = shape[0] * shape[1];
+            if (size * sizeof(Scalar) > detail::kSchemaReadChunkBytes) {
+                // stage large matrices so that a corrupt shape cannot allocate them up front
+                std::vector<Scalar> buffer;
+                if (!detail::ReadSchemaSequence(s, buffer, size)) { return false; }
+                value.resize(shape[0], shape[1]);
+                std::copy(buffer.begin(), buffer.end(), value.data());
+                return true;
+            }
+            value.resize(shape[0], shape[1]);
+            s.read(
+                reinterpret_cast<char *>(value.data()),
+                static_cast<std::streamsize>(size * sizeof(Scalar)));
+        } else if constexpr (detail::IsSmartPointer<T>::value) {
+            const int present = s.get();
+            if (!s.good()) { return false; }
+            if (present == 0) {
+                value.reset();
+                return true;
+            }
+            if (value == nullptr) { value.reset(new typename T::element_type()); }
+            return ReadSchemaValue(s, *value);
+        } else {
+            return ReadSchemaMembers(s, value);
+        }
+        return s.good();
+    }
+
+    template<typename T>
+    bool
+    WriteSchemaValues(std::ostream &s, const T *values, const std::size_t n) {
+        if constexpr (kIsBulkSerializable<T>) {
+            s.write(
+                reinterpret_cast<const char *>(values),
+                static_cast<std::streamsize>(n * sizeof(T)));
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!WriteSchemaValue(s, values[i])) { return false; }
+            }
+        }
+        return s.good();
+    }
+
+    template<typename T>
+    bool
+    ReadSchemaValues(std::istream &s, T *values, const std::size_t n) {
+        if constexpr (kIsBulkSerializable<T>) {
+            s.read(reinterpret_cast<char *>(values), static_cast<std::streamsize>(n * sizeof(T)));
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!ReadSchemaValue(s, values[i])) { return false; }
+            }
+        }
+        return s.good();
+    }
+
+    /**
+     * Write the members of T::Schema in declaration order, without a header.
+     */
+    template<typename T>
+    bool
+    WriteSchemaMembers(std::ostream &s, const T &obj) {
+        static_assert(kHasSerializableSchema<T>, "T::Schema has unsupported members.");
+        bool success = true;
+        std::apply(
+            [&](const auto &...member_info) {
+                success = (WriteSchemaValue(s, obj.*(member_info.ptr)) && ...);
+            },
+            T::Schema);
+        return success && s.good();
+    }
+
+    template<typename T>
+    bool
+    ReadSchemaMembers(std::istream &s, T &obj) {
+        static_assert(kHasSerializableSchema<T>, "T::Schema has unsupported members.");
+        bool success = true;
+        std::apply(
+            [&](const auto &...member_info) {
+                success = (ReadSchemaValue(s, obj.*(member_info.ptr)) && ...);
+            },
+            T::Schema);
+        return success && s.good();
+    }
+
+    /**
+     * Write an object declared with ERL_REFLECT_SCHEMA in a compact binary layout: a header with
+     * the layout version and the schema hash, then the members. Much faster than going through
+     * YAML, but the data can only be read back with the same schema.
+     */
+    template<typename T>
+    bool
+    WriteSchema(std::ostream &s, const T &obj) {
+        return WriteSchemaHeader(s, GetSchemaHash<T>()) && WriteSchemaMembers(s, obj);
+    }
+
+    template<typename T>
+    bool
+    ReadSchema(std::istream &s, T &obj) {
+        char magic[sizeof(kSchemaMagic) - 1];
+        s.read(magic, sizeof(magic));
+        if (!s.good() || !IsSchemaMagic(magic)) {
+            ERL_WARN("Data does not start with the schema header.");
+            return false;
+        }
+        return ReadSchemaHeaderAfterMagic(s, GetSchemaHash<T>()) && ReadSchemaMembers(s, obj);
+    }
+
+    // objects that cannot be copied as bytes but have a supported schema are written by member
+    template<typename T>
+    struct Writer<
+        T,
+        std::enable_if_t<
+            !HasWriteMethod<T>::value && !kIsBulkSerializable<T> && kHasSerializableSchema<T>>> {
+        static bool
+        Run(const T *entry, std::ostream &stream) {
+            return WriteSchemaMembers(stream, *entry);
+        }
+    };
+
+    template<typename T>
+    struct Reader<
+        T,
+        std::enable_if_t<
+            !HasReadMethod<T>::value && !kIsBulkSerializable<T> && kHasSerializableSchema<T>>> {
+        static bool
+        Run(T *entry, std::istream &stream) {
+            return ReadSchemaMembers(stream, *entry);
+        }
+    };
+
+    /**
+     * Write n contiguous entries. Bulk-serializable entries are written with one stream call,
+     * other entries go through Writer<T> one by one. Both produce the same bytes.
+     * @param stream The output stream to write to.
+     * @param entries Pointer to the first entry.
+     * @param n Number of entries.
+     * @return true if successful.
+     */
+    template<typename T>
+    bool
+    WriteArray(std::ostream &stream, const T *entries, const std::size_t n) {
+        if constexpr (kIsBulkSerializable<T>) {
+            stream.write(
+                reinterpret_cast<const char *>(entries),
+                static_cast<std::streamsize>(n * sizeof(T)));
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!Writer<T>::Run(entries + i, stream)) {
+                    ERL_WARN("Failed to write entry {}.", i);
+                    return false;
+                }
+            }
+        }
+        return stream.good();
+    }
+
+    /**
+     * Read n contiguous entries written by WriteArray.
+     * @param stream The input stream to read from.
+     * @param entries Pointer to the first entry, the storage must hold n entries.
+     * @param n Number of entries.
+     * @return true if successful.
+     */
+    template<typename T>
+    bool
+    ReadArray(std::istream &stream, T *entries, const std::size_t n) {
+        if constexpr (kIsBulkSerializable<T>) {
+            stream.read(
+                reinterpret_cast<char *>(entries),
+                static_cast<std::streamsize>(n * sizeof(T)));
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!Reader<T>::Run(entries + i, stream)) {
+                    ERL_WARN("Failed to read entry {}.", i);
+                    return false;
+                }
+            }
+        }
+        return stream.good();
+    }
+
     /**
      * Template specialization for serialization.
      * @tparam T Object type.
      * @note It is better to pass the object as a pointer in case of polymorphism.
+     * @note Write takes the format of the tokens written by WriteTokens, Format::kAuto writes the
+     * binary container. Read accepts both formats.
      */
     template<typename T>
     struct Serialization {
 
         [[nodiscard]] static bool
-        Write(const std::string &filename, const std::shared_ptr<T> &data) {
-            return Write(filename, data.get());
+        Write(
+            const std::string &filename,
+            const std::shared_ptr<T> &data,
+            const Format format = Format::kAuto) {
+            return Write(filename, data.get(), format);
         }
 
         [[nodiscard]] static bool
-        Write(const std::string &filename, const std::shared_ptr<const T> &data) {
+        Write(
+            const std::string &filename,
+            const std::shared_ptr<const T> &data,
+            const Format format = Format::kAuto) {
             if (data == nullptr) {
                 ERL_WARN("Data is nullptr.");
                 return false;
             }
-            return Write(filename, data.get());
+            return Write(filename, data.get(), format);
         }
 
         [[nodiscard]] static bool
-        Write(const std::string &filename, T *data) {
-            return Write(filename, static_cast<const T *>(data));
+        Write(const std::string &filename, T *data, const Format format = Format::kAuto) {
+            return Write(filename, static_cast<const T *>(data), format);
         }
 
         [[nodiscard]] static bool
-        Write(const std::string &filename, const T *data) {
+        Write(const std::string &filename, const T *data, const Format format = Format::kAuto) {
             std::string type_str = type_name(*data);
             ERL_INFO("Writing {} to {}.", type_str, filename);
             std::filesystem::path folder = std::filesystem::absolute(filename).parent_path();
@@ -170,14 +930,25 @@ namespace erl::common::serialization {
                 ERL_WARN("Failed to open file {} for writing.", filename);
                 return false;
             }
-            ofs << "# " << type_str
-                << "\n# (feel free to add / change comments, but leave the first line as it is!)\n";
-            const bool success = data->Write(ofs);
-            ofs << "end_of_" << type_str << '\n';  // write end token
+            const bool success = Write(ofs, data, format);
             ofs.close();
             return success;
         }
 
+        /**
+         * Write the object with the same header and end token as a file, e.g. into an archive.
+         */
+        [[nodiscard]] static bool
+        Write(std::ostream &s, const T *data, const Format format = Format::kAuto) {
+            const std::string type_str = type_name(*data);
+            SetFormat(s, format == Format::kAuto ? Format::kBinaryContainer : format);
+            s << "# " << type_str
+              << "\n# (feel free to add / change comments, but leave the first line as it is!)\n";
+            const bool success = data->Write(s);
+            s << "end_of_" << type_str << '\n';  // write end token
+            return success && s.good();
+        }
+
         [[nodiscard]] static bool
         Read(const std::string &filename, const std::shared_ptr<T> &data) {
             if (data == nullptr) {
@@ -196,19 +967,28 @@ namespace erl::common::serialization {
                 ERL_WARN("Failed to open file {} for reading.", filename);
                 return false;
             }
+            return Read(ifs, data);
+        }
+
+        /**
+         * Read an object written by Write from a stream, e.g. an entry of an archive.
+         */
+        [[nodiscard]] static bool
+        Read(std::istream &s, T *data) {
+            const std::string type_str = type_name(*data);
             std::string line;
-            std::getline(ifs, line);
+            std::getline(s, line);
             if (std::string file_header = "# " + type_str;
                 line != file_header) {  // check if the first line is valid
                 ERL_WARN("Header does not start with \"{}\"", file_header);
                 return false;
             }
-            bool success = data->Read(ifs);
+            bool success = data->Read(s);
             if (!success) {
                 ERL_WARN("Failed to read {} from file.", type_str);
                 return false;
             }
-            std::getline(ifs, line);
+            std::getline(s, line);
             if (line != "end_of_" + type_str) {  // check if the last line is valid
                 ERL_WARN("Last line does not end with \"end_of_{}\" but \"{}\"", type_str, line);
                 return false;
@@ -218,7 +998,7 @@ namespace erl::common::serialization {
 
         template<typename Func>
         [[nodiscard]] static bool
-        Write(const std::string &filename, Func func) {
+        Write(const std::string &filename, Func func, const Format format = Format::kAuto) {
             std::string type_str = type_name<T>();
             ERL_INFO("Writing {} to {}.", type_str, filename);
             const std::filesystem::path folder = std::filesystem::absolute(filename).parent_path();
@@ -228,6 +1008,7 @@ namespace erl::common::serialization {
                 ERL_WARN("Failed to open file {} for writing.", filename);
                 return false;
             }
+            SetFormat(ofs, format == Format::kAuto ? Format::kBinaryContainer : format);
             ofs << "# " << type_str
                 << "\n# (feel free to add / change comments, but leave the first line as it is!)\n";
             const bool success = func(ofs);
@@ -0,0 +1,311 @@
+#pragma once
+
+#include "logging.hpp"
+#include "occupancy_bitmap.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace erl::common {
+
+    /**
+     * A slot map: entries live in a contiguous buffer, freed slots are reused, and every entry is
+     * addressed by a handle carrying the generation of its slot. Removing an entry bumps the
+     * generation, so a handle that outlives its entry is detected instead of silently aliasing
+     * the next entry stored in the same slot. Stale handles are asserted in debug builds by
+     * operator[] and always reported by Contains / Get.
+     * @tparam T Entry type.
+     */
+    template<typename T>
+    class SlotMap {
+    public:
+        struct Handle {
+            std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+            std::uint32_t generation = 0;
+
+            [[nodiscard]] bool
+            IsValid() const {
+                return index != std::numeric_limits<std::uint32_t>::max();
+            }
+
+            [[nodiscard]] bool
+            operator==(const Handle &other) const {
+                return index == other.index && generation == other.generation;
+            }
+
+            [[nodiscard]] bool
+            operator!=(const Handle &other) const {
+                return !(*this == other);
+            }
+        };
+
+        static constexpr std::size_t kInvalidIndex = static_cast<std::size_t>(-1);
+
+        template<typename Map, typename Value>
+        class IteratorImpl {
+            Map *m_map_ = nullptr;
+            std::size_t m_index_ = 0;
+
+        public:
+            IteratorImpl(Map *map, const std::size_t index)
+                : m_map_(map), m_index_(map->m_occupancy_.FindNext(index)) {}
+
+            [[nodiscard]] bool
+            operator==(const IteratorImpl &other) const {
+                return m_map_ == other.m_map_ && m_index_ == other.m_index_;
+            }
+
+            [[nodiscard]] bool
+            operator!=(const IteratorImpl &other) const {
+                return !(*this == other);
+            }
+
+            Value &
+            operator*() const {
+                return m_map_->m_entries_[m_index_];
+            }
+
+            Value *
+            operator->() const {
+                return &operator*();
+            }
+
+            IteratorImpl &
+            operator++() {
+                m_index_ = m_map_->m_occupancy_.FindNext(m_index_ + 1);
+                return *this;
+            }
+
+            IteratorImpl
+            operator++(int) {
+                IteratorImpl tmp = *this;
+                ++(*this);
+                return tmp;
+            }
+
+            [[nodiscard]] std::size_t
+            Index() const {
+                return m_index_;
+            }
+
+            [[nodiscard]] Handle
+            GetHandle() const {
+                return m_map_->HandleAt(m_index_);
+            }
+        };
+
+        using Iterator = IteratorImpl<SlotMap, T>;
+        using ConstIterator = IteratorImpl<const SlotMap, const T>;
+
+    private:
+        std::vector<T> m_entries_{};
+        std::vector<std::uint32_t> m_generations_{};  // may be longer than m_entries_
+        std::vector<std::uint32_t> m_free_slots_{};
+        OccupancyBitmap m_occupancy_{};
+
+    public:
+        [[nodiscard]] std::size_t
+        Size() const {
+            return m_occupancy_.Count();
+        }
+
+        [[nodiscard]] bool
+        IsEmpty() const {
+            return Size() == 0;
+        }
+
+        /**
+         *
+         * @return The number of slots, occupied or not.
+         */
+        [[nodiscard]] std::size_t
+        Capacity() const {
+            return m_entries_.size();
+        }
+
+        void
+        Reserve(const std::size_t size) {
+            m_entries_.reserve(size);
+            m_generations_.reserve(size);
+            m_occupancy_.Reserve(size);
+        }
+
+        [[nodiscard]] Handle
+        Insert(T &&entry) {
+            if (!m_free_slots_.empty()) {
+                const std::uint32_t index = m_free_slots_.back();
+                m_free_slots_.pop_back();
+                m_entries_[index] = std::move(entry);
+                m_occupancy_.Set(index);
+                return {index, m_generations_[index]};
+            }
+            const std::size_t index = m_entries_.size();
+            ERL_DEBUG_ASSERT(
+                index < std::numeric_limits<std::uint32_t>::max(),
+                "SlotMap is out of slots.");
+            m_entries_.emplace_back(std::move(entry));
+            if (index == m_generations_.size()) { m_generations_.push_back(0); }
+            m_occupancy_.PushBack(true);
+            return {static_cast<std::uint32_t>(index), m_generations_[index]};
+        }
+
+        [[nodiscard]] Handle
+        Insert(const T &entry) {
+            return Insert(T(entry));
+        }
+
+        template<typename... Args>
+        [[nodiscard]] Handle
+        Emplace(Args &&...args) {
+            return Insert(T(std::forward<Args>(args)...));
+        }
+
+        /**
+         * Remove the entry referenced by the handle. The entry stays constructed until its slot is
+         * reused.
+         * @param handle Handle of the entry.
+         * @return false if the handle is stale.
+         */
+        bool
+        Remove(const Handle &handle) {
+            if (!Contains(handle)) {
+                ERL_DEBUG_ASSERT(false, "Stale handle ({}, {}).", handle.index, handle.generation);
+                return false;
+            }
+            m_occupancy_.Reset(handle.index);
+            ++m_generations_[handle.index];
+            m_free_slots_.push_back(handle.index);
+            return true;
+        }
+
+        [[nodiscard]] bool
+        Contains(const Handle &handle) const {
+            return handle.index < m_entries_.size() && m_occupancy_.Test(handle.index) &&
+                   m_generations_[handle.index] == handle.generation;
+        }
+
+        /**
+         *
+         * @param handle Handle of the entry.
+         * @return Pointer to the entry, nullptr if the handle is stale.
+         */
+        T *
+        Get(const Handle &handle) {
+            return Contains(handle) ? &m_entries_[handle.index] : nullptr;
+        }
+
+        const T *
+        Get(const Handle &handle) const {
+            return Contains(handle) ? &m_entries_[handle.index] : nullptr;
+        }
+
+        T &
+        operator[](const Handle &handle) {
+            ERL_DEBUG_ASSERT(
+                Contains(handle),
+                "Stale handle ({}, {}).",
+                handle.index,
+                handle.generation);
+            return m_entries_[handle.index];
+        }
+
+        const T &
+        operator[](const Handle &handle) const {
+            ERL_DEBUG_ASSERT(
+                Contains(handle),
+                "Stale handle ({}, {}).",
+                handle.index,
+                handle.generation);
+            return m_entries_[handle.index];
+        }
+
+        /**
+         *
+         * @param index Index of an occupied slot.
+         * @return The handle of the entry currently stored at the slot.
+         */
+        [[nodiscard]] Handle
+        HandleAt(const std::size_t index) const {
+            ERL_DEBUG_ASSERT(m_occupancy_.Test(index), "Slot {} is empty.", index);
+            return {static_cast<std::uint32_t>(index), m_generations_[index]};
+        }
+
+        [[nodiscard]] const std::vector<T> &
+        GetBuffer() const {
+            return m_entries_;
+        }
+
+        [[nodiscard]] const OccupancyBitmap &
+        GetOccupancy() const {
+            return m_occupancy_;
+        }
+
+        /**
+         * Remove all entries. Handles issued before stay stale.
+         */
+        void
+        Clear() {
+            for (auto &generation: m_generations_) { ++generation; }
+            m_entries_.clear();
+            m_free_slots_.clear();
+            m_occupancy_.Clear();
+        }
+
+        /**
+         * Move all entries to the front of the buffer and release the empty slots. All handles
+         * issued before become stale, use the returned mapping and HandleAt to rebuild them.
+         * @return A vector mapping old slot indices to new ones, kInvalidIndex for empty slots.
+         */
+        std::vector<std::size_t>
+        Compact() {
+            std::vector<std::size_t> index_mapping(m_entries_.size(), kInvalidIndex);
+            std::size_t write_idx = 0;
+            m_occupancy_.ForEach([&](const std::size_t read_idx) {
+                index_mapping[read_idx] = write_idx;
+                if (read_idx != write_idx) {
+                    m_entries_[write_idx] = std::move(m_entries_[read_idx]);
+                }
+                ++write_idx;
+            });
+            for (auto &generation: m_generations_) { ++generation; }
+            m_entries_.resize(write_idx);
+            m_free_slots_.clear();
+            m_occupancy_.SetFirst(write_idx);
+            m_occupancy_.Resize(write_idx);
+            return index_mapping;
+        }
+
+        template<typename Func>
+        void
+        ForEach(Func func) {
+            m_occupancy_.ForEach([&](const std::size_t i) { func(m_entries_[i]); });
+        }
+
+        template<typename Func>
+        void
+        ForEach(Func func) const {
+            m_occupancy_.ForEach([&](const std::size_t i) { func(m_entries_[i]); });
+        }
+
+        Iterator
+        begin() {
+            return Iterator(this, 0);
+        }
+
+        Iterator
+        end() {
+            return Iterator(this, m_entries_.size());
+        }
+
+        ConstIterator
+        begin() const {
+            return ConstIterator(this, 0);
+        }
+
+        ConstIterator
+        end() const {
+            return ConstIterator(this, m_entries_.size());
+        }
+    };
+}  // namespace erl::common
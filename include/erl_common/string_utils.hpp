@@ -2,9 +2,23 @@
 
 #include <cxxabi.h>
 
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
 #include <typeinfo>
+#include <vector>
+
+#ifndef __cpp_lib_to_chars
+    #include "fmt.hpp"
+
+    #include <iterator>
+#endif
 
 #ifdef __GNUG__
 inline std::string
@@ -63,4 +77,69 @@ namespace erl::common {
         while (std::getline(ss, token, delimiter)) { tokens.push_back(token); }
         return tokens;
     }
+
+    /**
+     * std::from_chars for integers and floating-point numbers. Floating-point std::from_chars
+     * needs libstdc++ 11 (__cpp_lib_to_chars); older standard libraries, e.g. GCC 9 of Ubuntu
+     * 20.04, parse a copy of the token with strtod instead, which also depends on the locale.
+     */
+    template<typename T>
+    std::from_chars_result
+    FromChars(const char *begin, const char *end, T &value) {
+#ifndef __cpp_lib_to_chars
+        if constexpr (std::is_floating_point_v<T>) {
+            // strtod needs a null-terminated string, and the range may not be
+            const char *token_end = begin;
+            while (token_end < end && (std::isalnum(static_cast<unsigned char>(*token_end)) ||
+                                       *token_end == '.' || *token_end == '-' ||
+                                       *token_end == '+')) {
+                ++token_end;
+            }
+            if (token_end == begin || *begin == '+') {
+                return {begin, std::errc::invalid_argument};
+            }
+            const std::string token(begin, token_end);
+            char *parsed_end = nullptr;
+            errno = 0;
+            T result;
+            if constexpr (std::is_same_v<T, float>) {
+                result = std::strtof(token.c_str(), &parsed_end);
+            } else if constexpr (std::is_same_v<T, double>) {
+                result = std::strtod(token.c_str(), &parsed_end);
+            } else {
+                result = std::strtold(token.c_str(), &parsed_end);
+            }
+            const char *ptr = begin + (parsed_end - token.c_str());
+            if (ptr == begin) { return {begin, std::errc::invalid_argument}; }
+            if (errno == ERANGE) { return {ptr, std::errc::result_out_of_range}; }
+            value = result;
+            return {ptr, std::errc()};
+        } else {
+            return std::from_chars(begin, end, value);
+        }
+#else
+        return std::from_chars(begin, end, value);
+#endif
+    }
+
+    /**
+     * Append a number formatted by std::to_chars, floating-point numbers in the shortest form
+     * that reads back exactly. Without floating-point std::to_chars (libstdc++ < 11), they are
+     * formatted by fmt with "{}", which is the shortest round-trip form as well.
+     */
+    template<typename T>
+    void
+    AppendChars(std::string &buffer, const T value) {
+        static_assert(std::is_arithmetic_v<T>, "T must be a number.");
+#ifndef __cpp_lib_to_chars
+        if constexpr (std::is_floating_point_v<T>) {
+            fmt::format_to(std::back_inserter(buffer), "{}", value);
+        } else
+#endif
+        {
+            char chars[64];
+            const auto result = std::to_chars(chars, chars + sizeof(chars), value);
+            buffer.append(chars, result.ptr);
+        }
+    }
 }  // namespace erl::common
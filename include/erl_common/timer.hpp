@@ -1,20 +1,217 @@
 #pragma once
 
+#include "latency_histogram.hpp"
+#include "running_statistics.hpp"
+
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <optional>
 #include <thread>
+#include <vector>
 
 namespace erl::common {
+
+    /**
+     * Runs one-shot and periodic tasks from a min-heap of steady_clock deadlines, served by a
+     * small pool of worker threads. A periodic task is rescheduled from its previous deadline
+     * rather than from the time it ran, so the lateness of one run does not accumulate; when a
+     * task falls more than a period behind, the missed runs are skipped and counted. The delay
+     * between a deadline and the start of its run is recorded as jitter, per task and in a
+     * histogram shared by all tasks.
+     */
+    class Scheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Setting {
+            std::size_t num_threads = 1;
+            // a worker busy-waits for a deadline closer than this instead of sleeping, which
+            // trades a CPU core for less jitter than the wake-up latency of the OS
+            Clock::duration spin_threshold = Clock::duration::zero();
+        };
+
+    private:
+        struct Task {
+            std::function<void()> callback;
+            Clock::duration period;  // zero for a one-shot task
+            Clock::time_point deadline;
+            bool active = true;
+            bool running = false;
+            std::thread::id runner;
+            std::uint64_t num_runs = 0;
+            std::uint64_t num_missed = 0;
+            RunningStatistics jitter;  // in microseconds
+        };
+
+        struct Entry {
+            Clock::time_point deadline;
+            std::uint64_t seq;  // keeps the order of tasks with the same deadline
+            std::shared_ptr<Task> task;
+
+            bool
+            operator>(const Entry &other) const {
+                return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+            }
+        };
+
+    public:
+        /**
+         * Cancellation handle of a scheduled task. It is cheap to copy and stays valid after the
+         * task is done, but must not outlive its scheduler.
+         */
+        class Handle {
+            friend class Scheduler;
+            Scheduler *m_scheduler_ = nullptr;
+            std::shared_ptr<Task> m_task_ = nullptr;
+
+            Handle(Scheduler *scheduler, std::shared_ptr<Task> task)
+                : m_scheduler_(scheduler),
+                  m_task_(std::move(task)) {}
+
+        public:
+            Handle() = default;
+
+            /**
+             * Stop the task and remove it from the scheduler. If it is running in another
+             * thread, wait until the run returns, so the callback is not running after Cancel
+             * unless Cancel is called from it. The callback and its captures are released once it
+             * is not running.
+             * @return true if the task was still active.
+             */
+            bool
+            Cancel();
+
+            /**
+             * @return true if the task is scheduled or running and not cancelled.
+             */
+            [[nodiscard]] bool
+            IsActive() const;
+
+            [[nodiscard]] std::uint64_t
+            GetNumRuns() const;
+
+            /**
+             * @return The number of runs of a periodic task skipped because it fell behind.
+             */
+            [[nodiscard]] std::uint64_t
+            GetNumMissed() const;
+
+            /**
+             * @return Statistics of the delay between deadline and run, in microseconds.
+             */
+            [[nodiscard]] RunningStatistics
+            GetJitter() const;
+
+            explicit
+            operator bool() const {
+                return m_task_ != nullptr;
+            }
+        };
+
+    private:
+        Setting m_setting_;
+        mutable std::mutex m_mutex_;
+        std::condition_variable m_cv_;       // wakes the workers when the heap changes
+        std::condition_variable m_done_cv_;  // wakes Cancel when a run returns
+        std::vector<Entry> m_heap_;          // min-heap by std::push_heap / std::pop_heap
+        std::uint64_t m_seq_ = 0;
+        bool m_stopping_ = false;
+        std::mutex m_join_mutex_;                    // serializes joining the workers in Stop
+        std::vector<std::thread> m_workers_;
+        std::vector<std::thread::id> m_worker_ids_;  // not changed by joining, unlike m_workers_
+        LatencyHistogram m_jitter_histogram_;  // in microseconds
+
+    public:
+        Scheduler();
+
+        explicit Scheduler(Setting setting);
+
+        Scheduler(const Scheduler &) = delete;
+        Scheduler &
+        operator=(const Scheduler &) = delete;
+        Scheduler(Scheduler &&) = delete;
+        Scheduler &
+        operator=(Scheduler &&) = delete;
+
+        ~Scheduler() { Stop(); }
+
+        /**
+         * @return A process-wide scheduler with one worker, never destroyed.
+         */
+        static Scheduler &
+        GetDefault();
+
+        Handle
+        ScheduleAt(Clock::time_point deadline, std::function<void()> callback);
+
+        Handle
+        ScheduleAfter(const Clock::duration delay, std::function<void()> callback) {
+            return ScheduleAt(Clock::now() + delay, std::move(callback));
+        }
+
+        /**
+         * Run the callback every period, first after the given delay.
+         */
+        Handle
+        SchedulePeriodic(
+            Clock::duration period,
+            std::function<void()> callback,
+            Clock::duration initial_delay);
+
+        Handle
+        SchedulePeriodic(const Clock::duration period, std::function<void()> callback) {
+            return SchedulePeriodic(period, std::move(callback), period);
+        }
+
+        /**
+         * Drop the pending tasks and join the workers after their current runs. Stop may be
+         * called several times and from several threads, and every call from outside the
+         * scheduler returns only when all workers have exited. When called from a callback, it
+         * returns without waiting; the workers exit after their runs and are joined by a later
+         * Stop or by the destructor, so the scheduler must not be destroyed from a callback.
+         */
+        void
+        Stop();
+
+        /**
+         * @return The number of scheduled tasks, without the cancelled ones.
+         */
+        [[nodiscard]] std::size_t
+        GetNumPending() const;
+
+        /**
+         * @return The jitter of all runs, in microseconds.
+         */
+        [[nodiscard]] const LatencyHistogram &
+        GetJitterHistogram() const {
+            return m_jitter_histogram_;
+        }
+
+    private:
+        void
+        Push(const std::shared_ptr<Task> &task);
+
+        void
+        PopTop();
+
+        void
+        WorkerLoop();
+    };
+
+    /**
+     * One-shot timer running on Scheduler::GetDefault(), so a Start does not spawn a thread. All
+     * timers share the single worker of that scheduler: a slow callback delays the callbacks of
+     * the other timers, which should hand long work over to another thread.
+     */
     class Timer {
 
         std::atomic<bool> m_active_;
-        bool m_triggered_ = false;
-        std::optional<std::thread> m_timer_thread_;
-        std::mutex m_mutex_;
-        std::condition_variable m_cv_;
+        std::atomic<bool> m_triggered_ = false;
+        Scheduler::Handle m_handle_;
 
     public:
         Timer()
@@ -31,34 +228,24 @@ namespace erl::common {
 
         void
         Start(const int interval_ms, const std::function<void()> &callback) {
-            if (m_timer_thread_.has_value()) { Reset(); }
+            if (m_handle_) { Reset(); }
 
             m_active_ = true;
-            m_timer_thread_ = std::thread([interval_ms, callback, this]() {
-                std::unique_lock<std::mutex> lock(m_mutex_);
-                if (m_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms), [this] {
-                        return !m_active_;
-                    })) {
-                    return;  // Timer was stopped
-                }
-                callback();  // Execute the callback function
-                m_triggered_ = true;
-                m_active_ = false;
-            });
+            m_handle_ = Scheduler::GetDefault().ScheduleAfter(
+                std::chrono::milliseconds(interval_ms),
+                [callback, this]() {
+                    callback();  // Execute the callback function
+                    m_triggered_ = true;
+                    m_active_ = false;
+                });
         }
 
         void
         Stop() {
-            if (!m_timer_thread_.has_value()) { return; }
-            {
-                const std::scoped_lock lock(m_mutex_);
-                m_active_ = false;
-            }
-            m_cv_.notify_all();  // Notify the timer thread to stop
-            if (m_timer_thread_->joinable()) {
-                m_timer_thread_->join();
-                m_timer_thread_ = std::nullopt;
-            }
+            if (!m_handle_) { return; }
+            m_handle_.Cancel();  // waits for a running callback
+            m_active_ = false;
+            m_handle_ = {};
         }
 
         void
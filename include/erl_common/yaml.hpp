@@ -9,6 +9,7 @@
 #include "opencv.hpp"
 #include "reflection.hpp"
 #include "ros.hpp"
+#include "serialization.hpp"
 #include "template_helper.hpp"
 #include "version_check.hpp"
 
@@ -105,12 +106,39 @@ namespace erl::common {
         void
         AsYamlFile(const std::string &yaml_file) const;
 
+        /**
+         * Write the parameters as a YAML string. If the stream is marked with
+         * serialization::Format::kBinarySchema and all members support it, the compact binary
+         * layout of serialization::WriteSchema is written instead.
+         */
         [[nodiscard]] bool
         Write(std::ostream &s) const;
 
+        /**
+         * Read the parameters written by Write in either layout.
+         */
         [[nodiscard]] bool
         Read(std::istream &s);
 
+        /**
+         * Hash of the members written by WriteSchemaBinary, including those of the base classes.
+         * 0 if some member is not supported by the binary layout.
+         */
+        [[nodiscard]] virtual std::uint64_t
+        GetSchemaBinaryHash() const {
+            return 0;
+        }
+
+        [[nodiscard]] virtual bool
+        WriteSchemaBinary(std::ostream & /*s*/) const {
+            return false;
+        }
+
+        [[nodiscard]] virtual bool
+        ReadSchemaBinary(std::istream & /*s*/) {
+            return false;
+        }
+
         /**
          *
          * @param args Command line arguments.
@@ -766,6 +794,56 @@ namespace erl::common {
             return schema_size_v<T>;
         }
 
+        /**
+         * Whether the members of T and its Yamlable bases can be written in the binary layout of
+         * serialization::WriteSchemaMembers instead of YAML.
+         */
+        static constexpr bool
+        HasSchemaBinary() {
+            if constexpr (std::is_base_of_v<YamlableBase, Base> &&
+                          !std::is_same_v<YamlableBase, Base>) {
+                if (!Base::HasSchemaBinary()) { return false; }
+            }
+            return serialization::kHasSerializableSchema<T>;
+        }
+
+        [[nodiscard]] std::uint64_t
+        GetSchemaBinaryHash() const override {
+            if constexpr (HasSchemaBinary()) {
+                std::uint64_t hash = serialization::kSchemaHashSeed;
+                if constexpr (!std::is_same_v<YamlableBase, Base>) {
+                    hash = Base::GetSchemaBinaryHash();
+                }
+                return serialization::GetSchemaHash<T>(hash);
+            } else {
+                return 0;
+            }
+        }
+
+        [[nodiscard]] bool
+        WriteSchemaBinary(std::ostream &s) const override {
+            if constexpr (HasSchemaBinary()) {
+                if constexpr (!std::is_same_v<YamlableBase, Base>) {
+                    if (!Base::WriteSchemaBinary(s)) { return false; }
+                }
+                return serialization::WriteSchemaMembers(s, *static_cast<const T *>(this));
+            } else {
+                return false;
+            }
+        }
+
+        [[nodiscard]] bool
+        ReadSchemaBinary(std::istream &s) override {
+            if constexpr (HasSchemaBinary()) {
+                if constexpr (!std::is_same_v<YamlableBase, Base>) {
+                    if (!Base::ReadSchemaBinary(s)) { return false; }
+                }
+                return serialization::ReadSchemaMembers(s, *static_cast<T *>(this));
+            } else {
+                return false;
+            }
+        }
+
         /**
          * Template specialization for YAML conversion of erl::common::Yamlable types.
          */
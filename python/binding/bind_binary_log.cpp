@@ -0,0 +1,72 @@
+#include "pybind11_erl_common.hpp"
+
+#include "erl_common/binary_log.hpp"
+
+using namespace erl::common;
+
+void
+BindBinaryLog(const py::module &m) {
+    py::class_<BinaryLog> log(m, "BinaryLog");
+    py::enum_<BinaryLog::ArgType>(log, "ArgType")
+        .value("kBool", BinaryLog::ArgType::kBool)
+        .value("kChar", BinaryLog::ArgType::kChar)
+        .value("kInt8", BinaryLog::ArgType::kInt8)
+        .value("kUInt8", BinaryLog::ArgType::kUInt8)
+        .value("kInt16", BinaryLog::ArgType::kInt16)
+        .value("kUInt16", BinaryLog::ArgType::kUInt16)
+        .value("kInt32", BinaryLog::ArgType::kInt32)
+        .value("kUInt32", BinaryLog::ArgType::kUInt32)
+        .value("kInt64", BinaryLog::ArgType::kInt64)
+        .value("kUInt64", BinaryLog::ArgType::kUInt64)
+        .value("kFloat", BinaryLog::ArgType::kFloat)
+        .value("kDouble", BinaryLog::ArgType::kDouble)
+        .value("kString", BinaryLog::ArgType::kString)
+        .export_values();
+    py::class_<BinaryLog::Format>(log, "Format")
+        .def_readonly("id", &BinaryLog::Format::id)
+        .def_readonly("level", &BinaryLog::Format::level)
+        .def_readonly("file", &BinaryLog::Format::file)
+        .def_readonly("line", &BinaryLog::Format::line)
+        .def_readonly("format", &BinaryLog::Format::format)
+        .def_readonly("arg_types", &BinaryLog::Format::arg_types);
+    log.def_static("close", &BinaryLog::Close)
+        .def_static(
+            "open",
+            [](const std::string &path,
+               const std::size_t ring_capacity,
+               const std::size_t dictionary_capacity) {
+                BinaryLog::Setting setting;
+                setting.ring_capacity = ring_capacity;
+                setting.dictionary_capacity = dictionary_capacity;
+                return BinaryLog::Open(path, setting);
+            },
+            py::arg("path"),
+            py::arg("ring_capacity") = BinaryLog::Setting().ring_capacity,
+            py::arg("dictionary_capacity") = BinaryLog::Setting().dictionary_capacity)
+        .def_static("is_open", &BinaryLog::IsOpen)
+        .def_static("flush", &BinaryLog::Flush)
+        .def_static("get_num_dropped_records", &BinaryLog::GetNumDroppedRecords);
+
+    py::class_<BinaryLogReader> reader(m, "BinaryLogReader");
+    py::class_<BinaryLogReader::Record>(reader, "Record")
+        .def_readonly("time_ns", &BinaryLogReader::Record::time_ns)
+        .def_readonly("format_id", &BinaryLogReader::Record::format_id)
+        .def_readonly("message", &BinaryLogReader::Record::message);
+    reader.def(py::init<>())
+        .def("open", &BinaryLogReader::Open, py::arg("path"))
+        .def_property_readonly("formats", &BinaryLogReader::GetFormats)
+        .def_property_readonly("records", &BinaryLogReader::GetRecords)
+        .def_property_readonly("num_dropped_records", &BinaryLogReader::GetNumDroppedRecords)
+        .def("to_string", &BinaryLogReader::ToString, py::arg("record"))
+        .def(
+            "decode",
+            [](const BinaryLogReader &self) {
+                std::vector<std::string> lines;
+                lines.reserve(self.GetRecords().size());
+                for (const auto &record: self.GetRecords()) {
+                    lines.push_back(self.ToString(record));
+                }
+                return lines;
+            },
+            "Records as lines of the text log.");
+}
@@ -0,0 +1,198 @@
+#include "pybind11_erl_common.hpp"
+
+#include "erl_common/columnar_log.hpp"
+
+using namespace erl::common;
+
+namespace {
+    /**
+     * Wrap a plain-encoded chunk in a read-only array over the mapped file, without a copy. The
+     * array holds a reference to the mapping, so it stays valid after the reader is closed.
+     * @return None if the chunk is not plain-encoded.
+     */
+    template<typename T>
+    py::object
+    ViewChunk(const ColumnarLogReader &reader, const std::size_t row_group, const long column) {
+        const MappedArray<T> view = reader.GetChunkView<T>(row_group, column);
+        if (!view.IsValid()) { return py::none(); }
+        py::capsule owner(new std::shared_ptr<const MappedFile>(view.GetFile()), [](void *p) {
+            delete static_cast<std::shared_ptr<const MappedFile> *>(p);
+        });
+        py::array_t<T> array(static_cast<py::ssize_t>(view.size()), view.data(), owner);
+        array.attr("flags").attr("writeable") = false;
+        return std::move(array);
+    }
+
+    /**
+     * View the column if the rows are one plain-encoded chunk in the mapped file, otherwise
+     * decode it into a buffer that is handed over to NumPy, without another copy.
+     */
+    template<typename T>
+    py::array
+    ReadColumnAsArray(
+        const ColumnarLogReader &reader,
+        const long column,
+        const std::vector<std::size_t> &row_groups) {
+        const std::size_t num_row_groups = reader.GetRowGroups().size();
+        for (const std::size_t row_group: row_groups) {
+            if (row_group >= num_row_groups) {
+                throw py::index_error(
+                    "Row group " + std::to_string(row_group) + " is out of range.");
+            }
+        }
+        if (row_groups.size() == 1 || (row_groups.empty() && num_row_groups == 1)) {
+            const std::size_t row_group = row_groups.empty() ? 0 : row_groups[0];
+            if (py::object view = ViewChunk<T>(reader, row_group, column); !view.is_none()) {
+                return view.cast<py::array>();
+            }
+        }
+        auto values = std::make_unique<std::vector<T>>(reader.CountRows(row_groups));
+        bool success;
+        {
+            py::gil_scoped_release release;
+            constexpr ColumnarLog::Type type = ColumnarLog::GetType<T>();
+            success = reader.ReadColumn(column, type, values->data(), row_groups);
+        }
+        if (!success) { throw std::runtime_error("Failed to read column."); }
+        const std::size_t size = values->size();
+        T *data = values->data();
+        py::capsule owner(values.release(), [](void *p) {
+            delete static_cast<std::vector<T> *>(p);
+        });
+        return py::array_t<T>(static_cast<py::ssize_t>(size), data, owner);
+    }
+
+    py::array
+    ReadColumn(
+        const ColumnarLogReader &reader,
+        const std::string &name,
+        const std::vector<std::size_t> &row_groups) {
+        const long column = reader.GetColumnIndex(name);
+        if (column < 0) { throw py::key_error(name); }
+        switch (reader.GetColumns()[column].type) {
+            case ColumnarLog::Type::kFloat64:
+                return ReadColumnAsArray<double>(reader, column, row_groups);
+            case ColumnarLog::Type::kFloat32:
+                return ReadColumnAsArray<float>(reader, column, row_groups);
+            case ColumnarLog::Type::kInt64:
+                return ReadColumnAsArray<std::int64_t>(reader, column, row_groups);
+            case ColumnarLog::Type::kInt32:
+                return ReadColumnAsArray<std::int32_t>(reader, column, row_groups);
+            case ColumnarLog::Type::kUInt8:
+                return ReadColumnAsArray<std::uint8_t>(reader, column, row_groups);
+        }
+        throw std::runtime_error("Unknown column type.");
+    }
+}  // namespace
+
+void
+BindColumnarLog(const py::module &m) {
+    py::class_<ColumnarLog> log(m, "ColumnarLog");
+    py::enum_<ColumnarLog::Type>(log, "Type")
+        .value("kFloat64", ColumnarLog::Type::kFloat64)
+        .value("kFloat32", ColumnarLog::Type::kFloat32)
+        .value("kInt64", ColumnarLog::Type::kInt64)
+        .value("kInt32", ColumnarLog::Type::kInt32)
+        .value("kUInt8", ColumnarLog::Type::kUInt8)
+        .export_values();
+    py::enum_<ColumnarLog::Encoding>(log, "Encoding")
+        .value("kPlain", ColumnarLog::Encoding::kPlain)
+        .value("kDelta", ColumnarLog::Encoding::kDelta)
+        .value("kRunLength", ColumnarLog::Encoding::kRunLength)
+        .export_values();
+    py::class_<ColumnarLog::Column>(log, "Column")
+        .def(
+            py::init([](std::string name, ColumnarLog::Type type, ColumnarLog::Encoding encoding) {
+                return ColumnarLog::Column{std::move(name), type, encoding};
+            }),
+            py::arg("name"),
+            py::arg("type") = ColumnarLog::Type::kFloat64,
+            py::arg("encoding") = ColumnarLog::Encoding::kPlain)
+        .def_readwrite("name", &ColumnarLog::Column::name)
+        .def_readwrite("type", &ColumnarLog::Column::type)
+        .def_readwrite("encoding", &ColumnarLog::Column::encoding);
+    py::class_<ColumnarLog::ColumnChunk>(log, "ColumnChunk")
+        .def_readonly("offset", &ColumnarLog::ColumnChunk::offset)
+        .def_readonly("size", &ColumnarLog::ColumnChunk::size)
+        .def_readonly("encoding", &ColumnarLog::ColumnChunk::encoding)
+        .def_readonly("min", &ColumnarLog::ColumnChunk::min)
+        .def_readonly("max", &ColumnarLog::ColumnChunk::max);
+    py::class_<ColumnarLog::RowGroup>(log, "RowGroup")
+        .def_readonly("first_row", &ColumnarLog::RowGroup::first_row)
+        .def_readonly("num_rows", &ColumnarLog::RowGroup::num_rows)
+        .def_readonly("chunks", &ColumnarLog::RowGroup::chunks);
+
+    py::class_<ColumnarLogWriter>(m, "ColumnarLogWriter")
+        .def(
+            py::init([](const std::size_t row_group_size) {
+                ColumnarLogWriter::Setting setting;
+                setting.row_group_size = row_group_size;
+                return std::make_unique<ColumnarLogWriter>(setting);
+            }),
+            py::arg("row_group_size") = 65536)
+        .def(
+            "open",
+            &ColumnarLogWriter::Open,
+            py::arg("path"),
+            py::arg("columns"),
+            py::arg("append") = false)
+        .def_property_readonly("is_open", &ColumnarLogWriter::IsOpen)
+        .def_property_readonly("columns", &ColumnarLogWriter::GetColumns)
+        .def_property_readonly("num_rows", &ColumnarLogWriter::GetNumRows)
+        .def(
+            "append_row",
+            [](ColumnarLogWriter &self, const std::vector<double> &values) {
+                if (values.size() != self.GetColumns().size()) {
+                    throw py::value_error("The number of values does not match the columns.");
+                }
+                self.AppendRow(values);
+            },
+            py::arg("values"))
+        .def(
+            "append_rows",
+            [](ColumnarLogWriter &self, const Eigen::Ref<const Eigen::MatrixXd> &rows) {
+                if (rows.cols() != static_cast<long>(self.GetColumns().size())) {
+                    throw py::value_error("The number of columns does not match.");
+                }
+                std::vector<double> values(rows.cols());
+                for (long i = 0; i < rows.rows(); ++i) {
+                    for (long j = 0; j < rows.cols(); ++j) { values[j] = rows(i, j); }
+                    self.AppendRow(values);
+                }
+            },
+            py::arg("rows"))
+        .def("flush", &ColumnarLogWriter::Flush)
+        .def("close", &ColumnarLogWriter::Close);
+
+    py::class_<ColumnarLogReader>(m, "ColumnarLogReader")
+        .def(py::init<>())
+        .def("open", &ColumnarLogReader::Open, py::arg("path"))
+        .def_property_readonly("is_open", &ColumnarLogReader::IsOpen)
+        .def_property_readonly("columns", &ColumnarLogReader::GetColumns)
+        .def_property_readonly("row_groups", &ColumnarLogReader::GetRowGroups)
+        .def_property_readonly("num_rows", &ColumnarLogReader::GetNumRows)
+        .def(
+            "filter_row_groups",
+            &ColumnarLogReader::FilterRowGroups,
+            py::arg("column"),
+            py::arg("lower"),
+            py::arg("upper"))
+        .def(
+            "read_column",
+            &ReadColumn,
+            py::arg("name"),
+            py::arg("row_groups") = std::vector<std::size_t>{})
+        .def(
+            "read_columns",
+            [](const ColumnarLogReader &self,
+               const std::vector<std::string> &names,
+               const std::vector<std::size_t> &row_groups) {
+                py::dict columns;
+                for (const std::string &name: names) {
+                    columns[py::str(name)] = ReadColumn(self, name, row_groups);
+                }
+                return columns;
+            },
+            py::arg("names"),
+            py::arg("row_groups") = std::vector<std::size_t>{});
+}
@@ -14,17 +14,47 @@ BindLogging(const py::module &m) {
         .value("kSilent", LoggingLevel::kSilent)
         .export_values();
     py::class_<Logging> logging(m, "Logging");
+    py::enum_<Logging::Overflow>(logging, "Overflow")
+        .value("kBlock", Logging::Overflow::kBlock)
+        .value("kDrop", Logging::Overflow::kDrop)
+        .value("kCount", Logging::Overflow::kCount)
+        .export_values();
+    py::enum_<Logging::TimeFormat>(logging, "TimeFormat")
+        .value("kSeconds", Logging::TimeFormat::kSeconds)
+        .value("kMicroseconds", Logging::TimeFormat::kMicroseconds)
+        .value("kMonotonic", Logging::TimeFormat::kMonotonic)
+        .export_values();
     logging.def_static("get_level", &Logging::GetLevel)
         .def_static("set_level", &Logging::SetLevel)
+        .def_static("get_time_format", &Logging::GetTimeFormat)
+        .def_static("set_time_format", &Logging::SetTimeFormat, py::arg("format"))
         .def_static("get_date_str", &Logging::GetDateStr)
         .def_static("get_time_str", &Logging::GetTimeStr)
         .def_static("get_date_time_str", &Logging::GetDateTimeStr)
         .def_static("get_time_stamp", &Logging::GetTimeStamp)
-        .def_static("info", &Logging::Info<std::string>, py::arg("msg"))
-        .def_static("debug", &Logging::Debug<std::string>, py::arg("msg"))
-        .def_static("warn", &Logging::Warn<std::string>, py::arg("msg"))
-        .def_static("error", &Logging::Error<std::string>, py::arg("msg"))
-        .def_static("fatal", &Logging::Fatal<std::string>, py::arg("msg"))
-        .def_static("success", &Logging::Success<std::string>, py::arg("msg"))
-        .def_static("failure", &Logging::Failure<std::string>, py::arg("msg"));
+        .def_static(
+            "start_async",
+            [](const std::size_t queue_capacity,
+               const Logging::Overflow overflow,
+               const long flush_interval_ms) {
+                Logging::AsyncSetting setting;
+                setting.queue_capacity = queue_capacity;
+                setting.overflow = overflow;
+                setting.flush_interval = std::chrono::milliseconds(flush_interval_ms);
+                Logging::StartAsync(setting);
+            },
+            py::arg("queue_capacity") = 1024,
+            py::arg("overflow") = Logging::Overflow::kCount,
+            py::arg("flush_interval_ms") = 1)
+        .def_static("stop_async", &Logging::StopAsync)
+        .def_static("is_async", &Logging::IsAsync)
+        .def_static("flush", &Logging::Flush)
+        .def_static("get_num_dropped_records", &Logging::GetNumDroppedRecords)
+        .def_static("info", &Logging::Info<const std::string &>, py::arg("msg"))
+        .def_static("debug", &Logging::Debug<const std::string &>, py::arg("msg"))
+        .def_static("warn", &Logging::Warn<const std::string &>, py::arg("msg"))
+        .def_static("error", &Logging::Error<const std::string &>, py::arg("msg"))
+        .def_static("fatal", &Logging::Fatal<const std::string &>, py::arg("msg"))
+        .def_static("success", &Logging::Success<const std::string &>, py::arg("msg"))
+        .def_static("failure", &Logging::Failure<const std::string &>, py::arg("msg"));
 }
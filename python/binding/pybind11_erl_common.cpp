@@ -12,6 +12,12 @@ BindStorage(py::module &m);
 void
 BindLogging(const py::module &m);
 
+void
+BindColumnarLog(const py::module &m);
+
+void
+BindBinaryLog(const py::module &m);
+
 PYBIND11_MODULE(PYBIND_MODULE_NAME, m) {
     m.doc() = "Python 3 Interface of erl_common";
     m.def("set_global_random_seed", &SetGlobalRandomSeed, py::arg("seed"));
@@ -19,4 +25,6 @@ PYBIND11_MODULE(PYBIND_MODULE_NAME, m) {
     BindYamlableBase(m);
     BindStorage(m);
     BindLogging(m);
+    BindColumnarLog(m);
+    BindBinaryLog(m);
 }
@@ -0,0 +1,76 @@
+#include "erl_common/binary_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace erl::common {
+
+    namespace {
+        int
+        ToMadvise(const MappedFile::Advice advice) {
+            switch (advice) {
+                case MappedFile::Advice::kNormal:
+                    return MADV_NORMAL;
+                case MappedFile::Advice::kSequential:
+                    return MADV_SEQUENTIAL;
+                case MappedFile::Advice::kRandom:
+                    return MADV_RANDOM;
+                case MappedFile::Advice::kWillNeed:
+                    return MADV_WILLNEED;
+                case MappedFile::Advice::kDontNeed:
+                    return MADV_DONTNEED;
+            }
+            return MADV_NORMAL;
+        }
+    }  // namespace
+
+    MappedFile::~MappedFile() {
+        if (m_data_ != nullptr) { ::munmap(const_cast<char *>(m_data_), m_size_); }
+    }
+
+    std::shared_ptr<const MappedFile>
+    MappedFile::Open(const std::string &path, const Advice advice) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            ERL_WARN("Failed to open {}: {}", path, std::strerror(errno));
+            return nullptr;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ERL_WARN("Failed to stat {}: {}", path, std::strerror(errno));
+            ::close(fd);
+            return nullptr;
+        }
+
+        std::shared_ptr<MappedFile> file(new MappedFile());
+        file->m_path_ = path;
+        file->m_size_ = static_cast<std::size_t>(st.st_size);
+        if (file->m_size_ > 0) {  // an empty file cannot be mapped
+            void *data = ::mmap(nullptr, file->m_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ERL_WARN("Failed to map {}: {}", path, std::strerror(errno));
+                ::close(fd);
+                return nullptr;
+            }
+            file->m_data_ = static_cast<const char *>(data);
+        }
+        ::close(fd);  // the mapping stays valid
+        if (advice != Advice::kNormal) { file->Advise(0, file->m_size_, advice); }
+        return file;
+    }
+
+    void
+    MappedFile::Advise(std::size_t offset, std::size_t length, const Advice advice) const {
+        if (m_data_ == nullptr || offset >= m_size_) { return; }
+        // madvise needs a page-aligned address
+        static const auto kPageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t aligned_offset = offset / kPageSize * kPageSize;
+        length = std::min(length, m_size_ - offset) + (offset - aligned_offset);
+        ::madvise(const_cast<char *>(m_data_) + aligned_offset, length, ToMadvise(advice));
+    }
+}  // namespace erl::common
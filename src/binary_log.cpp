@@ -0,0 +1,571 @@
+#include "erl_common/binary_log.hpp"
+
+#include "erl_common/binary_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <new>
+#include <variant>
+
+#ifdef ERL_USE_FMT
+    #include <fmt/args.h>
+#else
+    #include <sstream>
+#endif
+
+namespace erl::common {
+
+    namespace {
+        constexpr std::size_t kRecordHeaderSize = sizeof(BinaryLog::RecordHeader);
+
+        std::size_t
+        AlignTo8(const std::size_t size) {
+            return (size + 7) & ~static_cast<std::size_t>(7);
+        }
+
+        template<typename T>
+        void
+        AppendBytes(std::string &out, const T &value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        void
+        AppendString(std::string &out, const std::string &str) {
+            AppendBytes(out, static_cast<std::uint32_t>(str.size()));
+            out += str;
+        }
+
+        /**
+         * Bounds-checked cursor over the bytes of the file.
+         */
+        class ByteReader {
+            const char *m_ptr_;
+            const char *m_end_;
+
+        public:
+            ByteReader(const char *ptr, const std::size_t size)
+                : m_ptr_(ptr),
+                  m_end_(ptr + size) {}
+
+            template<typename T>
+            bool
+            Read(T &value) {
+                if (static_cast<std::size_t>(m_end_ - m_ptr_) < sizeof(T)) { return false; }
+                std::memcpy(&value, m_ptr_, sizeof(T));
+                m_ptr_ += sizeof(T);
+                return true;
+            }
+
+            bool
+            ReadString(std::string &str) {
+                std::uint32_t size = 0;
+                if (!Read(size) || static_cast<std::size_t>(m_end_ - m_ptr_) < size) {
+                    return false;
+                }
+                str.assign(m_ptr_, size);
+                m_ptr_ += size;
+                return true;
+            }
+        };
+
+        using ArgValue =
+            std::variant<bool, char, std::int64_t, std::uint64_t, float, double, std::string>;
+
+        template<typename T, typename Stored = T>
+        bool
+        ReadArg(ByteReader &reader, std::vector<ArgValue> &values) {
+            T value{};
+            if (!reader.Read(value)) { return false; }
+            values.emplace_back(static_cast<Stored>(value));
+            return true;
+        }
+
+        bool
+        ReadArgs(
+            ByteReader &reader,
+            const std::vector<BinaryLog::ArgType> &arg_types,
+            std::vector<ArgValue> &values) {
+            using ArgType = BinaryLog::ArgType;
+            for (const ArgType type: arg_types) {
+                bool success = false;
+                switch (type) {
+                    case ArgType::kBool:
+                        success = ReadArg<bool>(reader, values);
+                        break;
+                    case ArgType::kChar:
+                        success = ReadArg<char>(reader, values);
+                        break;
+                    case ArgType::kInt8:
+                        success = ReadArg<std::int8_t, std::int64_t>(reader, values);
+                        break;
+                    case ArgType::kUInt8:
+                        success = ReadArg<std::uint8_t, std::uint64_t>(reader, values);
+                        break;
+                    case ArgType::kInt16:
+                        success = ReadArg<std::int16_t, std::int64_t>(reader, values);
+                        break;
+                    case ArgType::kUInt16:
+                        success = ReadArg<std::uint16_t, std::uint64_t>(reader, values);
+                        break;
+                    case ArgType::kInt32:
+                        success = ReadArg<std::int32_t, std::int64_t>(reader, values);
+                        break;
+                    case ArgType::kUInt32:
+                        success = ReadArg<std::uint32_t, std::uint64_t>(reader, values);
+                        break;
+                    case ArgType::kInt64:
+                        success = ReadArg<std::int64_t>(reader, values);
+                        break;
+                    case ArgType::kUInt64:
+                        success = ReadArg<std::uint64_t>(reader, values);
+                        break;
+                    case ArgType::kFloat:
+                        success = ReadArg<float>(reader, values);
+                        break;
+                    case ArgType::kDouble:
+                        success = ReadArg<double>(reader, values);
+                        break;
+                    case ArgType::kString: {
+                        std::string str;
+                        success = reader.ReadString(str);
+                        if (success) { values.emplace_back(std::move(str)); }
+                        break;
+                    }
+                }
+                if (!success) { return false; }
+            }
+            return true;
+        }
+
+#ifdef ERL_USE_FMT
+        std::string
+        FormatMessage(const std::string &format, const std::vector<ArgValue> &values) {
+            fmt::dynamic_format_arg_store<fmt::format_context> store;
+            for (const ArgValue &value: values) {
+                std::visit([&store](const auto &v) { store.push_back(v); }, value);
+            }
+            try {
+                return fmt::vformat(format, store);
+            } catch (const fmt::format_error &e) {
+                return format + " [format error: " + e.what() + "]";
+            }
+        }
+#else
+        /**
+         * Replace the placeholders in order, ignoring the format specifications.
+         */
+        std::string
+        FormatMessage(const std::string &format, const std::vector<ArgValue> &values) {
+            std::ostringstream out;
+            out << std::boolalpha;
+            std::size_t next = 0;
+            for (std::size_t i = 0; i < format.size(); ++i) {
+                const char c = format[i];
+                if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+                    out << c;
+                    ++i;
+                } else if (c == '{') {
+                    const std::size_t close = format.find('}', i);
+                    if (close == std::string::npos) {
+                        out << format.substr(i);
+                        break;
+                    }
+                    if (next < values.size()) {
+                        std::visit([&out](const auto &v) { out << v; }, values[next++]);
+                    }
+                    i = close;
+                } else {
+                    out << c;
+                }
+            }
+            return out.str();
+        }
+#endif
+
+        const char *
+        GetLevelName(const LoggingLevel level) {
+            switch (level) {
+                case kDebug:
+                    return "DEBUG";
+                case kInfo:
+                    return "INFO";
+                case kWarn:
+                    return "WARN";
+                case kError:
+                    return "ERROR";
+                case kSilent:
+                    break;
+            }
+            return "UNKNOWN";
+        }
+    }  // namespace
+
+    struct BinaryLog::Sink {
+        std::mutex mutex{};  // guards the members and the ring
+        std::vector<Format> formats{};
+        int fd = -1;
+        char *data = nullptr;
+        std::size_t size = 0;
+        FileHeader *header = nullptr;
+        char *dictionary = nullptr;
+        char *ring = nullptr;
+        std::uint64_t ring_capacity = 0;
+        std::uint32_t num_formats_in_file = 0;
+        std::uint64_t reserved_end = 0;  // ring_head after the reserved record
+
+        static Sink &
+        Get() {
+            // not destroyed, log statements may run during the static destruction
+            static Sink *sink = new Sink();
+            return *sink;
+        }
+
+        bool
+        AppendFormat(const Format &format) {
+            std::string entry;
+            AppendBytes(entry, std::uint32_t{0});  // entry size, filled below
+            AppendBytes(entry, format.id);
+            AppendBytes(entry, format.line);
+            AppendBytes(entry, static_cast<std::uint8_t>(format.level));
+            AppendBytes(entry, static_cast<std::uint8_t>(format.arg_types.size()));
+            AppendBytes(entry, std::uint16_t{0});
+            for (const ArgType type: format.arg_types) { AppendBytes(entry, type); }
+            AppendString(entry, format.file);
+            AppendString(entry, format.format);
+            entry.resize(AlignTo8(entry.size()), '\0');
+            const auto entry_size = static_cast<std::uint32_t>(entry.size());
+            std::memcpy(entry.data(), &entry_size, sizeof(entry_size));
+
+            const std::uint64_t offset = header->dictionary_size.load(std::memory_order_relaxed);
+            if (offset + entry.size() > header->dictionary_capacity) { return false; }
+            std::memcpy(dictionary + offset, entry.data(), entry.size());
+            header->dictionary_size.store(offset + entry.size(), std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] std::uint64_t
+        GetRecordSize(const std::uint64_t offset) const {
+            const std::uint64_t remaining = ring_capacity - offset % ring_capacity;
+            if (remaining < kRecordHeaderSize) { return remaining; }  // implicit padding
+            RecordHeader record{};
+            std::memcpy(&record, ring + offset % ring_capacity, kRecordHeaderSize);
+            if (record.size < kRecordHeaderSize || record.size > remaining) { return remaining; }
+            return record.size;
+        }
+
+        /**
+         * Drop the oldest records until the ring has room up to end.
+         */
+        void
+        Evict(const std::uint64_t end) const {
+            std::uint64_t tail = header->ring_tail.load(std::memory_order_relaxed);
+            if (tail + ring_capacity >= end) { return; }
+            while (tail + ring_capacity < end) { tail += GetRecordSize(tail); }
+            header->ring_tail.store(tail, std::memory_order_release);
+        }
+
+        void
+        CloseFile() {
+            if (data == nullptr) { return; }
+            ::munmap(data, size);
+            ::close(fd);
+            fd = -1;
+            data = nullptr;
+            size = 0;
+            header = nullptr;
+            dictionary = nullptr;
+            ring = nullptr;
+            ring_capacity = 0;
+            num_formats_in_file = 0;
+        }
+    };
+
+    std::atomic<bool> BinaryLog::s_open_{false};
+
+    bool
+    BinaryLog::Open(const std::string &path, const Setting &setting) {
+        Sink &sink = Sink::Get();
+        const std::scoped_lock lock(sink.mutex);
+        s_open_.store(false, std::memory_order_relaxed);
+        sink.CloseFile();
+
+        const std::size_t dictionary_capacity = AlignTo8(setting.dictionary_capacity);
+        const std::size_t ring_capacity = AlignTo8(setting.ring_capacity);
+        if (ring_capacity < 4 * kRecordHeaderSize) {
+            ERL_WARN("The ring capacity {} of {} is too small.", setting.ring_capacity, path);
+            return false;
+        }
+        const std::size_t size = sizeof(FileHeader) + dictionary_capacity + ring_capacity;
+
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            ERL_WARN("Failed to open {}: {}", path, std::strerror(errno));
+            return false;
+        }
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ERL_WARN("Failed to resize {}: {}", path, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ERL_WARN("Failed to map {}: {}", path, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+
+        sink.fd = fd;
+        sink.data = static_cast<char *>(data);
+        sink.size = size;
+        sink.header = new (data) FileHeader{};
+        std::memcpy(sink.header->magic, kMagic, sizeof(kMagic));
+        sink.header->version = kVersion;
+        sink.header->dictionary_capacity = dictionary_capacity;
+        sink.header->ring_capacity = ring_capacity;
+        sink.dictionary = sink.data + sizeof(FileHeader);
+        sink.ring = sink.dictionary + dictionary_capacity;
+        sink.ring_capacity = ring_capacity;
+        for (const Format &format: sink.formats) {
+            if (!sink.AppendFormat(format)) { break; }
+            ++sink.num_formats_in_file;
+        }
+        s_open_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void
+    BinaryLog::Close() {
+        Sink &sink = Sink::Get();
+        const std::scoped_lock lock(sink.mutex);
+        s_open_.store(false, std::memory_order_relaxed);
+        sink.CloseFile();
+    }
+
+    void
+    BinaryLog::Flush() {
+        Sink &sink = Sink::Get();
+        const std::scoped_lock lock(sink.mutex);
+        if (sink.data == nullptr) { return; }
+        if (::msync(sink.data, sink.size, MS_SYNC) != 0) {
+            ERL_WARN("Failed to flush the binary log: {}", std::strerror(errno));
+        }
+    }
+
+    std::uint64_t
+    BinaryLog::GetNumDroppedRecords() {
+        Sink &sink = Sink::Get();
+        const std::scoped_lock lock(sink.mutex);
+        if (sink.header == nullptr) { return 0; }
+        return sink.header->num_dropped_records.load(std::memory_order_relaxed);
+    }
+
+    std::uint32_t
+    BinaryLog::RegisterFormat(Site &site, const char *format, std::vector<ArgType> arg_types) {
+        Sink &sink = Sink::Get();
+        const std::scoped_lock lock(sink.mutex);
+        // another thread may have registered the site meanwhile
+        std::uint32_t format_id = site.format_id.load(std::memory_order_relaxed);
+        if (format_id != Site::kUnregistered) { return format_id; }
+
+        format_id = static_cast<std::uint32_t>(sink.formats.size());
+        Format &entry = sink.formats.emplace_back();
+        entry.id = format_id;
+        entry.level = site.level;
+        entry.file = site.file;
+        entry.line = static_cast<std::uint32_t>(site.line);
+        entry.format = format;
+        entry.arg_types = std::move(arg_types);
+        if (sink.header != nullptr && sink.num_formats_in_file == format_id) {
+            if (sink.AppendFormat(entry)) {
+                ++sink.num_formats_in_file;
+            } else {
+                ERL_WARN(
+                    "The dictionary of the binary log is full, {}:{} is dropped.",
+                    site.file,
+                    site.line);
+            }
+        }
+        site.format_id.store(format_id, std::memory_order_release);
+        return format_id;
+    }
+
+    char *
+    BinaryLog::Reserve(
+        const std::uint32_t format_id,
+        const std::int64_t time_ns,
+        const std::size_t payload_size) {
+        Sink &sink = Sink::Get();
+        sink.mutex.lock();
+        if (sink.header == nullptr) {
+            sink.mutex.unlock();
+            return nullptr;
+        }
+        const std::uint64_t size = AlignTo8(kRecordHeaderSize + payload_size);
+        if (format_id >= sink.num_formats_in_file || size > sink.ring_capacity / 2) {
+            sink.header->num_dropped_records.fetch_add(1, std::memory_order_relaxed);
+            sink.mutex.unlock();
+            return nullptr;
+        }
+
+        std::uint64_t head = sink.header->ring_head.load(std::memory_order_relaxed);
+        std::uint64_t pos = head % sink.ring_capacity;
+        const std::uint64_t remaining = sink.ring_capacity - pos;
+        if (remaining < size) {  // the record does not fit before the end, pad and wrap around
+            sink.Evict(head + remaining);
+            if (remaining >= kRecordHeaderSize) {
+                const RecordHeader padding{static_cast<std::uint32_t>(remaining), kPaddingId, 0};
+                std::memcpy(sink.ring + pos, &padding, kRecordHeaderSize);
+            }
+            head += remaining;
+            pos = 0;
+        }
+        sink.Evict(head + size);
+        const RecordHeader record{static_cast<std::uint32_t>(size), format_id, time_ns};
+        std::memcpy(sink.ring + pos, &record, kRecordHeaderSize);
+        sink.reserved_end = head + size;
+        return sink.ring + pos + kRecordHeaderSize;
+    }
+
+    void
+    BinaryLog::Commit() {
+        Sink &sink = Sink::Get();
+        sink.header->ring_head.store(sink.reserved_end, std::memory_order_release);
+        sink.mutex.unlock();
+    }
+
+    bool
+    BinaryLogReader::Open(const std::string &path) {
+        m_formats_.clear();
+        m_records_.clear();
+        m_num_dropped_records_ = 0;
+
+        const std::shared_ptr<const MappedFile> file = MappedFile::Open(path);
+        if (file == nullptr) { return false; }
+        using FileHeader = BinaryLog::FileHeader;
+        if (file->GetSize() < sizeof(FileHeader) ||
+            std::memcmp(file->GetData(), BinaryLog::kMagic, sizeof(BinaryLog::kMagic)) != 0) {
+            ERL_WARN("{} is not a binary log.", path);
+            return false;
+        }
+        const auto *header = reinterpret_cast<const FileHeader *>(file->GetData());
+        if (header->version != BinaryLog::kVersion) {
+            ERL_WARN("Binary log version {} of {} is not supported.", header->version, path);
+            return false;
+        }
+        const std::uint64_t dictionary_capacity = header->dictionary_capacity;
+        const std::uint64_t ring_capacity = header->ring_capacity;
+        if (file->GetSize() != sizeof(FileHeader) + dictionary_capacity + ring_capacity) {
+            ERL_WARN("{} is truncated.", path);
+            return false;
+        }
+        m_num_dropped_records_ = header->num_dropped_records.load(std::memory_order_relaxed);
+
+        // dictionary
+        const char *dictionary = file->GetData() + sizeof(FileHeader);
+        const std::uint64_t dictionary_size =
+            std::min(header->dictionary_size.load(std::memory_order_acquire), dictionary_capacity);
+        std::uint64_t offset = 0;
+        while (offset < dictionary_size) {
+            ByteReader reader(dictionary + offset, dictionary_size - offset);
+            std::uint32_t entry_size = 0;
+            std::uint8_t level = 0;
+            std::uint8_t num_args = 0;
+            std::uint16_t reserved = 0;
+            BinaryLog::Format &format = m_formats_.emplace_back();
+            bool success = reader.Read(entry_size) && reader.Read(format.id) &&
+                           reader.Read(format.line) && reader.Read(level) &&
+                           reader.Read(num_args) && reader.Read(reserved);
+            format.level = static_cast<LoggingLevel>(level);
+            format.arg_types.resize(num_args);
+            for (std::uint8_t i = 0; success && i < num_args; ++i) {
+                success = reader.Read(format.arg_types[i]);
+            }
+            success = success && reader.ReadString(format.file) &&
+                      reader.ReadString(format.format);
+            if (!success || entry_size == 0 || format.id != m_formats_.size() - 1) {
+                ERL_WARN("The dictionary of {} is corrupted at {}.", path, offset);
+                m_formats_.pop_back();
+                break;
+            }
+            offset += entry_size;
+        }
+
+        // ring, from the oldest record to the newest
+        const char *ring = dictionary + dictionary_capacity;
+        const std::uint64_t head = header->ring_head.load(std::memory_order_acquire);
+        std::uint64_t tail = header->ring_tail.load(std::memory_order_acquire);
+        if (tail > head || head - tail > ring_capacity) {
+            ERL_WARN("The ring of {} is corrupted.", path);
+            return false;
+        }
+        std::vector<ArgValue> values;
+        while (tail < head) {
+            const std::uint64_t pos = tail % ring_capacity;
+            const std::uint64_t remaining = ring_capacity - pos;
+            if (remaining < kRecordHeaderSize) {
+                tail += remaining;
+                continue;
+            }
+            BinaryLog::RecordHeader record{};
+            std::memcpy(&record, ring + pos, kRecordHeaderSize);
+            if (record.size < kRecordHeaderSize || record.size > remaining ||
+                tail + record.size > head) {
+                ERL_WARN("The ring of {} is corrupted at {}.", path, tail);
+                break;
+            }
+            tail += record.size;
+            if (record.format_id == BinaryLog::kPaddingId) { continue; }
+            if (record.format_id >= m_formats_.size()) {
+                ERL_WARN("Unknown format {} in {}.", record.format_id, path);
+                continue;
+            }
+            const BinaryLog::Format &format = m_formats_[record.format_id];
+            ByteReader reader(ring + pos + kRecordHeaderSize, record.size - kRecordHeaderSize);
+            values.clear();
+            Record &decoded = m_records_.emplace_back();
+            decoded.time_ns = record.time_ns;
+            decoded.format_id = record.format_id;
+            if (ReadArgs(reader, format.arg_types, values)) {
+                decoded.message = FormatMessage(format.format, values);
+            } else {
+                decoded.message = format.format + " [truncated arguments]";
+            }
+        }
+        return true;
+    }
+
+    std::string
+    BinaryLogReader::ToString(const Record &record) const {
+        const std::time_t seconds = record.time_ns / 1000000000;
+        const auto microseconds = static_cast<long>(record.time_ns % 1000000000 / 1000);
+        std::tm tm{};
+        localtime_r(&seconds, &tm);
+        char time_str[32];
+        const std::size_t n = std::strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm);
+        std::snprintf(time_str + n, sizeof(time_str) - n, ".%06ld", microseconds);
+
+        std::string out = "[";
+        out += time_str;
+        out += "][";
+        if (record.format_id < m_formats_.size()) {
+            const BinaryLog::Format &format = m_formats_[record.format_id];
+            out += GetLevelName(format.level);
+            out += "]: ";
+            out += format.file;
+            out += ':';
+            out += std::to_string(format.line);
+            out += ": ";
+        } else {
+            out += "UNKNOWN]: ";
+        }
+        out += record.message;
+        return out;
+    }
+}  // namespace erl::common
@@ -0,0 +1,170 @@
+#include "erl_common/checkpoint_writer.hpp"
+
+#include "erl_common/logging.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+
+namespace erl::common::serialization {
+
+    namespace {
+        bool
+        SyncPath(const std::string &path, const int flags) {
+            const int fd = ::open(path.c_str(), flags);
+            if (fd < 0) { return false; }
+            const bool success = ::fsync(fd) == 0;
+            ::close(fd);
+            return success;
+        }
+    }  // namespace
+
+    CheckpointWriter::CheckpointWriter()
+        : m_thread_([this] { Run(); }) {}
+
+    CheckpointWriter::~CheckpointWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex_);
+            m_stop_ = true;
+        }
+        m_queue_cv_.notify_all();
+        if (m_thread_.joinable()) { m_thread_.join(); }
+    }
+
+    CheckpointWriter::Ticket
+    CheckpointWriter::Submit(std::string filename, WriteFileFunction write_file) {
+        auto job = std::make_shared<Job>();
+        job->filename = std::move(filename);
+        job->write_file = std::move(write_file);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex_);
+            m_queue_.push_back(job);
+            ++m_metrics_.num_submitted;
+            m_metrics_.max_queue_depth = std::max(m_metrics_.max_queue_depth, m_queue_.size());
+        }
+        m_queue_cv_.notify_one();
+        return Ticket(std::move(job));
+    }
+
+    void
+    CheckpointWriter::WaitAll() {
+        std::unique_lock<std::mutex> lock(m_mutex_);
+        m_idle_cv_.wait(lock, [this] { return m_queue_.empty() && !m_busy_; });
+    }
+
+    std::size_t
+    CheckpointWriter::GetQueueDepth() const {
+        std::lock_guard<std::mutex> lock(m_mutex_);
+        return m_queue_.size();
+    }
+
+    CheckpointWriter::Metrics
+    CheckpointWriter::GetMetrics() const {
+        std::lock_guard<std::mutex> lock(m_mutex_);
+        Metrics metrics = m_metrics_;
+        metrics.queue_depth = m_queue_.size();
+        return metrics;
+    }
+
+    bool
+    CheckpointWriter::WriteAtomically(
+        const std::string &filename,
+        const WriteFileFunction &write_file,
+        std::uint64_t &bytes) {
+        static std::atomic<std::uint64_t> s_counter{0};
+
+        const std::filesystem::path path = std::filesystem::absolute(filename);
+        const std::filesystem::path folder = path.parent_path();
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+        if (ec) {
+            ERL_WARN("Failed to create directory {}: {}", folder.string(), ec.message());
+            return false;
+        }
+        // unique per process and call, so concurrent writers never share a temporary file
+        const std::string tmp_path = fmt::format(
+            "{}.tmp.{}.{}",
+            path.string(),
+            static_cast<long>(::getpid()),
+            s_counter.fetch_add(1));
+
+        bool success = false;
+        try {
+            success = write_file(tmp_path);
+        } catch (const std::exception &e) {
+            ERL_WARN("Exception while writing {}: {}", tmp_path, e.what());
+        }
+        if (success) {
+            bytes = std::filesystem::file_size(tmp_path, ec);
+            success = !ec && SyncPath(tmp_path, O_RDONLY);
+            if (!success) { ERL_WARN("Failed to flush {} to disk.", tmp_path); }
+        }
+        if (success) {
+            std::filesystem::rename(tmp_path, path, ec);  // atomic on POSIX file systems
+            success = !ec;
+            if (!success) {
+                ERL_WARN("Failed to rename {} to {}: {}", tmp_path, path.string(), ec.message());
+            }
+        }
+        if (!success) {
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+        // persist the new directory entry
+        SyncPath(folder.string(), O_RDONLY | O_DIRECTORY);
+        return true;
+    }
+
+    void
+    CheckpointWriter::Run() {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex_);
+                m_queue_cv_.wait(lock, [this] { return m_stop_ || !m_queue_.empty(); });
+                if (m_queue_.empty()) { return; }  // stopped and drained
+                job = std::move(m_queue_.front());
+                m_queue_.pop_front();
+                m_busy_ = true;
+            }
+            {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->status = Status::kRunning;
+            }
+
+            const auto t0 = std::chrono::steady_clock::now();
+            std::uint64_t bytes = 0;
+            const bool success = WriteAtomically(job->filename, job->write_file, bytes);
+            job->write_file = nullptr;  // release the snapshot
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+                    .count();
+            if (!success) { ERL_WARN("Failed to write checkpoint {}.", job->filename); }
+
+            {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->status = success ? Status::kSucceeded : Status::kFailed;
+                job->bytes = success ? bytes : 0;
+                job->duration_ms = duration_ms;
+            }
+            job->cv.notify_all();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex_);
+                if (success) {
+                    ++m_metrics_.num_succeeded;
+                    m_metrics_.total_bytes += bytes;
+                    m_metrics_.last_bytes = bytes;
+                } else {
+                    ++m_metrics_.num_failed;
+                }
+                m_metrics_.total_duration_ms += duration_ms;
+                m_metrics_.last_duration_ms = duration_ms;
+                m_metrics_.max_duration_ms = std::max(m_metrics_.max_duration_ms, duration_ms);
+                m_busy_ = false;
+            }
+            m_idle_cv_.notify_all();
+        }
+    }
+}  // namespace erl::common::serialization
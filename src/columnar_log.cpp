@@ -0,0 +1,631 @@
+#include "erl_common/columnar_log.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace erl::common {
+
+    namespace {
+        constexpr std::size_t kAlignment = 8;
+
+        std::size_t
+        AlignUp(const std::size_t n) {
+            return (n + kAlignment - 1) / kAlignment * kAlignment;
+        }
+
+        template<typename T>
+        void
+        PutRaw(std::string &out, const T &value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        T
+        GetRaw(const char *p) {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        void
+        PutVarint(std::string &out, std::uint64_t v) {
+            while (v >= 0x80) {
+                out.push_back(static_cast<char>(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<char>(v));
+        }
+
+        bool
+        GetVarint(const char *&p, const char *end, std::uint64_t &v) {
+            v = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                const auto byte = static_cast<std::uint8_t>(*p++);
+                v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) { return true; }
+            }
+            return false;
+        }
+
+        template<typename T>
+        using BitsOf = std::conditional_t<
+            sizeof(T) == 8,
+            std::uint64_t,
+            std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint8_t>>;
+
+        template<typename T>
+        void
+        EncodeDelta(const T *values, const std::size_t n, std::string &out) {
+            if constexpr (std::is_floating_point_v<T>) {
+                // consecutive samples share sign, exponent and leading mantissa bits, so the XOR
+                // with the previous value has many leading zeros
+                BitsOf<T> prev = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    BitsOf<T> bits;
+                    std::memcpy(&bits, values + i, sizeof(T));
+                    PutVarint(out, bits ^ prev);
+                    prev = bits;
+                }
+            } else {
+                std::uint64_t prev = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    const auto u = static_cast<std::uint64_t>(static_cast<std::int64_t>(values[i]));
+                    const auto delta = static_cast<std::int64_t>(u - prev);
+                    PutVarint(
+                        out,
+                        (static_cast<std::uint64_t>(delta) << 1) ^
+                            static_cast<std::uint64_t>(delta >> 63));  // zigzag
+                    prev = u;
+                }
+            }
+        }
+
+        template<typename T>
+        bool
+        DecodeDelta(const char *p, const char *end, const std::size_t n, T *values) {
+            if constexpr (std::is_floating_point_v<T>) {
+                BitsOf<T> prev = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::uint64_t x;
+                    if (!GetVarint(p, end, x)) { return false; }
+                    prev ^= static_cast<BitsOf<T>>(x);
+                    std::memcpy(values + i, &prev, sizeof(T));
+                }
+            } else {
+                std::uint64_t prev = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::uint64_t zigzag;
+                    if (!GetVarint(p, end, zigzag)) { return false; }
+                    const std::uint64_t delta = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+                    prev += delta;
+                    values[i] = static_cast<T>(static_cast<std::int64_t>(prev));
+                }
+            }
+            return p == end;
+        }
+
+        template<typename T>
+        void
+        EncodeRunLength(const T *values, const std::size_t n, std::string &out) {
+            std::size_t i = 0;
+            while (i < n) {
+                std::size_t j = i + 1;  // bitwise comparison, so NaN runs are detected
+                while (j < n && std::memcmp(values + j, values + i, sizeof(T)) == 0) { ++j; }
+                PutVarint(out, j - i);
+                PutRaw(out, values[i]);
+                i = j;
+            }
+        }
+
+        template<typename T>
+        bool
+        DecodeRunLength(const char *p, const char *end, const std::size_t n, T *values) {
+            std::size_t i = 0;
+            while (i < n) {
+                std::uint64_t run;
+                if (!GetVarint(p, end, run) || run == 0 || run > n - i) { return false; }
+                if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) { return false; }
+                const T value = GetRaw<T>(p);
+                p += sizeof(T);
+                std::fill(values + i, values + i + run, value);
+                i += run;
+            }
+            return p == end;
+        }
+
+        template<typename T>
+        void
+        EncodeTyped(
+            const ColumnarLog::Encoding encoding,
+            const T *values,
+            const std::size_t n,
+            std::string &out,
+            ColumnarLog::ColumnChunk &chunk) {
+            chunk.encoding = encoding;
+            switch (encoding) {
+                case ColumnarLog::Encoding::kPlain:
+                    out.append(reinterpret_cast<const char *>(values), n * sizeof(T));
+                    break;
+                case ColumnarLog::Encoding::kDelta:
+                    EncodeDelta(values, n, out);
+                    break;
+                case ColumnarLog::Encoding::kRunLength:
+                    EncodeRunLength(values, n, out);
+                    break;
+            }
+
+            if constexpr (std::is_floating_point_v<T>) {
+                T min = std::numeric_limits<T>::quiet_NaN();
+                T max = std::numeric_limits<T>::quiet_NaN();
+                for (std::size_t i = 0; i < n; ++i) {
+                    const T v = values[i];
+                    if (std::isnan(v)) { continue; }
+                    if (!(v >= min)) { min = v; }  // also replaces the initial NaN
+                    if (!(v <= max)) { max = v; }
+                }
+                chunk.min = static_cast<double>(min);
+                chunk.max = static_cast<double>(max);
+            } else {
+                T min = n > 0 ? values[0] : T(0);
+                T max = min;
+                for (std::size_t i = 1; i < n; ++i) {
+                    min = std::min(min, values[i]);
+                    max = std::max(max, values[i]);
+                }
+                chunk.min_int = static_cast<std::int64_t>(min);
+                chunk.max_int = static_cast<std::int64_t>(max);
+                chunk.min = static_cast<double>(min);
+                chunk.max = static_cast<double>(max);
+            }
+        }
+
+        template<typename T>
+        bool
+        DecodeTyped(
+            const ColumnarLog::Encoding encoding,
+            const char *data,
+            const std::size_t size,
+            const std::size_t n,
+            T *values) {
+            switch (encoding) {
+                case ColumnarLog::Encoding::kPlain:
+                    if (size != n * sizeof(T)) { return false; }
+                    std::memcpy(values, data, size);
+                    return true;
+                case ColumnarLog::Encoding::kDelta:
+                    return DecodeDelta(data, data + size, n, values);
+                case ColumnarLog::Encoding::kRunLength:
+                    return DecodeRunLength(data, data + size, n, values);
+            }
+            return false;
+        }
+
+        /**
+         * Call func(T *) with the buffer reinterpreted as the given type.
+         */
+        template<typename Func>
+        decltype(auto)
+        VisitType(const ColumnarLog::Type type, void *data, Func &&func) {
+            switch (type) {
+                case ColumnarLog::Type::kFloat64:
+                    return func(static_cast<double *>(data));
+                case ColumnarLog::Type::kFloat32:
+                    return func(static_cast<float *>(data));
+                case ColumnarLog::Type::kInt64:
+                    return func(static_cast<std::int64_t *>(data));
+                case ColumnarLog::Type::kInt32:
+                    return func(static_cast<std::int32_t *>(data));
+                case ColumnarLog::Type::kUInt8:
+                    return func(static_cast<std::uint8_t *>(data));
+            }
+            throw std::invalid_argument("Unknown column type.");
+        }
+
+        /**
+         * Parse the schema at the beginning of a log.
+         * @return Size of the schema, 0 if it is malformed.
+         */
+        std::size_t
+        ParseSchema(
+            const char *data,
+            const std::size_t size,
+            std::vector<ColumnarLog::Column> &columns) {
+            constexpr std::size_t kFixedSize = sizeof(ColumnarLog::kMagic) + 8;
+            if (size < kFixedSize ||
+                std::memcmp(data, ColumnarLog::kMagic, sizeof(ColumnarLog::kMagic)) != 0) {
+                return 0;
+            }
+            const char *p = data + sizeof(ColumnarLog::kMagic);
+            const char *end = data + size;
+            if (GetRaw<std::uint32_t>(p) != ColumnarLog::kVersion) { return 0; }
+            const auto num_columns = GetRaw<std::uint32_t>(p + 4);
+            p += 8;
+            columns.clear();
+            for (std::uint32_t i = 0; i < num_columns; ++i) {
+                if (end - p < 4) { return 0; }
+                ColumnarLog::Column &column = columns.emplace_back();
+                column.type = static_cast<ColumnarLog::Type>(p[0]);
+                column.encoding = static_cast<ColumnarLog::Encoding>(p[1]);
+                const auto name_size = GetRaw<std::uint16_t>(p + 2);
+                p += 4;
+                if (column.type > ColumnarLog::Type::kUInt8 || end - p < name_size) { return 0; }
+                column.name.assign(p, name_size);
+                p += name_size;
+            }
+            const std::size_t schema_size = AlignUp(p - data);
+            return schema_size <= size ? schema_size : 0;
+        }
+    }  // namespace
+
+    std::size_t
+    ColumnarLog::GetTypeSize(const Type type) {
+        switch (type) {
+            case Type::kFloat64:
+            case Type::kInt64:
+                return 8;
+            case Type::kFloat32:
+            case Type::kInt32:
+                return 4;
+            case Type::kUInt8:
+                return 1;
+        }
+        return 0;
+    }
+
+    const char *
+    ColumnarLog::GetTypeName(const Type type) {
+        switch (type) {
+            case Type::kFloat64:
+                return "float64";
+            case Type::kFloat32:
+                return "float32";
+            case Type::kInt64:
+                return "int64";
+            case Type::kInt32:
+                return "int32";
+            case Type::kUInt8:
+                return "uint8";
+        }
+        return "unknown";
+    }
+
+    void
+    ColumnarLog::EncodeChunk(
+        const Type type,
+        const Encoding encoding,
+        const char *values,
+        const std::size_t n,
+        std::string &out,
+        ColumnChunk &chunk) {
+        VisitType(type, const_cast<char *>(values), [&](auto *typed_values) {
+            EncodeTyped(encoding, typed_values, n, out, chunk);
+        });
+    }
+
+    bool
+    ColumnarLog::DecodeChunk(
+        const Type type,
+        const Encoding encoding,
+        const char *data,
+        const std::size_t size,
+        const std::size_t n,
+        const Type out_type,
+        char *out) {
+        if (type == out_type) {
+            return VisitType(type, out, [&](auto *typed_out) {
+                return DecodeTyped(encoding, data, size, n, typed_out);
+            });
+        }
+        // decode to the stored type, then convert
+        std::vector<char> buffer(n * GetTypeSize(type));
+        return VisitType(type, buffer.data(), [&](auto *typed_buffer) {
+            if (!DecodeTyped(encoding, data, size, n, typed_buffer)) { return false; }
+            VisitType(out_type, out, [&](auto *typed_out) {
+                using OutType = std::remove_pointer_t<decltype(typed_out)>;
+                for (std::size_t i = 0; i < n; ++i) {
+                    typed_out[i] = static_cast<OutType>(typed_buffer[i]);
+                }
+            });
+            return true;
+        });
+    }
+
+    bool
+    ColumnarLogWriter::Open(
+        const std::string &path,
+        std::vector<ColumnarLog::Column> columns,
+        const bool append) {
+        Close();
+        ERL_ASSERTM(!columns.empty(), "No columns for {}.", path);
+        m_num_rows_ = 0;
+        if (append && std::filesystem::exists(path)) {
+            ColumnarLogReader reader;
+            if (!reader.Open(path)) { return false; }
+            if (reader.GetColumns() != columns) {
+                ERL_WARN("The columns of {} do not match.", path);
+                return false;
+            }
+            m_num_rows_ = reader.GetNumRows();
+            // drop a truncated row group left by an interrupted write
+            const std::size_t data_end = reader.GetDataEnd();
+            if (data_end < std::filesystem::file_size(path)) {
+                ERL_WARN("Dropping a truncated row group at the end of {}.", path);
+                std::filesystem::resize_file(path, data_end);
+            }
+            m_ofs_.open(path, std::ios::binary | std::ios::app);
+            if (!m_ofs_.is_open()) { return false; }
+        } else {
+            m_ofs_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+            if (!m_ofs_.is_open()) { return false; }
+            std::string schema(ColumnarLog::kMagic, sizeof(ColumnarLog::kMagic));
+            PutRaw(schema, ColumnarLog::kVersion);
+            PutRaw(schema, static_cast<std::uint32_t>(columns.size()));
+            for (const ColumnarLog::Column &column: columns) {
+                ERL_ASSERTM(column.name.size() <= UINT16_MAX, "Column name is too long.");
+                schema.push_back(static_cast<char>(column.type));
+                schema.push_back(static_cast<char>(column.encoding));
+                PutRaw(schema, static_cast<std::uint16_t>(column.name.size()));
+                schema.append(column.name);
+            }
+            schema.resize(AlignUp(schema.size()), '\0');
+            m_ofs_.write(schema.data(), static_cast<std::streamsize>(schema.size()));
+        }
+        m_path_ = path;
+        m_columns_ = std::move(columns);
+        m_buffers_.assign(m_columns_.size(), {});
+        for (std::size_t i = 0; i < m_columns_.size(); ++i) {
+            m_buffers_[i].reserve(
+                m_setting_.row_group_size * ColumnarLog::GetTypeSize(m_columns_[i].type));
+        }
+        m_num_buffered_rows_ = 0;
+        return m_ofs_.good();
+    }
+
+    bool
+    ColumnarLogWriter::Flush() {
+        if (!m_ofs_.is_open()) { return false; }
+        if (m_num_buffered_rows_ == 0) { return m_ofs_.good(); }
+
+        const std::size_t num_columns = m_columns_.size();
+        std::vector<std::string> payloads(num_columns);
+        std::vector<ColumnarLog::ColumnChunk> chunks(num_columns);
+        const auto num_columns_long = static_cast<long>(num_columns);
+#pragma omp parallel for schedule(dynamic) if (m_setting_.parallel && num_columns > 1)
+        for (long i = 0; i < num_columns_long; ++i) {
+            ColumnarLog::EncodeChunk(
+                m_columns_[i].type,
+                m_columns_[i].encoding,
+                m_buffers_[i].data(),
+                m_num_buffered_rows_,
+                payloads[i],
+                chunks[i]);
+        }
+
+        std::size_t offset = AlignUp(
+            ColumnarLog::kRowGroupHeaderSize + num_columns * ColumnarLog::kChunkHeaderSize);
+        std::string header;
+        header.reserve(offset);
+        PutRaw(header, ColumnarLog::kRowGroupMagic);
+        PutRaw(header, static_cast<std::uint32_t>(num_columns));
+        PutRaw(header, static_cast<std::uint64_t>(m_num_buffered_rows_));
+        const std::size_t group_size_pos = header.size();
+        PutRaw(header, std::uint64_t{0});  // group size, filled below
+        for (std::size_t i = 0; i < num_columns; ++i) {
+            const ColumnarLog::ColumnChunk &chunk = chunks[i];
+            PutRaw(header, static_cast<std::uint64_t>(offset));
+            PutRaw(header, static_cast<std::uint64_t>(payloads[i].size()));
+            header.push_back(static_cast<char>(chunk.encoding));
+            header.append(7, '\0');
+            if (ColumnarLog::IsFloatingPoint(m_columns_[i].type)) {
+                PutRaw(header, chunk.min);
+                PutRaw(header, chunk.max);
+            } else {
+                PutRaw(header, chunk.min_int);
+                PutRaw(header, chunk.max_int);
+            }
+            offset = AlignUp(offset + payloads[i].size());
+        }
+        const auto group_size = static_cast<std::uint64_t>(offset);
+        std::memcpy(header.data() + group_size_pos, &group_size, sizeof(group_size));
+        header.resize(AlignUp(header.size()), '\0');
+
+        m_ofs_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        static const char kPadding[kAlignment] = {};
+        for (const std::string &payload: payloads) {
+            m_ofs_.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+            const std::size_t padding = AlignUp(payload.size()) - payload.size();
+            m_ofs_.write(kPadding, static_cast<std::streamsize>(padding));
+        }
+        m_ofs_.flush();
+
+        m_num_rows_ += m_num_buffered_rows_;
+        m_num_buffered_rows_ = 0;
+        for (std::vector<char> &buffer: m_buffers_) { buffer.clear(); }
+        if (!m_ofs_.good()) {
+            ERL_WARN("Failed to write a row group to {}.", m_path_);
+            return false;
+        }
+        return true;
+    }
+
+    void
+    ColumnarLogWriter::Close() {
+        if (!m_ofs_.is_open()) { return; }
+        Flush();
+        m_ofs_.close();
+    }
+
+    void
+    ColumnarLogWriter::EndRow() {
+        if (++m_num_buffered_rows_ >= m_setting_.row_group_size) { Flush(); }
+    }
+
+    bool
+    ColumnarLogReader::Open(const std::string &path) {
+        m_file_ = nullptr;
+        m_row_groups_.clear();
+        m_num_rows_ = 0;
+
+        std::shared_ptr<const MappedFile> file = MappedFile::Open(path);
+        if (file == nullptr) { return false; }
+        const char *data = file->GetData();
+        const std::size_t size = file->GetSize();
+        m_data_begin_ = ParseSchema(data, size, m_columns_);
+        if (m_data_begin_ == 0) {
+            ERL_WARN("{} is not a columnar log.", path);
+            return false;
+        }
+
+        // hop over the row groups, a truncated one ends the log
+        const std::size_t num_columns = m_columns_.size();
+        const std::size_t header_size =
+            ColumnarLog::kRowGroupHeaderSize + num_columns * ColumnarLog::kChunkHeaderSize;
+        std::size_t pos = m_data_begin_;
+        while (pos + header_size <= size) {
+            const char *p = data + pos;
+            if (GetRaw<std::uint32_t>(p) != ColumnarLog::kRowGroupMagic ||
+                GetRaw<std::uint32_t>(p + 4) != num_columns) {
+                break;
+            }
+            const auto group_size = GetRaw<std::uint64_t>(p + 16);
+            if (group_size < header_size || group_size > size - pos) { break; }
+            ColumnarLog::RowGroup &group = m_row_groups_.emplace_back();
+            group.first_row = m_num_rows_;
+            group.num_rows = GetRaw<std::uint64_t>(p + 8);
+            group.chunks.resize(num_columns);
+            bool valid = true;
+            for (std::size_t i = 0; i < num_columns; ++i) {
+                const char *q =
+                    p + ColumnarLog::kRowGroupHeaderSize + i * ColumnarLog::kChunkHeaderSize;
+                ColumnarLog::ColumnChunk &chunk = group.chunks[i];
+                const auto offset = GetRaw<std::uint64_t>(q);
+                chunk.size = GetRaw<std::uint64_t>(q + 8);
+                chunk.offset = pos + offset;
+                chunk.encoding = static_cast<ColumnarLog::Encoding>(q[16]);
+                if (ColumnarLog::IsFloatingPoint(m_columns_[i].type)) {
+                    chunk.min = GetRaw<double>(q + 24);
+                    chunk.max = GetRaw<double>(q + 32);
+                } else {
+                    chunk.min_int = GetRaw<std::int64_t>(q + 24);
+                    chunk.max_int = GetRaw<std::int64_t>(q + 32);
+                    chunk.min = static_cast<double>(chunk.min_int);
+                    chunk.max = static_cast<double>(chunk.max_int);
+                }
+                valid = valid && offset <= group_size && chunk.size <= group_size - offset &&
+                        chunk.encoding <= ColumnarLog::Encoding::kRunLength;
+                // plain chunks are viewed in place, so they must hold exactly num_rows values
+                if (valid && chunk.encoding == ColumnarLog::Encoding::kPlain) {
+                    const std::size_t type_size = ColumnarLog::GetTypeSize(m_columns_[i].type);
+                    valid = chunk.size % type_size == 0 &&
+                            chunk.size / type_size == group.num_rows;
+                }
+            }
+            if (!valid) {
+                m_row_groups_.pop_back();
+                break;
+            }
+            m_num_rows_ += group.num_rows;
+            pos += group_size;
+        }
+        m_data_end_ = pos;
+        if (pos != size) { ERL_WARN("Ignoring {} trailing bytes of {}.", size - pos, path); }
+        m_file_ = std::move(file);
+        return true;
+    }
+
+    long
+    ColumnarLogReader::GetColumnIndex(const std::string &name) const {
+        for (std::size_t i = 0; i < m_columns_.size(); ++i) {
+            if (m_columns_[i].name == name) { return static_cast<long>(i); }
+        }
+        return -1;
+    }
+
+    std::vector<std::size_t>
+    ColumnarLogReader::FilterRowGroups(
+        const std::string &column,
+        const double lower,
+        const double upper) const {
+        std::vector<std::size_t> row_groups;
+        const long index = GetColumnIndex(column);
+        if (index < 0) {
+            ERL_WARN("Column {} is not in the log.", column);
+            return row_groups;
+        }
+        for (std::size_t i = 0; i < m_row_groups_.size(); ++i) {
+            const ColumnarLog::ColumnChunk &chunk = m_row_groups_[i].chunks[index];
+            // a chunk of NaN only has NaN statistics and never matches
+            if (chunk.max >= lower && chunk.min <= upper) { row_groups.push_back(i); }
+        }
+        return row_groups;
+    }
+
+    std::uint64_t
+    ColumnarLogReader::CountRows(const std::vector<std::size_t> &row_groups) const {
+        if (row_groups.empty()) { return m_num_rows_; }
+        std::uint64_t num_rows = 0;
+        for (const std::size_t i: row_groups) {
+            if (i < m_row_groups_.size()) { num_rows += m_row_groups_[i].num_rows; }
+        }
+        return num_rows;
+    }
+
+    bool
+    ColumnarLogReader::CheckRowGroups(const std::vector<std::size_t> &row_groups) const {
+        for (const std::size_t i: row_groups) {
+            if (i >= m_row_groups_.size()) {
+                ERL_WARN("Row group {} is out of range of {}.", i, m_row_groups_.size());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool
+    ColumnarLogReader::ReadColumn(
+        const long column,
+        const ColumnarLog::Type out_type,
+        void *out,
+        const std::vector<std::size_t> &row_groups) const {
+        if (!IsOpen() || column < 0 || column >= static_cast<long>(m_columns_.size()) ||
+            !CheckRowGroups(row_groups)) {
+            return false;
+        }
+        std::vector<std::size_t> selected = row_groups;
+        if (selected.empty()) {
+            selected.resize(m_row_groups_.size());
+            for (std::size_t i = 0; i < selected.size(); ++i) { selected[i] = i; }
+        }
+        std::vector<std::uint64_t> out_offsets(selected.size() + 1, 0);
+        for (std::size_t i = 0; i < selected.size(); ++i) {
+            out_offsets[i + 1] = out_offsets[i] + m_row_groups_[selected[i]].num_rows;
+        }
+
+        const std::size_t out_type_size = ColumnarLog::GetTypeSize(out_type);
+        const ColumnarLog::Type type = m_columns_[column].type;
+        const auto num_selected = static_cast<long>(selected.size());
+        bool success = true;
+#pragma omp parallel for schedule(dynamic) reduction(&& : success) if (num_selected > 1)
+        for (long i = 0; i < num_selected; ++i) {
+            const ColumnarLog::RowGroup &group = m_row_groups_[selected[i]];
+            const ColumnarLog::ColumnChunk &chunk = group.chunks[column];
+            success = ColumnarLog::DecodeChunk(
+                          type,
+                          chunk.encoding,
+                          m_file_->GetData() + chunk.offset,
+                          chunk.size,
+                          group.num_rows,
+                          out_type,
+                          static_cast<char *>(out) + out_offsets[i] * out_type_size) &&
+                      success;
+        }
+        if (!success) {
+            ERL_WARN(
+                "Corrupted chunk of column {} in {}.",
+                m_columns_[column].name,
+                m_file_->GetPath());
+        }
+        return success;
+    }
+}  // namespace erl::common
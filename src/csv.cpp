@@ -2,34 +2,320 @@
 
 #include "erl_common/logging.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
 namespace erl::common {
 
-    std::vector<std::vector<std::string>>
-    LoadCsvFile(const char *path, char delimiter) {
-        std::ifstream ifs;
-        ifs.open(path);
-        ERL_ASSERTM(ifs.is_open(), "Fail to open file {}", path);
+    namespace {
+        bool
+        IsSpace(const char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
 
-        std::vector<std::vector<std::string>> rows;
-        std::string line;
-        std::string cell;
+        void
+        Trim(const char *&begin, const char *&end) {
+            while (begin < end && IsSpace(*begin)) { ++begin; }
+            while (end > begin && IsSpace(*(end - 1))) { --end; }
+        }
 
-        while (std::getline(ifs, line)) {
-            std::stringstream ss(line);
-            std::vector<std::string> row;
+        const char *
+        FindLineEnd(const char *begin, const char *end) {
+            const void *p = std::memchr(begin, '\n', end - begin);
+            return p == nullptr ? end : static_cast<const char *>(p);
+        }
+
+        bool
+        IsBlank(const char *begin, const char *end) {
+            for (; begin < end; ++begin) {
+                if (!IsSpace(*begin)) { return false; }
+            }
+            return true;
+        }
 
-            while (std::getline(ss, cell, delimiter)) {
-                const auto type_of_whitespaces = "\t\n\r ";
-                auto first = cell.find_first_not_of(type_of_whitespaces);
-                auto last = cell.find_last_not_of(type_of_whitespaces);
-                cell = cell.substr(first, last - first + 1);
-                row.push_back(cell);
+        const char *
+        FindCellEnd(const char *begin, const char *end, const char delimiter) {
+            const void *p = std::memchr(begin, delimiter, end - begin);
+            return p == nullptr ? end : static_cast<const char *>(p);
+        }
+
+        /**
+         * Split a line into trimmed cells.
+         */
+        void
+        SplitLine(
+            const char *begin,
+            const char *end,
+            const char delimiter,
+            std::vector<std::string_view> &cells) {
+            cells.clear();
+            while (true) {
+                const char *cell_end = FindCellEnd(begin, end, delimiter);
+                const char *cell_begin = begin;
+                const char *cell_trimmed_end = cell_end;
+                Trim(cell_begin, cell_trimmed_end);
+                cells.emplace_back(cell_begin, cell_trimmed_end - cell_begin);
+                if (cell_end == end) { break; }
+                begin = cell_end + 1;
             }
+        }
 
-            rows.push_back(row);
+        long
+        CountLines(const char *begin, const char *end) {
+            long count = 0;
+            while (begin < end) {
+                const char *line_end = FindLineEnd(begin, end);
+                if (!IsBlank(begin, line_end)) { ++count; }
+                begin = line_end + 1;
+            }
+            return count;
+        }
+    }  // namespace
+
+    bool
+    CsvReader::Open(const std::string &path) {
+        m_file_ = MappedFile::Open(path, MappedFile::Advice::kSequential);
+        m_header_.clear();
+        if (m_file_ == nullptr) { return false; }
+        m_begin_ = m_file_->GetData();
+        m_end_ = m_begin_ + m_file_->GetSize();
+        if (m_end_ - m_begin_ >= 3 && std::memcmp(m_begin_, "\xEF\xBB\xBF", 3) == 0) {
+            m_begin_ += 3;  // UTF-8 byte order mark
         }
 
-        ifs.close();
+        // the first non-blank line defines the columns
+        const char *line_begin = m_begin_;
+        const char *line_end = line_begin;
+        while (line_begin < m_end_) {
+            line_end = FindLineEnd(line_begin, m_end_);
+            if (!IsBlank(line_begin, line_end)) { break; }
+            line_begin = line_end + 1;
+        }
+        if (line_begin >= m_end_) { return true; }  // no data
+        std::vector<std::string_view> cells;
+        SplitLine(line_begin, line_end, m_setting_.delimiter, cells);
+        m_header_.reserve(cells.size());
+        if (m_setting_.has_header) {
+            for (const std::string_view &cell: cells) { m_header_.emplace_back(cell); }
+            m_begin_ = std::min(line_end + 1, m_end_);
+        } else {
+            for (std::size_t i = 0; i < cells.size(); ++i) {
+                m_header_.emplace_back(std::to_string(i));
+            }
+        }
+        return true;
+    }
+
+    long
+    CsvReader::GetColumnIndex(const std::string &name) const {
+        const auto it = std::find(m_header_.begin(), m_header_.end(), name);
+        return it == m_header_.end() ? -1 : static_cast<long>(it - m_header_.begin());
+    }
+
+    long
+    CsvReader::CountRows() const {
+        if (!IsOpen()) { return 0; }
+        const std::vector<const char *> chunks = SplitChunks();
+        const long num_chunks = static_cast<long>(chunks.size()) - 1;
+        long num_rows = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : num_rows) if (m_setting_.parallel)
+        for (long i = 0; i < num_chunks; ++i) { num_rows += CountLines(chunks[i], chunks[i + 1]); }
+        return num_rows;
+    }
+
+    bool
+    CsvReader::ForEachRow(const std::function<bool(const Row &)> &func) const {
+        if (!IsOpen()) { return false; }
+        constexpr std::ptrdiff_t kReleaseSize = 64 << 20;
+        Row row;
+        const char *released = m_file_->GetData();
+        const char *line_begin = m_begin_;
+        while (line_begin < m_end_) {
+            const char *line_end = FindLineEnd(line_begin, m_end_);
+            if (!IsBlank(line_begin, line_end)) {
+                SplitLine(line_begin, line_end, m_setting_.delimiter, row.m_cells_);
+                if (!func(row)) { return true; }
+                ++row.m_index_;
+            }
+            line_begin = line_end + 1;
+            if (line_begin - released >= kReleaseSize) {  // drop the pages behind
+                const auto offset = static_cast<std::size_t>(released - m_file_->GetData());
+                m_file_->Advise(offset, kReleaseSize, MappedFile::Advice::kDontNeed);
+                released += kReleaseSize;
+            }
+        }
+        return true;
+    }
+
+    std::vector<const char *>
+    CsvReader::SplitChunks() const {
+        std::vector<const char *> chunks = {m_begin_};
+        const std::size_t chunk_size = std::max<std::size_t>(m_setting_.chunk_size, 1);
+        while (chunks.back() < m_end_) {
+            const char *begin = chunks.back();
+            if (static_cast<std::size_t>(m_end_ - begin) <= chunk_size) {
+                chunks.push_back(m_end_);
+                break;
+            }
+            chunks.push_back(std::min(FindLineEnd(begin + chunk_size, m_end_) + 1, m_end_));
+        }
+        if (chunks.size() == 1) { chunks.push_back(m_end_); }  // no data
+        return chunks;
+    }
+
+    bool
+    CsvReader::ParseColumns(const std::function<std::vector<ColumnSink>(long)> &prepare) const {
+        if (!IsOpen()) { return false; }
+        const std::vector<const char *> chunks = SplitChunks();
+        const long num_chunks = static_cast<long>(chunks.size()) - 1;
+
+        // first pass: count the rows of each chunk to know where its rows go
+        std::vector<long> row_offsets(num_chunks + 1, 0);
+#pragma omp parallel for schedule(dynamic) if (m_setting_.parallel)
+        for (long i = 0; i < num_chunks; ++i) {
+            row_offsets[i + 1] = CountLines(chunks[i], chunks[i + 1]);
+        }
+        for (long i = 0; i < num_chunks; ++i) { row_offsets[i + 1] += row_offsets[i]; }
+
+        std::vector<ColumnSink> sinks = prepare(row_offsets.back());
+        std::stable_sort(sinks.begin(), sinks.end(), [](const auto &a, const auto &b) {
+            return a.column < b.column;
+        });
+        const std::size_t num_sinks = sinks.size();
+        const char delimiter = m_setting_.delimiter;
+
+        // second pass: parse the cells of each chunk into its rows
+        std::mutex error_mutex;
+        long error_row = -1;
+        long error_column = -1;
+        std::string error_cell;
+#pragma omp parallel for schedule(dynamic) if (m_setting_.parallel)
+        for (long i = 0; i < num_chunks; ++i) {
+            long row = row_offsets[i];
+            const char *line_begin = chunks[i];
+            const char *chunk_end = chunks[i + 1];
+            while (line_begin < chunk_end) {
+                const char *line_end = FindLineEnd(line_begin, chunk_end);
+                if (IsBlank(line_begin, line_end)) {
+                    line_begin = line_end + 1;
+                    continue;
+                }
+                // walk the cells once, the sinks are sorted by column
+                const char *cell_begin = line_begin;
+                long column = 0;
+                std::size_t k = 0;
+                while (k < num_sinks) {
+                    const char *cell_end = cell_begin;
+                    const char *next = line_end;
+                    if (cell_begin <= line_end) {
+                        cell_end = FindCellEnd(cell_begin, line_end, delimiter);
+                        next = cell_end + 1;
+                    }  // else: missing cells are empty
+                    for (; k < num_sinks && sinks[k].column == column; ++k) {
+                        const char *b = cell_begin;
+                        const char *e = cell_end;
+                        Trim(b, e);
+                        if (sinks[k].parse(b, e, sinks[k].data, row)) { continue; }
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (error_row < 0 || row < error_row) {
+                            error_row = row;
+                            error_column = column;
+                            error_cell.assign(b, e);
+                        }
+                    }
+                    cell_begin = next;
+                    ++column;
+                }
+                ++row;
+                line_begin = line_end + 1;
+            }
+        }
+        if (error_row >= 0) {
+            ERL_WARN(
+                "Failed to parse \"{}\" at row {}, column {} of {}.",
+                error_cell,
+                error_row,
+                m_header_[error_column],
+                m_file_->GetPath());
+            return false;
+        }
+        return true;
+    }
+
+    bool
+    CsvWriter::Open(const std::string &path, const bool append) {
+        Close();
+        m_ofs_.open(path, append ? std::ios::app : std::ios::out);
+        if (!m_ofs_.is_open()) { return false; }
+        m_buffer_.reserve(m_setting_.buffer_size + (m_setting_.buffer_size >> 2));
+        m_last_flush_ = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    bool
+    CsvWriter::Flush() {
+        if (!m_ofs_.is_open()) { return false; }
+        if (!m_buffer_.empty()) {
+            m_ofs_.write(m_buffer_.data(), static_cast<std::streamsize>(m_buffer_.size()));
+            m_buffer_.clear();
+        }
+        m_ofs_.flush();
+        m_last_flush_ = std::chrono::steady_clock::now();
+        return m_ofs_.good();
+    }
+
+    void
+    CsvWriter::Close() {
+        if (!m_ofs_.is_open()) { return; }
+        Flush();
+        m_ofs_.close();
+    }
+
+    void
+    CsvWriter::EndRow() {
+        m_buffer_.push_back('\n');
+        if (m_buffer_.size() >= m_setting_.buffer_size) {
+            Flush();
+            return;
+        }
+        if (m_setting_.flush_period > 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - m_last_flush_)
+                    .count() >= m_setting_.flush_period) {
+            Flush();
+        }
+    }
+
+    void
+    CsvWriter::Append(const std::string &rows) {
+        if (m_buffer_.size() + rows.size() < m_setting_.buffer_size) {
+            m_buffer_.append(rows);
+            return;
+        }
+        // large blocks go to the file directly instead of through the buffer
+        if (!m_buffer_.empty()) {
+            m_ofs_.write(m_buffer_.data(), static_cast<std::streamsize>(m_buffer_.size()));
+            m_buffer_.clear();
+        }
+        m_ofs_.write(rows.data(), static_cast<std::streamsize>(rows.size()));
+    }
+
+    std::vector<std::vector<std::string>>
+    LoadCsvFile(const char *path, char delimiter) {
+        CsvReader::Setting setting;
+        setting.delimiter = delimiter;
+        setting.has_header = false;
+        CsvReader reader(setting);
+        const bool opened = reader.Open(path);
+        ERL_ASSERTM(opened, "Fail to open file {}", path);
+
+        std::vector<std::vector<std::string>> rows;
+        reader.ForEachRow([&rows](const CsvReader::Row &row) {
+            std::vector<std::string> &cells = rows.emplace_back();
+            cells.reserve(row.Size());
+            for (std::size_t i = 0; i < row.Size(); ++i) { cells.emplace_back(row[i]); }
+            return true;
+        });
         return rows;
     }
 
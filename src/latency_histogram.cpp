@@ -0,0 +1,212 @@
+#include "erl_common/latency_histogram.hpp"
+
+#include "erl_common/serialization.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace erl::common {
+
+    LatencyHistogram::LatencyHistogram()
+        : m_buckets_(new std::atomic<std::uint64_t>[kNumBuckets]) {
+        Reset();
+    }
+
+    LatencyHistogram::LatencyHistogram(const LatencyHistogram &other)
+        : LatencyHistogram() {
+        Merge(other);
+    }
+
+    LatencyHistogram &
+    LatencyHistogram::operator=(const LatencyHistogram &other) {
+        if (this == &other) { return *this; }
+        Reset();
+        Merge(other);
+        return *this;
+    }
+
+    double
+    LatencyHistogram::GetBucketLowerBound(const std::size_t index) {
+        if (index == 0) { return 0.0; }
+        const std::size_t i = index - 1;
+        const int exponent = static_cast<int>(i / kSubBucketCount) + kMinExponent;
+        const double mantissa = 1.0 + static_cast<double>(i % kSubBucketCount) / kSubBucketCount;
+        return std::ldexp(mantissa, exponent);
+    }
+
+    void
+    LatencyHistogram::Merge(const LatencyHistogram &other) {
+        const std::uint64_t count = other.GetCount();
+        if (count == 0) { return; }
+        for (std::size_t i = 0; i < kNumBuckets; ++i) {
+            const std::uint64_t n = other.GetBucketCount(i);
+            if (n > 0) { m_buckets_[i].fetch_add(n, std::memory_order_relaxed); }
+        }
+        m_count_.fetch_add(count, std::memory_order_relaxed);
+        const double other_min = other.m_min_.load(std::memory_order_relaxed);
+        double min = m_min_.load(std::memory_order_relaxed);
+        while (other_min < min &&
+               !m_min_.compare_exchange_weak(min, other_min, std::memory_order_relaxed)) {}
+        const double other_max = other.m_max_.load(std::memory_order_relaxed);
+        double max = m_max_.load(std::memory_order_relaxed);
+        while (other_max > max &&
+               !m_max_.compare_exchange_weak(max, other_max, std::memory_order_relaxed)) {}
+    }
+
+    void
+    LatencyHistogram::Reset() {
+        for (std::size_t i = 0; i < kNumBuckets; ++i) {
+            m_buckets_[i].store(0, std::memory_order_relaxed);
+        }
+        m_count_.store(0, std::memory_order_relaxed);
+        m_min_.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+        m_max_.store(-std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+    }
+
+    double
+    LatencyHistogram::GetMin() const {
+        return GetCount() == 0 ? 0.0 : m_min_.load(std::memory_order_relaxed);
+    }
+
+    double
+    LatencyHistogram::GetMax() const {
+        return GetCount() == 0 ? 0.0 : m_max_.load(std::memory_order_relaxed);
+    }
+
+    double
+    LatencyHistogram::GetPercentile(const double p) const {
+        const std::uint64_t count = GetCount();
+        if (count == 0) { return 0.0; }
+        const double min = GetMin();
+        const double max = GetMax();
+        const auto target = std::max<std::uint64_t>(
+            1,
+            static_cast<std::uint64_t>(
+                std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(count))));
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < kNumBuckets; ++i) {
+            cumulative += GetBucketCount(i);
+            if (cumulative < target) { continue; }
+            if (i == 0) { return min; }
+            if (i == kNumBuckets - 1) { return max; }
+            return std::clamp(GetBucketLowerBound(i + 1), min, max);
+        }
+        return max;  // the buckets are behind the count while other threads record
+    }
+
+    std::string
+    LatencyHistogram::ToString() const {
+        char buf[256];
+        std::snprintf(
+            buf,
+            sizeof(buf),
+            "count %llu, min %.4g, p50 %.4g, p90 %.4g, p99 %.4g, p999 %.4g, max %.4g",
+            static_cast<unsigned long long>(GetCount()),
+            GetMin(),
+            GetPercentile(50),
+            GetPercentile(90),
+            GetPercentile(99),
+            GetPercentile(99.9),
+            GetMax());
+        return buf;
+    }
+
+    bool
+    LatencyHistogram::Write(std::ostream &s) const {
+        using namespace serialization;
+        static const TokenWriteFunctionPairs<LatencyHistogram> token_function_pairs = {
+            {
+                "info",
+                [](const LatencyHistogram *self, std::ostream &stream) {
+                    const std::int32_t layout[3] = {kSubBucketBits, kMinExponent, kMaxExponent};
+                    const std::uint64_t count = self->GetCount();
+                    const double min = self->GetMin();
+                    const double max = self->GetMax();
+                    stream.write(reinterpret_cast<const char *>(layout), sizeof(layout));
+                    stream.write(reinterpret_cast<const char *>(&count), sizeof(count));
+                    stream.write(reinterpret_cast<const char *>(&min), sizeof(min));
+                    stream.write(reinterpret_cast<const char *>(&max), sizeof(max));
+                    return stream.good();
+                },
+            },
+            {
+                "buckets",
+                [](const LatencyHistogram *self, std::ostream &stream) {
+                    std::vector<std::pair<std::uint32_t, std::uint64_t>> buckets;
+                    for (std::size_t i = 0; i < kNumBuckets; ++i) {
+                        const std::uint64_t n = self->GetBucketCount(i);
+                        if (n > 0) { buckets.emplace_back(static_cast<std::uint32_t>(i), n); }
+                    }
+                    const std::uint64_t num_buckets = buckets.size();
+                    stream.write(reinterpret_cast<const char *>(&num_buckets), sizeof(num_buckets));
+                    for (const auto &[index, n]: buckets) {
+                        stream.write(reinterpret_cast<const char *>(&index), sizeof(index));
+                        stream.write(reinterpret_cast<const char *>(&n), sizeof(n));
+                    }
+                    return stream.good();
+                },
+            },
+        };
+        return WriteTokens(s, this, token_function_pairs);
+    }
+
+    bool
+    LatencyHistogram::Read(std::istream &s) {
+        using namespace serialization;
+        static const TokenReadFunctionPairs<LatencyHistogram> token_function_pairs = {
+            {
+                "info",
+                [](LatencyHistogram *self, std::istream &stream) {
+                    std::int32_t layout[3] = {0, 0, 0};
+                    std::uint64_t count = 0;
+                    double min = 0.0;
+                    double max = 0.0;
+                    stream.read(reinterpret_cast<char *>(layout), sizeof(layout));
+                    stream.read(reinterpret_cast<char *>(&count), sizeof(count));
+                    stream.read(reinterpret_cast<char *>(&min), sizeof(min));
+                    stream.read(reinterpret_cast<char *>(&max), sizeof(max));
+                    if (layout[0] != kSubBucketBits || layout[1] != kMinExponent ||
+                        layout[2] != kMaxExponent) {
+                        ERL_WARN(
+                            "Bucket layout mismatch. Expected ({}, {}, {}), got ({}, {}, {}).",
+                            kSubBucketBits,
+                            kMinExponent,
+                            kMaxExponent,
+                            layout[0],
+                            layout[1],
+                            layout[2]);
+                        return false;
+                    }
+                    self->Reset();
+                    self->m_count_.store(count, std::memory_order_relaxed);
+                    if (count > 0) {
+                        self->m_min_.store(min, std::memory_order_relaxed);
+                        self->m_max_.store(max, std::memory_order_relaxed);
+                    }
+                    return stream.good();
+                },
+            },
+            {
+                "buckets",
+                [](LatencyHistogram *self, std::istream &stream) {
+                    std::uint64_t num_buckets = 0;
+                    stream.read(reinterpret_cast<char *>(&num_buckets), sizeof(num_buckets));
+                    for (std::uint64_t i = 0; i < num_buckets && stream.good(); ++i) {
+                        std::uint32_t index = 0;
+                        std::uint64_t n = 0;
+                        stream.read(reinterpret_cast<char *>(&index), sizeof(index));
+                        stream.read(reinterpret_cast<char *>(&n), sizeof(n));
+                        if (index >= kNumBuckets) {
+                            ERL_WARN("Bucket index {} out of range.", index);
+                            return false;
+                        }
+                        self->m_buckets_[index].store(n, std::memory_order_relaxed);
+                    }
+                    return stream.good();
+                },
+            },
+        };
+        return ReadTokens(s, this, token_function_pairs);
+    }
+}  // namespace erl::common
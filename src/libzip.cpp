@@ -0,0 +1,524 @@
+#ifdef ERL_USE_LIBZIP
+    #include "erl_common/libzip.hpp"
+
+    #include <algorithm>
+    #include <fstream>
+
+namespace erl::common {
+
+    namespace {
+        std::string
+        GetErrorString(const int code) {
+            zip_error_t zip_error;
+            zip_error_init_with_code(&zip_error, code);
+            std::string error_msg = zip_error_strerror(&zip_error);
+            zip_error_fini(&zip_error);
+            return error_msg;
+        }
+
+        std::string
+        GetErrorString(zip_error_t *zip_error) {
+            std::string error_msg = zip_error_strerror(zip_error);
+            zip_error_fini(zip_error);
+            return error_msg;
+        }
+    }  // namespace
+
+    LibZip::LibZip(const std::string &zip_filepath)
+        : LibZip(zip_filepath, Setting()) {}
+
+    LibZip::LibZip(const std::string &zip_filepath, const Setting &setting)
+        : m_setting_(setting),
+          m_zip_(zip_open(
+              zip_filepath.c_str(),
+              ZIP_CREATE | (setting.overwrite ? ZIP_TRUNCATE : ZIP_EXCL),
+              &m_error_)),
+          m_zip_filepath_(zip_filepath) {
+        if (m_zip_ == nullptr) {
+            ERL_FATAL(
+                "Failed to create zip file {}: {}",
+                zip_filepath,
+                GetErrorString(m_error_));  // throw error
+        }
+    }
+
+    bool
+    LibZip::AddFile(const std::string &filepath, const std::string &filename_in_zip) {
+        if (!CheckOpen()) { return false; }
+        if (!m_setting_.parallel) {
+            zip_source_t *source = zip_source_file(m_zip_, filepath.c_str(), 0, 0);
+            if (source == nullptr) {
+                ERL_ERROR("Failed to add file {} as {} in zip", filepath, filename_in_zip);
+                return false;
+            }
+            return AddSource(source, filename_in_zip);
+        }
+        std::error_code ec;
+        const std::uintmax_t size = std::filesystem::file_size(filepath, ec);
+        if (ec) {
+            ERL_ERROR(
+                "Failed to add file {} as {} in zip: {}",
+                filepath,
+                filename_in_zip,
+                ec.message());
+            return false;
+        }
+        return AddPending({filename_in_zip, filepath, {}}, size);
+    }
+
+    bool
+    LibZip::AddBuffer(const std::string &filename_in_zip, std::string data) {
+        if (!CheckOpen()) { return false; }
+        if (!m_setting_.parallel) {
+            // libzip reads the buffer when the archive is written
+            const std::string &buffer = m_buffers_.emplace_back(std::move(data));
+            zip_source_t *source = zip_source_buffer(m_zip_, buffer.data(), buffer.size(), 0);
+            if (source == nullptr) {
+                ERL_ERROR("Failed to add buffer as {} in zip", filename_in_zip);
+                return false;
+            }
+            m_held_bytes_ += buffer.size();
+            if (!AddSource(source, filename_in_zip)) { return false; }
+            return m_held_bytes_ < m_setting_.max_pending_bytes || Commit();
+        }
+        const std::size_t size = data.size();
+        return AddPending({filename_in_zip, {}, std::move(data)}, size);
+    }
+
+    bool
+    LibZip::AddDirectory(  // NOLINT(*-no-recursion)
+        const std::string &dirpath,
+        const std::string &dirname_in_zip) {
+        ERL_ASSERTM(std::filesystem::is_directory(dirpath), "Not a directory: {}", dirpath);
+        auto directory_itr = std::filesystem::directory_iterator(dirpath);
+        return std::all_of(
+            std::filesystem::begin(directory_itr),
+            std::filesystem::end(directory_itr),
+            [this, &dirname_in_zip](const auto &entry) {  // NOLINT(*-no-recursion)
+                const std::string entry_path = entry.path().string();
+                const std::string entry_name = entry.path().filename().string();
+                const std::string next_dirname_in_zip =
+                    dirname_in_zip + "/" +
+                    entry_name;  // NOLINT(*-inefficient-string-concatenation)
+                if (entry.is_directory()) { return AddDirectory(entry_path, next_dirname_in_zip); }
+                if (entry.is_regular_file()) { return AddFile(entry_path, next_dirname_in_zip); }
+                ERL_ERROR("Unsupported file {}.", entry_path);
+                return false;
+            });
+    }
+
+    bool
+    LibZip::AddItems(
+        const std::vector<std::pair<std::string, std::string>> &item_and_name_in_zip) {
+        return std::all_of(
+            item_and_name_in_zip.begin(),
+            item_and_name_in_zip.end(),
+            [this](const auto &pair) {
+                if (std::filesystem::is_directory(pair.first)) {
+                    return AddDirectory(pair.first, pair.second);
+                }
+                if (std::filesystem::is_regular_file(pair.first)) {
+                    return AddFile(pair.first, pair.second);
+                }
+                ERL_ERROR("Unsupported file {}.", pair.first);
+                return false;
+            });
+    }
+
+    bool
+    LibZip::Flush() {
+        if (m_pending_entries_.empty()) { return true; }
+        if (!CheckOpen()) { return false; }
+        const auto n = static_cast<long>(m_pending_entries_.size());
+        std::vector<zip_t *> compressed(n, nullptr);
+    #pragma omp parallel for schedule(dynamic) if (m_setting_.parallel && n > 1)
+        for (long i = 0; i < n; ++i) {
+            compressed[i] = CompressEntry(m_pending_entries_[i]);
+            m_pending_entries_[i].data = {};  // release the memory early
+        }
+
+        bool success = true;
+        for (long i = 0; i < n; ++i) {
+            const std::string &filename_in_zip = m_pending_entries_[i].name_in_zip;
+            if (compressed[i] == nullptr) {
+                success = false;
+                continue;
+            }
+            m_compressed_entries_.push_back(compressed[i]);
+            zip_stat_t stat;
+            zip_stat_init(&stat);
+            if (zip_stat_index(compressed[i], 0, 0, &stat) == 0 &&
+                (stat.valid & ZIP_STAT_COMP_SIZE)) {
+                m_held_bytes_ += stat.comp_size;
+            }
+            // copy the compressed data as it is, libzip does not compress it again
+    #if LIBZIP_VERSION_MAJOR > 1 || (LIBZIP_VERSION_MAJOR == 1 && LIBZIP_VERSION_MINOR >= 10)
+            zip_source_t *source =
+                zip_source_zip_file(m_zip_, compressed[i], 0, ZIP_FL_COMPRESSED, 0, -1, nullptr);
+    #else
+            zip_source_t *source =
+                zip_source_zip(m_zip_, compressed[i], 0, ZIP_FL_COMPRESSED, 0, -1);
+    #endif
+            if (source == nullptr) {
+                ERL_ERROR("Failed to add {} in zip: {}", filename_in_zip, zip_strerror(m_zip_));
+                success = false;
+                continue;
+            }
+            if (!AddSource(source, filename_in_zip)) { success = false; }
+        }
+        m_pending_entries_.clear();
+        m_pending_bytes_ = 0;
+        if (m_held_bytes_ >= m_setting_.max_pending_bytes && !Commit()) { return false; }
+        return success;
+    }
+
+    bool
+    LibZip::Close() {
+        if (m_zip_ == nullptr) { return true; }
+        bool success = Flush();
+        if (m_zip_ == nullptr) { return false; }  // Flush failed to write the archive
+        if (zip_close(m_zip_) < 0) {
+            ERL_ERROR("Failed to close zip file {}: {}", m_zip_filepath_, zip_strerror(m_zip_));
+            zip_discard(m_zip_);
+            success = false;
+        }
+        m_zip_ = nullptr;
+        for (zip_t *zip: m_compressed_entries_) { zip_discard(zip); }
+        m_compressed_entries_.clear();
+        m_buffers_.clear();
+        m_held_bytes_ = 0;
+        return success;
+    }
+
+    bool
+    LibZip::Commit() {
+        const bool closed = zip_close(m_zip_) == 0;
+        if (!closed) {
+            ERL_ERROR("Failed to write zip file {}: {}", m_zip_filepath_, zip_strerror(m_zip_));
+            zip_discard(m_zip_);
+        }
+        m_zip_ = nullptr;
+        for (zip_t *zip: m_compressed_entries_) { zip_discard(zip); }
+        m_compressed_entries_.clear();
+        m_buffers_.clear();
+        m_held_bytes_ = 0;
+        if (!closed) { return false; }
+        // keep the written entries, later entries are added after them
+        m_zip_ = zip_open(m_zip_filepath_.c_str(), 0, &m_error_);
+        if (m_zip_ == nullptr) {
+            ERL_ERROR(
+                "Failed to reopen zip file {}: {}",
+                m_zip_filepath_,
+                GetErrorString(m_error_));
+            return false;
+        }
+        return true;
+    }
+
+    bool
+    LibZip::CheckOpen() const {
+        if (m_zip_ != nullptr) { return true; }
+        ERL_ERROR("Zip file {} is closed.", m_zip_filepath_);
+        return false;
+    }
+
+    bool
+    LibZip::AddPending(PendingEntry entry, const std::size_t size) {
+        m_pending_entries_.push_back(std::move(entry));
+        m_pending_bytes_ += size;
+        if (m_pending_bytes_ < m_setting_.max_pending_bytes) { return true; }
+        return Flush();
+    }
+
+    bool
+    LibZip::AddSource(zip_source_t *source, const std::string &filename_in_zip) {
+        const zip_int64_t index = zip_file_add(
+            m_zip_,
+            filename_in_zip.c_str(),
+            source,
+            ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE);
+        if (index < 0) {
+            ERL_ERROR("Failed to add {} in zip: {}", filename_in_zip, zip_strerror(m_zip_));
+            zip_source_free(source);
+            return false;
+        }
+        if (m_setting_.compression_level != 0 && !m_setting_.parallel &&
+            zip_set_file_compression(
+                m_zip_,
+                index,
+                ZIP_CM_DEFLATE,
+                static_cast<zip_uint32_t>(m_setting_.compression_level)) < 0) {
+            ERL_WARN(
+                "Failed to set the compression of {}: {}",
+                filename_in_zip,
+                zip_strerror(m_zip_));
+        }
+        return true;
+    }
+
+    zip_t *
+    LibZip::CompressEntry(const PendingEntry &entry) const {
+        zip_error_t error;
+        zip_error_init(&error);
+        zip_source_t *buffer = zip_source_buffer_create(nullptr, 0, 0, &error);
+        if (buffer == nullptr) {
+            ERL_ERROR("Failed to compress {}: {}", entry.name_in_zip, GetErrorString(&error));
+            return nullptr;
+        }
+        zip_t *zip = zip_open_from_source(buffer, ZIP_CREATE | ZIP_TRUNCATE, &error);
+        if (zip == nullptr) {
+            ERL_ERROR("Failed to compress {}: {}", entry.name_in_zip, GetErrorString(&error));
+            zip_source_free(buffer);
+            return nullptr;
+        }
+        zip_source_keep(buffer);  // keep the compressed data after the archive is closed
+
+        zip_source_t *source =
+            entry.filepath.empty()
+                ? zip_source_buffer(zip, entry.data.data(), entry.data.size(), 0)
+                : zip_source_file(zip, entry.filepath.c_str(), 0, 0);
+        zip_int64_t index = -1;
+        if (source != nullptr) {
+            index = zip_file_add(zip, entry.name_in_zip.c_str(), source, ZIP_FL_ENC_UTF_8);
+            if (index < 0) { zip_source_free(source); }
+        }
+        if (index < 0 ||
+            zip_set_file_compression(
+                zip,
+                index,
+                ZIP_CM_DEFLATE,
+                static_cast<zip_uint32_t>(m_setting_.compression_level)) < 0 ||
+            zip_close(zip) < 0) {  // compress
+            ERL_ERROR("Failed to compress {}: {}", entry.name_in_zip, zip_strerror(zip));
+            zip_discard(zip);
+            zip_source_free(buffer);
+            return nullptr;
+        }
+
+        zip = zip_open_from_source(buffer, ZIP_RDONLY, &error);
+        if (zip == nullptr) {
+            ERL_ERROR("Failed to compress {}: {}", entry.name_in_zip, GetErrorString(&error));
+            zip_source_free(buffer);
+            return nullptr;
+        }
+        zip_error_fini(&error);
+        return zip;
+    }
+
+    LibZipEntryStreamBuf::LibZipEntryStreamBuf(
+        zip_t *zip,
+        const zip_uint64_t index,
+        const zip_uint64_t size)
+        : m_zip_(zip),
+          m_index_(index),
+          m_size_(size),
+          m_buffer_(1 << 16) {
+        Reopen();
+    }
+
+    LibZipEntryStreamBuf::~LibZipEntryStreamBuf() {
+        if (m_file_ != nullptr) { zip_fclose(m_file_); }
+    }
+
+    LibZipEntryStreamBuf::int_type
+    LibZipEntryStreamBuf::underflow() {
+        if (gptr() < egptr()) { return traits_type::to_int_type(*gptr()); }
+        if (m_file_ == nullptr) { return traits_type::eof(); }
+        m_buffer_pos_ += egptr() - eback();
+        const zip_int64_t n = zip_fread(m_file_, m_buffer_.data(), m_buffer_.size());
+        if (n <= 0) {
+            if (n < 0) { ERL_WARN("Failed to read zip entry: {}", zip_file_strerror(m_file_)); }
+            setg(m_buffer_.data(), m_buffer_.data(), m_buffer_.data());
+            return traits_type::eof();
+        }
+        setg(m_buffer_.data(), m_buffer_.data(), m_buffer_.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    LibZipEntryStreamBuf::pos_type
+    LibZipEntryStreamBuf::seekoff(
+        const off_type off,
+        const std::ios_base::seekdir dir,
+        const std::ios_base::openmode which) {
+        if (!(which & std::ios_base::in) || m_file_ == nullptr) { return {off_type(-1)}; }
+        const auto position = static_cast<off_type>(m_buffer_pos_ + (gptr() - eback()));
+        const off_type target = dir == std::ios_base::beg   ? off
+                                : dir == std::ios_base::cur ? position + off
+                                                            : static_cast<off_type>(m_size_) + off;
+        if (target < 0 || target > static_cast<off_type>(m_size_)) { return {off_type(-1)}; }
+        if (target < static_cast<off_type>(m_buffer_pos_) && !Reopen()) {
+            return {off_type(-1)};
+        }
+        // decompress and drop the data up to the target
+        while (target > static_cast<off_type>(m_buffer_pos_) + (egptr() - eback())) {
+            setg(eback(), egptr(), egptr());
+            if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+                return {off_type(-1)};
+            }
+        }
+        setg(eback(), eback() + (target - static_cast<off_type>(m_buffer_pos_)), egptr());
+        return {target};
+    }
+
+    LibZipEntryStreamBuf::pos_type
+    LibZipEntryStreamBuf::seekpos(const pos_type pos, const std::ios_base::openmode which) {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    bool
+    LibZipEntryStreamBuf::Reopen() {
+        if (m_file_ != nullptr) { zip_fclose(m_file_); }
+        m_file_ = zip_fopen_index(m_zip_, m_index_, 0);
+        m_buffer_pos_ = 0;
+        setg(m_buffer_.data(), m_buffer_.data(), m_buffer_.data());
+        if (m_file_ == nullptr) {
+            ERL_WARN("Failed to open zip entry {}: {}", m_index_, zip_strerror(m_zip_));
+            return false;
+        }
+        return true;
+    }
+
+    LibZipReader::LibZipReader(const std::string &zip_filepath)
+        : m_zip_(zip_open(zip_filepath.c_str(), ZIP_RDONLY, &m_error_)),
+          m_zip_filepath_(zip_filepath) {
+        if (m_zip_ == nullptr) {
+            ERL_FATAL(
+                "Failed to open zip file {}: {}",
+                zip_filepath,
+                GetErrorString(m_error_));  // throw error
+        }
+    }
+
+    LibZipReader::~LibZipReader() {
+        if (m_zip_ != nullptr) {
+            zip_discard(m_zip_);  // read-only, nothing to write
+            m_zip_ = nullptr;
+        }
+    }
+
+    std::vector<std::string>
+    LibZipReader::GetEntryNames() const {
+        const zip_int64_t n = zip_get_num_entries(m_zip_, 0);
+        std::vector<std::string> names;
+        names.reserve(static_cast<std::size_t>(std::max<zip_int64_t>(n, 0)));
+        for (zip_int64_t i = 0; i < n; ++i) {
+            if (const char *name = zip_get_name(m_zip_, i, ZIP_FL_ENC_GUESS); name != nullptr) {
+                names.emplace_back(name);
+            }
+        }
+        return names;
+    }
+
+    bool
+    LibZipReader::HasEntry(const std::string &filename_in_zip) const {
+        return zip_name_locate(m_zip_, filename_in_zip.c_str(), ZIP_FL_ENC_GUESS) >= 0;
+    }
+
+    std::size_t
+    LibZipReader::GetEntrySize(const std::string &filename_in_zip) const {
+        const zip_int64_t index =
+            zip_name_locate(m_zip_, filename_in_zip.c_str(), ZIP_FL_ENC_GUESS);
+        if (index < 0) { return 0; }
+        zip_stat_t stat;
+        zip_stat_init(&stat);
+        if (zip_stat_index(m_zip_, index, 0, &stat) < 0 || !(stat.valid & ZIP_STAT_SIZE)) {
+            return 0;
+        }
+        return stat.size;
+    }
+
+    bool
+    LibZipReader::Extract(const std::string &filename_in_zip, std::string &data) const {
+        const std::unique_ptr<LibZipEntryIStream> stream = OpenEntry(filename_in_zip);
+        if (stream == nullptr) { return false; }
+        // grow the buffer as the data arrives, the size declared by a corrupt or crafted archive
+        // must not allocate more than the entry really holds
+        constexpr std::size_t kChunkSize = 1 << 20;
+        const std::size_t size = GetEntrySize(filename_in_zip);
+        data.clear();
+        while (data.size() < size) {
+            const std::size_t offset = data.size();
+            const std::size_t n = std::min(kChunkSize, size - offset);
+            data.resize(offset + n);
+            stream->read(data.data() + offset, static_cast<std::streamsize>(n));
+            if (stream->gcount() != static_cast<std::streamsize>(n)) {
+                ERL_ERROR("Failed to extract {} from {}.", filename_in_zip, m_zip_filepath_);
+                data.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool
+    LibZipReader::ExtractFile(const std::string &filename_in_zip, const std::string &filepath)
+        const {
+        const std::unique_ptr<LibZipEntryIStream> stream = OpenEntry(filename_in_zip);
+        if (stream == nullptr) { return false; }
+        const std::filesystem::path folder = std::filesystem::absolute(filepath).parent_path();
+        std::filesystem::create_directories(folder);
+        std::ofstream ofs(filepath, std::ios_base::out | std::ios_base::binary);
+        if (!ofs.is_open()) {
+            ERL_ERROR("Failed to open file {} for writing.", filepath);
+            return false;
+        }
+        if (GetEntrySize(filename_in_zip) > 0) { ofs << stream->rdbuf(); }
+        if (!ofs.good() || stream->bad()) {
+            ERL_ERROR("Failed to extract {} to {}.", filename_in_zip, filepath);
+            return false;
+        }
+        return true;
+    }
+
+    bool
+    LibZipReader::ExtractAll(const std::string &dirpath) const {
+        const std::vector<std::string> names = GetEntryNames();
+        // reject the whole archive before writing anything if an entry would escape dirpath
+        for (const std::string &name: names) {
+            const std::filesystem::path path(name);
+            const bool escapes =
+                path.has_root_path() || std::any_of(path.begin(), path.end(), [](const auto &part) {
+                    return part == "..";
+                });
+            if (name.empty() || escapes) {
+                ERL_ERROR(
+                    "Unsafe entry name \"{}\" in {}, nothing is extracted.",
+                    name,
+                    m_zip_filepath_);
+                return false;
+            }
+        }
+        return std::all_of(names.begin(), names.end(), [&](const std::string &name) {
+            const std::filesystem::path path = std::filesystem::path(dirpath) / name;
+            if (!name.empty() && name.back() == '/') {  // directory entry
+                std::filesystem::create_directories(path);
+                return true;
+            }
+            return ExtractFile(name, path.string());
+        });
+    }
+
+    std::unique_ptr<LibZipEntryIStream>
+    LibZipReader::OpenEntry(const std::string &filename_in_zip) const {
+        const zip_int64_t index = Locate(filename_in_zip);
+        if (index < 0) { return nullptr; }
+        auto stream = std::make_unique<LibZipEntryIStream>(
+            m_zip_,
+            static_cast<zip_uint64_t>(index),
+            GetEntrySize(filename_in_zip));
+        if (!stream->good()) { return nullptr; }
+        return stream;
+    }
+
+    zip_int64_t
+    LibZipReader::Locate(const std::string &filename_in_zip) const {
+        const zip_int64_t index =
+            zip_name_locate(m_zip_, filename_in_zip.c_str(), ZIP_FL_ENC_GUESS);
+        if (index < 0) {
+            ERL_ERROR("{} is not in {}.", filename_in_zip, m_zip_filepath_);
+        }
+        return index;
+    }
+}  // namespace erl::common
+
+#endif
@@ -1,7 +1,305 @@
 #ifdef ERL_USE_FMT
     #include "erl_common/logging.hpp"
 
+    #include <algorithm>
+    #include <array>
+    #include <condition_variable>
+    #include <iterator>
+    #include <cstdlib>
+    #include <limits>
+    #include <memory>
+    #include <thread>
+    #include <vector>
+
 namespace erl::common {
+
+    namespace {
+        // start of the monotonic timestamps
+        const std::chrono::steady_clock::time_point g_start_time = std::chrono::steady_clock::now();
+
+        void
+        WriteTwoDigits(char *dst, const int value) {
+            dst[0] = static_cast<char>('0' + value / 10);
+            dst[1] = static_cast<char>('0' + value % 10);
+        }
+
+        /**
+         * Local date and time of one second, formatted.
+         */
+        struct LocalTime {
+            bool valid = false;
+            std::time_t second = 0;
+            std::time_t minute = 0;  // start of the minute of second
+            char date[10] = {};      // YYYY-mm-dd
+            char time[8] = {};       // HH:MM:SS
+        };
+
+        /**
+         * @return The local time of the thread, updated to now. localtime_r, which takes a lock
+         * of libc, runs once a minute; within a minute only the seconds are rewritten.
+         */
+        const LocalTime &
+        GetLocalTime(const std::time_t now) {
+            thread_local LocalTime local_time;
+            if (local_time.valid && now == local_time.second) { return local_time; }
+            if (local_time.valid && now >= local_time.minute && now - local_time.minute < 60) {
+                local_time.second = now;
+                WriteTwoDigits(local_time.time + 6, static_cast<int>(now - local_time.minute));
+                return local_time;
+            }
+            std::tm tm{};
+            localtime_r(&now, &tm);
+            const int year = tm.tm_year + 1900;
+            WriteTwoDigits(local_time.date, year / 100 % 100);
+            WriteTwoDigits(local_time.date + 2, year % 100);
+            local_time.date[4] = '-';
+            WriteTwoDigits(local_time.date + 5, tm.tm_mon + 1);
+            local_time.date[7] = '-';
+            WriteTwoDigits(local_time.date + 8, tm.tm_mday);
+            WriteTwoDigits(local_time.time, tm.tm_hour);
+            local_time.time[2] = ':';
+            WriteTwoDigits(local_time.time + 3, tm.tm_min);
+            local_time.time[5] = ':';
+            WriteTwoDigits(local_time.time + 6, tm.tm_sec);
+            local_time.valid = true;
+            local_time.second = now;
+            local_time.minute = now - tm.tm_sec;
+            return local_time;
+        }
+
+        const LocalTime &
+        GetLocalTimeNow() {
+            return GetLocalTime(std::time(nullptr));
+        }
+
+        struct LogRecord {
+            std::uint64_t seq = 0;  // global order of the records of all threads
+            Logging::TimeFormat time_format = Logging::TimeFormat::kSeconds;
+            std::int64_t time_ns = 0;
+            int tag = 0;
+            std::string msg{};
+        };
+
+        /**
+         * Single-producer single-consumer ring of the records of one thread.
+         */
+        class LogQueue {
+            std::vector<LogRecord> m_records_;
+            std::size_t m_mask_;
+            alignas(64) std::atomic<std::size_t> m_head_{0};  // written by the producer
+            alignas(64) std::atomic<std::size_t> m_tail_{0};  // written by the consumer
+
+        public:
+            std::atomic<bool> closed{false};  // the producer thread has exited
+
+            explicit LogQueue(std::size_t capacity) {
+                std::size_t n = 1;
+                while (n < capacity) { n <<= 1; }
+                m_records_.resize(n);
+                m_mask_ = n - 1;
+            }
+
+            bool
+            TryPush(LogRecord &record) {
+                const std::size_t head = m_head_.load(std::memory_order_relaxed);
+                if (head - m_tail_.load(std::memory_order_acquire) > m_mask_) { return false; }
+                m_records_[head & m_mask_] = std::move(record);
+                m_head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            void
+            PopAll(std::vector<LogRecord> &records) {
+                std::size_t tail = m_tail_.load(std::memory_order_relaxed);
+                const std::size_t head = m_head_.load(std::memory_order_acquire);
+                for (; tail != head; ++tail) {
+                    records.push_back(std::move(m_records_[tail & m_mask_]));
+                }
+                m_tail_.store(tail, std::memory_order_release);
+            }
+
+            [[nodiscard]] bool
+            Empty() const {
+                return m_head_.load(std::memory_order_acquire) ==
+                       m_tail_.load(std::memory_order_acquire);
+            }
+        };
+    }  // namespace
+
+    struct Logging::Async {
+        AsyncSetting setting{};  // read by the background thread, which StartAsync restarts
+        // copies of the setting read by the producers, which may run while StartAsync sets them
+        std::atomic<std::size_t> queue_capacity{0};
+        std::atomic<Overflow> overflow{Overflow::kCount};
+        std::atomic<std::uint64_t> epoch{0};  // incremented by StartAsync to replace the queues
+        std::atomic<std::uint64_t> seq{0};
+        std::atomic<std::size_t> num_dropped{0};
+        std::atomic<std::size_t> num_unreported{0};
+
+        std::mutex queues_mutex;
+        std::vector<std::shared_ptr<LogQueue>> queues;
+        std::atomic<std::uint64_t> queues_version{0};
+
+        std::mutex wake_mutex;
+        std::condition_variable wake_cv;
+        std::condition_variable flush_cv;
+        bool stop = false;
+        std::uint64_t flush_requested = 0;
+        std::uint64_t flush_done = 0;
+        std::thread thread;
+
+        struct ThreadQueue {
+            std::shared_ptr<LogQueue> queue = nullptr;
+            std::uint64_t epoch = 0;
+
+            ~ThreadQueue() {
+                if (queue != nullptr) { queue->closed.store(true, std::memory_order_release); }
+            }
+        };
+
+        static Async &
+        GetInstance() {
+            // never destroyed, StopAsync runs at exit before the other statics are destroyed
+            static auto *async = new Async();
+            return *async;
+        }
+
+        LogQueue &
+        GetThreadQueue() {
+            thread_local ThreadQueue thread_queue;
+            const std::uint64_t current_epoch = epoch.load(std::memory_order_acquire);
+            if (thread_queue.queue == nullptr || thread_queue.epoch != current_epoch) {
+                if (thread_queue.queue != nullptr) {
+                    thread_queue.queue->closed.store(true, std::memory_order_release);
+                }
+                thread_queue.queue =
+                    std::make_shared<LogQueue>(queue_capacity.load(std::memory_order_relaxed));
+                thread_queue.epoch = current_epoch;
+                const std::scoped_lock lock(queues_mutex);
+                queues.push_back(thread_queue.queue);
+                queues_version.fetch_add(1, std::memory_order_release);
+            }
+            return *thread_queue.queue;
+        }
+
+        /**
+         * @return false if the record is not queued and the caller should write it.
+         */
+        bool
+        Push(const Tag tag, const Timestamp &time, std::string &msg) {
+            LogRecord record;
+            record.seq = seq.fetch_add(1, std::memory_order_relaxed);
+            record.time_format = time.format;
+            record.time_ns = time.ns;
+            record.tag = static_cast<int>(tag);
+            record.msg = std::move(msg);
+            LogQueue &queue = GetThreadQueue();
+            if (queue.TryPush(record)) { return true; }
+            switch (overflow.load(std::memory_order_relaxed)) {
+                case Overflow::kBlock:
+                    do {
+                        {
+                            const std::scoped_lock lock(wake_mutex);
+                            ++flush_requested;  // wake up the background thread now
+                        }
+                        wake_cv.notify_one();
+                        std::this_thread::yield();
+                        if (!IsAsync()) {
+                            msg = std::move(record.msg);
+                            return false;
+                        }
+                    } while (!queue.TryPush(record));
+                    return true;
+                case Overflow::kCount:
+                    num_unreported.fetch_add(1, std::memory_order_relaxed);
+                    [[fallthrough]];
+                case Overflow::kDrop:
+                    num_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+            }
+            return true;
+        }
+
+        void
+        Run() {
+            std::vector<std::shared_ptr<LogQueue>> local_queues;
+            std::uint64_t local_version = std::numeric_limits<std::uint64_t>::max();
+            std::vector<LogRecord> records;
+            std::string out;
+            bool stopping = false;
+            while (!stopping) {
+                std::uint64_t flush_target;
+                {
+                    std::unique_lock lock(wake_mutex);
+                    wake_cv.wait_for(lock, setting.flush_interval, [this] {
+                        return stop || flush_requested != flush_done;
+                    });
+                    stopping = stop;
+                    flush_target = flush_requested;
+                }
+                if (const std::uint64_t version = queues_version.load(std::memory_order_acquire);
+                    version != local_version) {
+                    const std::scoped_lock lock(queues_mutex);
+                    local_queues = queues;
+                    local_version = queues_version.load(std::memory_order_relaxed);
+                }
+                Drain(local_queues, records, out);
+                RemoveClosedQueues();
+                {
+                    const std::scoped_lock lock(wake_mutex);
+                    flush_done = flush_target;
+                }
+                flush_cv.notify_all();
+            }
+        }
+
+        void
+        Drain(
+            const std::vector<std::shared_ptr<LogQueue>> &local_queues,
+            std::vector<LogRecord> &records,
+            std::string &out) {
+            records.clear();
+            for (const auto &queue: local_queues) { queue->PopAll(records); }
+            const std::size_t num_unreported_now =
+                num_unreported.exchange(0, std::memory_order_relaxed);
+            if (records.empty() && num_unreported_now == 0) { return; }
+            std::sort(records.begin(), records.end(), [](const auto &a, const auto &b) {
+                return a.seq < b.seq;
+            });
+            out.clear();
+            const std::scoped_lock lock(g_print_mutex);
+            // without progress bars, every record ends with a new line
+            const char *separator = ProgressBar::GetNumBars() == 0 ? "\n" : "";
+            for (std::size_t i = 0; i < records.size(); ++i) {
+                if (i > 0 && *separator == '\0') { out += '\n'; }
+                const Timestamp time{records[i].time_format, records[i].time_ns};
+                AppendPrefix(out, static_cast<Tag>(records[i].tag), time);
+                out += records[i].msg;
+                out += separator;
+            }
+            if (num_unreported_now > 0) {
+                if (!records.empty() && *separator == '\0') { out += '\n'; }
+                AppendPrefix(out, Tag::kWarn, Now());
+                out += fmt::format("{} log records were dropped.", num_unreported_now);
+                out += separator;
+            }
+            ProgressBar::Write(out);
+        }
+
+        void
+        RemoveClosedQueues() {
+            const std::scoped_lock lock(queues_mutex);
+            const auto removed = std::remove_if(queues.begin(), queues.end(), [](const auto &q) {
+                return q->closed.load(std::memory_order_acquire) && q->Empty();
+            });
+            if (removed == queues.end()) { return; }
+            queues.erase(removed, queues.end());
+            queues_version.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    std::atomic<bool> Logging::s_async_{false};
+    std::atomic<Logging::TimeFormat> Logging::s_time_format_{Logging::TimeFormat::kSeconds};
     #ifndef NDEBUG
     LoggingLevel Logging::s_level_ = kDebug;
     #else
@@ -19,44 +317,198 @@ namespace erl::common {
         return s_level_;
     }
 
+    void
+    Logging::StartAsync(const AsyncSetting &setting) {
+        StopAsync();
+        Async &async = Async::GetInstance();
+        async.setting = setting;
+        async.queue_capacity.store(setting.queue_capacity, std::memory_order_relaxed);
+        async.overflow.store(setting.overflow, std::memory_order_relaxed);
+        async.num_dropped = 0;
+        async.num_unreported = 0;
+        async.stop = false;
+        async.epoch.fetch_add(1, std::memory_order_release);
+        async.thread = std::thread([&async] { async.Run(); });
+        s_async_.store(true, std::memory_order_release);
+        static const bool registered = std::atexit([] { StopAsync(); }) == 0;
+        (void) registered;
+    }
+
+    void
+    Logging::StartAsync() {
+        StartAsync(AsyncSetting());
+    }
+
+    void
+    Logging::StopAsync() {
+        if (!s_async_.exchange(false, std::memory_order_acq_rel)) { return; }
+        Async &async = Async::GetInstance();
+        {
+            const std::scoped_lock lock(async.wake_mutex);
+            async.stop = true;
+        }
+        async.wake_cv.notify_one();
+        async.thread.join();
+        async.flush_cv.notify_all();
+    }
+
+    void
+    Logging::Flush() {
+        if (!IsAsync()) { return; }
+        Async &async = Async::GetInstance();
+        std::unique_lock lock(async.wake_mutex);
+        const std::uint64_t target = ++async.flush_requested;
+        async.wake_cv.notify_one();
+        async.flush_cv.wait(lock, [&async, target] {
+            return async.flush_done >= target || async.stop;
+        });
+    }
+
+    std::size_t
+    Logging::GetNumDroppedRecords() {
+        return Async::GetInstance().num_dropped.load(std::memory_order_relaxed);
+    }
+
+    void
+    Logging::Write(const std::string &msg) {
+        Flush();
+        const std::scoped_lock lock(g_print_mutex);
+        ProgressBar::Write(msg);
+    }
+
+    void
+    Logging::Submit(const Tag tag, std::string msg) {
+        const Timestamp now = Now();
+        if (tag == Tag::kFatal) {
+            Flush();  // the program exits after this
+        } else if (IsAsync() && Async::GetInstance().Push(tag, now, msg)) {
+            return;
+        }
+        std::string out;
+        AppendPrefix(out, tag, now);
+        out += msg;
+        const std::scoped_lock lock(g_print_mutex);
+        if (ProgressBar::GetNumBars() == 0) { out += "\n"; }
+        ProgressBar::Write(out);
+    }
+
+    std::string
+    Logging::SubmitFailure(std::string msg) {
+        Flush();
+        std::string out;
+        AppendPrefix(out, Tag::kFailure, Now());
+        const std::scoped_lock lock(g_print_mutex);
+        if (ProgressBar::GetNumBars() == 0) { msg += "\n"; }
+        ProgressBar::Write(out + msg);
+        return msg;
+    }
+
+    void
+    Logging::SetTimeFormat(const TimeFormat format) {
+        s_time_format_.store(format, std::memory_order_relaxed);
+    }
+
+    Logging::TimeFormat
+    Logging::GetTimeFormat() {
+        return s_time_format_.load(std::memory_order_relaxed);
+    }
+
+    Logging::Timestamp
+    Logging::Now() {
+        using namespace std::chrono;
+        const TimeFormat format = s_time_format_.load(std::memory_order_relaxed);
+        if (format == TimeFormat::kMonotonic) {
+            return {format, duration_cast<nanoseconds>(steady_clock::now() - g_start_time).count()};
+        }
+        return {format, duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count()};
+    }
+
+    void
+    Logging::AppendPrefix(std::string &out, const Tag tag, const Timestamp &time) {
+        static constexpr const char *kLabels[] = {
+            "DEBUG",
+            "INFO",
+            "WARN",
+            "ERROR",
+            "FATAL",
+            "SUCCESS",
+            "FAILURE",
+        };
+        static constexpr std::size_t kNumTags = std::size(kLabels);
+        // escape sequences before and after the prefix, formatted once
+        static const auto kStyles = [] {
+            const fmt::text_style styles[kNumTags] = {
+                fmt::fg(fmt::color::orange) | fmt::emphasis::bold,
+                fmt::fg(fmt::color::deep_sky_blue) | fmt::emphasis::bold,
+                fmt::fg(fmt::color::orange_red) | fmt::emphasis::bold,
+                fmt::fg(fmt::color::red) | fmt::emphasis::bold,
+                fmt::fg(fmt::color::dark_red) | fmt::emphasis::bold,
+                fmt::fg(fmt::color::spring_green) | fmt::emphasis::bold,
+                fmt::fg(fmt::color::red) | fmt::emphasis::bold,
+            };
+            std::array<std::pair<std::string, std::string>, kNumTags> begin_end;
+            for (std::size_t i = 0; i < kNumTags; ++i) {
+                const std::string styled = fmt::format(styles[i], "{}", '\x1f');
+                const std::size_t pos = styled.find('\x1f');
+                begin_end[i] = {styled.substr(0, pos), styled.substr(pos + 1)};
+            }
+            return begin_end;
+        }();
+
+        const auto i = static_cast<std::size_t>(tag);
+        out += kStyles[i].first;
+        out += '[';
+        if (time.format == TimeFormat::kMonotonic) {
+            const std::int64_t us = time.ns / 1000;
+            fmt::format_to(std::back_inserter(out), "{}.{:06}", us / 1000000, us % 1000000);
+        } else {
+            const std::time_t seconds = time.ns / 1000000000;
+            out.append(GetLocalTime(seconds).time, sizeof(LocalTime::time));
+            if (time.format == TimeFormat::kMicroseconds) {
+                fmt::format_to(std::back_inserter(out), ".{:06}", time.ns % 1000000000 / 1000);
+            }
+        }
+        out += "][";
+        out += kLabels[i];
+        out += "]: ";
+        out += kStyles[i].second;
+    }
+
     std::string
     Logging::GetDateStr() {
-        time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-        return fmt::format("{:%Y-%m-%d}", *std::localtime(&now));
-    #else
-        return fmt::format("{:%Y-%m-%d}", fmt::localtime(now));
-    #endif
+        const LocalTime &now = GetLocalTimeNow();
+        return {now.date, sizeof(now.date)};
     }
 
     std::string
     Logging::GetTimeStr() {
-        time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-        return fmt::format("{:%X}", *std::localtime(&now));
-    #else
-        return fmt::format("{:%X}", fmt::localtime(now));
-    #endif
+        const LocalTime &now = GetLocalTimeNow();
+        return {now.time, sizeof(now.time)};
     }
 
     std::string
     Logging::GetDateTimeStr() {
-        time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-        return fmt::format("{:%Y-%m-%d %X}", *std::localtime(&now));
-    #else
-        return fmt::format("{:%Y-%m-%d %X}", fmt::localtime(now));
-    #endif
+        const LocalTime &now = GetLocalTimeNow();
+        std::string str(now.date, sizeof(now.date));
+        str += ' ';
+        str.append(now.time, sizeof(now.time));
+        return str;
     }
 
     std::string
     Logging::GetTimeStamp() {
-        time_t now = std::time(nullptr);
-    #if FMT_VERSION >= 110200
-        return fmt::format("{:%Y%m%d-%H%M%S}", *std::localtime(&now));
-    #else
-        return fmt::format("{:%Y%m%d-%H%M%S}", fmt::localtime(now));
-    #endif
+        // YYYYmmdd-HHMMSS
+        const LocalTime &now = GetLocalTimeNow();
+        std::string str;
+        str.reserve(15);
+        for (const char c: now.date) {
+            if (c != '-') { str += c; }
+        }
+        str += '-';
+        for (const char c: now.time) {
+            if (c != ':') { str += c; }
+        }
+        return str;
     }
 
 }  // namespace erl::common
@@ -0,0 +1,407 @@
+#include "erl_common/profiler.hpp"
+
+#include "erl_common/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace erl::common {
+
+    namespace {
+        constexpr std::uint64_t kNoMin = std::numeric_limits<std::uint64_t>::max();
+
+        // incremented by Profiler::Reset, each thread clears its own statistics when it sees it
+        std::atomic<std::uint64_t> g_reset_epoch{0};
+
+        std::int64_t
+        NowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        std::size_t
+        GetHistogramBucket(const std::uint64_t ns) {
+            if (ns == 0) { return 0; }
+            const auto bucket = static_cast<std::size_t>(64 - __builtin_clzll(ns));
+            return std::min(bucket, Profiler::kNumHistogramBuckets - 1);
+        }
+
+        /**
+         * Node of the tree of one thread. The statistics are written by the thread only.
+         */
+        struct ThreadNode {
+            const ProfileSite *site = nullptr;
+            std::vector<std::pair<const ProfileSite *, std::uint32_t>> children{};
+            std::atomic<std::uint64_t> count{0};
+            std::atomic<std::uint64_t> total_ns{0};
+            std::atomic<std::uint64_t> min_ns{kNoMin};
+            std::atomic<std::uint64_t> max_ns{0};
+            std::array<std::atomic<std::uint64_t>, Profiler::kNumHistogramBuckets> histogram{};
+
+            // single writer, so no read-modify-write instructions are needed
+            static void
+            Increase(std::atomic<std::uint64_t> &value, const std::uint64_t delta) {
+                const std::uint64_t old_value = value.load(std::memory_order_relaxed);
+                value.store(old_value + delta, std::memory_order_relaxed);
+            }
+
+            void
+            Add(const std::uint64_t ns) {
+                Increase(count, 1);
+                Increase(total_ns, ns);
+                if (ns < min_ns.load(std::memory_order_relaxed)) {
+                    min_ns.store(ns, std::memory_order_relaxed);
+                }
+                if (ns > max_ns.load(std::memory_order_relaxed)) {
+                    max_ns.store(ns, std::memory_order_relaxed);
+                }
+                Increase(histogram[GetHistogramBucket(ns)], 1);
+            }
+
+            [[nodiscard]] Profiler::Stats
+            GetStats() const {
+                Profiler::Stats stats;
+                stats.count = count.load(std::memory_order_relaxed);
+                if (stats.count == 0) { return stats; }
+                stats.total_ns = total_ns.load(std::memory_order_relaxed);
+                stats.min_ns = min_ns.load(std::memory_order_relaxed);
+                stats.max_ns = max_ns.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < Profiler::kNumHistogramBuckets; ++i) {
+                    stats.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+                }
+                return stats;
+            }
+
+            void
+            Reset() {
+                count.store(0, std::memory_order_relaxed);
+                total_ns.store(0, std::memory_order_relaxed);
+                min_ns.store(kNoMin, std::memory_order_relaxed);
+                max_ns.store(0, std::memory_order_relaxed);
+                for (auto &n: histogram) { n.store(0, std::memory_order_relaxed); }
+            }
+        };
+
+        void
+        SortByTotal(Profiler::Node &node) {
+            std::sort(node.children.begin(), node.children.end(), [](const auto &a, const auto &b) {
+                return a.stats.total_ns > b.stats.total_ns;
+            });
+            for (Profiler::Node &child: node.children) { SortByTotal(child); }
+        }
+
+        std::string
+        QuoteCsv(const std::string &str) {
+            std::string quoted = "\"";
+            for (const char c: str) {
+                if (c == '"') { quoted += '"'; }
+                quoted += c;
+            }
+            quoted += '"';
+            return quoted;
+        }
+    }  // namespace
+
+    ProfileSite::ProfileSite(
+        std::string name_in,
+        const char *function_in,
+        const char *file_in,
+        const int line_in)
+        : name(std::move(name_in)),
+          function(function_in),
+          file(file_in),
+          line(line_in)
+#ifdef TRACY_ENABLE
+          ,
+          tracy_location{name.c_str(), function, file, static_cast<std::uint32_t>(line), 0}
+#endif
+    {
+    }
+
+    std::uint64_t
+    Profiler::Stats::GetPercentileNs(const double p) const {
+        if (count == 0) { return 0; }
+        const auto target = std::max<std::uint64_t>(
+            1,
+            static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * count)));
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < kNumHistogramBuckets; ++i) {
+            cumulative += histogram[i];
+            if (cumulative < target) { continue; }
+            const std::uint64_t upper = i == 0 ? 0 : std::uint64_t{1} << i;
+            return std::clamp(upper, min_ns, max_ns);
+        }
+        return max_ns;
+    }
+
+    void
+    Profiler::Stats::Merge(const Stats &other) {
+        if (other.count == 0) { return; }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        count += other.count;
+        total_ns += other.total_ns;
+        min_ns = std::min(min_ns, other.min_ns);
+        max_ns = std::max(max_ns, other.max_ns);
+        for (std::size_t i = 0; i < kNumHistogramBuckets; ++i) {
+            histogram[i] += other.histogram[i];
+        }
+    }
+
+    struct Profiler::ThreadProfile {
+        struct Frame {
+            std::uint32_t node;
+            std::int64_t start_ns;
+        };
+
+        // guards adding nodes and children, the thread reads the tree without it
+        std::mutex mutex{};
+        std::deque<ThreadNode> nodes{};  // nodes[0] is the root
+        std::vector<Frame> stack{};      // only used by the thread
+        // reset epoch of the statistics, older ones are left out of the reports
+        std::atomic<std::uint64_t> epoch{g_reset_epoch.load(std::memory_order_relaxed)};
+
+        ThreadProfile() { nodes.emplace_back(); }
+
+        /**
+         * Clear the statistics of the thread, called by the thread only so that they keep a
+         * single writer.
+         */
+        void
+        ResetStats(const std::uint64_t new_epoch) {
+            for (ThreadNode &node: nodes) { node.Reset(); }
+            epoch.store(new_epoch, std::memory_order_release);
+        }
+
+        void
+        MergeInto(const std::uint32_t index, Node &out, const bool with_stats) const {
+            const ThreadNode &node = nodes[index];
+            if (with_stats) { out.stats.Merge(node.GetStats()); }
+            for (const auto &[site, child_index]: node.children) {
+                auto it = std::find_if(out.children.begin(), out.children.end(), [&](auto &c) {
+                    return c.site == site;
+                });
+                if (it == out.children.end()) {
+                    it = out.children.emplace(out.children.end());
+                    it->site = site;
+                }
+                MergeInto(child_index, *it, with_stats);
+            }
+        }
+    };
+
+    struct Profiler::Registry {
+        std::mutex mutex{};
+        std::vector<std::unique_ptr<ThreadProfile>> profiles{};
+        std::atomic<bool> report_at_exit{false};
+
+        static Registry &
+        Get() {
+            // not destroyed, the report runs at exit
+            static auto *registry = new Registry();
+            return *registry;
+        }
+    };
+
+    std::atomic<bool> Profiler::s_enabled_{true};
+
+    void
+    Profiler::SetEnabled(const bool enabled) {
+        s_enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    Profiler::ThreadProfile &
+    Profiler::GetThreadProfile() {
+        // owned by the registry, so the statistics of a thread outlive it
+        thread_local ThreadProfile *profile = nullptr;
+        if (profile != nullptr) { return *profile; }
+        Registry &registry = Registry::Get();
+        const std::scoped_lock lock(registry.mutex);
+        profile = registry.profiles.emplace_back(std::make_unique<ThreadProfile>()).get();
+        return *profile;
+    }
+
+    void
+    Profiler::Enter(const ProfileSite &site) {
+        ThreadProfile &profile = GetThreadProfile();
+        const std::uint32_t parent = profile.stack.empty() ? 0 : profile.stack.back().node;
+        std::uint32_t index = 0;
+        for (const auto &[child_site, child_index]: profile.nodes[parent].children) {
+            if (child_site == &site) {
+                index = child_index;
+                break;
+            }
+        }
+        if (index == 0) {  // the first time in this parent
+            const std::scoped_lock lock(profile.mutex);
+            index = static_cast<std::uint32_t>(profile.nodes.size());
+            profile.nodes.emplace_back().site = &site;
+            profile.nodes[parent].children.emplace_back(&site, index);
+        }
+        profile.stack.push_back({index, NowNs()});
+    }
+
+    void
+    Profiler::Leave() {
+        const std::int64_t now = NowNs();
+        ThreadProfile &profile = GetThreadProfile();
+        if (profile.stack.empty()) { return; }
+        if (const std::uint64_t epoch = g_reset_epoch.load(std::memory_order_relaxed);
+            epoch != profile.epoch.load(std::memory_order_relaxed)) {
+            profile.ResetStats(epoch);
+        }
+        const ThreadProfile::Frame frame = profile.stack.back();
+        profile.stack.pop_back();
+        profile.nodes[frame.node].Add(static_cast<std::uint64_t>(now - frame.start_ns));
+    }
+
+    Profiler::Node
+    Profiler::GetTree() {
+        Node root;
+        Registry &registry = Registry::Get();
+        const std::scoped_lock lock(registry.mutex);
+        const std::uint64_t epoch = g_reset_epoch.load(std::memory_order_acquire);
+        for (const auto &profile: registry.profiles) {
+            const std::scoped_lock profile_lock(profile->mutex);
+            profile->MergeInto(0, root, profile->epoch.load(std::memory_order_acquire) == epoch);
+        }
+        SortByTotal(root);
+        return root;
+    }
+
+    void
+    Profiler::Reset() {
+        g_reset_epoch.fetch_add(1, std::memory_order_release);
+    }
+
+    std::string
+    Profiler::ToString() {
+        const Node root = GetTree();
+        struct Row {
+            std::string name;
+            const Stats *stats;
+            double percent;  // of the parent, negative for the top level
+        };
+
+        std::vector<Row> rows;
+        std::size_t name_width = 5;
+        auto collect = [&](auto &self, const Node &node, const std::size_t depth) -> void {
+            for (const Node &child: node.children) {
+                Row &row = rows.emplace_back();
+                row.name = std::string(2 * depth, ' ') + child.site->name;
+                row.stats = &child.stats;
+                row.percent = depth == 0 || node.stats.total_ns == 0
+                                  ? -1.0
+                                  : 100.0 * child.stats.total_ns / node.stats.total_ns;
+                name_width = std::max(name_width, row.name.size());
+                self(self, child, depth + 1);
+            }
+        };
+        collect(collect, root, 0);
+        name_width = std::min<std::size_t>(name_width, 80);
+
+        std::string out;
+        char line[256];
+        std::snprintf(
+            line,
+            sizeof(line),
+            "%-*s %10s %12s %7s %10s %10s %10s %10s %10s\n",
+            static_cast<int>(name_width),
+            "scope",
+            "count",
+            "total ms",
+            "%",
+            "mean us",
+            "min us",
+            "max us",
+            "p50 us",
+            "p99 us");
+        out += line;
+        for (const Row &row: rows) {
+            const Stats &s = *row.stats;
+            char percent[16] = "";
+            if (row.percent >= 0) { std::snprintf(percent, sizeof(percent), "%.1f", row.percent); }
+            std::snprintf(
+                line,
+                sizeof(line),
+                "%-*s %10llu %12.3f %7s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                static_cast<int>(name_width),
+                row.name.substr(0, name_width).c_str(),
+                static_cast<unsigned long long>(s.count),
+                s.total_ns * 1.0e-6,
+                percent,
+                s.GetMeanNs() * 1.0e-3,
+                s.min_ns * 1.0e-3,
+                s.max_ns * 1.0e-3,
+                s.GetPercentileNs(50) * 1.0e-3,
+                s.GetPercentileNs(99) * 1.0e-3);
+            out += line;
+        }
+        return out;
+    }
+
+    std::string
+    Profiler::ToCsv() {
+        const Node root = GetTree();
+        std::string out = "path,count,total_ns,mean_ns,min_ns,max_ns,p50_ns,p90_ns,p99_ns\n";
+        auto write = [&out](auto &self, const Node &node, const std::string &prefix) -> void {
+            for (const Node &child: node.children) {
+                const std::string path =
+                    prefix.empty() ? child.site->name : prefix + ';' + child.site->name;
+                const Stats &s = child.stats;
+                out += QuoteCsv(path);
+                for (const double value:
+                     {static_cast<double>(s.count),
+                      static_cast<double>(s.total_ns),
+                      s.GetMeanNs(),
+                      static_cast<double>(s.min_ns),
+                      static_cast<double>(s.max_ns),
+                      static_cast<double>(s.GetPercentileNs(50)),
+                      static_cast<double>(s.GetPercentileNs(90)),
+                      static_cast<double>(s.GetPercentileNs(99))}) {
+                    char buf[32];
+                    std::snprintf(buf, sizeof(buf), ",%.17g", value);
+                    out += buf;
+                }
+                out += '\n';
+                self(self, child, path);
+            }
+        };
+        write(write, root, "");
+        return out;
+    }
+
+    bool
+    Profiler::WriteCsv(const std::string &path) {
+        std::ofstream ofs(path, std::ios::binary);
+        if (!ofs.is_open()) {
+            ERL_WARN("Failed to open {}.", path);
+            return false;
+        }
+        ofs << ToCsv();
+        return ofs.good();
+    }
+
+    void
+    Profiler::SetReportAtExit(const bool report) {
+        Registry &registry = Registry::Get();
+        registry.report_at_exit.store(report, std::memory_order_relaxed);
+        static const bool registered = std::atexit([] {
+            if (Registry::Get().report_at_exit.load(std::memory_order_relaxed)) {
+                Logging::Write(ToString());
+            }
+        }) == 0;
+        (void) registered;
+    }
+}  // namespace erl::common
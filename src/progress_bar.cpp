@@ -1,16 +1,231 @@
 #include "erl_common/progress_bar.hpp"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace erl::common {
 
-    std::vector<std::weak_ptr<const ProgressBar>> ProgressBar::s_progress_bars_ = {};
+    struct ProgressBar::Registry {
+        std::mutex mutex{};  // guards the bars and the terminal
+        std::condition_variable cv{};
+        std::vector<ProgressBar *> bars{};  // a bar removes itself on Close and destruction
+        std::size_t num_lines = 0;          // bar lines drawn, the cursor is at the end of the last
+        bool dirty = false;                 // a setting changed since the last draw
+        bool renderer_running = false;
+        std::chrono::duration<double> period{0.05};
+
+        void
+        StartRenderer() {
+            if (renderer_running) { return; }
+            renderer_running = true;
+            // detached, it exits when the last bar is closed
+            std::thread(&ProgressBar::RenderLoop).detach();
+        }
+
+        void
+        UpdateNumBars() const {
+            s_num_bars_.store(bars.size(), std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<std::size_t> ProgressBar::s_num_bars_{0};
+
+    ProgressBar::Registry &
+    ProgressBar::GetRegistry() {
+        // not destroyed, the renderer may still run at exit
+        static auto *registry = new Registry();
+        return *registry;
+    }
 
     std::shared_ptr<ProgressBar>
     ProgressBar::Open(std::shared_ptr<Setting> setting, std::ostream &out) {
-        auto bar = std::shared_ptr<ProgressBar>(new ProgressBar(std::move(setting), out));
-        s_progress_bars_.push_back(bar);
-        bar->Update(0);
-        bar->m_displayed_ = true;
+        auto bar = std::shared_ptr<ProgressBar>(new ProgressBar(setting.get(), out));
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        registry.bars.push_back(bar.get());
+        registry.UpdateNumBars();
+        Draw(registry, "", out);
+        registry.StartRenderer();
         return bar;
     }
 
+    void
+    ProgressBar::Close() {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        const auto itr = std::find(registry.bars.begin(), registry.bars.end(), this);
+        if (itr == registry.bars.end()) { return; }
+        Draw(registry, "", m_out_);  // the final count
+        registry.bars.erase(itr);
+        registry.UpdateNumBars();
+        // the last bars stay on the screen, a closed bar among others is erased by the next draw
+        if (registry.bars.empty()) { registry.num_lines = 0; }
+        registry.cv.notify_all();
+    }
+
+    void
+    ProgressBar::SetRefreshRate(const double hz) {
+        if (!(hz > 0.0)) { return; }
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        registry.period = std::chrono::duration<double>(1.0 / hz);
+        registry.cv.notify_all();
+    }
+
+    double
+    ProgressBar::GetRefreshRate() {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        return 1.0 / registry.period.count();
+    }
+
+    void
+    ProgressBar::Refresh() {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        if (registry.bars.empty()) { return; }
+        Draw(registry, "", registry.bars.front()->m_out_);
+    }
+
+    void
+    ProgressBar::SetDescription(const std::string &description) {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        m_setting_.description = description;
+        registry.dirty = true;
+    }
+
+    void
+    ProgressBar::SetTotal(const std::size_t total) {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        m_setting_.total = total;
+        registry.dirty = true;
+    }
+
+    ProgressBar::Setting
+    ProgressBar::GetSetting() const {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        return m_setting_;
+    }
+
+    void
+    ProgressBar::Write(const std::string &str, std::ostream &out) {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        if (registry.bars.empty()) {
+            out << str << std::flush;
+            return;
+        }
+        Draw(registry, str, out);
+    }
+
+    void
+    ProgressBar::Reset() {
+        Registry &registry = GetRegistry();
+        const std::scoped_lock lock(registry.mutex);
+        m_count_.store(0, std::memory_order_relaxed);
+        m_t0_ = std::chrono::steady_clock::now();
+        m_rendered_count_ = 0;
+        m_rendered_seconds_ = 0.0;
+        m_fps_ = 0.0;
+        registry.dirty = true;
+        if (std::find(registry.bars.begin(), registry.bars.end(), this) == registry.bars.end()) {
+            registry.bars.push_back(this);
+            registry.UpdateNumBars();
+            registry.StartRenderer();
+        }
+    }
+
+    void
+    ProgressBar::Draw(Registry &registry, const std::string &str, std::ostream &out) {
+        std::vector<ProgressBar *> bars = registry.bars;
+        std::stable_sort(bars.begin(), bars.end(), [](const auto *a, const auto *b) {
+            return a->m_setting_.position < b->m_setting_.position;
+        });
+        if (registry.num_lines >= 1) { GoBackLines(out, registry.num_lines); }
+        if (!str.empty()) { out << str << '\n'; }
+        const auto now = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < bars.size(); ++i) {
+            if (i > 0) { out << '\n'; }
+            out << bars[i]->Render(now);
+        }
+        out << std::flush;
+        registry.num_lines = bars.size();
+        registry.dirty = false;
+    }
+
+    void
+    ProgressBar::RenderLoop() {
+        Registry &registry = GetRegistry();
+        std::unique_lock lock(registry.mutex);
+        while (!registry.bars.empty()) {
+            registry.cv.wait_for(lock, registry.period);
+            if (registry.bars.empty()) { break; }
+            bool changed = registry.dirty;
+            for (const ProgressBar *bar: registry.bars) {
+                changed = changed || bar->GetCount() != bar->m_rendered_count_;
+            }
+            if (changed) { Draw(registry, "", registry.bars.front()->m_out_); }
+        }
+        registry.renderer_running = false;
+    }
+
+    std::string
+    ProgressBar::Render(const std::chrono::steady_clock::time_point now) {
+        const std::size_t count = m_count_.load(std::memory_order_relaxed);
+        const std::size_t total = m_setting_.total;
+        const double passed_seconds = std::chrono::duration<double>(now - m_t0_).count();
+        double fraction = 0.0;
+        if (total > 0) {
+            fraction = std::clamp(static_cast<double>(count) / static_cast<double>(total), 0., 1.);
+        }
+        // rate over the interval since the count last changed
+        if (count != m_rendered_count_) {
+            if (count > m_rendered_count_ && passed_seconds > m_rendered_seconds_) {
+                m_fps_ = static_cast<double>(count - m_rendered_count_) /
+                         (passed_seconds - m_rendered_seconds_);
+            }
+            m_rendered_count_ = count;
+            m_rendered_seconds_ = passed_seconds;
+        }
+        const double fps =
+            m_fps_ > 0.0 ? m_fps_ : static_cast<double>(count) / (passed_seconds + 0.001);
+
+        std::stringstream ss_time;
+        const double remaining_seconds =
+            fraction > 0.0 ? passed_seconds / fraction - passed_seconds : 0.0;
+        ss_time << "| [" << DurationToString(remaining_seconds) << "/"
+                << DurationToString(passed_seconds) << "]";
+        std::string time_str = ss_time.str();
+
+        std::stringstream ss_count;
+        if (total > 0) {
+            ss_count << "[" << std::setw(3) << count << "/" << total << ": "
+                     << std::setprecision(2) << fps << "it/s]";
+        }
+        std::string count_str = ss_count.str();
+
+        std::stringstream ss_desc;
+        ss_desc << m_setting_.description << ": ";
+        std::string desc_str = ss_desc.str();
+
+        std::string symbol_buffer = m_setting_.GetSymbolBuffer();
+        std::size_t n = symbol_buffer.size() / 2;
+        std::size_t bar_width = n - count_str.size() - time_str.size();
+        std::size_t offset =  // static_cast from positive real to unsigned integer is fine.
+            n - static_cast<std::size_t>(static_cast<double>(bar_width) * fraction);
+
+        std::stringstream ss_bar;
+        ss_bar << desc_str;  // write description
+        ss_bar.write(
+            symbol_buffer.data() + offset,
+            static_cast<std::streamsize>(bar_width));  // write bar
+        ss_bar << time_str << count_str;               // write time and count
+        ss_bar << "[" << std::fixed << std::setprecision(2) << std::setw(6) << 100 * fraction
+               << "%]";  // write time and count
+        return ss_bar.str();
+    }
 }  // namespace erl::common
@@ -0,0 +1,228 @@
+#include "erl_common/timer.hpp"
+
+#include "erl_common/logging.hpp"
+
+#include <algorithm>
+
+namespace erl::common {
+
+    bool
+    Scheduler::Handle::Cancel() {
+        if (m_task_ == nullptr) { return false; }
+        std::function<void()> callback;  // destroyed after the lock is released
+        std::unique_lock lock(m_scheduler_->m_mutex_);
+        const bool was_active = m_task_->active;
+        m_task_->active = false;
+        std::vector<Entry> &heap = m_scheduler_->m_heap_;
+        const auto it = std::find_if(heap.begin(), heap.end(), [this](const Entry &entry) {
+            return entry.task == m_task_;
+        });
+        if (it != heap.end()) {
+            heap.erase(it);
+            std::make_heap(heap.begin(), heap.end(), std::greater<>());
+            m_scheduler_->m_cv_.notify_all();  // a worker may wait for its deadline
+        }
+        if (m_task_->runner == std::this_thread::get_id()) {
+            return was_active;  // called from the callback, the worker releases it after the run
+        }
+        m_scheduler_->m_done_cv_.wait(lock, [this] { return !m_task_->running; });
+        callback = std::move(m_task_->callback);
+        lock.unlock();
+        return was_active;
+    }
+
+    bool
+    Scheduler::Handle::IsActive() const {
+        if (m_task_ == nullptr) { return false; }
+        const std::scoped_lock lock(m_scheduler_->m_mutex_);
+        return m_task_->active;
+    }
+
+    std::uint64_t
+    Scheduler::Handle::GetNumRuns() const {
+        if (m_task_ == nullptr) { return 0; }
+        const std::scoped_lock lock(m_scheduler_->m_mutex_);
+        return m_task_->num_runs;
+    }
+
+    std::uint64_t
+    Scheduler::Handle::GetNumMissed() const {
+        if (m_task_ == nullptr) { return 0; }
+        const std::scoped_lock lock(m_scheduler_->m_mutex_);
+        return m_task_->num_missed;
+    }
+
+    RunningStatistics
+    Scheduler::Handle::GetJitter() const {
+        if (m_task_ == nullptr) { return {}; }
+        const std::scoped_lock lock(m_scheduler_->m_mutex_);
+        return m_task_->jitter;
+    }
+
+    Scheduler::Scheduler()
+        : Scheduler(Setting()) {}
+
+    Scheduler::Scheduler(Setting setting)
+        : m_setting_(std::move(setting)) {
+        const std::size_t num_threads = std::max<std::size_t>(1, m_setting_.num_threads);
+        m_workers_.reserve(num_threads);
+        m_worker_ids_.reserve(num_threads);
+        for (std::size_t i = 0; i < num_threads; ++i) {
+            m_workers_.emplace_back(&Scheduler::WorkerLoop, this);
+            m_worker_ids_.push_back(m_workers_.back().get_id());
+        }
+    }
+
+    Scheduler &
+    Scheduler::GetDefault() {
+        // not destroyed, timers in static objects may be stopped at exit
+        static auto *scheduler = new Scheduler();
+        return *scheduler;
+    }
+
+    Scheduler::Handle
+    Scheduler::ScheduleAt(const Clock::time_point deadline, std::function<void()> callback) {
+        auto task = std::make_shared<Task>();
+        task->callback = std::move(callback);
+        task->period = Clock::duration::zero();
+        task->deadline = deadline;
+        Push(task);
+        return {this, std::move(task)};
+    }
+
+    Scheduler::Handle
+    Scheduler::SchedulePeriodic(
+        const Clock::duration period,
+        std::function<void()> callback,
+        const Clock::duration initial_delay) {
+        if (period <= Clock::duration::zero()) {
+            ERL_WARN("Period must be positive, the task is not scheduled.");
+            return {};
+        }
+        auto task = std::make_shared<Task>();
+        task->callback = std::move(callback);
+        task->period = period;
+        task->deadline = Clock::now() + initial_delay;
+        Push(task);
+        return {this, std::move(task)};
+    }
+
+    void
+    Scheduler::Stop() {
+        std::vector<std::function<void()>> callbacks;  // destroyed after the lock is released
+        {
+            const std::scoped_lock lock(m_mutex_);
+            if (!m_stopping_) {
+                m_stopping_ = true;
+                callbacks.reserve(m_heap_.size());
+                for (const Entry &entry: m_heap_) {
+                    entry.task->active = false;
+                    callbacks.push_back(std::move(entry.task->callback));
+                }
+                m_heap_.clear();
+            }
+        }
+        m_cv_.notify_all();
+        // a worker cannot join itself, and joining the others could deadlock with their own
+        // callbacks calling Stop; it exits after the callback and is joined by a later Stop
+        const std::thread::id this_id = std::this_thread::get_id();
+        if (std::find(m_worker_ids_.begin(), m_worker_ids_.end(), this_id) !=
+            m_worker_ids_.end()) {
+            return;
+        }
+        const std::scoped_lock lock(m_join_mutex_);
+        for (std::thread &worker: m_workers_) {
+            if (worker.joinable()) { worker.join(); }
+        }
+    }
+
+    std::size_t
+    Scheduler::GetNumPending() const {
+        const std::scoped_lock lock(m_mutex_);
+        return m_heap_.size();
+    }
+
+    void
+    Scheduler::Push(const std::shared_ptr<Task> &task) {
+        {
+            const std::scoped_lock lock(m_mutex_);
+            if (m_stopping_) {
+                task->active = false;
+                return;
+            }
+            const bool earliest = m_heap_.empty() || task->deadline < m_heap_.front().deadline;
+            m_heap_.push_back({task->deadline, m_seq_++, task});
+            std::push_heap(m_heap_.begin(), m_heap_.end(), std::greater<>());
+            if (!earliest) { return; }  // the workers already wait for an earlier deadline
+        }
+        m_cv_.notify_one();
+    }
+
+    void
+    Scheduler::PopTop() {
+        std::pop_heap(m_heap_.begin(), m_heap_.end(), std::greater<>());
+        m_heap_.pop_back();
+    }
+
+    void
+    Scheduler::WorkerLoop() {
+        std::unique_lock lock(m_mutex_);
+        while (!m_stopping_) {
+            if (m_heap_.empty()) {
+                m_cv_.wait(lock);
+                continue;
+            }
+            const Entry &top = m_heap_.front();
+            const Clock::time_point deadline = top.deadline;
+            Clock::time_point now = Clock::now();
+            if (now < deadline) {
+                if (deadline - now > m_setting_.spin_threshold) {
+                    m_cv_.wait_until(lock, deadline - m_setting_.spin_threshold);
+                    continue;
+                }
+                lock.unlock();
+                while ((now = Clock::now()) < deadline) { std::this_thread::yield(); }
+                lock.lock();
+                continue;  // the heap may have changed meanwhile
+            }
+            const std::shared_ptr<Task> task = top.task;
+            PopTop();
+
+            const double jitter = std::chrono::duration<double, std::micro>(now - deadline).count();
+            task->jitter.Add(jitter);
+            m_jitter_histogram_.Record(jitter);
+            ++task->num_runs;
+            task->running = true;
+            task->runner = std::this_thread::get_id();
+            lock.unlock();
+            task->callback();
+            lock.lock();
+            task->running = false;
+            task->runner = std::thread::id();
+            m_done_cv_.notify_all();
+
+            if (task->period == Clock::duration::zero()) { task->active = false; }
+            if (!task->active || m_stopping_) {
+                // release the captures of a finished task, outside the lock
+                std::function<void()> callback = std::move(task->callback);
+                lock.unlock();
+                callback = nullptr;
+                lock.lock();
+                continue;
+            }
+            // the next deadline follows the previous one, runs more than a period late are
+            // skipped instead of run back to back
+            task->deadline = deadline + task->period;
+            now = Clock::now();
+            if (now - task->deadline >= task->period) {
+                const auto missed = (now - task->deadline) / task->period;
+                task->deadline += missed * task->period;
+                task->num_missed += static_cast<std::uint64_t>(missed);
+            }
+            m_heap_.push_back({task->deadline, m_seq_++, task});
+            std::push_heap(m_heap_.begin(), m_heap_.end(), std::greater<>());
+            // another worker may wait for a later deadline
+            if (m_workers_.size() > 1) { m_cv_.notify_one(); }
+        }
+    }
+}  // namespace erl::common
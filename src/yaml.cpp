@@ -1,6 +1,7 @@
 #include "erl_common/yaml.hpp"
 
 #include <any>
+#include <cstring>
 #include <fstream>
 #include <stack>
 #include <string>
@@ -113,6 +114,13 @@ namespace erl::common {
     bool
     YamlableBase::Write(std::ostream &s) const {
         if (!s.good()) { return false; }
+        // opt-in, readers before the binary layout would take its magic for a string length
+        if (serialization::GetFormat(s) == serialization::Format::kBinarySchema) {
+            if (const std::uint64_t hash = GetSchemaBinaryHash(); hash != 0) {
+                return serialization::WriteSchemaHeader(s, hash) && WriteSchemaBinary(s);
+            }
+        }
+        // the length prefix of the YAML string never matches the magic of the binary layout
         const std::string yaml_str = AsYamlString() + "\n";
         const auto len = static_cast<std::streamsize>(yaml_str.size());
         s.write(reinterpret_cast<const char *>(&len), sizeof(len));
@@ -123,11 +131,27 @@ namespace erl::common {
     bool
     YamlableBase::Read(std::istream &s) {
         if (!s.good()) { return false; }
+        char magic[sizeof(serialization::kSchemaMagic) - 1];
+        static_assert(sizeof(magic) == sizeof(std::streamsize));
+        s.read(magic, sizeof(magic));
+        if (!s.good()) { return false; }
+        if (serialization::IsSchemaMagic(magic)) {
+            const std::uint64_t hash = GetSchemaBinaryHash();
+            if (hash == 0) {
+                ERL_WARN("{} cannot be read from the binary layout.", type_name(*this));
+                return false;
+            }
+            return serialization::ReadSchemaHeaderAfterMagic(s, hash) && ReadSchemaBinary(s) &&
+                   PostDeserialization();
+        }
         std::streamsize len = 0;
-        s.read(reinterpret_cast<char *>(&len), sizeof(len));
-        std::string yaml_str(len, '\0');
-        s.read(yaml_str.data(), len);
-        return FromYamlString(yaml_str) && s.good();
+        std::memcpy(&len, magic, sizeof(len));
+        std::string yaml_str;
+        if (len < 0 || !serialization::detail::ReadSchemaSequence(s, yaml_str, len)) {
+            ERL_WARN("Failed to read the YAML string of {}.", type_name(*this));
+            return false;
+        }
+        return FromYamlString(yaml_str);
     }
 
     bool
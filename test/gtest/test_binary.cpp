@@ -1,6 +1,8 @@
 #include "erl_common/binary_file.hpp"
 #include "erl_common/test_helper.hpp"
 
+#include <numeric>
+
 using namespace erl::common;
 
 TEST(BinaryFileIoTest, ReadWrite) {
@@ -16,3 +18,34 @@ TEST(BinaryFileIoTest, ReadWrite) {
 
     for (std::size_t i = 0; i < data_loaded.size(); ++i) { ASSERT_EQ(data_gt[i], data_loaded[i]); }
 }
+
+TEST(BinaryFileIoTest, MapBinaryFile) {
+    const std::vector<double> data_gt{1., 2., 3.};
+    const auto path = "example_map.bin";
+    SaveBinaryFile(path, data_gt.data(), static_cast<std::streamsize>(data_gt.size()));
+
+    const MappedArray<double> data_mapped = MapBinaryFile<double>(path);
+    ASSERT_TRUE(data_mapped.IsValid());
+    ASSERT_EQ(data_gt.size(), data_mapped.size());
+    EXPECT_TRUE(std::equal(data_gt.begin(), data_gt.end(), data_mapped.begin()));
+    EXPECT_FALSE(MapBinaryFile<double>("does_not_exist.bin").IsValid());
+}
+
+TEST(BinaryFileIoTest, Benchmark) {
+    std::vector<double> data_gt(50000000);  // 400 MB
+    for (std::size_t i = 0; i < data_gt.size(); ++i) { data_gt[i] = static_cast<double>(i); }
+    const auto path = "example_large.bin";
+    SaveBinaryFile(path, data_gt.data(), static_cast<std::streamsize>(data_gt.size()));
+
+    double sum_loaded = 0;
+    ReportTime<std::chrono::milliseconds>("LoadBinaryFile + sum", 3, false, [&] {
+        const auto data_loaded = LoadBinaryFile<double>(path);
+        sum_loaded = std::accumulate(data_loaded.begin(), data_loaded.end(), 0.0);
+    });
+    double sum_mapped = 0;
+    ReportTime<std::chrono::milliseconds>("MapBinaryFile + sum", 3, false, [&] {
+        const auto data_mapped = MapBinaryFile<double>(path, MappedFile::Advice::kSequential);
+        sum_mapped = std::accumulate(data_mapped.begin(), data_mapped.end(), 0.0);
+    });
+    EXPECT_EQ(sum_loaded, sum_mapped);
+}
@@ -0,0 +1,169 @@
+#include "erl_common/binary_log.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <thread>
+
+namespace {
+    enum class Mode : std::uint8_t { kIdle = 0, kRun = 3 };
+}  // namespace
+
+TEST(BinaryLog, WriteAndRead) {
+    using namespace erl::common;
+    ASSERT_TRUE(BinaryLog::Open("binary_log.bin"));
+    const std::string name = "robot";
+    for (int i = 0; i < 3; ++i) {
+        ERL_BLOG_INFO("step {} of {}: x = {:.3f}", i, name, 0.5 * i);
+        ERL_BLOG_WARN("flags {} {} {} {}", i % 2 == 0, 'c', Mode::kRun, std::uint8_t{200});
+    }
+    ERL_BLOG_ERROR("no arguments");
+    BinaryLog::Close();
+    EXPECT_FALSE(BinaryLog::IsOpen());
+    ERL_BLOG_INFO("not written");
+
+    BinaryLogReader reader;
+    ASSERT_TRUE(reader.Open("binary_log.bin"));
+    EXPECT_EQ(reader.GetNumDroppedRecords(), 0);
+    ASSERT_EQ(reader.GetFormats().size(), 3);
+    EXPECT_EQ(reader.GetFormats()[1].level, kWarn);
+    EXPECT_EQ(reader.GetFormats()[1].arg_types.size(), 4);
+    const std::vector<BinaryLogReader::Record> &records = reader.GetRecords();
+    ASSERT_EQ(records.size(), 7);
+    EXPECT_EQ(records[0].message, "step 0 of robot: x = 0.000");
+    EXPECT_EQ(records[1].message, "flags true c 3 200");
+    EXPECT_EQ(records[4].message, "step 2 of robot: x = 1.000");
+    EXPECT_EQ(records[5].message, "flags true c 3 200");
+    EXPECT_EQ(records[6].message, "no arguments");
+    for (std::size_t i = 1; i < records.size(); ++i) {
+        EXPECT_LE(records[i - 1].time_ns, records[i].time_ns);
+    }
+    const std::string line = reader.ToString(records[6]);
+    std::cout << line << std::endl;
+    EXPECT_NE(line.find("[ERROR]: "), std::string::npos);
+    EXPECT_NE(line.find("test_binary_log.cpp:"), std::string::npos);
+
+    // the formats are registered once per process and copied into every new file
+    ASSERT_TRUE(BinaryLog::Open("binary_log.bin"));
+    ERL_BLOG_ERROR("no arguments");
+    BinaryLog::Close();
+    ASSERT_TRUE(reader.Open("binary_log.bin"));
+    EXPECT_EQ(reader.GetFormats().size(), 4);
+    ASSERT_EQ(reader.GetRecords().size(), 1);
+    EXPECT_EQ(reader.GetRecords()[0].message, "no arguments");
+}
+
+TEST(BinaryLog, RingWrapsAround) {
+    using namespace erl::common;
+    BinaryLog::Setting setting;
+    setting.ring_capacity = 4096;
+    ASSERT_TRUE(BinaryLog::Open("binary_log_ring.bin", setting));
+    constexpr int kRecords = 1000;
+    for (int i = 0; i < kRecords; ++i) {
+        if (i % 3 == 0) {
+            ERL_BLOG_INFO("record {} {}", i, std::string(i % 50, 'x'));
+        } else {
+            ERL_BLOG_INFO("record {}", i);
+        }
+    }
+    BinaryLog::Close();
+
+    BinaryLogReader reader;
+    ASSERT_TRUE(reader.Open("binary_log_ring.bin"));
+    const std::vector<BinaryLogReader::Record> &records = reader.GetRecords();
+    ASSERT_FALSE(records.empty());
+    EXPECT_LT(records.size(), kRecords);
+    // the newest records are kept in order
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        const int index = kRecords - static_cast<int>(records.size() - i);
+        std::string expected = "record " + std::to_string(index);
+        if (index % 3 == 0) { expected += " " + std::string(index % 50, 'x'); }
+        ASSERT_EQ(records[i].message, expected);
+    }
+}
+
+TEST(BinaryLog, SurvivesCrash) {
+    using namespace erl::common;
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        if (!BinaryLog::Open("binary_log_crash.bin")) { _exit(1); }
+        for (int i = 0; i < 100; ++i) { ERL_BLOG_WARN("before the crash {}", i); }
+        raise(SIGKILL);  // neither Close nor Flush
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFSIGNALED(status));
+
+    BinaryLogReader reader;
+    ASSERT_TRUE(reader.Open("binary_log_crash.bin"));
+    ASSERT_EQ(reader.GetRecords().size(), 100);
+    EXPECT_EQ(reader.GetRecords().back().message, "before the crash 99");
+}
+
+TEST(BinaryLog, MultiThread) {
+    using namespace erl::common;
+    ASSERT_TRUE(BinaryLog::Open("binary_log_threads.bin"));
+    constexpr int kThreads = 4;
+    constexpr int kRecords = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kRecords; ++i) { ERL_BLOG_INFO("{} {}", t, i); }
+        });
+    }
+    for (auto &thread: threads) { thread.join(); }
+    BinaryLog::Close();
+
+    BinaryLogReader reader;
+    ASSERT_TRUE(reader.Open("binary_log_threads.bin"));
+    ASSERT_EQ(reader.GetRecords().size(), kThreads * kRecords);
+    std::vector<int> next(kThreads, 0);
+    for (const auto &record: reader.GetRecords()) {
+        std::istringstream ss(record.message);
+        int t, i;
+        ss >> t >> i;
+        ASSERT_EQ(i, next[t]++);
+    }
+}
+
+TEST(BinaryLog, Benchmark) {
+    using namespace erl::common;
+    constexpr int kRecords = 200000;
+    BinaryLog::Setting setting;
+    setting.ring_capacity = 64 << 20;
+    ASSERT_TRUE(BinaryLog::Open("binary_log_benchmark.bin", setting));
+    const double t_binary = ReportTime<std::chrono::milliseconds>("binary log", 1, false, [&] {
+        for (int i = 0; i < kRecords; ++i) {
+            ERL_BLOG_INFO("step {}: x = {:.3f}, y = {:.3f}, mode {}", i, 0.1 * i, -0.2 * i, 3);
+        }
+    });
+    BinaryLog::Close();
+    std::size_t total_size = 0;
+    const double t_text = ReportTime<std::chrono::milliseconds>("text formatting", 1, false, [&] {
+        for (int i = 0; i < kRecords; ++i) {
+            total_size += fmt::format(
+                              "[{}][INFO]: {}:{}: step {}: x = {:.3f}, y = {:.3f}, mode {}",
+                              "00:00:00",
+                              __FILE__,
+                              __LINE__,
+                              i,
+                              0.1 * i,
+                              -0.2 * i,
+                              3)
+                              .size();
+        }
+    });
+    std::cout << "per record: binary " << t_binary * 1.0e6 / kRecords << " ns, text formatting "
+              << t_text * 1.0e6 / kRecords << " ns (" << total_size << " bytes)" << std::endl;
+
+    BinaryLogReader reader;
+    ASSERT_TRUE(reader.Open("binary_log_benchmark.bin"));
+    ASSERT_FALSE(reader.GetRecords().empty());
+    constexpr int kLast = kRecords - 1;
+    EXPECT_EQ(
+        reader.GetRecords().back().message,
+        fmt::format("step {}: x = {:.3f}, y = {:.3f}, mode 3", kLast, 0.1 * kLast, -0.2 * kLast));
+}
@@ -0,0 +1,95 @@
+#include "erl_common/checkpoint_writer.hpp"
+#include "erl_common/data_buffer_manager.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <filesystem>
+
+TEST(CheckpointWriter, Basic) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    using Manager = DataBufferManager<double>;
+
+    Manager manager;
+    for (int i = 0; i < 1000; ++i) { (void) manager.AddEntry(i); }
+
+    CheckpointWriter writer;
+    // copy
+    CheckpointWriter::Ticket ticket_copy = writer.SubmitCopy("checkpoint/copy.bin", manager);
+    // copy-on-write handoff
+    auto snapshot = std::make_shared<const Manager>(manager);
+    CheckpointWriter::Ticket ticket_shared =
+        writer.Submit<Manager>("checkpoint/shared.bin", snapshot);
+    snapshot.reset();  // the writer keeps its own reference
+    // user-provided snapshot function
+    CheckpointWriter::Ticket ticket_func = writer.SubmitSnapshot<Manager>(
+        "checkpoint/live.bin",
+        [&manager] {
+            auto live = std::make_shared<const Manager>(manager);
+            return [live](std::ostream &s) { return live->WriteLive(s); };
+        });
+    // the caller keeps working on the object while the checkpoints are written
+    for (int i = 0; i < 1000; i += 2) { manager.RemoveEntry(i); }
+
+    EXPECT_TRUE(ticket_copy.Wait());
+    EXPECT_TRUE(ticket_shared.Wait());
+    EXPECT_TRUE(ticket_func.Wait());
+    EXPECT_EQ(ticket_copy.GetStatus(), CheckpointWriter::Status::kSucceeded);
+    EXPECT_GT(ticket_copy.GetBytes(), 1000 * sizeof(double));
+    EXPECT_TRUE(std::filesystem::exists("checkpoint/copy.bin"));
+
+    Manager manager_read;
+    ASSERT_TRUE(Serialization<Manager>::Read("checkpoint/copy.bin", &manager_read));
+    EXPECT_EQ(manager_read.Size(), 1000);
+    ASSERT_TRUE(Serialization<Manager>::Read("checkpoint/shared.bin", &manager_read));
+    EXPECT_EQ(manager_read.Size(), 1000);
+    ASSERT_TRUE(Serialization<Manager>::Read("checkpoint/live.bin", &manager_read));
+    EXPECT_EQ(manager_read.Size(), 1000);
+
+    // a failed job leaves the previous checkpoint and no temporary file behind
+    CheckpointWriter::Ticket ticket_fail =
+        writer.Submit("checkpoint/copy.bin", [](const std::string &) { return false; });
+    EXPECT_FALSE(ticket_fail.Wait());
+    EXPECT_EQ(ticket_fail.GetStatus(), CheckpointWriter::Status::kFailed);
+    ASSERT_TRUE(Serialization<Manager>::Read("checkpoint/copy.bin", &manager_read));
+    EXPECT_EQ(manager_read.Size(), 1000);
+    for (const auto &entry: std::filesystem::directory_iterator("checkpoint")) {
+        EXPECT_EQ(entry.path().string().find(".tmp."), std::string::npos) << entry.path();
+    }
+
+    writer.WaitAll();
+    const CheckpointWriter::Metrics metrics = writer.GetMetrics();
+    EXPECT_EQ(metrics.num_submitted, 4);
+    EXPECT_EQ(metrics.num_succeeded, 3);
+    EXPECT_EQ(metrics.num_failed, 1);
+    EXPECT_EQ(metrics.queue_depth, 0);
+    EXPECT_GE(metrics.max_queue_depth, 1);
+    EXPECT_GT(metrics.total_bytes, 0);
+}
+
+TEST(CheckpointWriter, Benchmark) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    using Manager = DataBufferManager<double>;
+
+    Manager manager;
+    manager.Reserve(10000000);
+    for (int i = 0; i < 10000000; ++i) { (void) manager.AddEntry(i); }
+
+    ReportTime<std::chrono::milliseconds>("Serialization<T>::Write", 3, false, [&] {
+        ASSERT_TRUE(Serialization<Manager>::Write("checkpoint/sync.bin", &manager));
+    });
+    CheckpointWriter writer;
+    CheckpointWriter::Ticket ticket;
+    ReportTime<std::chrono::milliseconds>("CheckpointWriter::SubmitCopy", 3, false, [&] {
+        ticket = writer.SubmitCopy("checkpoint/async.bin", manager);
+    });
+    writer.WaitAll();
+    EXPECT_EQ(ticket.GetStatus(), CheckpointWriter::Status::kSucceeded);
+    const CheckpointWriter::Metrics metrics = writer.GetMetrics();
+    ERL_INFO(
+        "{} checkpoints, {} MB, {:.1f} ms on the worker, max queue depth {}.",
+        metrics.num_succeeded,
+        metrics.total_bytes >> 20,
+        metrics.total_duration_ms,
+        metrics.max_queue_depth);
+}
@@ -0,0 +1,166 @@
+#include "erl_common/columnar_log.hpp"
+#include "erl_common/csv.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    std::vector<erl::common::ColumnarLog::Column>
+    GetColumns() {
+        using Log = erl::common::ColumnarLog;
+        return {
+            {"step", Log::Type::kInt64, Log::Encoding::kDelta},
+            {"time", Log::Type::kFloat64, Log::Encoding::kDelta},
+            {"x", Log::Type::kFloat64, Log::Encoding::kPlain},
+            {"y", Log::Type::kFloat32, Log::Encoding::kPlain},
+            {"mode", Log::Type::kUInt8, Log::Encoding::kRunLength},
+        };
+    }
+}  // namespace
+
+TEST(ColumnarLog, WriteAndRead) {
+    using namespace erl::common;
+    constexpr long kRows = 10000;
+    ColumnarLogWriter::Setting setting;
+    setting.row_group_size = 1000;
+    {
+        ColumnarLogWriter writer(setting);
+        ASSERT_TRUE(writer.Open("log.bin", GetColumns()));
+        for (long i = 0; i < kRows; ++i) {
+            const double x = i % 7 == 0 ? std::numeric_limits<double>::quiet_NaN() : std::sin(i);
+            writer.AppendRow(i, i * 0.01, x, -i, i / 2500);
+        }
+        EXPECT_EQ(writer.GetNumRows(), kRows);
+    }
+    {  // append with the same columns
+        ColumnarLogWriter writer(setting);
+        ASSERT_TRUE(writer.Open("log.bin", GetColumns(), /*append*/ true));
+        EXPECT_EQ(writer.GetNumRows(), kRows);
+        writer.AppendRow(std::vector<double>{kRows, kRows * 0.01, 0.0, -kRows, 4});
+        auto other_columns = GetColumns();
+        other_columns.pop_back();
+        ColumnarLogWriter other_writer;
+        EXPECT_FALSE(other_writer.Open("log.bin", other_columns, true));
+    }
+
+    ColumnarLogReader reader;
+    ASSERT_TRUE(reader.Open("log.bin"));
+    EXPECT_EQ(reader.GetNumRows(), kRows + 1);
+    EXPECT_EQ(reader.GetRowGroups().size(), 11);
+    EXPECT_EQ(reader.GetColumns(), GetColumns());
+
+    Eigen::VectorX<std::int64_t> steps;
+    ASSERT_TRUE(reader.ReadColumn("step", steps));
+    Eigen::VectorXd times, xs;
+    ASSERT_TRUE(reader.ReadColumn("time", times));
+    ASSERT_TRUE(reader.ReadColumn("x", xs));
+    Eigen::VectorXf ys;
+    ASSERT_TRUE(reader.ReadColumn("y", ys));
+    Eigen::VectorXi modes;  // converted from uint8
+    ASSERT_TRUE(reader.ReadColumn("mode", modes));
+    for (long i = 0; i < kRows; ++i) {
+        ASSERT_EQ(steps[i], i);
+        ASSERT_EQ(times[i], i * 0.01);
+        if (i % 7 == 0) {
+            ASSERT_TRUE(std::isnan(xs[i]));
+        } else {
+            ASSERT_EQ(xs[i], std::sin(i));
+        }
+        ASSERT_EQ(ys[i], static_cast<float>(-i));
+        ASSERT_EQ(modes[i], i / 2500);
+    }
+    EXPECT_EQ(steps[kRows], kRows);
+
+    // statistics and projection
+    const ColumnarLog::ColumnChunk &chunk = reader.GetRowGroups()[3].chunks[0];
+    EXPECT_EQ(chunk.min_int, 3000);
+    EXPECT_EQ(chunk.max_int, 3999);
+    const std::vector<std::size_t> row_groups = reader.FilterRowGroups("time", 25.5, 41.0);
+    EXPECT_EQ(row_groups, std::vector<std::size_t>({2, 3, 4}));
+    Eigen::MatrixXd matrix;
+    ASSERT_TRUE(reader.ReadColumns({"time", "step"}, matrix, row_groups));
+    ASSERT_EQ(matrix.rows(), 3000);
+    EXPECT_EQ(matrix(0, 1), 2000.0);
+    EXPECT_EQ(matrix(2999, 0), times[4999]);
+
+    // plain chunks are viewed without copying
+    const MappedArray<double> view = reader.GetChunkView<double>(1, 2);
+    ASSERT_TRUE(view.IsValid());
+    EXPECT_EQ(view.size(), 1000);
+    EXPECT_EQ(view[2], xs[1002]);
+    EXPECT_FALSE(reader.GetChunkView<double>(1, 1).IsValid());  // delta-encoded
+    EXPECT_FALSE(reader.GetChunkView<double>(99, 2).IsValid());
+
+    // out-of-range row groups are rejected instead of being read out of bounds
+    EXPECT_FALSE(reader.ReadColumn("x", xs, {1, 99}));
+    EXPECT_FALSE(reader.ReadColumns({"time", "step"}, matrix, {99}));
+
+    // a truncated row group is ignored and dropped on append
+    const auto size = std::filesystem::file_size("log.bin");
+    std::filesystem::resize_file("log.bin", size - 10);
+    ASSERT_TRUE(reader.Open("log.bin"));
+    EXPECT_EQ(reader.GetNumRows(), kRows);
+    {
+        ColumnarLogWriter writer;
+        ASSERT_TRUE(writer.Open("log.bin", GetColumns(), true));
+        writer.AppendRow(kRows, 0.0, 0.0, 0.0, 0);
+    }
+    ASSERT_TRUE(reader.Open("log.bin"));
+    EXPECT_EQ(reader.GetNumRows(), kRows + 1);
+
+    // a plain chunk that does not hold exactly the rows of its group ends the log there
+    {
+        const std::size_t num_columns = GetColumns().size();
+        const std::size_t group_begin = reader.GetRowGroups()[5].chunks[0].offset -
+                                        ColumnarLog::kRowGroupHeaderSize -
+                                        num_columns * ColumnarLog::kChunkHeaderSize;
+        const std::uint64_t chunk_size = reader.GetRowGroups()[5].chunks[2].size - 8;
+        std::fstream file("log.bin", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(
+            group_begin + ColumnarLog::kRowGroupHeaderSize + 2 * ColumnarLog::kChunkHeaderSize +
+            8));
+        file.write(reinterpret_cast<const char *>(&chunk_size), sizeof(chunk_size));
+    }
+    ASSERT_TRUE(reader.Open("log.bin"));
+    EXPECT_EQ(reader.GetRowGroups().size(), 5);
+    EXPECT_EQ(reader.GetNumRows(), 5000);
+}
+
+TEST(ColumnarLog, Benchmark) {
+    using namespace erl::common;
+    constexpr long kRows = 1000000;
+    Eigen::MatrixXd data(kRows, 4);
+    for (long i = 0; i < kRows; ++i) {
+        data.row(i) << static_cast<double>(i), i * 0.001, std::sin(i * 0.001), i / 100000;
+    }
+
+    ReportTime<std::chrono::milliseconds>("CSV write", 1, false, [&] {
+        ASSERT_TRUE(SaveEigenMatrixToCsvFile("log.csv", data, {"step", "time", "x", "mode"}));
+    });
+    ReportTime<std::chrono::milliseconds>("columnar log write", 1, false, [&] {
+        ColumnarLogWriter writer;
+        ASSERT_TRUE(writer.Open("log_large.bin", GetColumns()));
+        for (long i = 0; i < kRows; ++i) {
+            writer.AppendRow(data(i, 0), data(i, 1), data(i, 2), data(i, 2), data(i, 3));
+        }
+    });
+    ERL_INFO(
+        "CSV: {} MB, columnar log: {} MB",
+        std::filesystem::file_size("log.csv") >> 20,
+        std::filesystem::file_size("log_large.bin") >> 20);
+
+    Eigen::VectorXd xs_csv, xs;
+    ReportTime<std::chrono::milliseconds>("CSV read one column", 1, false, [&] {
+        CsvReader reader;
+        ASSERT_TRUE(reader.Open("log.csv"));
+        ASSERT_TRUE(reader.ReadColumns({"x"}, xs_csv));
+    });
+    ReportTime<std::chrono::milliseconds>("columnar log read one column", 1, false, [&] {
+        ColumnarLogReader reader;
+        ASSERT_TRUE(reader.Open("log_large.bin"));
+        ASSERT_TRUE(reader.ReadColumn("x", xs));
+    });
+    EXPECT_EQ(xs, data.col(2));
+    EXPECT_EQ(xs_csv, data.col(2));
+}
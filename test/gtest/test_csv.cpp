@@ -1,5 +1,6 @@
 #include "erl_common/csv.hpp"
 #include "erl_common/logging.hpp"
+#include "erl_common/test_helper.hpp"
 
 #include <gtest/gtest.h>
 
@@ -28,3 +29,153 @@ TEST(CsvIoTest, ReadWrite) {
         }
     }
 }
+
+TEST(CsvIoTest, TypedColumns) {
+    {
+        std::ofstream ofs("example_typed.csv");
+        ofs << "time, x ,y,id,name\n"
+            << "0.0,1.5,-2,3,a\n"
+            << "\n"
+            << "0.1,+2.5,,4,b\r\n"
+            << "0.2,3.5,1e-3,5\n";  // missing name
+    }
+    CsvReader::Setting setting;
+    setting.chunk_size = 8;  // force several chunks
+    CsvReader reader(setting);
+    ASSERT_TRUE(reader.Open("example_typed.csv"));
+    EXPECT_EQ(reader.GetHeader(), std::vector<std::string>({"time", "x", "y", "id", "name"}));
+    EXPECT_EQ(reader.CountRows(), 3);
+
+    Eigen::VectorXd times, ys;
+    Eigen::VectorXi ids;
+    std::vector<std::string> names;
+    ASSERT_TRUE(reader.ReadColumns({"id", "time", "y", "name"}, ids, times, ys, names));
+    EXPECT_EQ(times, Eigen::Vector3d(0.0, 0.1, 0.2));
+    EXPECT_EQ(ids, Eigen::Vector3i(3, 4, 5));
+    EXPECT_EQ(ys[0], -2.0);
+    EXPECT_TRUE(std::isnan(ys[1]));
+    EXPECT_EQ(ys[2], 1e-3);
+    EXPECT_EQ(names, std::vector<std::string>({"a", "b", ""}));
+
+    Eigen::MatrixXd matrix;
+    ASSERT_TRUE(reader.ReadMatrix(matrix, {"x", "time"}));
+    ASSERT_EQ(matrix.rows(), 3);
+    ASSERT_EQ(matrix.cols(), 2);
+    EXPECT_EQ(matrix.col(0), Eigen::Vector3d(1.5, 2.5, 3.5));
+    EXPECT_EQ(matrix.col(1), times);
+
+    Eigen::MatrixXd all;
+    EXPECT_FALSE(reader.ReadMatrix(all));  // name is not a number
+    EXPECT_FALSE(reader.ReadMatrix(all, {"z"}));
+
+    std::vector<std::string> rows;
+    EXPECT_TRUE(reader.ForEachRow([&](const CsvReader::Row &row) {
+        double x;
+        EXPECT_TRUE(row.Get(1, x));
+        rows.emplace_back(row[4]);
+        return row.GetIndex() < 1;  // stop after the second row
+    }));
+    EXPECT_EQ(rows, std::vector<std::string>({"a", "b"}));
+}
+
+TEST(CsvIoTest, Benchmark) {
+    constexpr long kRows = 1000000;
+    {
+        std::ofstream ofs("example_large.csv");
+        ofs << "t,x,y,z\n";
+        for (long i = 0; i < kRows; ++i) {
+            ofs << i * 0.01 << ',' << i * 0.5 << ',' << -i * 0.25 << ',' << i << '\n';
+        }
+    }
+
+    std::vector<std::vector<double>> rows;
+    ReportTime<std::chrono::milliseconds>("LoadAndCastCsvFile", 1, false, [&] {
+        rows = LoadAndCastCsvFile<double>("example_large.csv", [](const std::string &cell) {
+            return cell == "t" || cell == "x" || cell == "y" || cell == "z" ? 0.0 : std::stod(cell);
+        });
+    });
+    Eigen::MatrixXd matrix;
+    ReportTime<std::chrono::milliseconds>("CsvReader::ReadMatrix", 1, false, [&] {
+        CsvReader reader;
+        ASSERT_TRUE(reader.Open("example_large.csv"));
+        ASSERT_TRUE(reader.ReadMatrix(matrix));
+    });
+    double sum = 0;
+    ReportTime<std::chrono::milliseconds>("CsvReader::ForEachRow", 1, false, [&] {
+        CsvReader reader;
+        ASSERT_TRUE(reader.Open("example_large.csv"));
+        sum = 0;
+        reader.ForEachRow([&sum](const CsvReader::Row &row) {
+            double z;
+            if (row.Get(3, z)) { sum += z; }
+            return true;
+        });
+    });
+    ASSERT_EQ(matrix.rows(), kRows);
+    ASSERT_EQ(rows.size(), kRows + 1);
+    for (long i = 0; i < kRows; i += 997) {
+        for (long j = 0; j < 4; ++j) { ASSERT_EQ(matrix(i, j), rows[i + 1][j]); }
+    }
+    EXPECT_EQ(sum, static_cast<double>(kRows * (kRows - 1) / 2));
+}
+
+TEST(CsvIoTest, Writer) {
+    const Eigen::MatrixXd matrix = Eigen::MatrixXd::Random(10001, 3);
+    CsvWriter::Setting setting;
+    setting.buffer_size = 1000;  // force flushes between rows
+    setting.block_rows = 100;
+    {
+        CsvWriter writer(setting);
+        ASSERT_TRUE(writer.Open("example_writer.csv"));
+        writer.WriteRange(std::vector<std::string>{"a", "b", "c"});
+        writer.WriteRow(1, 0.1, "x");
+        ASSERT_TRUE(writer.WriteMatrix(matrix));
+    }
+
+    CsvReader reader;
+    ASSERT_TRUE(reader.Open("example_writer.csv"));
+    EXPECT_EQ(reader.GetHeader(), std::vector<std::string>({"a", "b", "c"}));
+    std::vector<std::string> first_row;
+    reader.ForEachRow([&](const CsvReader::Row &row) {
+        for (std::size_t i = 0; i < row.Size(); ++i) { first_row.emplace_back(row[i]); }
+        return false;
+    });
+    EXPECT_EQ(first_row, std::vector<std::string>({"1", "0.1", "x"}));
+
+    Eigen::VectorXd a, b;
+    std::vector<std::string> c;
+    ASSERT_TRUE(reader.ReadColumns({"a", "b", "c"}, a, b, c));
+    ASSERT_EQ(a.size(), matrix.rows() + 1);
+    // shortest round-trip formatting: values read back exactly
+    EXPECT_EQ(a.tail(matrix.rows()), matrix.col(0));
+    EXPECT_EQ(b.tail(matrix.rows()), matrix.col(1));
+    EXPECT_EQ(c[0], "x");
+
+    ASSERT_TRUE(SaveEigenMatrixToCsvFile("example_matrix.csv", matrix, {"a", "b", "c"}));
+    Eigen::MatrixXd matrix_read;
+    ASSERT_TRUE(reader.Open("example_matrix.csv"));
+    ASSERT_TRUE(reader.ReadMatrix(matrix_read));
+    EXPECT_EQ(matrix, matrix_read);
+}
+
+TEST(CsvIoTest, WriterBenchmark) {
+    const Eigen::MatrixXd matrix = Eigen::MatrixXd::Random(500000, 4);
+    ReportTime<std::chrono::milliseconds>("std::ofstream << with std::endl", 1, false, [&] {
+        std::ofstream ofs("example_write_stream.csv");
+        for (long i = 0; i < matrix.rows(); ++i) {
+            ofs << matrix(i, 0);
+            for (long j = 1; j < matrix.cols(); ++j) { ofs << ',' << matrix(i, j); }
+            ofs << std::endl;
+        }
+    });
+    ReportTime<std::chrono::milliseconds>("SaveEigenMatrixToCsvFile", 1, false, [&] {
+        ASSERT_TRUE(SaveEigenMatrixToCsvFile("example_write_matrix.csv", matrix));
+    });
+    ReportTime<std::chrono::milliseconds>("CsvWriter::WriteRow", 1, false, [&] {
+        CsvWriter writer;
+        ASSERT_TRUE(writer.Open("example_write_rows.csv"));
+        for (long i = 0; i < matrix.rows(); ++i) {
+            writer.WriteRow(matrix(i, 0), matrix(i, 1), matrix(i, 2), matrix(i, 3));
+        }
+    });
+}
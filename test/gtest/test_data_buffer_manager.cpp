@@ -1,6 +1,11 @@
 #include "erl_common/data_buffer_manager.hpp"
+#include "erl_common/slot_map.hpp"
 #include "erl_common/test_helper.hpp"
 
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
 TEST(DataBufferManager, Basic) {
     using namespace erl::common;
     using namespace erl::common::serialization;
@@ -19,3 +24,166 @@ TEST(DataBufferManager, Basic) {
     ASSERT_TRUE(Serialization<Manager>::Read("data_buffer_manager.bin", &manager_read));
     EXPECT_EQ(manager, manager_read);
 }
+
+TEST(DataBufferManager, RemoveIterateCompact) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    using Manager = DataBufferManager<int>;
+    Manager manager;
+
+    constexpr int num_entries = 300;
+    for (int i = 0; i < num_entries; ++i) { (void) manager.AddEntry(i); }
+    for (int i = 0; i < num_entries; ++i) {
+        if (i % 3 != 0) { manager.RemoveEntry(i); }
+    }
+    EXPECT_EQ(manager.Size(), num_entries / 3);
+    EXPECT_FALSE(manager.IsInUse(1));
+
+    int expected = 0;
+    for (const int &entry: std::as_const(manager)) {
+        EXPECT_EQ(entry, expected);
+        expected += 3;
+    }
+    EXPECT_EQ(expected, num_entries);
+
+    ASSERT_TRUE(Serialization<Manager>::Write("data_buffer_manager_sparse.bin", &manager));
+    Manager manager_read;
+    ASSERT_TRUE(Serialization<Manager>::Read("data_buffer_manager_sparse.bin", &manager_read));
+    EXPECT_EQ(manager, manager_read);
+    EXPECT_FALSE(manager_read.IsInUse(1));
+
+    const std::vector<std::size_t> index_mapping = manager.Compact();
+    ASSERT_EQ(index_mapping.size(), num_entries);
+    EXPECT_EQ(manager.GetBuffer().size(), num_entries / 3);
+    for (int old_index = 0; old_index < num_entries; ++old_index) {
+        if (old_index % 3 != 0) {
+            EXPECT_EQ(index_mapping[old_index], Manager::kInvalidIndex);
+        } else {
+            EXPECT_EQ(manager[index_mapping[old_index]], old_index);
+        }
+    }
+    EXPECT_EQ(manager.AddEntry(-1), num_entries / 3);
+}
+
+TEST(DataBufferManager, ReadRejectsBadIndices) {
+    using namespace erl::common;
+    using Manager = DataBufferManager<int>;
+    Manager manager;
+    for (int i = 0; i < 3; ++i) { (void) manager.AddEntry(i); }
+    manager.RemoveEntry(1);
+
+    std::stringstream ss;
+    ASSERT_TRUE(manager.Write(ss));
+    std::string data = ss.str();
+    // the stream ends with the only available index and a newline
+    for (const std::size_t index: {std::size_t(3), std::size_t(1) << 40}) {
+        std::memcpy(data.data() + data.size() - sizeof(std::size_t) - 1, &index, sizeof(index));
+        std::stringstream corrupt(data);
+        Manager manager_read;
+        EXPECT_FALSE(manager_read.Read(corrupt));
+    }
+}
+
+TEST(DataBufferManager, IterationBenchmark) {
+    using namespace erl::common;
+    using Manager = DataBufferManager<double>;
+
+    constexpr std::size_t num_entries = 1000000;
+    Manager manager;
+    SlotMap<double> slot_map;
+    std::vector<SlotMap<double>::Handle> handles;
+    manager.Reserve(num_entries);
+    slot_map.Reserve(num_entries);
+    handles.reserve(num_entries);
+    for (std::size_t i = 0; i < num_entries; ++i) {
+        (void) manager.AddEntry(static_cast<double>(i));
+        handles.push_back(slot_map.Insert(static_cast<double>(i)));
+    }
+    for (std::size_t i = 0; i < num_entries; i += 2) {  // free half of the entries
+        manager.RemoveEntry(i);
+        slot_map.Remove(handles[i]);
+    }
+
+    double sum_free_list = 0;
+    double sum_manager = 0;
+    double sum_slot_map = 0;
+    ReportTime<std::chrono::milliseconds>("free-list copy + scan", 5, false, [&] {
+        // what the iterator did before: copy the free list into a hash set and probe every index
+        const std::unordered_set<std::size_t> available_indices(
+            manager.GetAvailableIndices().begin(),
+            manager.GetAvailableIndices().end());
+        sum_free_list = 0;
+        for (std::size_t i = 0; i < manager.GetBuffer().size(); ++i) {
+            if (available_indices.count(i)) { continue; }
+            sum_free_list += manager.GetBuffer()[i];
+        }
+    });
+    ReportTime<std::chrono::milliseconds>("DataBufferManager::Iterator", 5, false, [&] {
+        sum_manager = 0;
+        for (const double &entry: std::as_const(manager)) { sum_manager += entry; }
+    });
+    ReportTime<std::chrono::milliseconds>("SlotMap::Iterator", 5, false, [&] {
+        sum_slot_map = 0;
+        for (const double &entry: std::as_const(slot_map)) { sum_slot_map += entry; }
+    });
+    EXPECT_EQ(sum_free_list, sum_manager);
+    EXPECT_EQ(sum_free_list, sum_slot_map);
+}
+
+TEST(DataBufferManager, WriteLive) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    using Manager = DataBufferManager<int>;
+    Manager manager;
+
+    for (int i = 0; i < 100; ++i) { (void) manager.AddEntry(i); }
+    for (int i = 0; i < 100; ++i) {
+        if (i % 10 < 4) { manager.RemoveEntry(i); }
+    }
+    ASSERT_TRUE(Serialization<Manager>::Write("data_buffer_manager_live.bin", [&](std::ostream &s) {
+        return manager.WriteLive(s);
+    }));
+    Manager manager_read;
+    ASSERT_TRUE(Serialization<Manager>::Read("data_buffer_manager_live.bin", &manager_read));
+    EXPECT_TRUE(manager_read.GetAvailableIndices().empty());
+    manager.Compact();
+    EXPECT_EQ(manager.GetBuffer(), manager_read.GetBuffer());
+}
+
+TEST(DataBufferManager, WriteBenchmark) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    using Manager = DataBufferManager<Eigen::Vector3d>;
+
+    constexpr std::size_t num_entries = 1000000;
+    Manager manager;
+    manager.Reserve(num_entries);
+    for (std::size_t i = 0; i < num_entries; ++i) {
+        (void) manager.AddEntry(Eigen::Vector3d::Constant(static_cast<double>(i)));
+    }
+    for (std::size_t i = 0; i < num_entries; i += 3) { manager.RemoveEntry(i); }
+
+    ReportTime<std::chrono::milliseconds>("per-entry Writer<T>::Run", 2, false, [&] {
+        std::ofstream ofs("data_buffer_manager_per_entry.bin", std::ios::binary);
+        for (const Eigen::Vector3d &entry: manager.GetBuffer()) {
+            Writer<Eigen::Vector3d>::Run(&entry, ofs);
+        }
+        for (const std::size_t &index: manager.GetAvailableIndices()) {
+            ofs.write(reinterpret_cast<const char *>(&index), sizeof(index));
+        }
+    });
+    ReportTime<std::chrono::milliseconds>("Write", 2, false, [&] {
+        std::ofstream ofs("data_buffer_manager_bulk.bin", std::ios::binary);
+        ASSERT_TRUE(manager.Write(ofs));
+    });
+    ReportTime<std::chrono::milliseconds>("WriteLive", 2, false, [&] {
+        std::ofstream ofs("data_buffer_manager_bulk_live.bin", std::ios::binary);
+        ASSERT_TRUE(manager.WriteLive(ofs));
+    });
+    Manager manager_read;
+    ReportTime<std::chrono::milliseconds>("Read", 2, false, [&] {
+        std::ifstream ifs("data_buffer_manager_bulk.bin", std::ios::binary);
+        ASSERT_TRUE(manager_read.Read(ifs));
+    });
+    EXPECT_EQ(manager, manager_read);
+}
@@ -1,10 +1,12 @@
 #include "erl_common/eigen.hpp"
+#include "erl_common/test_helper.hpp"
 
 #include <absl/container/flat_hash_set.h>
 #include <gtest/gtest.h>
 
 #include <iostream>
 #include <random>
+#include <sstream>
 
 TEST(EigenTest, MatrixCreation) {
 
@@ -68,6 +70,74 @@ TEST(EigenTest, SaveAndLoadTextWithInf) {
     }
 }
 
+TEST(EigenTest, FastTextFormat) {
+    using namespace erl::common;
+    const Eigen::Matrix3i matrix_int = (Eigen::Matrix3i() << 1, 2, 3, 4, 5, 6, 7, 8, 9).finished();
+    const Eigen::MatrixXd matrix = Eigen::MatrixXd::Random(2000, 7);
+    for (const EigenTextFormat format:
+         {EigenTextFormat::kDefaultFmt,
+          EigenTextFormat::kCommaInitFmt,
+          EigenTextFormat::kCleanFmt,
+          EigenTextFormat::kOctaveFmt,
+          EigenTextFormat::kNumpyFmt,
+          EigenTextFormat::kCsvFmt}) {
+        // same layout as Eigen when no column padding is needed
+        std::stringstream ss;
+        ss << matrix_int.format(GetEigenTextFormat(format));
+        std::string text = "prefix";
+        AppendEigenText(text, matrix_int, format);
+        EXPECT_EQ(text, "prefix" + ss.str());
+
+        // the shortest representation reads back exactly
+        SaveEigenMatrixToTextFile<double>("matrix_fast.txt", matrix, format);
+        const Eigen::MatrixXd loaded = LoadEigenMatrixFromTextFile<double>("matrix_fast.txt");
+        EXPECT_TRUE(loaded.cwiseEqual(matrix).all()) << static_cast<int>(format);
+        const Eigen::Matrix<double, 7, Eigen::Dynamic> loaded_transposed =
+            LoadEigenMatrixFromTextFile<double, 7>("matrix_fast.txt", true);
+        EXPECT_TRUE(loaded_transposed.cwiseEqual(matrix.transpose()).all());
+    }
+    EXPECT_EQ(EigenToNumPyFmtString(Eigen::Vector2d(0.1, -2.5).transpose()), "[[0.1, -2.5]]");
+}
+
+TEST(EigenTest, TextBenchmark) {
+    using namespace erl::common;
+    const Eigen::MatrixXd matrix = Eigen::MatrixXd::Random(200000, 10);
+    const Eigen::IOFormat format = GetEigenTextFormat(EigenTextFormat::kCsvFmt);
+    ReportTime<std::chrono::milliseconds>("save with IOFormat", 1, false, [&] {
+        std::ofstream ofs("matrix_iofmt.txt");
+        ofs << matrix.format(format);
+    });
+    ReportTime<std::chrono::milliseconds>("SaveEigenMatrixToTextFile", 1, false, [&] {
+        SaveEigenMatrixToTextFile<double>("matrix_fast.txt", matrix, EigenTextFormat::kCsvFmt);
+    });
+    std::vector<double> data;
+    ReportTime<std::chrono::milliseconds>("load with getline and stod", 1, false, [&] {
+        data.clear();
+        std::ifstream ifs("matrix_iofmt.txt");
+        std::string line, entry;
+        while (std::getline(ifs, line)) {
+            std::stringstream line_stream(line);
+            while (std::getline(line_stream, entry, ',')) { data.push_back(std::stod(entry)); }
+        }
+    });
+    EXPECT_EQ(data.size(), matrix.size());
+    Eigen::MatrixXd loaded;
+    ReportTime<std::chrono::milliseconds>("LoadEigenMatrixFromTextFile", 1, false, [&] {
+        loaded = LoadEigenMatrixFromTextFile<double>("matrix_fast.txt");
+    });
+    EXPECT_TRUE(loaded.cwiseEqual(matrix).all());
+    std::string buffer;
+    ReportTime<std::chrono::milliseconds>("EigenToString with IOFormat", 1, false, [&] {
+        std::stringstream ss;
+        ss << matrix.format(format);
+        buffer = ss.str();
+    });
+    ReportTime<std::chrono::milliseconds>("AppendEigenText", 1, false, [&] {
+        buffer.clear();  // the buffer is reused
+        AppendEigenText(buffer, matrix, EigenTextFormat::kCsvFmt);
+    });
+}
+
 TEST(EigenTest, SaveAndLoadBinary) {
 
     using namespace erl::common;
@@ -119,6 +189,242 @@ TEST(EigenTest, SaveAndLoadEigenMap) {
     EXPECT_TRUE(matrix.cwiseEqual(matrix_load).all());
 }
 
+TEST(EigenTest, MapBinaryFile) {
+    using namespace erl::common;
+    const Eigen::MatrixXd matrix1 = Eigen::MatrixXd::Random(10, 5);
+    const Eigen::Matrix3Xf matrix2 = Eigen::Matrix3Xf::Random(3, 7);
+    std::ofstream ofs("matrices.bin", std::ios::binary);
+    ASSERT_TRUE(SaveEigenMatrixToBinaryStream(ofs, matrix1));
+    ASSERT_TRUE(SaveEigenMatrixToBinaryStream(ofs, matrix2));
+    ofs.close();
+
+    MappedEigenMatrix<double> mapped1;
+    {
+        std::shared_ptr<const MappedFile> file = MappedFile::Open("matrices.bin");
+        ASSERT_NE(file, nullptr);
+        mapped1 = MapEigenMatrixFromMappedFile<double>(file);
+        ASSERT_TRUE(mapped1.IsValid());
+        const auto mapped2 =
+            MapEigenMatrixFromMappedFile<float, 3, Eigen::Dynamic>(file, mapped1.GetEndOffset());
+        ASSERT_TRUE(mapped2.IsValid());
+        EXPECT_EQ(mapped2.GetEndOffset(), file->GetSize());
+        EXPECT_TRUE(matrix2.cwiseEqual(mapped2.Get()).all());
+        // wrong template parameters are rejected
+        EXPECT_FALSE((MapEigenMatrixFromMappedFile<float, 4, Eigen::Dynamic>(
+                          file,
+                          mapped1.GetEndOffset())
+                          .IsValid()));
+    }
+    // the view keeps the mapping alive
+    EXPECT_EQ(mapped1.rows(), 10);
+    EXPECT_EQ(mapped1.cols(), 5);
+    EXPECT_TRUE(matrix1.cwiseEqual(*mapped1).all());
+
+    const auto mapped = MapEigenMatrixFromBinaryFile<double>("matrices.bin");
+    EXPECT_TRUE(mapped.IsValid());
+    EXPECT_TRUE(matrix1.cwiseEqual(mapped.Get()).all());
+    EXPECT_FALSE(MapEigenMatrixFromBinaryFile<double>("does_not_exist.bin").IsValid());
+}
+
+TEST(EigenTest, ColumnBlockReader) {
+    using namespace erl::common;
+    const Eigen::Matrix3Xd matrix = Eigen::Matrix3Xd::Random(3, 1003);
+    ASSERT_TRUE(SaveEigenMatrixToBinaryFile("matrix_blocks.bin", Eigen::MatrixXd(matrix)));
+
+    EigenBinaryColumnBlockReader<double, 3> reader("matrix_blocks.bin", 100);
+    ASSERT_TRUE(reader.IsOpen());
+    EXPECT_EQ(reader.GetRows(), 3);
+    EXPECT_EQ(reader.GetCols(), 1003);
+    long num_blocks = 0;
+    long num_cols = 0;
+    EXPECT_TRUE(reader.ForEachBlock([&](const long col_begin, const Eigen::Matrix3Xd &block) {
+        EXPECT_EQ(col_begin, num_cols);
+        EXPECT_TRUE(matrix.middleCols(col_begin, block.cols()).cwiseEqual(block).all());
+        num_cols += block.cols();
+        ++num_blocks;
+    }));
+    EXPECT_EQ(num_blocks, 11);
+    EXPECT_EQ(num_cols, 1003);
+    EXPECT_FALSE(reader.Next());
+
+    ASSERT_TRUE(reader.Seek(950));
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(reader.GetBlockBegin(), 950);
+    EXPECT_EQ(reader.GetBlock().cols(), 53);
+    EXPECT_TRUE(matrix.rightCols(53).cwiseEqual(reader.GetBlock()).all());
+}
+
+namespace {
+    std::vector<Eigen::Triplet<double>>
+    RandomTriplets(const long rows, const long cols, const long n) {
+        std::mt19937 engine(0);
+        std::uniform_int_distribution<long> row_distribution(0, rows - 1);
+        std::uniform_int_distribution<long> col_distribution(0, cols - 1);
+        std::uniform_real_distribution<double> value_distribution(-1.0, 1.0);
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(n);
+        for (long i = 0; i < n; ++i) {
+            triplets.emplace_back(
+                row_distribution(engine),
+                col_distribution(engine),
+                value_distribution(engine));
+        }
+        return triplets;
+    }
+}  // namespace
+
+TEST(EigenTest, SparseFromTriplets) {
+    using namespace erl::common;
+    std::vector<Eigen::Triplet<double>> triplets = RandomTriplets(300, 200, 20000);
+    triplets.emplace_back(3, 4, 1.0);  // duplicates are summed
+    triplets.emplace_back(3, 4, 2.0);
+
+    Eigen::SparseMatrix<double> expected(300, 200);
+    expected.setFromTriplets(triplets.begin(), triplets.end());
+    Eigen::SparseMatrix<double, Eigen::RowMajor> expected_row_major(300, 200);
+    expected_row_major.setFromTriplets(triplets.begin(), triplets.end());
+    for (const bool parallel: {false, true}) {
+        Eigen::SparseMatrix<double> matrix;
+        SetSparseEigenMatrixFromTriplets(matrix, 300, 200, triplets, parallel);
+        EXPECT_TRUE(matrix.isCompressed());
+        EXPECT_EQ(matrix.nonZeros(), expected.nonZeros());
+        EXPECT_TRUE(SafeSparseEigenMatrixEqual(matrix, expected));
+
+        Eigen::SparseMatrix<double, Eigen::RowMajor> row_major;
+        SetSparseEigenMatrixFromTriplets(row_major, 300, 200, triplets, parallel);
+        EXPECT_EQ(row_major.nonZeros(), expected_row_major.nonZeros());
+        EXPECT_TRUE(Eigen::MatrixXd(row_major).cwiseEqual(Eigen::MatrixXd(expected)).all());
+    }
+}
+
+TEST(EigenTest, MapSparseBinaryFile) {
+    using namespace erl::common;
+    Eigen::SparseMatrix<double> matrix1(300, 200);
+    const std::vector<Eigen::Triplet<double>> triplets = RandomTriplets(300, 200, 5000);
+    matrix1.setFromTriplets(triplets.begin(), triplets.end());
+    Eigen::SparseMatrix<float, Eigen::RowMajor> matrix2 = matrix1.cast<float>().transpose();
+    matrix2.coeffRef(0, 0) += 1.0f;  // uncompressed storage is compressed when saved
+    ASSERT_FALSE(matrix2.isCompressed());
+    std::ofstream ofs("sparse_matrices.bin", std::ios::binary);
+    ASSERT_TRUE(SaveCompressedSparseEigenMatrixToBinaryStream(ofs, matrix1));
+    ASSERT_TRUE(SaveCompressedSparseEigenMatrixToBinaryStream(ofs, matrix2));
+    ofs.close();
+
+    MappedSparseEigenMatrix<double> mapped1;
+    {
+        std::shared_ptr<const MappedFile> file = MappedFile::Open("sparse_matrices.bin");
+        ASSERT_NE(file, nullptr);
+        mapped1 = MapSparseEigenMatrixFromMappedFile<double>(file);
+        ASSERT_TRUE(mapped1.IsValid());
+        const auto mapped2 = MapSparseEigenMatrixFromMappedFile<float, Eigen::RowMajor>(
+            file,
+            mapped1.GetEndOffset());
+        ASSERT_TRUE(mapped2.IsValid());
+        EXPECT_EQ(mapped2.GetEndOffset(), file->GetSize());
+        EXPECT_TRUE(Eigen::MatrixXf(mapped2.Get()).cwiseEqual(Eigen::MatrixXf(matrix2)).all());
+        // the arrays are used in place
+        EXPECT_EQ(
+            reinterpret_cast<std::uintptr_t>(mapped2.Get().valuePtr()) %
+                SparseEigenMatrixBinary::kAlignment,
+            0);
+        // wrong template parameters are rejected
+        EXPECT_FALSE(MapSparseEigenMatrixFromMappedFile<float>(file, mapped1.GetEndOffset())
+                         .IsValid());
+        EXPECT_FALSE(MapSparseEigenMatrixFromMappedFile<double>(file, 8).IsValid());
+    }
+    // the view keeps the mapping alive
+    EXPECT_EQ(mapped1.rows(), 300);
+    EXPECT_EQ(mapped1.cols(), 200);
+    EXPECT_EQ(mapped1.nonZeros(), matrix1.nonZeros());
+    EXPECT_TRUE(SafeSparseEigenMatrixEqual(Eigen::SparseMatrix<double>(*mapped1), matrix1));
+
+    Eigen::SparseMatrix<double> loaded;
+    ASSERT_TRUE(SaveSparseEigenMatrixToBinaryFile("sparse_matrix.bin", matrix1));
+    ASSERT_TRUE(LoadSparseEigenMatrixFromBinaryFile("sparse_matrix.bin", loaded));
+    EXPECT_TRUE(SafeSparseEigenMatrixEqual(loaded, matrix1));
+    const auto mapped = MapSparseEigenMatrixFromBinaryFile<double>("sparse_matrix.bin");
+    ASSERT_TRUE(mapped.IsValid());
+    EXPECT_TRUE(SafeSparseEigenMatrixEqual(Eigen::SparseMatrix<double>(mapped.Get()), matrix1));
+
+    // corrupt indices are rejected instead of being read out of bounds later
+    std::ifstream ifs("sparse_matrix.bin", std::ios::binary);
+    const std::string bytes(
+        (std::istreambuf_iterator<char>(ifs)),
+        std::istreambuf_iterator<char>());
+    ifs.close();
+    const std::size_t inner_offset = SparseEigenMatrixBinary::Align(
+        SparseEigenMatrixBinary::kHeaderSize + (matrix1.outerSize() + 1) * sizeof(int));
+    const std::pair<std::size_t, int> corruptions[] = {
+        {SparseEigenMatrixBinary::kHeaderSize + 5 * sizeof(int), 1 << 30},  // outer index
+        {inner_offset + 7 * sizeof(int), 300},                              // inner index
+        {inner_offset, -1}};
+    for (const auto &[pos, value]: corruptions) {
+        std::string corrupted = bytes;
+        std::memcpy(corrupted.data() + pos, &value, sizeof(value));
+        std::ofstream corrupted_ofs("sparse_matrix_corrupted.bin", std::ios::binary);
+        corrupted_ofs.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+        corrupted_ofs.close();
+        EXPECT_FALSE(
+            MapSparseEigenMatrixFromBinaryFile<double>("sparse_matrix_corrupted.bin").IsValid());
+        EXPECT_FALSE(LoadSparseEigenMatrixFromBinaryFile("sparse_matrix_corrupted.bin", loaded));
+    }
+
+    // sizes in the header are bounded by the stream length instead of being allocated blindly
+    {
+        std::string corrupted = bytes;
+        const std::int64_t non_zeros = std::int64_t(1) << 30;
+        std::memcpy(corrupted.data() + 32, &non_zeros, sizeof(non_zeros));
+        std::istringstream iss(corrupted);
+        EXPECT_FALSE(LoadCompressedSparseEigenMatrixFromBinaryStream(iss, loaded));
+    }
+    {
+        loaded = matrix1;
+        std::istringstream iss(bytes.substr(0, bytes.size() - 64));
+        EXPECT_FALSE(LoadCompressedSparseEigenMatrixFromBinaryStream(iss, loaded));
+        EXPECT_EQ(loaded.nonZeros(), 0);
+    }
+}
+
+TEST(EigenTest, SparseBenchmark) {
+    using namespace erl::common;
+    constexpr long kRows = 200000;
+    constexpr long kCols = 100000;
+    const std::vector<Eigen::Triplet<double>> triplets = RandomTriplets(kRows, kCols, 4000000);
+
+    Eigen::SparseMatrix<double> expected(kRows, kCols);
+    ReportTime<std::chrono::milliseconds>("setFromTriplets", 1, false, [&] {
+        expected.setFromTriplets(triplets.begin(), triplets.end());
+    });
+    Eigen::SparseMatrix<double> matrix;
+    ReportTime<std::chrono::milliseconds>("SetSparseEigenMatrixFromTriplets", 1, false, [&] {
+        SetSparseEigenMatrixFromTriplets(matrix, kRows, kCols, triplets);
+    });
+    EXPECT_TRUE(SafeSparseEigenMatrixEqual(matrix, expected));
+
+    ReportTime<std::chrono::milliseconds>("save triplet stream", 1, false, [&] {
+        std::ofstream ofs("sparse_triplets.bin", std::ios::binary);
+        ASSERT_TRUE(SaveSparseEigenMatrixToBinaryStream(ofs, matrix));
+    });
+    ReportTime<std::chrono::milliseconds>("save compressed file", 1, false, [&] {
+        ASSERT_TRUE(SaveSparseEigenMatrixToBinaryFile("sparse_compressed.bin", matrix));
+    });
+    Eigen::SparseMatrix<double> loaded;
+    ReportTime<std::chrono::milliseconds>("load triplet stream", 1, false, [&] {
+        std::ifstream ifs("sparse_triplets.bin", std::ios::binary);
+        ASSERT_TRUE(LoadSparseEigenMatrixFromBinaryStream(ifs, loaded));
+    });
+    ReportTime<std::chrono::milliseconds>("load compressed file", 1, false, [&] {
+        ASSERT_TRUE(LoadSparseEigenMatrixFromBinaryFile("sparse_compressed.bin", loaded));
+    });
+    double sum = 0;
+    ReportTime<std::chrono::milliseconds>("map compressed file", 1, false, [&] {
+        const auto mapped = MapSparseEigenMatrixFromBinaryFile<double>("sparse_compressed.bin");
+        ASSERT_TRUE(mapped.IsValid());
+        sum = mapped.Get().sum();  // touch all values
+    });
+    EXPECT_NEAR(sum, matrix.sum(), 1e-6);
+}
+
 TEST(EigenTest, SaveAndLoadVectorOfFixedSizedMatrices) {
     using namespace erl::common;
     std::vector<Eigen::Matrix4d> matrices(10);
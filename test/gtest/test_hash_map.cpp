@@ -0,0 +1,208 @@
+#include "erl_common/hash_map.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <random>
+#include <string>
+
+TEST(HashMap, Modes) {
+    using namespace erl::common;
+
+    HashMap<int, double> hash_map(HashMapMode::kHash);
+    HashMap<int, double> dense_map(HashMapMode::kDense, 100000);
+    HashMap<int, double> legacy_map(true, 100000);  // use_vector: dense, pages allocated lazily
+    EXPECT_TRUE(dense_map.IsDense());
+    EXPECT_TRUE(legacy_map.UseVector());
+    EXPECT_EQ(legacy_map.GetNumAllocatedPages(), 0);
+
+    for (auto *map: {&hash_map, &dense_map, &legacy_map}) {
+        for (int key: {-5, 0, 7, 4096, 99999, 100000, 1 << 30}) {
+            EXPECT_TRUE(map->Insert(key, key * 0.5));
+        }
+        EXPECT_FALSE(map->Insert(7, 1.0));
+        (*map)[8] += 2.0;
+        EXPECT_EQ(map->Size(), 8);
+        EXPECT_TRUE(map->Contains(-5));
+        EXPECT_TRUE(map->Contains(1 << 30));
+        EXPECT_FALSE(map->Contains(9));
+        EXPECT_EQ((*map)[7], 1.0);
+        EXPECT_EQ((*map)[8], 2.0);
+        EXPECT_EQ(std::as_const(*map)[4096], 2048.0);
+        EXPECT_THROW((void) std::as_const(*map)[9], std::out_of_range);
+
+        double sum = 0;
+        map->ForEach([&](const int key, const double value) { sum += key + value; });
+        EXPECT_EQ(
+            sum,
+            -5 - 2.5 + 7 + 1 + 8 + 2 + 1.5 * (4096 + 99999 + 100000) + 1.5 * (1 << 30));
+
+        EXPECT_TRUE(map->Erase(0));
+        EXPECT_FALSE(map->Erase(0));
+        EXPECT_EQ(map->Size(), 7);
+    }
+    // keys 7 and 8 are on page 0, 4096 on page 1, 99999 on page 24; -5, 100000 and 2^30 are hashed
+    EXPECT_EQ(dense_map.GetNumAllocatedPages(), 3);
+    EXPECT_TRUE(dense_map.Erase(4096));
+    EXPECT_EQ(dense_map.GetNumAllocatedPages(), 2);
+
+    HashMap<std::string, int> string_map;  // non-integral keys never use the paged array
+    for (int i = 0; i < 5000; ++i) { string_map[std::to_string(i)] = i; }
+    EXPECT_FALSE(string_map.IsDense());
+    EXPECT_EQ(string_map[std::to_string(1234)], 1234);
+}
+
+TEST(HashMap, AdaptivePromotion) {
+    using namespace erl::common;
+
+    HashMap<long, int> map;
+    EXPECT_EQ(map.GetMode(), HashMapMode::kAdaptive);
+    // sparse keys: the density stays far below the threshold
+    for (long i = 0; i < 2000; ++i) { map[i * 1000] = static_cast<int>(i); }
+    EXPECT_FALSE(map.IsDense());
+
+    HashMap<long, int> copy = map;
+    map.Clear();
+    EXPECT_TRUE(map.IsEmpty());
+    EXPECT_EQ(copy.Size(), 2000);
+
+    // dense keys: promoted once enough keys are seen
+    for (long i = 0; i < 3000; ++i) { map[i + 100000] = static_cast<int>(i); }
+    EXPECT_TRUE(map.IsDense());
+    EXPECT_EQ(map.Size(), 3000);
+    for (long i = 0; i < 3000; ++i) { ASSERT_EQ(map[i + 100000], i); }
+    // keys allocate 1 or 2 pages around 100000, not 100000 / 4096 of them
+    EXPECT_LE(map.GetNumAllocatedPages(), 2);
+
+    // copies are deep
+    HashMap<long, int> dense_copy = map;
+    dense_copy[100000] = -1;
+    EXPECT_EQ(map[100000], 0);
+
+    // negative keys keep working after the promotion
+    map[-1] = 42;
+    EXPECT_EQ(map[-1], 42);
+    EXPECT_EQ(map.Size(), 3001);
+}
+
+TEST(HashMap, DenseWindow) {
+    using namespace erl::common;
+
+    // the window starts at the smallest key instead of key 0
+    constexpr long base = 1L << 44;
+    HashMap<long, int> far_map;
+    for (long i = 0; i < 2000; ++i) { far_map[base + i] = static_cast<int>(i); }
+    EXPECT_TRUE(far_map.IsDense());
+    EXPECT_LE(far_map.GetNumAllocatedPages(), 2);
+    for (long i = 0; i < 2000; ++i) { ASSERT_EQ(far_map[base + i], i); }
+    HashMap<long, int> far_dense_map(HashMapMode::kDense);
+    for (long i = 0; i < 2000; ++i) { far_dense_map[base - i] = static_cast<int>(i); }
+    EXPECT_EQ(far_dense_map.Size(), 2000);
+    EXPECT_EQ(far_dense_map[base - 1999], 1999);
+
+    // an outlier far from the other keys goes to the hash map
+    HashMap<long, int> outlier_map;
+    for (long i = 0; i < 2000; ++i) { outlier_map[i] = static_cast<int>(i); }
+    EXPECT_TRUE(outlier_map.IsDense());
+    EXPECT_TRUE(outlier_map.Insert(base, -1));
+    EXPECT_EQ(outlier_map.Size(), 2001);
+    EXPECT_EQ(outlier_map[base], -1);
+    EXPECT_EQ(outlier_map.GetNumAllocatedPages(), 1);
+    long sum = 0;
+    outlier_map.ForEach([&](const long key, const int value) { sum += key - value; });
+    EXPECT_EQ(sum, base + 1);
+    EXPECT_TRUE(outlier_map.Erase(base));
+    EXPECT_FALSE(outlier_map.Contains(base));
+
+    // keys left in the hash map move to the paged array once the window grows over them
+    HashMap<std::size_t, int> growing_map(HashMapMode::kDense);
+    growing_map[0] = 0;
+    growing_map[10000000] = 1;  // page 2441 is beyond the initial page table bound
+    for (std::size_t i = 1; i < 3000; ++i) { growing_map[i * 4096] = static_cast<int>(i); }
+    EXPECT_EQ(growing_map.Size(), 3001);
+    EXPECT_EQ(growing_map[10000000], 1);
+    // 10000000 shares page 2441 with 2441 * 4096
+    EXPECT_EQ(growing_map.GetNumAllocatedPages(), 3000);
+    EXPECT_TRUE(growing_map.Erase(10000000));
+    EXPECT_EQ(growing_map.Size(), 3000);
+}
+
+TEST(HashMap, Batch) {
+    using namespace erl::common;
+
+    for (const HashMapMode mode: {HashMapMode::kHash, HashMapMode::kDense}) {
+        HashMap<std::uint32_t, float> map(mode);
+        std::vector<std::uint32_t> keys;
+        std::vector<float> values;
+        for (std::uint32_t i = 0; i < 10000; ++i) {
+            keys.push_back(i * 3);
+            values.push_back(static_cast<float>(i));
+        }
+        EXPECT_EQ(map.Insert(keys, values), 10000);
+        EXPECT_EQ(map.Insert(keys, values), 0);
+
+        keys.push_back(1);  // absent
+        const std::vector<const float *> found = std::as_const(map).Find(keys);
+        ASSERT_EQ(found.size(), keys.size());
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            ASSERT_NE(found[i], nullptr);
+            EXPECT_EQ(*found[i], values[i]);
+        }
+        EXPECT_EQ(found.back(), nullptr);
+    }
+}
+
+TEST(HashMap, Benchmark) {
+    using namespace erl::common;
+
+    constexpr std::size_t num_keys = 1000000;
+    std::vector<std::size_t> keys(num_keys);
+    std::mt19937_64 rng(0);
+    // half of a 2M-wide key range, in random order
+    for (std::size_t i = 0; i < num_keys; ++i) { keys[i] = 2 * i + (rng() & 1); }
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::unordered_map<std::size_t, std::size_t> std_map;
+    HashMap<std::size_t, std::size_t> hash_map(HashMapMode::kHash);
+    HashMap<std::size_t, std::size_t> adaptive_map;
+    HashMap<std::size_t, std::size_t> dense_map(HashMapMode::kDense);
+    ReportTime<std::chrono::milliseconds>("std::unordered_map insert", 3, false, [&] {
+        std_map.clear();
+        for (const std::size_t key: keys) { std_map[key] = key; }
+    });
+    ReportTime<std::chrono::milliseconds>("HashMap(kHash) insert", 3, false, [&] {
+        hash_map.Clear();
+        for (const std::size_t key: keys) { hash_map[key] = key; }
+    });
+    ReportTime<std::chrono::milliseconds>("HashMap(kAdaptive) insert", 3, false, [&] {
+        adaptive_map.Clear();
+        for (const std::size_t key: keys) { adaptive_map[key] = key; }
+    });
+    ReportTime<std::chrono::milliseconds>("HashMap(kDense) insert", 3, false, [&] {
+        dense_map.Clear();
+        for (const std::size_t key: keys) { dense_map[key] = key; }
+    });
+    EXPECT_TRUE(adaptive_map.IsDense());
+
+    std::size_t sum_std = 0;
+    std::size_t sum_hash = 0;
+    std::size_t sum_dense = 0;
+    std::size_t sum_batch = 0;
+    ReportTime<std::chrono::milliseconds>("std::unordered_map find", 3, false, [&] {
+        sum_std = 0;
+        for (const std::size_t key: keys) { sum_std += std_map.find(key)->second; }
+    });
+    ReportTime<std::chrono::milliseconds>("HashMap(kHash) find", 3, false, [&] {
+        sum_hash = 0;
+        for (const std::size_t key: keys) { sum_hash += *hash_map.Find(key); }
+    });
+    ReportTime<std::chrono::milliseconds>("HashMap(kAdaptive) find", 3, false, [&] {
+        sum_dense = 0;
+        for (const std::size_t key: keys) { sum_dense += *adaptive_map.Find(key); }
+    });
+    ReportTime<std::chrono::milliseconds>("HashMap(kAdaptive) batch find", 3, false, [&] {
+        sum_batch = 0;
+        for (const std::size_t *value: adaptive_map.Find(keys)) { sum_batch += *value; }
+    });
+    EXPECT_EQ(sum_std, sum_hash);
+    EXPECT_EQ(sum_std, sum_dense);
+    EXPECT_EQ(sum_std, sum_batch);
+}
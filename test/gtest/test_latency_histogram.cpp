@@ -0,0 +1,132 @@
+#include "erl_common/block_timer.hpp"
+#include "erl_common/latency_histogram.hpp"
+#include "erl_common/random.hpp"
+#include "erl_common/running_statistics.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <sstream>
+#include <thread>
+
+TEST(LatencyHistogram, Percentiles) {
+    using namespace erl::common;
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.GetPercentile(50), 0.0);
+    for (int i = 1; i <= 100000; ++i) { histogram.Record(i); }
+    EXPECT_EQ(histogram.GetCount(), 100000);
+    EXPECT_EQ(histogram.GetMin(), 1.0);
+    EXPECT_EQ(histogram.GetMax(), 100000.0);
+    constexpr double kRelativeError = 1.0 / LatencyHistogram::kSubBucketCount;
+    for (const double p: {1.0, 50.0, 90.0, 99.0, 99.9}) {
+        const double expected = p * 1000.0;
+        EXPECT_GE(histogram.GetPercentile(p), expected) << p;
+        EXPECT_LE(histogram.GetPercentile(p), expected * (1.0 + kRelativeError)) << p;
+    }
+    EXPECT_EQ(histogram.GetPercentile(100), 100000.0);
+    std::cout << histogram.ToString() << std::endl;
+
+    // out of range values are clamped into the first and the last buckets
+    LatencyHistogram extremes;
+    extremes.Record(0.0);
+    extremes.Record(-1.0);
+    extremes.Record(1.0e30);
+    EXPECT_EQ(extremes.GetBucketCount(0), 2);
+    EXPECT_EQ(extremes.GetBucketCount(LatencyHistogram::kNumBuckets - 1), 1);
+    EXPECT_EQ(extremes.GetPercentile(50), -1.0);
+    EXPECT_EQ(extremes.GetPercentile(100), 1.0e30);
+
+    for (std::size_t i = 1; i + 1 < LatencyHistogram::kNumBuckets; ++i) {
+        const double lower = LatencyHistogram::GetBucketLowerBound(i);
+        ASSERT_EQ(LatencyHistogram::GetBucketIndex(lower), i);
+        ASSERT_EQ(LatencyHistogram::GetBucketIndex(std::nextafter(lower, 0.0)), i - 1);
+    }
+}
+
+TEST(LatencyHistogram, MergeAndSerialize) {
+    using namespace erl::common;
+    constexpr int kThreads = 4;
+    constexpr int kRecords = 100000;
+    std::vector<LatencyHistogram> histograms(kThreads);
+    LatencyHistogram shared;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 engine(t);
+            std::exponential_distribution<double> dist(1.0e-3);
+            for (int i = 0; i < kRecords; ++i) {
+                const double value = dist(engine);
+                histograms[t].Record(value);
+                shared.Record(value);
+            }
+        });
+    }
+    for (auto &thread: threads) { thread.join(); }
+
+    LatencyHistogram merged;
+    for (const auto &histogram: histograms) { merged.Merge(histogram); }
+    EXPECT_EQ(merged.GetCount(), kThreads * kRecords);
+    EXPECT_EQ(shared.GetCount(), kThreads * kRecords);
+    EXPECT_EQ(merged.GetMin(), shared.GetMin());
+    EXPECT_EQ(merged.GetMax(), shared.GetMax());
+    for (std::size_t i = 0; i < LatencyHistogram::kNumBuckets; ++i) {
+        ASSERT_EQ(merged.GetBucketCount(i), shared.GetBucketCount(i));
+    }
+    // exponential distribution: p99 = ln(100) / rate
+    EXPECT_NEAR(merged.GetPercentile(99), std::log(100.0) * 1000.0, 200.0);
+
+    std::stringstream ss;
+    ASSERT_TRUE(merged.Write(ss));
+    LatencyHistogram read;
+    read.Record(1.0);
+    ASSERT_TRUE(read.Read(ss));
+    EXPECT_EQ(read.GetCount(), merged.GetCount());
+    EXPECT_EQ(read.GetMin(), merged.GetMin());
+    EXPECT_EQ(read.GetMax(), merged.GetMax());
+    EXPECT_EQ(read.ToString(), merged.ToString());
+}
+
+TEST(LatencyHistogram, BlockTimer) {
+    using namespace erl::common;
+    LatencyHistogram histogram;
+    for (int i = 0; i < 20; ++i) {
+        ERL_BLOCK_TIMER_MICRO_MSG_HISTOGRAM("sleep", histogram);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    EXPECT_EQ(histogram.GetCount(), 20);
+    EXPECT_GE(histogram.GetMin(), 200.0);
+    EXPECT_GE(histogram.GetPercentile(50), 200.0);
+    std::cout << "sleep 200 us: " << histogram.ToString() << " us" << std::endl;
+}
+
+TEST(RunningStatistics, Stable) {
+    using namespace erl::common;
+    // E[x^2] - E[x]^2 loses every digit of the variance at this offset
+    constexpr double kOffset = 1.0e9;
+    RunningStatistics stats, first, second;
+    double sum = 0, squared_sum = 0;
+    for (int i = 0; i < 10000; ++i) {
+        const double value = kOffset + (i % 2 == 0 ? 1.0 : -1.0);
+        stats.Add(value);
+        (i < 3000 ? first : second).Add(value);
+        sum += value;
+        squared_sum += value * value;
+    }
+    EXPECT_DOUBLE_EQ(stats.GetMean(), kOffset);
+    EXPECT_NEAR(stats.GetStd(), 1.0, 1.0e-9);
+    const double naive_mean = sum / 10000;
+    std::cout << "naive variance: " << squared_sum / 10000 - naive_mean * naive_mean
+              << ", Welford variance: " << stats.GetVariance() << std::endl;
+
+    first.Merge(second);
+    EXPECT_EQ(first.count, stats.count);
+    EXPECT_NEAR(first.GetMean(), stats.GetMean(), 1.0e-6);
+    EXPECT_NEAR(first.GetVariance(), stats.GetVariance(), 1.0e-6);
+    EXPECT_EQ(first.min, kOffset - 1.0);
+    EXPECT_EQ(first.max, kOffset + 1.0);
+
+    RunningStatistics weighted;
+    weighted.Add(1.0, 3.0);
+    weighted.Add(5.0, 1.0);
+    EXPECT_DOUBLE_EQ(weighted.GetMean(), 2.0);
+    EXPECT_DOUBLE_EQ(weighted.GetVariance(), (3.0 * 1.0 + 9.0) / 4.0);
+    EXPECT_TRUE(std::isnan(RunningStatistics().GetMean()));
+}
@@ -1,5 +1,7 @@
 #ifdef ERL_USE_LIBZIP
+    #include "erl_common/data_buffer_manager.hpp"
     #include "erl_common/libzip.hpp"
+    #include "erl_common/random.hpp"
     #include "erl_common/test_helper.hpp"
 
 TEST(LibZip, AddDirectory) {
@@ -22,4 +24,147 @@ TEST(LibZip, AddItems) {
                         {module_root / "CMakeLists.txt", "erl_common/CMakeLists.txt"},
                     }));
 }
+
+TEST(LibZip, InMemoryAndReader) {
+    GTEST_PREPARE_OUTPUT_DIR();
+    using namespace erl::common;
+    using Manager = DataBufferManager<double>;
+
+    Manager manager;
+    for (int i = 0; i < 1000; ++i) { (void) manager.AddEntry(i); }
+    std::string text(100000, 'a');
+    for (std::size_t i = 0; i < text.size(); i += 7) { text[i] = static_cast<char>('a' + i % 26); }
+
+    const std::string zip_path = test_output_dir / "in_memory.zip";
+    std::filesystem::remove(zip_path);
+    {
+        LibZip zip(zip_path);
+        ASSERT_TRUE(zip.AddObject("objects/manager.bin", &manager));
+        ASSERT_TRUE(zip.AddBuffer("text.txt", text));
+        ASSERT_TRUE(zip.AddBuffer("empty.txt", ""));
+        ASSERT_TRUE(zip.AddFile(gtest_src_dir / "test_libzip.cpp", "test_libzip.cpp"));
+        ASSERT_TRUE(zip.Close());
+    }
+
+    LibZipReader reader(zip_path);
+    EXPECT_EQ(reader.GetEntryNames().size(), 4);
+    EXPECT_TRUE(reader.HasEntry("text.txt"));
+    EXPECT_FALSE(reader.HasEntry("missing.txt"));
+    EXPECT_EQ(reader.GetEntrySize("text.txt"), text.size());
+
+    std::string data;
+    ASSERT_TRUE(reader.Extract("text.txt", data));
+    EXPECT_EQ(data, text);
+    ASSERT_TRUE(reader.Extract("empty.txt", data));
+    EXPECT_TRUE(data.empty());
+
+    Manager manager_read;
+    ASSERT_TRUE(reader.ReadObject("objects/manager.bin", &manager_read));
+    EXPECT_TRUE(manager_read == manager);
+
+    // seeking in a compressed entry
+    const std::unique_ptr<LibZipEntryIStream> stream = reader.OpenEntry("text.txt");
+    ASSERT_NE(stream, nullptr);
+    char c;
+    stream->seekg(90000);
+    stream->get(c);
+    EXPECT_EQ(c, text[90000]);
+    stream->seekg(7);
+    stream->get(c);
+    EXPECT_EQ(c, text[7]);
+    EXPECT_EQ(stream->tellg(), 8);
+
+    const std::filesystem::path extract_dir = test_output_dir / "in_memory";
+    ASSERT_TRUE(reader.ExtractAll(extract_dir));
+    ASSERT_TRUE(serialization::Serialization<Manager>::Read(
+        extract_dir / "objects/manager.bin",
+        &manager_read));
+    EXPECT_TRUE(manager_read == manager);
+}
+
+TEST(LibZip, ExtractAllRejectsUnsafeNames) {
+    GTEST_PREPARE_OUTPUT_DIR();
+    using namespace erl::common;
+
+    for (const char *name: {"../escape.txt", "dir/../../escape.txt", "/tmp/escape.txt"}) {
+        const std::string zip_path = test_output_dir / "unsafe.zip";
+        {
+            LibZip::Setting setting;
+            setting.overwrite = true;
+            LibZip zip(zip_path, setting);
+            ASSERT_TRUE(zip.AddBuffer("safe.txt", "safe"));
+            ASSERT_TRUE(zip.AddBuffer(name, "escape"));
+            ASSERT_TRUE(zip.Close());
+        }
+        const std::filesystem::path extract_dir = test_output_dir / "unsafe";
+        std::filesystem::remove_all(extract_dir);
+        std::filesystem::remove(test_output_dir / "escape.txt");
+        EXPECT_FALSE(LibZipReader(zip_path).ExtractAll(extract_dir)) << name;
+        EXPECT_FALSE(std::filesystem::exists(test_output_dir / "escape.txt")) << name;
+        EXPECT_FALSE(std::filesystem::exists(extract_dir / "safe.txt")) << name;
+    }
+}
+
+TEST(LibZip, BoundedMemory) {
+    GTEST_PREPARE_OUTPUT_DIR();
+    using namespace erl::common;
+
+    std::vector<std::string> buffers(16);
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+        buffers[i].assign(64 << 10, static_cast<char>('a' + i));
+    }
+    for (const bool parallel: {false, true}) {
+        LibZip::Setting setting;
+        setting.overwrite = true;
+        setting.parallel = parallel;
+        setting.max_pending_bytes = 100 << 10;  // the archive is written several times
+        const std::string zip_path = test_output_dir / "bounded_memory.zip";
+        {
+            LibZip zip(zip_path, setting);
+            for (std::size_t i = 0; i < buffers.size(); ++i) {
+                ASSERT_TRUE(zip.AddBuffer(std::to_string(i) + ".txt", buffers[i]));
+            }
+            ASSERT_TRUE(zip.Close());
+        }
+        LibZipReader reader(zip_path);
+        ASSERT_EQ(reader.GetEntryNames().size(), buffers.size());
+        std::string data;
+        for (std::size_t i = 0; i < buffers.size(); ++i) {
+            ASSERT_TRUE(reader.Extract(std::to_string(i) + ".txt", data));
+            EXPECT_EQ(data, buffers[i]);
+        }
+    }
+}
+
+TEST(LibZip, ParallelBenchmark) {
+    GTEST_PREPARE_OUTPUT_DIR();
+    using namespace erl::common;
+
+    std::vector<std::string> buffers(32);
+    std::uniform_int_distribution<int> distribution(0, 15);
+    for (std::string &buffer: buffers) {
+        buffer.resize(4 << 20);
+        for (char &c: buffer) { c = static_cast<char>('a' + distribution(g_random_engine)); }
+    }
+
+    auto pack = [&](const char *name, const bool parallel) {
+        LibZip::Setting setting;
+        setting.overwrite = true;
+        setting.parallel = parallel;
+        LibZip zip(test_output_dir / name, setting);
+        for (std::size_t i = 0; i < buffers.size(); ++i) {
+            ASSERT_TRUE(zip.AddBuffer(std::to_string(i) + ".txt", buffers[i]));
+        }
+        ASSERT_TRUE(zip.Close());
+    };
+    ReportTime<std::chrono::milliseconds>("serial", 1, false, [&] { pack("serial.zip", false); });
+    ReportTime<std::chrono::milliseconds>("parallel", 1, false, [&] {
+        pack("parallel.zip", true);
+    });
+
+    LibZipReader reader(test_output_dir / "parallel.zip");
+    std::string data;
+    ASSERT_TRUE(reader.Extract("31.txt", data));
+    EXPECT_EQ(data, buffers[31]);
+}
 #endif
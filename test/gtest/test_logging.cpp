@@ -46,3 +46,262 @@ TEST(Logging, Macro) {
     // should exit
     ASSERT_DEATH(({ ERL_FATAL("fatal message, 2 / 3 = {:.3f}", 2.0 / 3.0); }), ".*");
 }
+
+TEST(Logging, Async) {
+    using namespace erl::common;
+    constexpr int kNumThreads = 4;
+    constexpr int kNumRecords = 100;
+
+    testing::internal::CaptureStdout();
+    Logging::StartAsync();
+    EXPECT_TRUE(Logging::IsAsync());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < kNumRecords; ++i) { ERL_INFO("thread {} record {}", t, i); }
+        });
+    }
+    for (auto &thread: threads) { thread.join(); }
+    Logging::Flush();
+    Logging::StopAsync();
+    EXPECT_FALSE(Logging::IsAsync());
+    const std::string output = testing::internal::GetCapturedStdout();
+
+    // every record is written once, in the order of its thread
+    for (int t = 0; t < kNumThreads; ++t) {
+        std::size_t pos = 0;
+        for (int i = 0; i < kNumRecords; ++i) {
+            const std::string msg = fmt::format("thread {} record {}\n", t, i);
+            pos = output.find(msg, pos);
+            ASSERT_NE(pos, std::string::npos) << msg;
+        }
+    }
+}
+
+TEST(Logging, AsyncOverflow) {
+    using namespace erl::common;
+    Logging::AsyncSetting setting;
+    setting.queue_capacity = 4;
+    setting.overflow = Logging::Overflow::kCount;
+    setting.flush_interval = std::chrono::milliseconds(1000);
+
+    testing::internal::CaptureStdout();
+    Logging::StartAsync(setting);
+    for (int i = 0; i < 100; ++i) { Logging::Info("record {}", i); }
+    Logging::Flush();
+    const std::size_t num_dropped = Logging::GetNumDroppedRecords();
+    Logging::StopAsync();
+    const std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(num_dropped, 96);
+    EXPECT_NE(output.find("96 log records were dropped."), std::string::npos);
+
+    setting.overflow = Logging::Overflow::kBlock;
+    testing::internal::CaptureStdout();
+    Logging::StartAsync(setting);
+    for (int i = 0; i < 100; ++i) { Logging::Info("record {}", i); }
+    Logging::StopAsync();
+    EXPECT_EQ(Logging::GetNumDroppedRecords(), 0);
+    EXPECT_NE(testing::internal::GetCapturedStdout().find("record 99\n"), std::string::npos);
+}
+
+TEST(Logging, AsyncRestart) {
+    using namespace erl::common;
+    Logging::AsyncSetting setting;
+    std::atomic<bool> done{false};
+
+    testing::internal::CaptureStdout();
+    Logging::StartAsync(setting);
+    // the setting is replaced while another thread is logging
+    std::thread producer([&done] {
+        for (int i = 0; !done.load(); ++i) { Logging::Info("record {}", i); }
+    });
+    for (int i = 0; i < 20; ++i) {
+        setting.queue_capacity = i % 2 == 0 ? 4 : 1024;
+        setting.overflow = i % 2 == 0 ? Logging::Overflow::kBlock : Logging::Overflow::kCount;
+        Logging::StartAsync(setting);
+    }
+    done = true;
+    producer.join();
+    Logging::Info("last record");
+    Logging::StopAsync();
+    EXPECT_NE(testing::internal::GetCapturedStdout().find("last record\n"), std::string::npos);
+}
+
+TEST(Logging, AsyncBenchmark) {
+    using namespace erl::common;
+    constexpr int kNumThreads = 8;
+    constexpr int kNumRecords = 20000;
+    auto log = [] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kNumThreads; ++t) {
+            threads.emplace_back([t] {
+                for (int i = 0; i < kNumRecords; ++i) { ERL_INFO("thread {} record {}", t, i); }
+            });
+        }
+        for (auto &thread: threads) { thread.join(); }
+        Logging::Flush();
+    };
+
+    testing::internal::CaptureStdout();
+    const double t_sync = ReportTime<std::chrono::milliseconds>("sync", 1, false, log);
+    Logging::AsyncSetting setting;
+    setting.overflow = Logging::Overflow::kBlock;
+    Logging::StartAsync(setting);
+    const double t_async = ReportTime<std::chrono::milliseconds>("async", 1, false, log);
+    Logging::StopAsync();
+    testing::internal::GetCapturedStdout();
+    std::cout << "sync: " << t_sync << " ms, async: " << t_async << " ms" << std::endl;
+}
+
+TEST(Logging, LazyArguments) {
+    using namespace erl::common;
+    const LoggingLevel level = Logging::GetLevel();
+    int num_evaluations = 0;
+    auto evaluate = [&num_evaluations] { return ++num_evaluations; };
+
+    Logging::SetLevel(kWarn);
+    ERL_DEBUG("not evaluated {}", evaluate());
+    ERL_INFO("not evaluated {}", evaluate());
+    EXPECT_EQ(num_evaluations, 0);
+    ERL_WARN("evaluated {}", evaluate());
+    EXPECT_EQ(num_evaluations, 1);
+    Logging::SetLevel(level);
+}
+
+TEST(Logging, RateLimited) {
+    using namespace erl::common;
+    std::atomic<int> num_evaluations = 0;
+    auto evaluate = [&num_evaluations] { return ++num_evaluations; };
+
+    for (int i = 0; i < 10; ++i) { ERL_INFO_EVERY_N(3, "every 3rd {}", evaluate()); }
+    EXPECT_EQ(num_evaluations, 4);  // 0, 3, 6, 9
+
+    num_evaluations = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&evaluate] {
+            for (int i = 0; i < 10000; ++i) {
+                ERL_DEBUG_EVERY_N(1000, "every 1000th {}", evaluate());
+            }
+        });
+    }
+    for (auto &thread: threads) { thread.join(); }
+    EXPECT_EQ(num_evaluations, Logging::IsEnabled(kDebug) ? 40 : 0);
+
+    num_evaluations = 0;
+    for (int i = 0; i < 100; ++i) { ERL_WARN_EVERY_MS(60000, "once a minute {}", evaluate()); }
+    EXPECT_EQ(num_evaluations, 1);
+
+    num_evaluations = 0;
+    for (int i = 0; i < 100; ++i) { ERL_WARN_THROTTLED(0.01, 3, "burst of 3 {}", evaluate()); }
+    EXPECT_EQ(num_evaluations, 3);
+
+    LogEveryMs every_ms;
+    EXPECT_TRUE(every_ms.ShouldLog(20));
+    for (int i = 0; i < 5; ++i) { EXPECT_FALSE(every_ms.ShouldLog(20)); }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_TRUE(every_ms.ShouldLog(20));
+    EXPECT_EQ(every_ms.TakeNumSuppressed(), 5);
+
+    LogThrottle throttle;  // 100 per second, bursts of 2
+    EXPECT_TRUE(throttle.ShouldLog(100, 2));
+    EXPECT_TRUE(throttle.ShouldLog(100, 2));
+    EXPECT_FALSE(throttle.ShouldLog(100, 2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    EXPECT_TRUE(throttle.ShouldLog(100, 2));
+    EXPECT_EQ(throttle.TakeNumSuppressed(), 1);
+
+    LogThrottle invalid;
+    EXPECT_FALSE(invalid.ShouldLog(0, 2));
+    EXPECT_FALSE(invalid.ShouldLog(-1, 2));
+    EXPECT_FALSE(invalid.ShouldLog(std::numeric_limits<double>::quiet_NaN(), 2));
+    EXPECT_EQ(invalid.TakeNumSuppressed(), 3);
+    LogThrottle tiny;  // the time per token is clamped instead of overflowing
+    EXPECT_TRUE(tiny.ShouldLog(1.0e-30, 0));
+    EXPECT_FALSE(tiny.ShouldLog(1.0e-30, 0));
+}
+
+TEST(Logging, TimeFormat) {
+    using namespace erl::common;
+    // '#' matches a digit
+    auto has_shape = [](const std::string &str, const std::string &shape) {
+        if (str.size() != shape.size()) { return false; }
+        for (std::size_t i = 0; i < str.size(); ++i) {
+            if (shape[i] == '#' ? !std::isdigit(str[i]) : str[i] != shape[i]) { return false; }
+        }
+        return true;
+    };
+    EXPECT_TRUE(has_shape(Logging::GetDateStr(), "####-##-##"));
+    EXPECT_TRUE(has_shape(Logging::GetTimeStr(), "##:##:##"));
+    EXPECT_TRUE(has_shape(Logging::GetDateTimeStr(), "####-##-## ##:##:##"));
+    EXPECT_TRUE(has_shape(Logging::GetTimeStamp(), "########-######"));
+
+    const std::pair<Logging::TimeFormat, std::string> formats[] = {
+        {Logging::TimeFormat::kSeconds, "##:##:##"},
+        {Logging::TimeFormat::kMicroseconds, "##:##:##.######"},
+        {Logging::TimeFormat::kMonotonic, "#.######"},  // less than 10 s after the start
+    };
+    for (const auto &[format, shape]: formats) {
+        Logging::SetTimeFormat(format);
+        EXPECT_EQ(Logging::GetTimeFormat(), format);
+        testing::internal::CaptureStdout();
+        ERL_INFO("time format");
+        const std::string output = testing::internal::GetCapturedStdout();
+        const std::size_t end = output.find("][INFO]: ");
+        ASSERT_NE(end, std::string::npos) << output;
+        const std::size_t begin = output.rfind('[', end) + 1;  // after the escape sequence
+        EXPECT_TRUE(has_shape(output.substr(begin, end - begin), shape)) << output;
+    }
+    Logging::SetTimeFormat(Logging::TimeFormat::kSeconds);
+}
+
+TEST(Logging, ThroughputBenchmark) {
+    using namespace erl::common;
+    constexpr int kNumRecords = 100000;
+    const int num_threads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+    auto log = [](const int n) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n; ++t) {
+            threads.emplace_back([t, n] {
+                for (int i = 0; i < kNumRecords / n; ++i) { ERL_INFO("thread {} record {}", t, i); }
+            });
+        }
+        for (auto &thread: threads) { thread.join(); }
+    };
+
+    const std::pair<Logging::TimeFormat, const char *> formats[] = {
+        {Logging::TimeFormat::kSeconds, "seconds"},
+        {Logging::TimeFormat::kMicroseconds, "microseconds"},
+        {Logging::TimeFormat::kMonotonic, "monotonic"},
+    };
+    for (const auto &[format, name]: formats) {
+        Logging::SetTimeFormat(format);
+        testing::internal::CaptureStdout();
+        const double t_1 = ReportTime<std::chrono::milliseconds>("1", 1, false, [&] { log(1); });
+        const double t_n = ReportTime<std::chrono::milliseconds>("N", 1, false, [&] {
+            log(num_threads);
+        });
+        testing::internal::GetCapturedStdout();
+        std::cout << name << " records per second, 1 thread: " << kNumRecords / t_1 * 1000 << ", "
+                  << num_threads << " threads: " << kNumRecords / t_n * 1000 << std::endl;
+    }
+    Logging::SetTimeFormat(Logging::TimeFormat::kSeconds);
+
+    // the time formatting alone, without and with the cache
+    constexpr int kNumCalls = 1000000;
+    std::size_t size = 0;
+    const double t_format = ReportTime<std::chrono::milliseconds>("fmt", 1, false, [&] {
+        for (int i = 0; i < kNumCalls; ++i) {
+            const std::time_t now = std::time(nullptr);
+            std::tm tm{};
+            localtime_r(&now, &tm);
+            size += fmt::format("{:%X}", tm).size();
+        }
+    });
+    const double t_cached = ReportTime<std::chrono::milliseconds>("cached", 1, false, [&] {
+        for (int i = 0; i < kNumCalls; ++i) { size += Logging::GetTimeStr().size(); }
+    });
+    std::cout << "time string: localtime_r + fmt " << t_format * 1.0e6 / kNumCalls
+              << " ns, cached " << t_cached * 1.0e6 / kNumCalls << " ns (" << size << ")"
+              << std::endl;
+}
@@ -0,0 +1,19 @@
+#define ERL_LOG_ACTIVE_LEVEL ERL_LOG_LEVEL_WARN
+
+#include "erl_common/test_helper.hpp"
+
+TEST(LoggingActiveLevel, RemovedAtCompileTime) {
+    using namespace erl::common;
+    const LoggingLevel level = Logging::GetLevel();
+    Logging::SetLevel(kDebug);
+    int num_evaluations = 0;
+    auto evaluate = [&num_evaluations] { return ++num_evaluations; };
+    ERL_DEBUG("removed {}", evaluate());
+    ERL_INFO("removed {}", evaluate());
+    ERL_INFO_ONCE("removed {}", evaluate());
+    EXPECT_EQ(num_evaluations, 0);
+    ERL_WARN("kept {}", evaluate());
+    ERL_ERROR("kept {}", evaluate());
+    EXPECT_EQ(num_evaluations, 2);
+    Logging::SetLevel(level);
+}
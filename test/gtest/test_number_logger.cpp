@@ -3,6 +3,8 @@
 #include "erl_common/random.hpp"
 #include "erl_common/test_helper.hpp"
 
+#include <thread>
+
 TEST(NumberLogger, Basic) {
     GTEST_PREPARE_OUTPUT_DIR();
     using namespace erl::common;
@@ -48,3 +50,136 @@ TEST(NumberLogger, WithProgressBar) {
     }
     pbar->Close();
 }
+
+TEST(NumberLogger, Percentiles) {
+    GTEST_PREPARE_OUTPUT_DIR();
+    using namespace erl::common;
+    NumberLogger logger(test_output_dir / "percentiles.csv", "step", 0, false, true);
+    logger.AddColumn("offset");
+    logger.AddColumn("latency", /*percentiles*/ true);
+
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 1; j <= 1000; ++j) {
+            logger.Log("offset", 1.0e9 + (j % 2 == 0 ? 1.0 : -1.0));
+            logger.Log("latency", j);
+        }
+        const auto statistics = logger.GetColumnStatistics();
+        ASSERT_EQ(statistics.size(), 2);
+        EXPECT_DOUBLE_EQ(statistics[0].stats.GetMean(), 1.0e9);
+        EXPECT_NEAR(statistics[0].stats.GetStd(), 1.0, 1.0e-9);
+        EXPECT_TRUE(std::isnan(statistics[0].GetPercentile(50)));
+        EXPECT_NEAR(statistics[1].GetPercentile(50), 500.0, 500.0 / 32);
+        EXPECT_NEAR(statistics[1].GetPercentile(99), 990.0, 990.0 / 32);
+        EXPECT_EQ(statistics[1].stats.max, 1000.0);
+        logger.Print();
+    }
+    logger.Flush();
+
+    std::ifstream ifs(test_output_dir / "percentiles.csv");
+    std::string header;
+    std::getline(ifs, header);
+    EXPECT_EQ(
+        header,
+        "step,offset_mean,offset_std,latency_mean,latency_std,latency_p50,latency_p99,"
+        "latency_p999");
+}
+
+TEST(NumberLogger, OutlyingFirstSample) {
+    using namespace erl::common;
+    NumberLogger logger;
+    const NumberLogger::ColumnId x = logger.AddColumn("x");
+
+    // a light warm-up sample far from the rest must not cost the std its precision
+    constexpr int kSamples = 100000;
+    constexpr double kOutlier = 1.0e6;
+    constexpr double kOutlierWeight = 1.0e-6;
+    logger.Log(x, kOutlier, kOutlierWeight);
+    for (int i = 0; i < kSamples; ++i) { logger.Log(x, i % 2 == 0 ? 1.0 : -1.0); }
+
+    // exact for the values above: the samples have mean 0 and variance 1
+    const long double weight_sum = kSamples + static_cast<long double>(kOutlierWeight);
+    const long double mean = kOutlierWeight * static_cast<long double>(kOutlier) / weight_sum;
+    const long double m2 = kSamples * (1.0L + mean * mean) +
+                           kOutlierWeight * (kOutlier - mean) * (kOutlier - mean);
+    const auto statistics = logger.GetColumnStatistics();
+    EXPECT_NEAR(statistics[0].stats.GetMean(), static_cast<double>(mean), 1.0e-12);
+    EXPECT_NEAR(
+        statistics[0].stats.GetStd(),
+        static_cast<double>(std::sqrt(m2 / weight_sum)),
+        1.0e-9);
+}
+
+TEST(NumberLogger, MultiThread) {
+    using namespace erl::common;
+    NumberLogger logger;
+    const NumberLogger::ColumnId x = logger.AddColumn("x");
+    const NumberLogger::ColumnId y = logger.AddColumn("y", /*percentiles*/ true);
+    EXPECT_EQ(logger.GetColumnId("y"), y);
+
+    constexpr int kThreads = 4;
+    constexpr int kSamples = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<double> batch(kSamples);
+            for (int i = 0; i < kSamples; ++i) {
+                logger.Log(x, t);
+                batch[i] = i + 1;
+            }
+            logger.Log(y, batch);
+        });
+    }
+    for (auto &thread: threads) { thread.join(); }
+
+    const auto statistics = logger.GetColumnStatistics();
+    EXPECT_EQ(statistics[0].stats.count, kThreads * kSamples);
+    EXPECT_NEAR(statistics[0].stats.GetMean(), 1.5, 1.0e-12);
+    EXPECT_NEAR(statistics[0].stats.GetVariance(), 1.25, 1.0e-12);
+    EXPECT_EQ(statistics[1].stats.count, kThreads * kSamples);
+    EXPECT_NEAR(statistics[1].stats.GetMean(), (kSamples + 1) / 2.0, 1.0e-9);
+    EXPECT_NEAR(statistics[1].GetPercentile(99), 0.99 * kSamples, 0.99 * kSamples / 32);
+
+    const auto printed = logger.Print();
+    EXPECT_NEAR(std::get<1>(printed[0]), 1.5, 1.0e-12);
+    EXPECT_EQ(logger.GetColumnStatistics()[0].stats.count, 0);
+}
+
+TEST(NumberLogger, Benchmark) {
+    using namespace erl::common;
+    constexpr int kColumns = 16;
+    constexpr int kSamples = 1000000;
+    NumberLogger logger;
+    std::vector<NumberLogger::ColumnId> ids;
+    std::vector<std::string> names;
+    for (int i = 0; i < kColumns; ++i) {
+        names.push_back("column_" + std::to_string(i));
+        ids.push_back(logger.AddColumn(names.back()));
+    }
+
+    const double t_id = ReportTime<std::chrono::milliseconds>("log by id", 1, false, [&] {
+        for (int i = 0; i < kSamples; ++i) { logger.Log(ids[i % kColumns], i); }
+    });
+    const double t_name = ReportTime<std::chrono::milliseconds>("log by name", 1, false, [&] {
+        for (int i = 0; i < kSamples; ++i) { logger.Log(names[i % kColumns], i); }
+    });
+    std::vector<double> values(kSamples / kColumns);
+    for (std::size_t i = 0; i < values.size(); ++i) { values[i] = static_cast<double>(i); }
+    const double t_batch = ReportTime<std::chrono::milliseconds>("log a batch", 1, false, [&] {
+        for (int i = 0; i < kColumns; ++i) { logger.Log(ids[i], values); }
+    });
+    constexpr int kThreads = 4;
+    const double t_threads = ReportTime<std::chrono::milliseconds>("log by id", 1, false, [&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < kSamples; ++i) { logger.Log(ids[i % kColumns], i); }
+            });
+        }
+        for (auto &thread: threads) { thread.join(); }
+    });
+    std::cout << "per sample: by id " << t_id * 1.0e6 / kSamples << " ns, by name "
+              << t_name * 1.0e6 / kSamples << " ns, batch " << t_batch * 1.0e6 / kSamples
+              << " ns, " << kThreads << " threads " << t_threads * 1.0e6 / kSamples / kThreads
+              << " ns" << std::endl;
+    logger.Print();
+}
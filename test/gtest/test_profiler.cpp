@@ -0,0 +1,187 @@
+#include "erl_common/block_timer.hpp"
+#include "erl_common/profiler.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+    const erl::common::Profiler::Node *
+    FindChild(const erl::common::Profiler::Node &node, const std::string &name) {
+        for (const auto &child: node.children) {
+            if (child.site->name == name) { return &child; }
+        }
+        return nullptr;
+    }
+
+    void
+    Inner() {
+        ERL_PROFILE_FUNCTION();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    void
+    Outer(const int n) {
+        ERL_PROFILE_FUNCTION();
+        for (int i = 0; i < n; ++i) { Inner(); }
+        {
+            ERL_PROFILE_SCOPE("block");
+            Inner();
+        }
+    }
+}  // namespace
+
+TEST(Profiler, NestedScopes) {
+    using namespace erl::common;
+    Profiler::Reset();
+    for (int i = 0; i < 3; ++i) { Outer(2); }
+    Inner();
+
+    const Profiler::Node root = Profiler::GetTree();
+    const Profiler::Node *outer = FindChild(root, "Outer");
+    ASSERT_NE(outer, nullptr);
+    EXPECT_EQ(outer->stats.count, 3);
+    ASSERT_EQ(outer->children.size(), 2);
+    // sorted by total time: Inner is entered twice as often as block
+    EXPECT_EQ(outer->children[0].site->name, "Inner");
+    EXPECT_EQ(outer->children[0].stats.count, 6);
+    const Profiler::Node *block = FindChild(*outer, "block");
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->stats.count, 3);
+    ASSERT_EQ(block->children.size(), 1);
+    EXPECT_EQ(block->children[0].stats.count, 3);
+    // Inner called from the top level is another node
+    const Profiler::Node *inner = FindChild(root, "Inner");
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(inner->stats.count, 1);
+
+    const Profiler::Stats &stats = outer->children[0].stats;
+    EXPECT_GE(stats.min_ns, 100000);
+    EXPECT_LE(stats.min_ns, stats.max_ns);
+    EXPECT_GE(stats.GetPercentileNs(50), stats.min_ns);
+    EXPECT_LE(stats.GetPercentileNs(99), stats.max_ns);
+    EXPECT_GE(outer->stats.total_ns, outer->children[0].stats.total_ns + block->stats.total_ns);
+
+    std::cout << Profiler::ToString() << std::endl;
+    const std::string csv = Profiler::ToCsv();
+    std::cout << csv << std::endl;
+    EXPECT_NE(csv.find("\"Outer;block;Inner\",3,"), std::string::npos);
+    EXPECT_NE(csv.find("\"Inner\",1,"), std::string::npos);
+    EXPECT_TRUE(Profiler::WriteCsv("profiler.csv"));
+
+    Profiler::Reset();
+    EXPECT_EQ(FindChild(Profiler::GetTree(), "Outer")->stats.count, 0);
+}
+
+TEST(Profiler, MultiThread) {
+    using namespace erl::common;
+    Profiler::Reset();
+    constexpr int kThreads = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([] { Outer(1); });
+    }
+    for (auto &thread: threads) { thread.join(); }
+
+    // the threads have exited, their statistics are kept
+    const Profiler::Node root = Profiler::GetTree();
+    const Profiler::Node *outer = FindChild(root, "Outer");
+    ASSERT_NE(outer, nullptr);
+    EXPECT_EQ(outer->stats.count, kThreads);
+    EXPECT_EQ(FindChild(*outer, "Inner")->stats.count, kThreads);
+}
+
+TEST(Profiler, NestedBlockTimers) {
+    using namespace erl::common;
+    Profiler::Reset();
+    double t_outer = 0, t_inner = 0;
+    for (int i = 0; i < 2; ++i) {
+        ERL_BLOCK_TIMER_MSG_TIME("timer outer", t_outer);
+        ERL_BLOCK_TIMER_MICRO_MSG_TIME("timer inner", t_inner);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_GE(t_outer, 1.0);
+    EXPECT_GE(t_inner, 1000.0);
+
+    const Profiler::Node root = Profiler::GetTree();
+    const Profiler::Node *outer = FindChild(root, "timer outer");
+    ASSERT_NE(outer, nullptr);
+    EXPECT_EQ(outer->stats.count, 2);
+    const Profiler::Node *inner = FindChild(*outer, "timer inner");
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(inner->stats.count, 2);
+}
+
+TEST(Profiler, ResetWhileThreadIsAlive) {
+    using namespace erl::common;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int step = 0;
+    auto wait_for = [&](const int target) {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&] { return step >= target; });
+    };
+    auto advance = [&] {
+        {
+            const std::scoped_lock lock(mutex);
+            ++step;
+        }
+        cv.notify_all();
+    };
+    auto count_of = [](const char *name) {
+        const Profiler::Node *node = FindChild(Profiler::GetTree(), name);
+        return node == nullptr ? 0 : node->stats.count;
+    };
+
+    auto work = [] { ERL_PROFILE_SCOPE("worker"); };
+    std::thread worker([&] {
+        for (int i = 0; i < 100; ++i) { work(); }
+        advance();  // step 1
+        wait_for(2);
+        work();
+    });
+    wait_for(1);
+    EXPECT_EQ(count_of("worker"), 100);
+    Profiler::Reset();
+    EXPECT_EQ(count_of("worker"), 0);  // the worker has not cleared its statistics yet
+    advance();
+    worker.join();
+    EXPECT_EQ(count_of("worker"), 1);  // the worker cleared them before accounting the scope
+
+    // the macros expand to a single declaration
+    LatencyHistogram histogram;
+    for (int i = 0; i < 3; ++i) ERL_BLOCK_TIMER_MICRO_MSG_HISTOGRAM("single statement", histogram);
+    EXPECT_EQ(histogram.GetCount(), 3);
+}
+
+TEST(Profiler, Disabled) {
+    using namespace erl::common;
+    Profiler::Reset();
+    Profiler::SetEnabled(false);
+    Outer(1);
+    Profiler::SetEnabled(true);
+    const Profiler::Node root = Profiler::GetTree();
+    const Profiler::Node *outer = FindChild(root, "Outer");
+    EXPECT_TRUE(outer == nullptr || outer->stats.count == 0);
+}
+
+TEST(Profiler, Overhead) {
+    using namespace erl::common;
+    Profiler::Reset();
+    constexpr int kScopes = 1000000;
+    volatile int sink = 0;
+    const double t_scope = ReportTime<std::chrono::milliseconds>("profile scope", 1, false, [&] {
+        for (int i = 0; i < kScopes; ++i) {
+            ERL_PROFILE_SCOPE("overhead");
+            sink = sink + 1;
+        }
+    });
+    const double t_loop = ReportTime<std::chrono::milliseconds>("empty loop", 1, false, [&] {
+        for (int i = 0; i < kScopes; ++i) { sink = sink + 1; }
+    });
+    std::cout << "per scope: " << (t_scope - t_loop) * 1.0e6 / kScopes << " ns" << std::endl;
+    const Profiler::Node *node = FindChild(Profiler::GetTree(), "overhead");
+    ASSERT_NE(node, nullptr);
+    EXPECT_GE(node->stats.count, kScopes);
+}
@@ -2,6 +2,7 @@
 #include "erl_common/test_helper.hpp"
 
 #include <chrono>
+#include <sstream>
 #include <thread>
 
 TEST(ProgressBar, SingleBar) {
@@ -110,3 +111,67 @@ TEST(ProgressBar, DynamicDescription) {
     bar->Close();
     std::cout << std::endl;
 }
+
+TEST(ProgressBar, ParallelUpdate) {
+    using namespace erl::common;
+    const auto setting = std::make_shared<ProgressBar::Setting>();
+    constexpr int kThreads = 4;
+    constexpr std::size_t kUpdates = 1000000;
+    setting->total = kThreads * kUpdates;
+    setting->description = "parallel";
+    std::stringstream out;
+    ProgressBar::SetRefreshRate(50);
+    EXPECT_DOUBLE_EQ(ProgressBar::GetRefreshRate(), 50);
+    const std::shared_ptr<ProgressBar> bar = ProgressBar::Open(setting, out);
+    EXPECT_EQ(ProgressBar::GetNumBars(), 1);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (std::size_t i = 0; i < kUpdates; ++i) { bar->Update(); }
+        });
+    }
+    for (auto &thread: threads) { thread.join(); }
+    const std::chrono::duration<double, std::nano> dt = std::chrono::steady_clock::now() - t0;
+    const double ns = dt.count() / (kThreads * kUpdates);
+    std::cout << "per update: " << ns << " ns" << std::endl;
+    EXPECT_EQ(bar->GetCount(), kThreads * kUpdates);
+
+    // the background thread redraws the bar without any Write
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_NE(out.str().find("100.00%"), std::string::npos);
+    ProgressBar::Write("message", out);
+    EXPECT_NE(out.str().find("message\nparallel: "), std::string::npos);
+    bar->Close();
+    EXPECT_EQ(ProgressBar::GetNumBars(), 0);
+    ProgressBar::SetRefreshRate(20);
+}
+
+TEST(ProgressBar, SettingIsCopied) {
+    using namespace erl::common;
+    const auto setting = std::make_shared<ProgressBar::Setting>();
+    setting->total = 10;
+    setting->description = "copied";
+    std::stringstream out;
+    const std::shared_ptr<ProgressBar> bar = ProgressBar::Open(setting, out);
+
+    // the renderer draws its own copy, so the caller may change the setting meanwhile
+    std::thread writer([&] {
+        for (int i = 0; i < 1000; ++i) { setting->description = "ignored " + std::to_string(i); }
+    });
+    for (int i = 0; i < 10; ++i) {
+        bar->Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    writer.join();
+    bar->SetDescription("changed");
+    bar->SetTotal(20);
+    EXPECT_EQ(bar->GetSetting().description, "changed");
+    EXPECT_EQ(bar->GetSetting().total, 20);
+    bar->Close();
+    const std::string drawn = out.str();
+    EXPECT_EQ(drawn.find("ignored"), std::string::npos);
+    EXPECT_NE(drawn.find("changed: "), std::string::npos);
+    EXPECT_NE(drawn.find(" 10/20: "), std::string::npos);
+}
@@ -96,3 +96,149 @@ TEST(RingBufferTest, PushMany) {
     PrintBufferState(buffer);
     DrainBuffer(buffer);  // Should print: 2, 3, 4, 5, 6
 }
+
+TEST(RingBufferTest, ReserveCommitPeekConsume) {
+    using namespace erl::common;
+
+    RingBuffer<int, -1> buffer(5);
+    buffer.PushRange({1, 2, 3});
+    ASSERT_EQ(buffer.Consume(2), 2);  // read = 2, write = 3
+
+    // reserve across the end of the storage
+    auto write_spans = buffer.ReserveWrite(4);
+    ASSERT_EQ(write_spans.Size(), 4);
+    ASSERT_EQ(write_spans.first_size, 2);
+    ASSERT_EQ(write_spans.second_size, 2);
+    for (std::size_t i = 0; i < write_spans.Size(); ++i) {
+        write_spans[i] = 4 + static_cast<int>(i);
+    }
+    ASSERT_EQ(buffer.Size(), 1);  // nothing visible before commit
+    buffer.CommitWrite(4);
+    PrintBufferState(buffer);
+    ASSERT_TRUE(buffer.IsFull());
+
+    auto read_spans = buffer.PeekRead();
+    ASSERT_EQ(read_spans.Size(), 5);
+    ASSERT_EQ(read_spans.first_size, 3);
+    ASSERT_EQ(read_spans.second_size, 2);
+    for (std::size_t i = 0; i < read_spans.Size(); ++i) {
+        ASSERT_EQ(read_spans[i], 3 + static_cast<int>(i));
+    }
+    ASSERT_EQ(buffer.Size(), 5);  // peeking does not remove elements
+    ASSERT_EQ(buffer.Consume(3), 3);
+    ASSERT_EQ(*buffer.Front(), 6);
+
+    // overwrite the oldest elements
+    buffer.PushRange({8, 9});  // 6, 7, 8, 9
+    write_spans = buffer.ReserveWrite(3);
+    ASSERT_EQ(write_spans.Size(), 3);
+    ASSERT_EQ(buffer.Size(), 2);  // 6 and 7 are dropped at once
+    for (std::size_t i = 0; i < 3; ++i) { write_spans[i] = 10 + static_cast<int>(i); }
+    buffer.CommitWrite(3);
+    ASSERT_TRUE(buffer.IsFull());
+    std::vector<int> popped;
+    buffer.PopAll(popped);
+    ASSERT_EQ(popped, std::vector<int>({8, 9, 10, 11, 12}));
+
+    // a partial commit after an overlapping reserve does not expose the uncommitted slots
+    buffer.PushRange({1, 2, 3, 4, 5});
+    write_spans = buffer.ReserveWrite(10);
+    ASSERT_EQ(write_spans.Size(), 5);
+    ASSERT_TRUE(buffer.IsEmpty());
+    for (std::size_t i = 0; i < write_spans.Size(); ++i) {
+        write_spans[i] = 20 + static_cast<int>(i);
+    }
+    buffer.CommitWrite(2);
+    ASSERT_EQ(buffer.Size(), 2);
+    popped.clear();
+    buffer.PopAll(popped);
+    ASSERT_EQ(popped, std::vector<int>({20, 21}));
+
+    // reject on full limits the reservation to the available space
+    buffer.RejectOnFull(true);
+    buffer.PushRange({1, 2, 3});
+    ASSERT_EQ(buffer.ReserveWrite(10).Size(), 2);
+    buffer.CommitWrite(0);
+    ASSERT_EQ(buffer.Size(), 3);
+    ASSERT_EQ(buffer.PeekRead(2).Size(), 2);
+}
+
+TEST(RingBufferTest, PowerOfTwoCapacity) {
+    using namespace erl::common;
+
+    RingBuffer<int, 8> static_buffer;
+    ASSERT_TRUE(static_buffer.IsPowerOfTwoCapacity());
+    ASSERT_FALSE((RingBuffer<int, 5>().IsPowerOfTwoCapacity()));
+
+    RingBuffer<int, -1> buffer(5, true);
+    ASSERT_EQ(buffer.Capacity(), 8);
+    ASSERT_TRUE(buffer.IsPowerOfTwoCapacity());
+
+    // wrap around many times, the counters keep increasing
+    std::vector<int> popped;
+    for (int i = 0; i < 100; ++i) {
+        buffer.Push(i);
+        static_buffer.Push(i);
+        if (i % 3 == 1) {
+            ASSERT_EQ(buffer.Pop().value(), static_buffer.Pop().value());
+        }
+    }
+    ASSERT_TRUE(buffer.IsFull());
+    buffer.PopAll(popped);
+    ASSERT_EQ(popped, std::vector<int>({92, 93, 94, 95, 96, 97, 98, 99}));
+
+    buffer.PushRange({1, 2, 3});
+    buffer.Resize(3);
+    ASSERT_FALSE(buffer.IsPowerOfTwoCapacity());
+    buffer.Push(4);
+    popped.clear();
+    buffer.PopAll(popped);
+    ASSERT_EQ(popped, std::vector<int>({2, 3, 4}));
+}
+
+TEST(RingBufferTest, Serialization) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    using Buffer = RingBuffer<int, -1>;
+
+    Buffer buffer(4);
+    for (int i = 0; i < 6; ++i) { buffer.Push(i); }
+    ASSERT_TRUE(Serialization<Buffer>::Write("ring_buffer.bin", &buffer));
+    Buffer buffer_read(1);
+    ASSERT_TRUE(Serialization<Buffer>::Read("ring_buffer.bin", &buffer_read));
+    EXPECT_EQ(buffer_read.Capacity(), 4);
+    EXPECT_TRUE(buffer_read.IsPowerOfTwoCapacity());
+    EXPECT_EQ(buffer, buffer_read);
+}
+
+TEST(RingBufferTest, PowerOfTwoBenchmark) {
+    using namespace erl::common;
+
+    constexpr int n = 1 << 20;
+    double sum = 0;
+    auto push_pop = [&sum](auto &buffer) {
+        for (int i = 0; i < n; ++i) {
+            buffer.Push(static_cast<float>(i));
+            if (i & 1) { sum += *buffer.Pop(); }
+        }
+    };
+
+    RingBuffer<float, 1000> static_buffer;
+    RingBuffer<float, 1024> static_buffer_pow2;
+    RingBuffer<float, -1> dynamic_buffer(1000);
+    RingBuffer<float, -1> dynamic_buffer_pow2(1000, true);
+    ReportTime<std::chrono::microseconds>("static, N = 1000", 10, false, [&] {
+        push_pop(static_buffer);
+    });
+    ReportTime<std::chrono::microseconds>("static, N = 1024", 10, false, [&] {
+        push_pop(static_buffer_pow2);
+    });
+    ReportTime<std::chrono::microseconds>("dynamic, capacity = 1000", 10, false, [&] {
+        push_pop(dynamic_buffer);
+    });
+    ReportTime<std::chrono::microseconds>("dynamic, capacity = 1024", 10, false, [&] {
+        push_pop(dynamic_buffer_pow2);
+    });
+    EXPECT_EQ(static_buffer_pow2.Size(), dynamic_buffer_pow2.Size());
+    std::cout << "checksum: " << sum << std::endl;
+}
@@ -0,0 +1,430 @@
+#include "erl_common/serialization.hpp"
+#include "erl_common/test_helper.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <sstream>
+
+namespace {
+    struct Inner {
+        std::string name;
+
+        [[nodiscard]] bool
+        Write(std::ostream &s) const {
+            using namespace erl::common::serialization;
+            static const TokenWriteFunctionPairs<Inner> token_function_pairs = {
+                {
+                    "name",
+                    [](const Inner *self, std::ostream &stream) {
+                        stream << self->name;
+                        return stream.good();
+                    },
+                },
+            };
+            return WriteTokens(s, this, token_function_pairs);
+        }
+
+        [[nodiscard]] bool
+        Read(std::istream &s) {
+            using namespace erl::common::serialization;
+            static const TokenReadFunctionPairs<Inner> token_function_pairs = {
+                {
+                    "name",
+                    [](Inner *self, std::istream &stream) {
+                        stream >> self->name;
+                        return stream.good() || stream.eof();
+                    },
+                },
+            };
+            return ReadTokens(s, this, token_function_pairs);
+        }
+    };
+
+    struct Outer {
+        Inner inner;
+        std::vector<std::vector<double>> columns;
+
+        [[nodiscard]] static erl::common::serialization::TokenWriteFunctionPairs<Outer>
+        GetWriteFunctions(const std::size_t num_columns) {
+            using namespace erl::common::serialization;
+            TokenWriteFunctionPairs<Outer> token_function_pairs = {
+                {
+                    "inner",
+                    [](const Outer *self, std::ostream &stream) {
+                        return self->inner.Write(stream);
+                    },
+                },
+            };
+            static const char *tokens[] = {"column_0", "column_1", "column_2", "column_3"};
+            for (std::size_t i = 0; i < num_columns; ++i) {
+                token_function_pairs.emplace_back(
+                    tokens[i],
+                    [i](const Outer *self, std::ostream &stream) {
+                        const std::size_t size = self->columns[i].size();
+                        stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
+                        return WriteArray(stream, self->columns[i].data(), size);
+                    });
+            }
+            return token_function_pairs;
+        }
+
+        [[nodiscard]] static erl::common::serialization::TokenReadFunctionPairs<Outer>
+        GetReadFunctions(const std::size_t num_columns) {
+            using namespace erl::common::serialization;
+            TokenReadFunctionPairs<Outer> token_function_pairs = {
+                {
+                    "inner",
+                    [](Outer *self, std::istream &stream) { return self->inner.Read(stream); },
+                },
+            };
+            static const char *tokens[] = {"column_0", "column_1", "column_2", "column_3"};
+            for (std::size_t i = 0; i < num_columns; ++i) {
+                token_function_pairs.emplace_back(
+                    tokens[i],
+                    [i](Outer *self, std::istream &stream) {
+                        std::size_t size;
+                        stream.read(reinterpret_cast<char *>(&size), sizeof(size));
+                        self->columns[i].resize(size);
+                        return ReadArray(stream, self->columns[i].data(), size);
+                    });
+            }
+            return token_function_pairs;
+        }
+
+        [[nodiscard]] bool
+        Write(std::ostream &s, const bool parallel = false) const {
+            return erl::common::serialization::WriteTokens(
+                s,
+                this,
+                GetWriteFunctions(4),
+                parallel);
+        }
+
+        [[nodiscard]] bool
+        Read(std::istream &s, const bool parallel = false) {
+            columns.resize(4);
+            // the columns do not depend on each other, so they can be decoded in parallel
+            return erl::common::serialization::ReadTokens(
+                s,
+                this,
+                GetReadFunctions(4),
+                parallel);
+        }
+
+        [[nodiscard]] bool
+        operator==(const Outer &other) const {
+            return inner.name == other.inner.name && columns == other.columns;
+        }
+    };
+
+    Outer
+    MakeOuter(const std::size_t column_size) {
+        Outer outer;
+        outer.inner.name = "outer";
+        outer.columns.resize(4);
+        for (std::size_t i = 0; i < 4; ++i) {
+            outer.columns[i].resize(column_size);
+            std::iota(outer.columns[i].begin(), outer.columns[i].end(), static_cast<double>(i));
+        }
+        return outer;
+    }
+}  // namespace
+
+TEST(Serialization, TextAndBinaryContainer) {
+    using namespace erl::common::serialization;
+    const Outer outer = MakeOuter(1000);
+
+    for (const Format format: {Format::kText, Format::kAuto, Format::kBinaryContainer}) {
+        ASSERT_TRUE(Serialization<Outer>::Write("outer.bin", &outer, format));
+        Outer outer_read;
+        ASSERT_TRUE(Serialization<Outer>::Read("outer.bin", &outer_read));
+        EXPECT_EQ(outer, outer_read);
+    }
+}
+
+TEST(Serialization, BinaryContainerParallel) {
+    using namespace erl::common::serialization;
+    const Outer outer = MakeOuter(1000);
+
+    for (const bool parallel_encoding: {false, true}) {
+        for (const bool parallel_decoding: {false, true}) {
+            std::stringstream ss;
+            SetFormat(ss, Format::kBinaryContainer);
+            ASSERT_TRUE(outer.Write(ss, parallel_encoding));
+            Outer outer_read;
+            ASSERT_TRUE(outer_read.Read(ss, parallel_decoding));
+            EXPECT_EQ(outer, outer_read);
+        }
+    }
+}
+
+TEST(Serialization, BinaryContainerRandomAccess) {
+    using namespace erl::common::serialization;
+    const Outer outer = MakeOuter(1000);
+
+    std::stringstream ss;
+    ss << "# leading comment\n";
+    SetFormat(ss, Format::kBinaryContainer);
+    ASSERT_TRUE(outer.Write(ss));
+    ss << "trailing";
+    const std::string bytes = ss.str();
+    EXPECT_EQ(bytes.find(BinaryContainer::kMagic, 0, 8) % BinaryContainer::kAlignment, 0);
+
+    // read one section directly
+    std::stringstream in(bytes);
+    SkipLine(in);
+    in >> std::ws;
+    ASSERT_TRUE(BinaryContainerReader::Detect(in));
+    BinaryContainerReader reader;
+    ASSERT_TRUE(reader.Open(in));
+    EXPECT_EQ(reader.GetSections().size(), 5);
+    for (const auto &section: reader.GetSections()) {
+        EXPECT_EQ(section.offset % BinaryContainer::kAlignment, 0);
+    }
+    std::string payload;
+    ASSERT_TRUE(reader.ReadSection("column_2", payload));
+    EXPECT_EQ(payload.size(), sizeof(std::size_t) + 1000 * sizeof(double));
+    double value;
+    std::memcpy(&value, payload.data() + sizeof(std::size_t) + 10 * sizeof(value), sizeof(value));
+    EXPECT_EQ(value, 12.0);
+
+    // the nested object is a container as well
+    ASSERT_TRUE(reader.ReadSection("inner", payload));
+    EXPECT_EQ(payload.compare(0, 8, BinaryContainer::kMagic, 8), 0);
+
+    // sections that are not requested are skipped, the stream ends after the container
+    std::stringstream in2(bytes);
+    Outer partial;
+    partial.columns.resize(4);
+    ASSERT_TRUE(ReadTokens(in2, &partial, Outer::GetReadFunctions(2)));
+    EXPECT_EQ(partial.inner.name, "outer");
+    EXPECT_EQ(partial.columns[1], outer.columns[1]);
+    EXPECT_TRUE(partial.columns[3].empty());
+    std::string rest;
+    in2 >> rest;
+    EXPECT_EQ(rest, "trailing");
+
+    // sizes in the header beyond the end of the stream are rejected before allocating
+    const std::size_t start = bytes.find(BinaryContainer::kMagic, 0, 8);
+    auto corrupt_header = [&](const std::size_t pos, const auto value) {
+        std::string corrupted_header = bytes.substr(start);
+        std::memcpy(corrupted_header.data() + pos, &value, sizeof(value));
+        std::stringstream in3(corrupted_header);
+        BinaryContainerReader reader3;
+        return reader3.Open(in3);
+    };
+    EXPECT_FALSE(corrupt_header(16, std::uint64_t(1) << 40));       // table size
+    EXPECT_FALSE(corrupt_header(12, std::uint32_t(1) << 30));       // number of sections
+    EXPECT_FALSE(corrupt_header(32 + 8, std::uint64_t(1) << 40));   // length of section 0
+    EXPECT_FALSE(corrupt_header(32 + 24, std::uint32_t(1) << 31));  // tag size of section 0
+
+    // corrupted payloads are detected
+    std::string corrupted = bytes;
+    corrupted[corrupted.size() - 100] ^= 0x1;
+    for (const bool parallel: {false, true}) {
+        std::stringstream in3(corrupted);
+        Outer outer_read;
+        EXPECT_FALSE(outer_read.Read(in3, parallel));
+    }
+}
+
+TEST(Serialization, BinaryContainerBenchmark) {
+    using namespace erl::common;
+    using namespace erl::common::serialization;
+    const Outer outer = MakeOuter(4000000);  // 4 x 32 MB
+
+    for (const Format format: {Format::kText, Format::kBinaryContainer}) {
+        const char *name = format == Format::kText ? "text" : "binary container";
+        ReportTime<std::chrono::milliseconds>(fmt::format("{} write", name).c_str(), 3, false, [&] {
+            ASSERT_TRUE(Serialization<Outer>::Write("outer_large.bin", &outer, format));
+        });
+        Outer outer_read;
+        ReportTime<std::chrono::milliseconds>(fmt::format("{} read", name).c_str(), 3, false, [&] {
+            ASSERT_TRUE(Serialization<Outer>::Read("outer_large.bin", &outer_read));
+        });
+        EXPECT_EQ(outer, outer_read);
+    }
+}
+
+namespace {
+    // trivially copyable, but with its own Write / Read in another layout
+    struct TrivialWithMethods {
+        int id = 0;
+        double value = 0.0;
+
+        [[nodiscard]] bool
+        Write(std::ostream &s) const {
+            s << id << ' ' << value << '\n';
+            return s.good();
+        }
+
+        [[nodiscard]] bool
+        Read(std::istream &s) {
+            s >> id >> value;
+            return s.good();
+        }
+    };
+}  // namespace
+
+TEST(Serialization, TriviallyCopyableWithMethods) {
+    using namespace erl::common::serialization;
+    static_assert(kIsBulkSerializable<TrivialWithMethods>);
+
+    // Writer / Reader copied the bytes of such types before the stream overloads were detected,
+    // so data written then must still load
+    const std::vector<TrivialWithMethods> entries = {{1, 0.5}, {2, -1.25}, {3, 1.0e300}};
+    std::string old_bytes(
+        reinterpret_cast<const char *>(entries.data()),
+        entries.size() * sizeof(TrivialWithMethods));
+    std::stringstream old_stream(old_bytes);
+    std::vector<TrivialWithMethods> entries_read(entries.size());
+    for (auto &entry: entries_read) {
+        ASSERT_TRUE(Reader<TrivialWithMethods>::Run(&entry, old_stream));
+    }
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(entries_read[i].id, entries[i].id);
+        EXPECT_EQ(entries_read[i].value, entries[i].value);
+    }
+
+    std::stringstream stream;
+    for (const auto &entry: entries) {
+        ASSERT_TRUE(Writer<TrivialWithMethods>::Run(&entry, stream));
+    }
+    EXPECT_EQ(stream.str(), old_bytes);
+    std::stringstream array_stream;
+    ASSERT_TRUE(WriteArray(array_stream, entries.data(), entries.size()));
+    EXPECT_EQ(array_stream.str(), old_bytes);
+}
+
+namespace {
+    struct SchemaPoint {
+        float x = 0.0f;
+        float y = 0.0f;
+
+        ERL_REFLECT_SCHEMA(
+            SchemaPoint,
+            ERL_REFLECT_MEMBER(SchemaPoint, x),
+            ERL_REFLECT_MEMBER(SchemaPoint, y));
+    };
+
+    struct SchemaTrack {
+        std::string name;
+        int id = 0;
+        std::pair<long, int> range = {0, 0};
+        std::array<double, 3> scale = {1.0, 1.0, 1.0};
+        std::vector<SchemaPoint> points;
+        std::vector<std::string> tags;
+        std::shared_ptr<SchemaPoint> origin;
+        std::unique_ptr<SchemaPoint> target;
+
+        ERL_REFLECT_SCHEMA(
+            SchemaTrack,
+            ERL_REFLECT_MEMBER(SchemaTrack, name),
+            ERL_REFLECT_MEMBER(SchemaTrack, id),
+            ERL_REFLECT_MEMBER(SchemaTrack, range),
+            ERL_REFLECT_MEMBER(SchemaTrack, scale),
+            ERL_REFLECT_MEMBER(SchemaTrack, points),
+            ERL_REFLECT_MEMBER(SchemaTrack, tags),
+            ERL_REFLECT_MEMBER(SchemaTrack, origin),
+            ERL_REFLECT_MEMBER(SchemaTrack, target));
+    };
+
+    struct SchemaTrackRenamed {
+        std::string label;
+        int id = 0;
+
+        ERL_REFLECT_SCHEMA(
+            SchemaTrackRenamed,
+            ERL_REFLECT_MEMBER(SchemaTrackRenamed, label),
+            ERL_REFLECT_MEMBER(SchemaTrackRenamed, id));
+    };
+
+    struct SchemaTrackSet {
+        std::vector<SchemaTrack> tracks;
+
+        ERL_REFLECT_SCHEMA(SchemaTrackSet, ERL_REFLECT_MEMBER(SchemaTrackSet, tracks));
+    };
+
+    struct SchemaTrackRenamedSet {
+        std::vector<SchemaTrackRenamed> tracks;
+
+        ERL_REFLECT_SCHEMA(
+            SchemaTrackRenamedSet,
+            ERL_REFLECT_MEMBER(SchemaTrackRenamedSet, tracks));
+    };
+}  // namespace
+
+TEST(Serialization, SchemaBinary) {
+    using namespace erl::common::serialization;
+    static_assert(kHasSerializableSchema<SchemaTrack>);
+    static_assert(kIsBulkSerializable<SchemaPoint>);
+    static_assert(!kIsBulkSerializable<SchemaTrack>);
+
+    SchemaTrack track;
+    track.name = "track";
+    track.id = 7;
+    track.range = {-3, 5};
+    track.scale = {0.5, 2.0, 4.0};
+    track.points = {{1.0f, 2.0f}, {3.0f, 4.0f}};
+    track.tags = {"a", "", "long tag"};
+    track.origin = std::make_shared<SchemaPoint>(SchemaPoint{5.0f, 6.0f});
+
+    std::stringstream stream;
+    ASSERT_TRUE(WriteSchema(stream, track));
+    SchemaTrack track_read;
+    track_read.target = std::make_unique<SchemaPoint>();  // reset by the null pointer
+    ASSERT_TRUE(ReadSchema(stream, track_read));
+    EXPECT_EQ(track_read.name, track.name);
+    EXPECT_EQ(track_read.id, track.id);
+    EXPECT_EQ(track_read.range, track.range);
+    EXPECT_EQ(track_read.scale, track.scale);
+    ASSERT_EQ(track_read.points.size(), track.points.size());
+    for (std::size_t i = 0; i < track.points.size(); ++i) {
+        EXPECT_EQ(track_read.points[i].x, track.points[i].x);
+        EXPECT_EQ(track_read.points[i].y, track.points[i].y);
+    }
+    EXPECT_EQ(track_read.tags, track.tags);
+    ASSERT_NE(track_read.origin, nullptr);
+    EXPECT_EQ(track_read.origin->x, 5.0f);
+    EXPECT_EQ(track_read.origin->y, 6.0f);
+    EXPECT_EQ(track_read.target, nullptr);
+
+    // Writer / Reader, e.g. used by WriteArray, go through the schema without a header
+    std::stringstream array_stream;
+    const std::vector<SchemaTrack> tracks(3);
+    ASSERT_TRUE(WriteArray(array_stream, tracks.data(), tracks.size()));
+    std::vector<SchemaTrack> tracks_read(3);
+    ASSERT_TRUE(ReadArray(array_stream, tracks_read.data(), tracks_read.size()));
+
+    // data written with other members is rejected
+    stream.clear();
+    stream.seekg(0);
+    SchemaTrackRenamed renamed;
+    EXPECT_FALSE(ReadSchema(stream, renamed));
+}
+
+TEST(Serialization, SchemaBinaryNestedAndCorrupt) {
+    using namespace erl::common::serialization;
+
+    // members of nested schema types are part of the hash
+    EXPECT_NE(GetSchemaHash<SchemaTrackSet>(), GetSchemaHash<SchemaTrackRenamedSet>());
+    SchemaTrackSet set;
+    set.tracks.resize(2);
+    std::stringstream set_stream;
+    ASSERT_TRUE(WriteSchema(set_stream, set));
+    SchemaTrackRenamedSet renamed_set;
+    EXPECT_FALSE(ReadSchema(set_stream, renamed_set));
+
+    // a corrupt length fails at the end of the data instead of allocating it
+    SchemaTrack track;
+    track.name = "track";
+    std::stringstream stream;
+    ASSERT_TRUE(WriteSchema(stream, track));
+    std::string data = stream.str();
+    constexpr std::size_t kNameOffset = sizeof(kSchemaMagic) - 1 + 4 + 8;  // after the header
+    constexpr std::uint64_t kHugeSize = 1ull << 60;
+    std::memcpy(data.data() + kNameOffset, &kHugeSize, sizeof(kHugeSize));
+    std::stringstream corrupt_stream(data);
+    SchemaTrack track_read;
+    EXPECT_FALSE(ReadSchema(corrupt_stream, track_read));
+}
@@ -0,0 +1,61 @@
+#include "erl_common/slot_map.hpp"
+#include "erl_common/test_helper.hpp"
+
+TEST(SlotMap, Basic) {
+    using namespace erl::common;
+    using Map = SlotMap<int>;
+    Map map;
+
+    std::vector<Map::Handle> handles;
+    for (int i = 0; i < 200; ++i) { handles.push_back(map.Insert(i)); }
+    EXPECT_EQ(map.Size(), 200);
+    for (int i = 0; i < 200; ++i) { EXPECT_EQ(map[handles[i]], i); }
+
+    // remove every entry except multiples of 7
+    for (int i = 0; i < 200; ++i) {
+        if (i % 7 != 0) { EXPECT_TRUE(map.Remove(handles[i])); }
+    }
+    EXPECT_EQ(map.Size(), 29);
+    EXPECT_FALSE(map.Contains(handles[1]));
+    EXPECT_EQ(map.Get(handles[1]), nullptr);
+
+    int expected = 0;
+    for (auto itr = map.begin(); itr != map.end(); ++itr, expected += 7) {
+        EXPECT_EQ(*itr, expected);
+        EXPECT_EQ(itr.GetHandle(), handles[expected]);
+    }
+    EXPECT_EQ(expected, 203);
+
+    // the slot is reused, the old handle stays stale
+    const Map::Handle handle = map.Insert(-1);
+    EXPECT_EQ(handle.index, handles[199].index);
+    EXPECT_NE(handle.generation, handles[199].generation);
+    EXPECT_FALSE(map.Contains(handles[199]));
+    EXPECT_EQ(map[handle], -1);
+#ifndef NDEBUG
+    EXPECT_THROW((void) map[handles[199]], std::runtime_error);
+#endif
+}
+
+TEST(SlotMap, Compact) {
+    using namespace erl::common;
+    using Map = SlotMap<int>;
+    Map map;
+
+    std::vector<Map::Handle> handles;
+    for (int i = 0; i < 100; ++i) { handles.push_back(map.Insert(i)); }
+    for (int i = 0; i < 100; i += 2) { map.Remove(handles[i]); }
+    const std::vector<std::size_t> index_mapping = map.Compact();
+    EXPECT_EQ(map.Size(), 50);
+    EXPECT_EQ(map.Capacity(), 50);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_FALSE(map.Contains(handles[i]));  // all handles are stale after compaction
+        if (i % 2 == 0) {
+            EXPECT_EQ(index_mapping[i], Map::kInvalidIndex);
+            continue;
+        }
+        EXPECT_EQ(index_mapping[i], i / 2);
+        EXPECT_EQ(map[map.HandleAt(index_mapping[i])], i);
+    }
+    EXPECT_EQ(map.Insert(100).index, 50);
+}
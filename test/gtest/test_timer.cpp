@@ -0,0 +1,205 @@
+#include "erl_common/test_helper.hpp"
+#include "erl_common/timer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(Scheduler, OneShot) {
+    using namespace erl::common;
+    Scheduler scheduler({1, std::chrono::microseconds(200)});  // spins the last 200 us
+    std::atomic<int> fired = 0;
+    auto handle = scheduler.ScheduleAfter(20ms, [&] { ++fired; });
+    EXPECT_TRUE(handle.IsActive());
+    auto cancelled = scheduler.ScheduleAfter(20ms, [&] { fired += 100; });
+    EXPECT_TRUE(cancelled.Cancel());
+    std::this_thread::sleep_for(100ms);
+    EXPECT_EQ(fired, 1);
+    EXPECT_FALSE(handle.IsActive());
+    EXPECT_EQ(handle.GetNumRuns(), 1);
+    EXPECT_FALSE(cancelled.Cancel());
+    EXPECT_EQ(scheduler.GetNumPending(), 0);
+}
+
+TEST(Scheduler, Periodic) {
+    using namespace erl::common;
+    Scheduler scheduler;
+    std::atomic<int> count_100hz = 0;
+    std::atomic<int> count_500hz = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    auto handle_100hz = scheduler.SchedulePeriodic(10ms, [&] { ++count_100hz; });
+    auto handle_500hz = scheduler.SchedulePeriodic(2ms, [&] { ++count_500hz; });
+    std::this_thread::sleep_until(t0 + 1005ms);
+    handle_100hz.Cancel();
+    handle_500hz.Cancel();
+    const int n_100hz = count_100hz;
+    const int n_500hz = count_500hz;
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(count_100hz, n_100hz);  // nothing runs after Cancel
+    EXPECT_EQ(count_500hz, n_500hz);
+
+    // the deadlines do not drift with the lateness of the runs
+    const std::uint64_t runs_500hz = handle_500hz.GetNumRuns() + handle_500hz.GetNumMissed();
+    EXPECT_NEAR(handle_100hz.GetNumRuns() + handle_100hz.GetNumMissed(), 100, 2);
+    EXPECT_NEAR(runs_500hz, 500, 2);
+    const RunningStatistics jitter = handle_500hz.GetJitter();
+    std::cout << "500 Hz jitter: mean " << jitter.GetMean() << " us, std " << jitter.GetStd()
+              << " us, max " << jitter.max << " us, missed " << handle_500hz.GetNumMissed()
+              << std::endl
+              << "jitter: " << scheduler.GetJitterHistogram().ToString() << std::endl;
+    EXPECT_EQ(scheduler.GetJitterHistogram().GetCount(), n_100hz + n_500hz);
+}
+
+TEST(Scheduler, SkipMissedRuns) {
+    using namespace erl::common;
+    Scheduler scheduler;
+    std::atomic<int> count = 0;
+    auto handle = scheduler.SchedulePeriodic(5ms, [&] {
+        if (count++ == 0) { std::this_thread::sleep_for(28ms); }
+    });
+    std::this_thread::sleep_for(60ms);
+    handle.Cancel();
+    // the first run overruns the next 5 deadlines, they are skipped instead of run back to back
+    EXPECT_GE(handle.GetNumMissed(), 4);
+    EXPECT_NEAR(handle.GetNumRuns() + handle.GetNumMissed(), 12, 2);
+}
+
+TEST(Scheduler, CancelWaitsForRun) {
+    using namespace erl::common;
+    Scheduler scheduler({2});
+    std::atomic<bool> started = false;
+    std::atomic<bool> finished = false;
+    auto handle = scheduler.ScheduleAfter(0ms, [&] {
+        started = true;
+        std::this_thread::sleep_for(50ms);
+        finished = true;
+    });
+    while (!started) { std::this_thread::yield(); }
+    handle.Cancel();
+    EXPECT_TRUE(finished);
+
+    // Cancel from the callback itself does not wait for itself
+    Scheduler::Handle self;
+    std::atomic<int> count = 0;
+    std::mutex mutex;
+    {
+        const std::scoped_lock lock(mutex);
+        self = scheduler.SchedulePeriodic(1ms, [&] {
+            const std::scoped_lock lock_self(mutex);
+            if (++count == 3) { self.Cancel(); }
+        });
+    }
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(count, 3);
+    EXPECT_FALSE(self.IsActive());
+}
+
+TEST(Scheduler, ManyTasks) {
+    using namespace erl::common;
+    Scheduler scheduler({2});
+    constexpr int kNumTasks = 50;
+    std::vector<std::atomic<int>> counts(kNumTasks);
+    std::vector<Scheduler::Handle> handles;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumTasks; ++i) {
+        const auto period = std::chrono::milliseconds(1 + i % 10);  // 100 - 1000 Hz
+        handles.push_back(scheduler.SchedulePeriodic(period, [&counts, i] { ++counts[i]; }));
+    }
+    std::this_thread::sleep_until(t0 + 500ms);
+    for (auto &handle: handles) { handle.Cancel(); }
+    for (int i = 0; i < kNumTasks; ++i) {
+        const double expected = 500.0 / (1 + i % 10);
+        const auto runs = static_cast<double>(handles[i].GetNumRuns() + handles[i].GetNumMissed());
+        EXPECT_NEAR(runs, expected, 2) << "task " << i;
+    }
+    std::cout << "jitter: " << scheduler.GetJitterHistogram().ToString() << std::endl;
+}
+
+TEST(Scheduler, CancelReleasesTask) {
+    using namespace erl::common;
+    Scheduler scheduler;
+    auto capture = std::make_shared<int>(0);
+    auto handle = scheduler.ScheduleAfter(1h, [capture] { ++*capture; });
+    EXPECT_EQ(scheduler.GetNumPending(), 1);
+    EXPECT_EQ(capture.use_count(), 2);
+    EXPECT_TRUE(handle.Cancel());
+    EXPECT_EQ(scheduler.GetNumPending(), 0);
+    EXPECT_EQ(capture.use_count(), 1);  // the captures are released by Cancel
+
+    // the worker waiting for the deadline of a cancelled task moves on to the next one
+    std::atomic<int> fired = 0;
+    auto first = scheduler.ScheduleAfter(200ms, [&] { fired += 100; });
+    auto second = scheduler.ScheduleAfter(20ms, [&] { ++fired; });
+    EXPECT_TRUE(first.Cancel());
+    std::this_thread::sleep_for(100ms);
+    EXPECT_EQ(fired, 1);
+}
+
+TEST(Scheduler, StopFromCallback) {
+    using namespace erl::common;
+    Scheduler scheduler({2, Scheduler::Clock::duration::zero()});
+    std::atomic<bool> stopped = false;
+    auto handle = scheduler.ScheduleAfter(10ms, [&] {
+        scheduler.Stop();  // returns without joining any worker
+        stopped = true;
+    });
+    std::this_thread::sleep_for(100ms);
+    EXPECT_TRUE(stopped);
+    EXPECT_FALSE(scheduler.ScheduleAfter(1ms, [] {}).IsActive());
+}
+
+TEST(Scheduler, StopWaitsForRunningCallbacks) {
+    using namespace erl::common;
+    std::atomic<bool> finished = false;
+    {
+        Scheduler scheduler;
+        std::atomic<bool> started = false;
+        scheduler.ScheduleAfter(1ms, [&] {
+            scheduler.Stop();
+            started = true;
+            std::this_thread::sleep_for(50ms);
+            finished = true;
+        });
+        while (!started) { std::this_thread::yield(); }
+    }  // the destructor joins the worker that stopped the scheduler
+    EXPECT_TRUE(finished);
+
+    // a second Stop from another thread also waits instead of returning at once
+    finished = false;
+    Scheduler scheduler;
+    std::atomic<bool> started = false;
+    scheduler.ScheduleAfter(1ms, [&] {
+        started = true;
+        std::this_thread::sleep_for(50ms);
+        finished = true;
+    });
+    while (!started) { std::this_thread::yield(); }
+    std::thread other([&] { scheduler.Stop(); });
+    scheduler.Stop();
+    EXPECT_TRUE(finished);
+    other.join();
+}
+
+TEST(Timer, StartStop) {
+    using namespace erl::common;
+    std::atomic<int> fired = 0;
+    Timer timer;
+    timer.Start(20, [&] { ++fired; });
+    EXPECT_TRUE(timer.IsActive());
+    std::this_thread::sleep_for(60ms);
+    EXPECT_FALSE(timer.IsActive());
+    EXPECT_TRUE(timer.IsTriggered());
+    EXPECT_EQ(fired, 1);
+
+    timer.Start(20, [&] { ++fired; });
+    EXPECT_FALSE(timer.IsTriggered());
+    timer.Stop();
+    std::this_thread::sleep_for(40ms);
+    EXPECT_FALSE(timer.IsActive());
+    EXPECT_FALSE(timer.IsTriggered());
+    EXPECT_EQ(fired, 1);
+}
@@ -2,7 +2,10 @@
 #include "erl_common/test_helper.hpp"
 #include "erl_common/yaml.hpp"
 
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <sstream>
 
 enum class Color {
     kRed = 0,
@@ -224,3 +227,109 @@ color: blue
     ASSERT_EQ(setting.sub_setting_shared->d, 10);  // from sub_setting_base.yaml
     ASSERT_EQ(setting.color, Color::kBlue);        // overridden
 }
+
+struct LargeSetting : erl::common::Yamlable<LargeSetting, Setting> {
+    std::string name = "large";
+    Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(4, 3);
+    std::vector<double> values;
+    std::vector<SubSetting> sub_settings;
+
+    ERL_REFLECT_SCHEMA(
+        LargeSetting,
+        ERL_REFLECT_MEMBER(LargeSetting, name),
+        ERL_REFLECT_MEMBER(LargeSetting, matrix),
+        ERL_REFLECT_MEMBER(LargeSetting, values),
+        ERL_REFLECT_MEMBER(LargeSetting, sub_settings));
+};
+
+struct MapSetting : erl::common::Yamlable<MapSetting> {
+    std::map<std::string, int> table = {{"a", 1}};
+
+    ERL_REFLECT_SCHEMA(MapSetting, ERL_REFLECT_MEMBER(MapSetting, table));
+};
+
+TEST(YamlTest, WriteReadBinary) {
+    using namespace erl::common;
+
+    LargeSetting setting;
+    setting.a = 5;
+    setting.b = -1.5;
+    setting.sub_setting.c = 3;
+    setting.sub_setting_shared->d = 4;
+    setting.vec_float = {1.0f, 2.0f};
+    setting.p = {-1, 2};
+    setting.color = Color::kBlue;
+    setting.matrix.setRandom();
+    setting.values = {0.1, 0.2, 0.3};
+    setting.sub_settings.resize(2);
+    setting.sub_settings[1].c = 9;
+
+    std::stringstream stream;
+    serialization::SetFormat(stream, serialization::Format::kBinarySchema);
+    ASSERT_TRUE(setting.Write(stream));
+    EXPECT_TRUE(serialization::IsSchemaMagic(stream.str().data()));
+    LargeSetting setting_read;
+    ASSERT_TRUE(setting_read.Read(stream));
+    EXPECT_EQ(setting_read.AsYamlString(), setting.AsYamlString());
+
+    // without the opt-in, the YAML layout read by older versions is written
+    std::stringstream yaml_stream;
+    ASSERT_TRUE(setting.Write(yaml_stream));
+    const std::string yaml_str = setting.AsYamlString() + "\n";
+    const auto len = static_cast<std::streamsize>(yaml_str.size());
+    std::string expected(reinterpret_cast<const char *>(&len), sizeof(len));
+    EXPECT_EQ(yaml_stream.str(), expected + yaml_str);
+    LargeSetting setting_from_yaml;
+    ASSERT_TRUE(setting_from_yaml.Read(yaml_stream));
+    EXPECT_EQ(setting_from_yaml.AsYamlString(), setting.AsYamlString());
+
+    // a corrupt length fails without allocating it
+    std::string corrupt = yaml_stream.str();
+    constexpr std::streamsize kHugeLen = std::streamsize(1) << 60;
+    std::memcpy(corrupt.data(), &kHugeLen, sizeof(kHugeLen));
+    std::stringstream corrupt_stream(corrupt);
+    EXPECT_FALSE(setting_from_yaml.Read(corrupt_stream));
+
+    // members without a binary layout fall back to YAML
+    MapSetting map_setting;
+    map_setting.table["b"] = 2;
+    std::stringstream map_stream;
+    serialization::SetFormat(map_stream, serialization::Format::kBinarySchema);
+    ASSERT_TRUE(map_setting.Write(map_stream));
+    EXPECT_FALSE(serialization::IsSchemaMagic(map_stream.str().data()));
+    MapSetting map_setting_read;
+    ASSERT_TRUE(map_setting_read.Read(map_stream));
+    EXPECT_EQ(map_setting_read.table, map_setting.table);
+
+    // a binary layout of another type is rejected
+    stream.clear();
+    stream.seekg(0);
+    Setting other;
+    EXPECT_FALSE(other.Read(stream));
+}
+
+TEST(YamlTest, WriteReadBinaryBenchmark) {
+    using namespace erl::common;
+
+    LargeSetting setting;
+    setting.matrix.setRandom(20, 20);
+    setting.values.assign(1000, 0.5);
+    setting.sub_settings.resize(50);
+    constexpr int kRepeats = 50;
+
+    LargeSetting setting_read;
+    ReportTime<std::chrono::milliseconds>("yaml string", 1, false, [&] {
+        for (int i = 0; i < kRepeats; ++i) {
+            ASSERT_TRUE(setting_read.FromYamlString(setting.AsYamlString()));
+        }
+    });
+    ReportTime<std::chrono::milliseconds>("schema binary", 1, false, [&] {
+        for (int i = 0; i < kRepeats; ++i) {
+            std::stringstream stream;
+            serialization::SetFormat(stream, serialization::Format::kBinarySchema);
+            ASSERT_TRUE(setting.Write(stream));
+            ASSERT_TRUE(setting_read.Read(stream));
+        }
+    });
+    EXPECT_EQ(setting_read.values, setting.values);
+}
@@ -0,0 +1,63 @@
+import os
+import tempfile
+import unittest
+
+import numpy as np
+from erl_common.pyerl_common import ColumnarLog, ColumnarLogReader, ColumnarLogWriter
+
+
+class TestColumnarLog(unittest.TestCase):
+    def setUp(self):
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmp_dir.name, "log.bin")
+
+    def tearDown(self):
+        self.tmp_dir.cleanup()
+
+    def write_log(self, num_rows, row_group_size):
+        writer = ColumnarLogWriter(row_group_size=row_group_size)
+        columns = [
+            ColumnarLog.Column("step", ColumnarLog.Type.kInt64, ColumnarLog.Encoding.kDelta),
+            ColumnarLog.Column("x", ColumnarLog.Type.kFloat64, ColumnarLog.Encoding.kPlain),
+        ]
+        self.assertTrue(writer.open(self.path, columns))
+        rows = np.stack([np.arange(num_rows), np.sin(np.arange(num_rows))], axis=1)
+        writer.append_rows(rows)
+        writer.close()
+        reader = ColumnarLogReader()
+        self.assertTrue(reader.open(self.path))
+        return reader, rows
+
+    def test_single_row_group_is_viewed(self):
+        reader, rows = self.write_log(100, 1000)
+        self.assertEqual(len(reader.row_groups), 1)
+        x = reader.read_column("x")
+        self.assertFalse(x.flags.writeable)
+        np.testing.assert_array_equal(x, rows[:, 1])
+        # the view keeps the mapping alive after the reader is gone
+        del reader
+        np.testing.assert_array_equal(x, rows[:, 1])
+
+    def test_repeated_row_group_is_concatenated(self):
+        reader, rows = self.write_log(100, 1000)
+        x = reader.read_column("x", [0, 0])
+        self.assertEqual(x.shape, (200,))
+        np.testing.assert_array_equal(x, np.concatenate([rows[:, 1], rows[:, 1]]))
+
+    def test_several_row_groups(self):
+        reader, rows = self.write_log(250, 100)
+        self.assertEqual(len(reader.row_groups), 3)
+        np.testing.assert_array_equal(reader.read_column("x"), rows[:, 1])
+        np.testing.assert_array_equal(reader.read_column("x", [2]), rows[200:, 1])
+        np.testing.assert_array_equal(reader.read_column("step", [1]), np.arange(100, 200))
+
+    def test_out_of_range_row_group(self):
+        reader, _ = self.write_log(100, 1000)
+        with self.assertRaises(IndexError):
+            reader.read_column("x", [99])
+        with self.assertRaises(IndexError):
+            reader.read_column("step", [0, 1])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,47 @@
+#include "erl_common/binary_log.hpp"
+
+#include <cstring>
+#include <iostream>
+
+/**
+ * Print the records of a binary log written by erl::common::BinaryLog as text, from the oldest to
+ * the newest.
+ */
+int
+main(int argc, char **argv) {
+    using namespace erl::common;
+    bool print_formats = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--formats") == 0) {
+            print_formats = true;
+        } else if (path == nullptr) {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--formats] <binary log>" << std::endl;
+        return 1;
+    }
+
+    BinaryLogReader reader;
+    if (!reader.Open(path)) { return 1; }
+    if (print_formats) {
+        for (const BinaryLog::Format &format: reader.GetFormats()) {
+            std::cout << format.id << ": " << format.file << ':' << format.line << ": "
+                      << format.format << std::endl;
+        }
+        return 0;
+    }
+    for (const BinaryLogReader::Record &record: reader.GetRecords()) {
+        std::cout << reader.ToString(record) << '\n';
+    }
+    std::cout.flush();
+    if (reader.GetNumDroppedRecords() > 0) {
+        std::cerr << reader.GetNumDroppedRecords() << " records were dropped." << std::endl;
+    }
+    return 0;
+}